@@ -0,0 +1,219 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//===- arena_allocator_test.cc ----------------------------------*- C++ -*-===//
+//
+// Unit test for TFRT ArenaAllocator.
+//
+//===----------------------------------------------------------------------===//
+
+#include "tfrt/host_context/arena_allocator.h"
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "tfrt/host_context/async_value_ref.h"
+#include "tfrt/host_context/concurrent_work_queue.h"
+#include "tfrt/host_context/diagnostic.h"
+#include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/host_allocator.h"
+#include "tfrt/host_context/host_context.h"
+
+namespace tfrt {
+namespace {
+
+// A HostAllocator that counts the live allocations of the wrapped allocator.
+class CountingAllocator : public HostAllocator {
+ public:
+  void* AllocateBytes(size_t size, size_t alignment) override {
+    if (exhausted_.load()) return nullptr;
+    ++num_allocations_;
+    return allocator_->AllocateBytes(size, alignment);
+  }
+
+  void DeallocateBytes(void* ptr, size_t size) override {
+    --num_allocations_;
+    allocator_->DeallocateBytes(ptr, size);
+  }
+
+  int num_allocations() const { return num_allocations_.load(); }
+
+  // Makes further allocations fail.
+  void set_exhausted(bool exhausted) { exhausted_.store(exhausted); }
+
+ private:
+  std::unique_ptr<HostAllocator> allocator_ = CreateMallocAllocator();
+  std::atomic<int> num_allocations_{0};
+  std::atomic<bool> exhausted_{false};
+};
+
+TEST(ArenaAllocatorTest, AllocationsAreAlignedAndOwned) {
+  CountingAllocator fallback;
+  auto arena = TakeRef(new ArenaAllocator(&fallback));
+
+  for (size_t alignment : {1, 8, 16, 64, 256}) {
+    void* ptr = arena->AllocateBytes(24, alignment);
+    ASSERT_NE(ptr, nullptr);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(ptr) % alignment, 0);
+    EXPECT_EQ(ArenaAllocator::FromPointer(ptr), arena.get());
+    arena->DeallocateBytes(ptr, 24);
+  }
+}
+
+TEST(ArenaAllocatorTest, LargeAllocationsUseFallback) {
+  CountingAllocator fallback;
+  auto arena = TakeRef(new ArenaAllocator(&fallback));
+  int num_blocks = fallback.num_allocations();
+
+  const size_t size = ArenaAllocator::kMaxAllocationSize + 1;
+  EXPECT_EQ(arena->TryAllocateBytes(size, 8), nullptr);
+
+  void* ptr = arena->AllocateBytes(size, 8);
+  EXPECT_EQ(fallback.num_allocations(), num_blocks + 1);
+  arena->DeallocateBytes(ptr, size);
+  EXPECT_EQ(fallback.num_allocations(), num_blocks);
+}
+
+TEST(ArenaAllocatorTest, BlocksAreFreedAfterLastAllocation) {
+  CountingAllocator fallback;
+  auto arena = TakeRef(new ArenaAllocator(&fallback));
+
+  // Allocate enough to span several blocks.
+  std::vector<void*> ptrs;
+  for (int i = 0; i < 100; ++i) ptrs.push_back(arena->AllocateBytes(2048, 8));
+  EXPECT_GT(fallback.num_allocations(), 1);
+
+  // Allocations keep the arena alive after the owner drops its reference.
+  arena.reset();
+  EXPECT_GT(fallback.num_allocations(), 0);
+
+  ArenaAllocator* owner = ArenaAllocator::FromPointer(ptrs.front());
+  for (void* ptr : ptrs) owner->DeallocateBytes(ptr, 2048);
+  EXPECT_EQ(fallback.num_allocations(), 0);
+}
+
+TEST(ArenaAllocatorTest, ConcurrentAllocations) {
+  CountingAllocator fallback;
+  auto arena = TakeRef(new ArenaAllocator(&fallback));
+
+  const int kNumThreads = 4;
+  const int kNumAllocations = 10000;
+  std::vector<std::thread> threads;
+  std::vector<std::vector<int64_t*>> ptrs(kNumThreads);
+  for (int t = 0; t < kNumThreads; ++t) {
+    threads.emplace_back([&, t] {
+      for (int i = 0; i < kNumAllocations; ++i) {
+        auto* ptr = arena->Allocate<int64_t>();
+        *ptr = t * kNumAllocations + i;
+        ptrs[t].push_back(ptr);
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+
+  // No two allocations overlap.
+  for (int t = 0; t < kNumThreads; ++t) {
+    for (int i = 0; i < kNumAllocations; ++i) {
+      EXPECT_EQ(*ptrs[t][i], t * kNumAllocations + i);
+      arena->Deallocate(ptrs[t][i]);
+    }
+  }
+
+  arena.reset();
+  EXPECT_EQ(fallback.num_allocations(), 0);
+}
+
+TEST(ArenaAllocatorTest, RequestScopedAsyncValues) {
+  auto allocator = std::make_unique<CountingAllocator>();
+  CountingAllocator* fallback = allocator.get();
+  auto host = std::make_unique<HostContext>(
+      [](const DecodedDiagnostic&) {}, std::move(allocator),
+      CreateMultiThreadedWorkQueue(/*num_threads=*/1,
+                                   /*num_blocking_threads=*/1));
+  int num_host_allocations = fallback->num_allocations();
+
+  auto req_ctx =
+      RequestContext::Create(host.get(), /*resource_context=*/nullptr,
+                             /*use_arena_allocator=*/true);
+  ArenaAllocator* arena = req_ctx->arena_allocator();
+  ASSERT_NE(arena, nullptr);
+
+  AsyncValueRef<int> escaping;
+  {
+    ScopedArenaAllocation arena_scope(arena);
+    auto value = host->MakeConstructedAsyncValueRef<int>(42);
+    escaping = host->MakeUnconstructedAsyncValueRef<int>();
+    EXPECT_EQ(ArenaAllocator::FromPointer(value.GetAsyncValue()), arena);
+    EXPECT_EQ(ArenaAllocator::FromPointer(escaping.GetAsyncValue()), arena);
+
+    int result = 0;
+    value.AndThen([&] { result = value.get(); });
+    value.SetStateConcrete();
+    EXPECT_EQ(result, 42);
+  }
+
+  // Outside of the scope, values are allocated from the HostContext.
+  auto host_value = host->MakeAvailableAsyncValueRef<int>(1);
+  EXPECT_EQ(fallback->num_allocations(), num_host_allocations + 2);
+  host_value.reset();
+
+  // The escaping value keeps the arena alive after the request is done.
+  req_ctx.reset();
+  EXPECT_GT(fallback->num_allocations(), num_host_allocations);
+
+  escaping.emplace(7);
+  EXPECT_EQ(escaping.get(), 7);
+  escaping.reset();
+  EXPECT_EQ(fallback->num_allocations(), num_host_allocations);
+}
+
+TEST(ArenaAllocatorTest, WaitersFallBackWhenArenaIsExhausted) {
+  auto host = std::make_unique<HostContext>(
+      [](const DecodedDiagnostic&) {}, CreateMallocAllocator(),
+      CreateMultiThreadedWorkQueue(/*num_threads=*/1,
+                                   /*num_blocking_threads=*/1));
+  CountingAllocator fallback;
+  auto arena = TakeRef(new ArenaAllocator(&fallback));
+
+  AsyncValueRef<int> value;
+  {
+    ScopedArenaAllocation arena_scope(arena.get());
+    value = host->MakeUnconstructedAsyncValueRef<int>();
+  }
+  ASSERT_EQ(ArenaAllocator::FromPointer(value.GetAsyncValue()), arena.get());
+
+  // Fill the current block, and fail to allocate a new one.
+  fallback.set_exhausted(true);
+  std::vector<void*> ptrs;
+  while (void* ptr = arena->TryAllocateBytes(64, 8)) ptrs.push_back(ptr);
+
+  // The waiter node is allocated from the HostContext instead.
+  int result = 0;
+  value.AndThen([&] { result = value.get(); });
+  value.emplace(42);
+  EXPECT_EQ(result, 42);
+
+  value.reset();
+  for (void* ptr : ptrs) arena->DeallocateBytes(ptr, 64);
+  arena.reset();
+  EXPECT_EQ(fallback.num_allocations(), 0);
+}
+
+}  // namespace
+}  // namespace tfrt
@@ -0,0 +1,79 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//===- host_allocator_benchmark.cc ------------------------------*- C++ -*-===//
+//
+// Benchmark comparing HostAllocator implementations under concurrent
+// allocations of small runtime objects.
+//
+//===----------------------------------------------------------------------===//
+
+#include <array>
+#include <cstddef>
+
+#include "benchmark/benchmark.h"
+#include "tfrt/host_context/host_allocator.h"
+
+namespace tfrt {
+namespace {
+
+// Sizes of the small objects the runtime allocates most, e.g. AsyncValues of
+// various payloads, waiter nodes and BEFExecutors.
+constexpr std::array<size_t, 8> kObjectSizes = {16, 24, 48, 48,
+                                                64, 80, 120, 480};
+
+// Allocate a batch of objects and free them in allocation order, which is the
+// typical lifetime pattern of the values produced while running a function.
+void RunAllocations(benchmark::State& state, HostAllocator* allocator) {
+  constexpr int kBatchSize = 64;
+  std::array<void*, kBatchSize> ptrs;
+  for (auto _ : state) {
+    for (int i = 0; i < kBatchSize; ++i) {
+      size_t size = kObjectSizes[i % kObjectSizes.size()];
+      ptrs[i] = allocator->AllocateBytes(size, alignof(std::max_align_t));
+      benchmark::DoNotOptimize(ptrs[i]);
+    }
+    for (int i = 0; i < kBatchSize; ++i) {
+      size_t size = kObjectSizes[i % kObjectSizes.size()];
+      allocator->DeallocateBytes(ptrs[i], size);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kBatchSize);
+}
+
+HostAllocator* GetMallocAllocator() {
+  static HostAllocator* allocator = CreateMallocAllocator().release();
+  return allocator;
+}
+
+HostAllocator* GetSizeClassAllocator() {
+  static HostAllocator* allocator =
+      CreateSizeClassAllocator(CreateMallocAllocator()).release();
+  return allocator;
+}
+
+void BM_MallocAllocator(benchmark::State& state) {
+  RunAllocations(state, GetMallocAllocator());
+}
+BENCHMARK(BM_MallocAllocator)->ThreadRange(1, 16)->UseRealTime();
+
+void BM_SizeClassAllocator(benchmark::State& state) {
+  RunAllocations(state, GetSizeClassAllocator());
+}
+BENCHMARK(BM_SizeClassAllocator)->ThreadRange(1, 16)->UseRealTime();
+
+}  // namespace
+}  // namespace tfrt
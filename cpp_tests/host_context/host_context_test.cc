@@ -22,8 +22,10 @@
 
 #include "tfrt/host_context/host_context.h"
 
+#include <atomic>
 #include <set>
 #include <thread>
+#include <vector>
 
 #include "gtest/gtest.h"
 #include "tfrt/host_context/concurrent_work_queue.h"
@@ -32,6 +34,7 @@
 #include "tfrt/host_context/host_context.h"
 #include "tfrt/support/latch.h"
 #include "tfrt/support/mutex.h"
+#include "tfrt/tracing/tracing.h"
 
 namespace tfrt {
 namespace {
@@ -83,5 +86,83 @@ TEST(HostContextTest, RunBlockingWorkWithResult) {
   ASSERT_EQ(result.get(), 42);
 }
 
+TEST(HostContextTest, EnqueuedWorkInheritsPriority) {
+  auto host = CreateTestHostContext(2);
+
+  latch done(3);
+  std::atomic<int> num_high_priority{0};
+  auto check_priority = [&] {
+    if (ScopedTaskPriority::GetCurrent() == TaskPriority::kHigh)
+      ++num_high_priority;
+    done.count_down();
+  };
+
+  host->EnqueueWork(TaskPriority::kHigh, [&] {
+    check_priority();
+    // Work enqueued without an explicit priority inherits it.
+    host->EnqueueWork(check_priority);
+  });
+  {
+    ScopedTaskPriority task_priority(TaskPriority::kHigh);
+    host->EnqueueWork(check_priority);
+  }
+  EXPECT_EQ(ScopedTaskPriority::GetCurrent(), TaskPriority::kDefault);
+
+  done.wait();
+  EXPECT_EQ(num_high_priority.load(), 3);
+}
+
+TEST(HostContextTest, EnqueueWorkBatch) {
+  auto host = CreateTestHostContext(4);
+
+  const int num_tasks = 100;
+  latch done(num_tasks);
+  std::atomic<int> num_high_priority{0};
+
+  std::vector<llvm::unique_function<void()>> work;
+  for (int i = 0; i < num_tasks; ++i) {
+    work.emplace_back([&] {
+      if (ScopedTaskPriority::GetCurrent() == TaskPriority::kHigh)
+        ++num_high_priority;
+      done.count_down();
+    });
+  }
+  host->EnqueueWork(TaskPriority::kHigh, work);
+
+  done.wait();
+  EXPECT_EQ(num_high_priority.load(), num_tasks);
+}
+
+TEST(HostContextTest, EnqueuedWorkAndWaitersInheritTracingRequest) {
+#ifdef TFRT_DISABLE_TRACING
+  GTEST_SKIP() << "Tracing is disabled";
+#endif
+  auto host = CreateTestHostContext(2);
+
+  latch done(3);
+  std::atomic<int> num_traced{0};
+  auto check_request = [&] {
+    if (tracing::GetTracingRequestId() == 42) ++num_traced;
+    done.count_down();
+  };
+
+  auto value = host->MakeUnconstructedAsyncValueRef<int>();
+  {
+    tracing::ScopedTracingRequest tracing_request(42);
+    host->EnqueueWork([&] {
+      check_request();
+      // Work enqueued by the work inherits the request too.
+      host->EnqueueWork(check_request);
+    });
+    value.AndThen(check_request);
+  }
+  EXPECT_EQ(tracing::GetTracingRequestId(), 0);
+  // The waiter runs on a thread without a tracing request.
+  host->EnqueueWork([&] { value.emplace(0); });
+
+  done.wait();
+  EXPECT_EQ(num_traced.load(), 3);
+}
+
 }  // namespace
 }  // namespace tfrt
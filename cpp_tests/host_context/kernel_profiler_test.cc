@@ -0,0 +1,169 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+//===- kernel_profiler_test.cc ----------------------------------*- C++ -*-===//
+//
+// Unit test for KernelProfiler.
+//
+//===----------------------------------------------------------------------===//
+
+#include "tfrt/host_context/kernel_profiler.h"
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "llvm/Support/raw_ostream.h"
+#include "tfrt/host_context/location.h"
+
+namespace tfrt {
+namespace {
+
+using ::testing::HasSubstr;
+
+// Decodes a location as line `data` of "test.mlir".
+class TestLocationHandler final : public LocationHandler {
+ public:
+  DecodedLocation DecodeLocation(Location loc) const override {
+    DecodedLocation result;
+    result.filename = "test.mlir";
+    result.line = loc.data;
+    result.column = 1;
+    return result;
+  }
+};
+
+TEST(KernelProfilerTest, AggregatesCallsByKernel) {
+  TestLocationHandler location_handler;
+  KernelProfiler profiler;
+  for (int i = 1; i <= 100; ++i) {
+    profiler.RecordKernelCall("fast", {&location_handler, i}, /*duration_ns=*/1,
+                              /*is_error=*/false);
+  }
+  profiler.RecordKernelCall("slow", {&location_handler, 1}, 1000,
+                            /*is_error=*/false);
+  profiler.RecordKernelCall("slow", {&location_handler, 2}, 3000,
+                            /*is_error=*/true);
+  profiler.RecordKernelCall("slow", {&location_handler, 3}, 2000,
+                            /*is_error=*/false);
+
+  auto profile = profiler.GetProfile();
+  ASSERT_EQ(profile.size(), 2);
+
+  // Sorted by decreasing total time.
+  EXPECT_EQ(profile[0].kernel_name, "slow");
+  EXPECT_EQ(profile[0].num_calls, 3);
+  EXPECT_EQ(profile[0].num_errors, 1);
+  EXPECT_EQ(profile[0].total_ns, 6000);
+  EXPECT_EQ(profile[0].max_ns, 3000);
+  EXPECT_EQ(profile[0].max_location.filename, "test.mlir");
+  EXPECT_EQ(profile[0].max_location.line, 2);
+  // The p99 is approximate, but at most the max.
+  EXPECT_GE(profile[0].p99_ns, 2000);
+  EXPECT_LE(profile[0].p99_ns, 3000);
+
+  EXPECT_EQ(profile[1].kernel_name, "fast");
+  EXPECT_EQ(profile[1].num_calls, 100);
+  EXPECT_EQ(profile[1].num_errors, 0);
+  EXPECT_EQ(profile[1].total_ns, 100);
+  EXPECT_EQ(profile[1].p99_ns, 1);
+  EXPECT_EQ(profile[1].max_location.line, 1);
+}
+
+TEST(KernelProfilerTest, P99) {
+  KernelProfiler profiler;
+  for (int i = 0; i < 990; ++i)
+    profiler.RecordKernelCall("kernel", {}, 100, /*is_error=*/false);
+  for (int i = 0; i < 10; ++i)
+    profiler.RecordKernelCall("kernel", {}, 1000000, /*is_error=*/false);
+
+  auto profile = profiler.GetProfile();
+  ASSERT_EQ(profile.size(), 1);
+  // 100ns is in the bucket [96, 103].
+  EXPECT_GE(profile[0].p99_ns, 100);
+  EXPECT_LE(profile[0].p99_ns, 103);
+  EXPECT_EQ(profile[0].max_ns, 1000000);
+}
+
+TEST(KernelProfilerTest, MergesThreads) {
+  KernelProfiler profiler;
+  // The names are merged by value, even if they are different pointers.
+  std::vector<std::string> names(8, "kernel");
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 8; ++i) {
+    threads.emplace_back([&, i] {
+      for (int j = 0; j < 1000; ++j)
+        profiler.RecordKernelCall(names[i].c_str(), {}, 10, j % 10 == 0);
+    });
+  }
+  // Reading the profile while the threads record calls is safe.
+  profiler.GetProfile();
+  for (auto& thread : threads) thread.join();
+
+  auto profile = profiler.GetProfile();
+  ASSERT_EQ(profile.size(), 1);
+  EXPECT_EQ(profile[0].kernel_name, "kernel");
+  EXPECT_EQ(profile[0].num_calls, 8000);
+  EXPECT_EQ(profile[0].num_errors, 800);
+  EXPECT_EQ(profile[0].total_ns, 80000);
+}
+
+TEST(KernelProfilerTest, AlternatesProfilers) {
+  // A thread which records into two profilers in turn keeps a single table in
+  // each of them.
+  KernelProfiler profiler, other_profiler;
+  for (int i = 0; i < 100; ++i) {
+    profiler.RecordKernelCall("kernel", {}, 10, /*is_error=*/false);
+    other_profiler.RecordKernelCall("other_kernel", {}, 20, i % 10 == 0);
+  }
+
+  auto profile = profiler.GetProfile();
+  ASSERT_EQ(profile.size(), 1);
+  EXPECT_EQ(profile[0].kernel_name, "kernel");
+  EXPECT_EQ(profile[0].num_calls, 100);
+  EXPECT_EQ(profile[0].num_errors, 0);
+  EXPECT_EQ(profile[0].total_ns, 1000);
+  EXPECT_EQ(profiler.GetNumThreads(), 1);
+
+  auto other_profile = other_profiler.GetProfile();
+  ASSERT_EQ(other_profile.size(), 1);
+  EXPECT_EQ(other_profile[0].kernel_name, "other_kernel");
+  EXPECT_EQ(other_profile[0].num_calls, 100);
+  EXPECT_EQ(other_profile[0].num_errors, 10);
+  EXPECT_EQ(other_profile[0].total_ns, 2000);
+  EXPECT_EQ(other_profiler.GetNumThreads(), 1);
+}
+
+TEST(KernelProfilerTest, PrintProfile) {
+  TestLocationHandler location_handler;
+  KernelProfiler profiler;
+  profiler.RecordKernelCall("tfrt.add.i32", {&location_handler, 7}, 2000,
+                            /*is_error=*/false);
+  profiler.RecordKernelCall("tfrt.add.i32", {&location_handler, 8}, 4000,
+                            /*is_error=*/true);
+
+  std::string output;
+  llvm::raw_string_ostream os(output);
+  profiler.PrintProfile(os);
+  EXPECT_THAT(os.str(), HasSubstr("calls   errors     total_ms       avg_us"));
+  EXPECT_THAT(os.str(), HasSubstr("         2        1        0.006        "
+                                  "3.000        4.000        4.000  "
+                                  "tfrt.add.i32 (test.mlir:8:1)\n"));
+}
+
+}  // namespace
+}  // namespace tfrt
@@ -0,0 +1,131 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//===- size_class_allocator_test.cc -----------------------------*- C++ -*-===//
+//
+// Unit test for the size class HostAllocator.
+//
+//===----------------------------------------------------------------------===//
+
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "tfrt/host_context/host_allocator.h"
+
+namespace tfrt {
+namespace {
+
+TEST(SizeClassAllocatorTest, SizesAndAlignments) {
+  auto allocator = CreateSizeClassAllocator(CreateMallocAllocator());
+
+  for (size_t size : {1, 8, 24, 40, 100, 500, 512, 513, 4096}) {
+    for (size_t alignment : {1, 8, 16, 64, 256}) {
+      void* ptr = allocator->AllocateBytes(size, alignment);
+      ASSERT_NE(ptr, nullptr);
+      EXPECT_EQ(reinterpret_cast<uintptr_t>(ptr) % alignment, 0)
+          << "size " << size << " alignment " << alignment;
+      // The whole allocation is writable.
+      memset(ptr, 0xab, size);
+      allocator->DeallocateBytes(ptr, size);
+    }
+  }
+}
+
+TEST(SizeClassAllocatorTest, OverAlignedSmallObjects) {
+  auto allocator = CreateSizeClassAllocator(CreateMallocAllocator());
+
+  // Alignments beyond those of the size classes are served by the underlying
+  // allocator, and are freed to it among objects of the size classes.
+  void* small = allocator->AllocateBytes(64, 8);
+  for (size_t alignment : {512, 1024, 4096, 128 * 1024}) {
+    void* ptr = allocator->AllocateBytes(64, alignment);
+    ASSERT_NE(ptr, nullptr);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(ptr) % alignment, 0)
+        << "alignment " << alignment;
+    memset(ptr, 0xab, 64);
+    allocator->DeallocateBytes(ptr, 64);
+  }
+  allocator->DeallocateBytes(small, 64);
+  EXPECT_EQ(allocator->AllocateBytes(64, 8), small);
+  allocator->DeallocateBytes(small, 64);
+}
+
+TEST(SizeClassAllocatorTest, ReusesFreedObjects) {
+  auto allocator = CreateSizeClassAllocator(CreateMallocAllocator());
+
+  void* ptr = allocator->AllocateBytes(40, 8);
+  allocator->DeallocateBytes(ptr, 40);
+  EXPECT_EQ(allocator->AllocateBytes(40, 8), ptr);
+  allocator->DeallocateBytes(ptr, 40);
+}
+
+TEST(SizeClassAllocatorTest, CrossThreadDeallocation) {
+  auto allocator = CreateSizeClassAllocator(CreateMallocAllocator());
+
+  const int kNumObjects = 10000;
+  std::vector<int64_t*> ptrs;
+  std::thread([&] {
+    for (int i = 0; i < kNumObjects; ++i) {
+      ptrs.push_back(allocator->Allocate<int64_t>());
+      *ptrs.back() = i;
+    }
+  }).join();
+
+  std::thread([&] {
+    for (int i = 0; i < kNumObjects; ++i) {
+      EXPECT_EQ(*ptrs[i], i);
+      allocator->Deallocate(ptrs[i]);
+    }
+  }).join();
+
+  // The objects freed by the second thread are reused by other threads through
+  // the depot.
+  std::vector<int64_t*> reused;
+  for (int i = 0; i < kNumObjects; ++i)
+    reused.push_back(allocator->Allocate<int64_t>());
+  for (int64_t* ptr : reused) allocator->Deallocate(ptr);
+}
+
+TEST(SizeClassAllocatorTest, ConcurrentAllocations) {
+  auto allocator = CreateSizeClassAllocator(CreateMallocAllocator());
+
+  const int kNumThreads = 4;
+  const int kNumObjects = 1000;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kNumThreads; ++t) {
+    threads.emplace_back([&, t] {
+      for (int round = 0; round < 10; ++round) {
+        std::vector<int*> ptrs;
+        for (int i = 0; i < kNumObjects; ++i) {
+          ptrs.push_back(allocator->Allocate<int>(1 + i % 32));
+          *ptrs.back() = t * kNumObjects + i;
+        }
+        // No object is handed out twice.
+        for (int i = 0; i < kNumObjects; ++i) {
+          EXPECT_EQ(*ptrs[i], t * kNumObjects + i);
+          allocator->Deallocate(ptrs[i], 1 + i % 32);
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+}
+
+}  // namespace
+}  // namespace tfrt
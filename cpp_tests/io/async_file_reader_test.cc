@@ -0,0 +1,221 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+//===- async_file_reader_test.cc --------------------------------*- C++ -*-===//
+//
+// Unit test for AsyncFileReader and AsyncFileInputStream.
+//
+//===----------------------------------------------------------------------===//
+
+#include "tfrt/io/async_file_reader.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "llvm/Support/FileSystem.h"
+#include "tfrt/cpp_tests/error_util.h"
+#include "tfrt/host_context/concurrent_work_queue.h"
+#include "tfrt/host_context/diagnostic.h"
+#include "tfrt/host_context/host_allocator.h"
+#include "tfrt/host_context/host_context.h"
+#include "tfrt/io/async_file_input_stream.h"
+
+namespace tfrt {
+namespace io {
+namespace {
+
+// The tests run with both the io_uring reader and the pread reader. The
+// io_uring reader falls back to pread where io_uring is not available.
+class AsyncFileReaderTest : public ::testing::TestWithParam<bool> {
+ protected:
+  void SetUp() override {
+    host_ = std::make_unique<HostContext>(
+        [](const DecodedDiagnostic&) {}, CreateMallocAllocator(),
+        CreateMultiThreadedWorkQueue(/*num_threads=*/2,
+                                     /*num_blocking_threads=*/2));
+    reader_ = AsyncFileReader::Create(/*queue_depth=*/8, UseIoUring());
+    // The names of parameterized tests contain a '/'.
+    std::string name =
+        ::testing::UnitTest::GetInstance()->current_test_info()->name();
+    std::replace(name.begin(), name.end(), '/', '_');
+    path_ = ::testing::TempDir() + "/async_file_reader_" + name + ".data";
+  }
+
+  void TearDown() override { unlink(path_.c_str()); }
+
+  bool UseIoUring() const { return GetParam(); }
+
+  // Writes a file of `size` bytes that differ from their neighbours.
+  std::string WriteFile(size_t size) {
+    std::string contents(size, '\0');
+    for (size_t i = 0; i < size; ++i) contents[i] = static_cast<char>(i % 251);
+    FILE* file = fopen(path_.c_str(), "wb");
+    EXPECT_NE(file, nullptr);
+    EXPECT_EQ(fwrite(contents.data(), 1, size, file), size);
+    fclose(file);
+    return contents;
+  }
+
+  llvm::sys::fs::file_t OpenFile() {
+    auto file = llvm::sys::fs::openNativeFileForRead(path_);
+    EXPECT_TRUE(static_cast<bool>(file));
+    return *file;
+  }
+
+  void Await(const AsyncValueRef<size_t>& result) {
+    host_->Await(result.CopyRCRef());
+  }
+
+  std::unique_ptr<HostContext> host_;
+  std::unique_ptr<AsyncFileReader> reader_;
+  std::string path_;
+};
+
+TEST_P(AsyncFileReaderTest, ReadsRanges) {
+  if (!UseIoUring()) EXPECT_FALSE(reader_->IsAsync());
+  const std::string contents = WriteFile(10000);
+  auto file = OpenFile();
+
+  std::vector<char> buf(4096);
+  auto result =
+      reader_->ReadAt(file, 1000, buf.data(), buf.size(), host_.get());
+  Await(result);
+  ASSERT_EQ(result.get(), 4096);
+  EXPECT_EQ(std::string(buf.data(), 4096), contents.substr(1000, 4096));
+
+  llvm::sys::fs::closeFile(file);
+}
+
+TEST_P(AsyncFileReaderTest, ShortReadAtEndOfFile) {
+  const std::string contents = WriteFile(10000);
+  auto file = OpenFile();
+
+  std::vector<char> buf(4096);
+  auto result =
+      reader_->ReadAt(file, 8192, buf.data(), buf.size(), host_.get());
+  Await(result);
+  ASSERT_EQ(result.get(), 1808);
+  EXPECT_EQ(std::string(buf.data(), 1808), contents.substr(8192));
+
+  // Reads at and past the end of the file read nothing.
+  for (uint64_t offset : {10000, 20000}) {
+    result = reader_->ReadAt(file, offset, buf.data(), buf.size(), host_.get());
+    Await(result);
+    EXPECT_EQ(result.get(), 0) << "offset " << offset;
+  }
+
+  // An empty read is available right away.
+  result = reader_->ReadAt(file, 0, buf.data(), 0, host_.get());
+  ASSERT_TRUE(result.IsAvailable());
+  EXPECT_EQ(result.get(), 0);
+
+  llvm::sys::fs::closeFile(file);
+}
+
+TEST_P(AsyncFileReaderTest, ReadErrors) {
+  std::vector<char> buf(4096);
+
+  // A file descriptor that is not open.
+  auto result = reader_->ReadAt(-1, 0, buf.data(), buf.size(), host_.get());
+  Await(result);
+  ASSERT_TRUE(result.IsError());
+  EXPECT_NE(result.GetError().message.find("failed to read file"),
+            std::string::npos);
+
+  // A directory can be opened, but not read.
+  auto dir = llvm::sys::fs::openNativeFileForRead(::testing::TempDir());
+  ASSERT_TRUE(static_cast<bool>(dir));
+  result = reader_->ReadAt(*dir, 0, buf.data(), buf.size(), host_.get());
+  Await(result);
+  EXPECT_TRUE(result.IsError());
+  llvm::sys::fs::closeFile(*dir);
+}
+
+TEST_P(AsyncFileReaderTest, ReadsWhenQueueIsFull) {
+  const size_t kReadSize = 4096;
+  const int kNumReads = 64;
+  const std::string contents = WriteFile(kReadSize * kNumReads);
+  auto file = OpenFile();
+
+  // The reads beyond the queue depth are served by pread in this thread.
+  auto reader = AsyncFileReader::Create(/*queue_depth=*/1, UseIoUring());
+  std::vector<char> buf(contents.size());
+  std::vector<AsyncValueRef<size_t>> results;
+  for (int i = 0; i < kNumReads; ++i) {
+    results.push_back(reader->ReadAt(file, i * kReadSize,
+                                     buf.data() + i * kReadSize, kReadSize,
+                                     host_.get()));
+  }
+  for (int i = 0; i < kNumReads; ++i) {
+    Await(results[i]);
+    EXPECT_EQ(results[i].get(), kReadSize) << "read " << i;
+  }
+  EXPECT_EQ(std::string(buf.data(), buf.size()), contents);
+
+  llvm::sys::fs::closeFile(file);
+}
+
+TEST_P(AsyncFileReaderTest, InputStreamReadsWholeFile) {
+  // The file ends in the middle of a chunk, and at the end of a chunk.
+  for (size_t size : {10000, 3000}) {
+    const std::string contents = WriteFile(size);
+    TFRT_ASSERT_AND_ASSIGN(
+        auto stream, AsyncFileInputStream::Open(path_, /*chunk_size=*/1000,
+                                                /*num_chunks=*/3, reader_.get(),
+                                                host_.get()));
+    std::string read;
+    std::vector<char> buf(777);
+    for (;;) {
+      TFRT_ASSERT_AND_ASSIGN(size_t count,
+                             stream->Read(buf.data(), buf.size()));
+      if (count == 0) break;
+      read.append(buf.data(), count);
+    }
+    EXPECT_EQ(read, contents) << "size " << size;
+    TFRT_ASSERT_AND_ASSIGN(size_t pos, stream->Tell());
+    EXPECT_EQ(pos, size);
+  }
+}
+
+TEST_P(AsyncFileReaderTest, InputStreamErrors) {
+  auto missing = AsyncFileInputStream::Open(
+      path_ + ".missing", /*chunk_size=*/1000, /*num_chunks=*/3, reader_.get(),
+      host_.get());
+  ASSERT_FALSE(static_cast<bool>(missing));
+  llvm::consumeError(missing.takeError());
+
+  TFRT_ASSERT_AND_ASSIGN(
+      auto stream,
+      AsyncFileInputStream::Open(::testing::TempDir(), /*chunk_size=*/1000,
+                                 /*num_chunks=*/3, reader_.get(), host_.get()));
+  std::vector<char> buf(100);
+  auto count = stream->Read(buf.data(), buf.size());
+  ASSERT_FALSE(static_cast<bool>(count));
+  llvm::consumeError(count.takeError());
+}
+
+INSTANTIATE_TEST_SUITE_P(IoUringAndPread, AsyncFileReaderTest,
+                         ::testing::Bool());
+
+}  // namespace
+}  // namespace io
+}  // namespace tfrt
@@ -0,0 +1,219 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+//===- metrics_test.cc ------------------------------------------*- C++ -*-===//
+//
+// Unit test for the built-in metrics implementation and its exporters.
+//
+//===----------------------------------------------------------------------===//
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+#include "tfrt/cpp_tests/error_util.h"
+#include "tfrt/metrics/metrics_api.h"
+#include "tfrt/metrics/metrics_exporter.h"
+#include "tfrt/metrics/metrics_registry.h"
+
+namespace tfrt {
+namespace metrics {
+namespace {
+
+using ::testing::HasSubstr;
+
+// Returns the snapshot of the metric with `name`, which must exist.
+MetricSnapshot GetSnapshot(string_view name) {
+  for (auto& snapshot : GetMetricsSnapshot())
+    if (snapshot.name == name) return snapshot;
+  ADD_FAILURE() << "metric " << name.str() << " not found";
+  return {};
+}
+
+std::string GetPrometheusText(string_view name) {
+  std::string text;
+  llvm::raw_string_ostream os(text);
+  MetricSnapshot snapshot = GetSnapshot(name);
+  WritePrometheusText(snapshot, os);
+  return os.str();
+}
+
+TEST(MetricsTest, SameMetricForSameNameAndLabels) {
+  Counter* counter = NewCounter("/test/same_counter", {{"key", "a"}});
+  EXPECT_EQ(NewCounter("/test/same_counter", {{"key", "a"}}), counter);
+  EXPECT_NE(NewCounter("/test/same_counter", {{"key", "b"}}), counter);
+  EXPECT_EQ(NewGauge<int64_t>("/test/same_gauge"),
+            NewGauge<int64_t>("/test/same_gauge"));
+}
+
+TEST(MetricsTest, CounterFromThreads) {
+  Counter* counter = NewCounter("/test/thread_counter");
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 32; ++i) {
+    threads.emplace_back([counter] {
+      for (int j = 0; j < 1000; ++j) counter->Increment();
+      counter->IncrementBy(10);
+    });
+  }
+  for (auto& thread : threads) thread.join();
+
+  MetricSnapshot snapshot = GetSnapshot("/test/thread_counter");
+  EXPECT_EQ(snapshot.kind, MetricSnapshot::Kind::kCounter);
+  EXPECT_EQ(snapshot.value, 32 * 1010);
+}
+
+TEST(MetricsTest, Gauges) {
+  NewGauge<int64_t>("/test/int_gauge")->SetValue(42);
+  NewGauge<std::string>("/test/string_gauge")->SetValue("version \"1\"");
+
+  MetricSnapshot int_gauge = GetSnapshot("/test/int_gauge");
+  EXPECT_EQ(int_gauge.kind, MetricSnapshot::Kind::kGauge);
+  EXPECT_FALSE(int_gauge.is_string);
+  EXPECT_EQ(int_gauge.value, 42);
+
+  MetricSnapshot string_gauge = GetSnapshot("/test/string_gauge");
+  EXPECT_TRUE(string_gauge.is_string);
+  EXPECT_EQ(string_gauge.string_value, "version \"1\"");
+  EXPECT_EQ(GetPrometheusText("/test/string_gauge"),
+            "# TYPE test_string_gauge gauge\n"
+            "test_string_gauge{value=\"version \\\"1\\\"\"} 1\n");
+}
+
+TEST(MetricsTest, HistogramBuckets) {
+  Histogram* histogram = NewHistogram("/test/histogram");
+  for (int64_t value : {-1, 0, 3, 5, 8, 9, 100, 100})
+    histogram->Record(value);
+
+  MetricSnapshot snapshot = GetSnapshot("/test/histogram");
+  EXPECT_EQ(snapshot.kind, MetricSnapshot::Kind::kHistogram);
+  EXPECT_EQ(snapshot.count, 8);
+  EXPECT_EQ(snapshot.sum, 225);
+  // The buckets up to the last non-empty one are kept, including the empty
+  // ones.
+  ASSERT_EQ(snapshot.buckets.size(), 23);
+  auto expect_bucket = [&](int i, int64_t lower_bound, int64_t upper_bound,
+                           uint64_t count) {
+    EXPECT_EQ(snapshot.buckets[i].lower_bound, lower_bound);
+    EXPECT_EQ(snapshot.buckets[i].upper_bound, upper_bound);
+    EXPECT_EQ(snapshot.buckets[i].count, count);
+  };
+  // Negative values are recorded as 0.
+  expect_bucket(0, 0, 0, 2);
+  expect_bucket(1, 1, 1, 0);
+  expect_bucket(3, 3, 3, 1);
+  expect_bucket(5, 5, 5, 1);
+  expect_bucket(8, 8, 9, 2);
+  expect_bucket(21, 80, 95, 0);
+  expect_bucket(22, 96, 111, 2);
+
+  EXPECT_EQ(GetPrometheusText("/test/histogram"),
+            "# TYPE test_histogram histogram\n"
+            "test_histogram_bucket{le=\"0\"} 2\n"
+            "test_histogram_bucket{le=\"1\"} 2\n"
+            "test_histogram_bucket{le=\"2\"} 2\n"
+            "test_histogram_bucket{le=\"3\"} 3\n"
+            "test_histogram_bucket{le=\"4\"} 3\n"
+            "test_histogram_bucket{le=\"5\"} 4\n"
+            "test_histogram_bucket{le=\"6\"} 4\n"
+            "test_histogram_bucket{le=\"7\"} 4\n"
+            "test_histogram_bucket{le=\"9\"} 6\n"
+            "test_histogram_bucket{le=\"11\"} 6\n"
+            "test_histogram_bucket{le=\"13\"} 6\n"
+            "test_histogram_bucket{le=\"15\"} 6\n"
+            "test_histogram_bucket{le=\"19\"} 6\n"
+            "test_histogram_bucket{le=\"23\"} 6\n"
+            "test_histogram_bucket{le=\"27\"} 6\n"
+            "test_histogram_bucket{le=\"31\"} 6\n"
+            "test_histogram_bucket{le=\"39\"} 6\n"
+            "test_histogram_bucket{le=\"47\"} 6\n"
+            "test_histogram_bucket{le=\"55\"} 6\n"
+            "test_histogram_bucket{le=\"63\"} 6\n"
+            "test_histogram_bucket{le=\"79\"} 6\n"
+            "test_histogram_bucket{le=\"95\"} 6\n"
+            "test_histogram_bucket{le=\"111\"} 8\n"
+            "test_histogram_bucket{le=\"+Inf\"} 8\n"
+            "test_histogram_sum 225\n"
+            "test_histogram_count 8\n");
+}
+
+TEST(MetricsTest, PrometheusTextSharesTypeLine) {
+  NewCounter("/test/labeled_counter", {{"op_handler", "cpu"}})->IncrementBy(3);
+  NewCounter("/test/labeled_counter", {{"op_handler", "gpu"}})->IncrementBy(4);
+
+  std::string text;
+  llvm::raw_string_ostream os(text);
+  std::vector<MetricSnapshot> snapshots;
+  for (auto& snapshot : GetMetricsSnapshot())
+    if (snapshot.name == "/test/labeled_counter") snapshots.push_back(snapshot);
+  WritePrometheusText(snapshots, os);
+  EXPECT_EQ(os.str(),
+            "# TYPE test_labeled_counter counter\n"
+            "test_labeled_counter{op_handler=\"cpu\"} 3\n"
+            "test_labeled_counter{op_handler=\"gpu\"} 4\n");
+}
+
+TEST(MetricsTest, WriteMetricsFile) {
+  NewCounter("/test/file_counter")->IncrementBy(7);
+
+  std::string path = ::testing::TempDir() + "/metrics_test.prom";
+  ASSERT_TRUE(IsSuccess(WriteMetricsFile(path)));
+  auto buffer = llvm::MemoryBuffer::getFile(path);
+  ASSERT_TRUE(static_cast<bool>(buffer));
+  EXPECT_THAT((*buffer)->getBuffer().str(), HasSubstr("test_file_counter 7\n"));
+  unlink(path.c_str());
+}
+
+TEST(MetricsTest, SocketServer) {
+  NewCounter("/test/socket_counter")->IncrementBy(9);
+
+  std::string path = ::testing::TempDir() + "/metrics_test.sock";
+  unlink(path.c_str());
+  TFRT_ASSERT_AND_ASSIGN(auto server, MetricsSocketServer::Create(path));
+
+  // Each connection reads a new snapshot.
+  for (int i = 0; i < 2; ++i) {
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    ASSERT_GE(fd, 0);
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+    ASSERT_EQ(connect(fd, reinterpret_cast<const sockaddr*>(&address),
+                      sizeof(address)),
+              0);
+    std::string text;
+    char buffer[4096];
+    ssize_t size;
+    while ((size = read(fd, buffer, sizeof(buffer))) > 0)
+      text.append(buffer, size);
+    close(fd);
+    EXPECT_THAT(text, HasSubstr("test_socket_counter 9\n"));
+  }
+
+  server.reset();
+  EXPECT_NE(access(path.c_str(), F_OK), 0);
+}
+
+}  // namespace
+}  // namespace metrics
+}  // namespace tfrt
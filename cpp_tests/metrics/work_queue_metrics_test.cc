@@ -0,0 +1,89 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//===- work_queue_metrics_test.cc -------------------------------*- C++ -*-===//
+//
+// Unit test for the export of work queue statistics to metrics.
+//
+//===----------------------------------------------------------------------===//
+
+#include "tfrt/metrics/work_queue_metrics.h"
+
+#include <memory>
+
+#include "gtest/gtest.h"
+#include "tfrt/host_context/concurrent_work_queue.h"
+#include "tfrt/host_context/diagnostic.h"
+#include "tfrt/host_context/host_allocator.h"
+#include "tfrt/host_context/host_context.h"
+#include "tfrt/metrics/metrics_registry.h"
+#include "tfrt/support/latch.h"
+
+namespace tfrt {
+namespace metrics {
+namespace {
+
+int64_t GetGaugeValue(string_view name) {
+  for (auto& snapshot : GetMetricsSnapshot())
+    if (snapshot.name == name) return snapshot.value;
+  ADD_FAILURE() << "metric " << name.str() << " not found";
+  return 0;
+}
+
+TEST(WorkQueueMetricsTest, CollectorRefreshesGaugesInEverySnapshot) {
+  auto host = std::make_unique<HostContext>(
+      [](const DecodedDiagnostic&) {}, CreateMallocAllocator(),
+      CreateMultiThreadedWorkQueue(/*num_threads=*/2,
+                                   /*num_blocking_threads=*/2));
+  auto collector = std::make_unique<WorkQueueMetricsCollector>(*host);
+
+  // Keep both worker threads busy, so that the tasks enqueued after them stay
+  // in the queues.
+  const int num_queued_tasks = 10;
+  latch started(2), release(1), done(2 + num_queued_tasks);
+  for (int i = 0; i < 2; ++i) {
+    host->EnqueueWork([&] {
+      started.count_down();
+      release.wait();
+      done.count_down();
+    });
+  }
+  started.wait();
+  for (int i = 0; i < num_queued_tasks; ++i)
+    host->EnqueueWork([&] { done.count_down(); });
+
+  EXPECT_EQ(GetGaugeValue("/tfrt/work_queue/worker_threads/num_threads"), 2);
+  EXPECT_EQ(GetGaugeValue("/tfrt/work_queue/worker_threads/queue_depth"),
+            num_queued_tasks);
+
+  release.count_down();
+  done.wait();
+  host->Quiesce();
+  EXPECT_EQ(GetGaugeValue("/tfrt/work_queue/worker_threads/queue_depth"), 0);
+  EXPECT_EQ(GetGaugeValue("/tfrt/work_queue/worker_threads/tasks_executed"),
+            2 + num_queued_tasks);
+
+  // The gauges keep their last values once the collector is removed.
+  collector.reset();
+  host->EnqueueWork([] {});
+  host->Quiesce();
+  EXPECT_EQ(GetGaugeValue("/tfrt/work_queue/worker_threads/tasks_executed"),
+            2 + num_queued_tasks);
+}
+
+}  // namespace
+}  // namespace metrics
+}  // namespace tfrt
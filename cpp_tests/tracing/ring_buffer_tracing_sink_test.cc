@@ -0,0 +1,278 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+//===- ring_buffer_tracing_sink_test.cc -------------------------*- C++ -*-===//
+//
+// Unit test for RingBufferTracingSink.
+//
+//===----------------------------------------------------------------------===//
+
+#include "tfrt/tracing/ring_buffer_tracing_sink/ring_buffer_tracing_sink.h"
+
+#include <set>
+#include <string>
+#include <thread>
+
+#include "gtest/gtest.h"
+#include "llvm/Support/JSON.h"
+#include "llvm/Support/raw_ostream.h"
+
+namespace tfrt {
+namespace tracing {
+namespace {
+
+// Flushes `sink` and returns the parsed trace.
+llvm::json::Object FlushTrace(RingBufferTracingSink* sink) {
+  std::string trace;
+  llvm::raw_string_ostream os(trace);
+  sink->Flush(os);
+  auto value = llvm::json::parse(os.str());
+  EXPECT_TRUE(static_cast<bool>(value)) << trace;
+  if (!value) {
+    llvm::consumeError(value.takeError());
+    return {};
+  }
+  return std::move(*value->getAsObject());
+}
+
+const llvm::json::Array& GetEvents(const llvm::json::Object& trace) {
+  static const auto* empty = new llvm::json::Array();
+  const auto* events = trace.getArray("traceEvents");
+  return events ? *events : *empty;
+}
+
+int64_t GetDropped(const llvm::json::Object& trace) {
+  return trace.getObject("otherData")
+      ->getInteger("dropped_activities")
+      .getValue();
+}
+
+class RingBufferTracingSinkTest : public ::testing::Test {
+ protected:
+  RingBufferTracingSinkTest() : sink_(Options(16)) {
+    RegisterTracingSink(&sink_);
+  }
+
+  static RingBufferTracingSink::Options Options(size_t capacity) {
+    RingBufferTracingSink::Options options;
+    options.capacity_per_thread = capacity;
+    return options;
+  }
+
+  RingBufferTracingSink sink_;
+};
+
+TEST_F(RingBufferTracingSinkTest, EventsAndScopes) {
+#ifdef TFRT_DISABLE_TRACING
+  GTEST_SKIP() << "Tracing is disabled";
+#endif
+  {
+    TracingRequester requester;
+    RecordTracingEvent("category", "event");
+    TracingScope outer("outer");
+    { TracingScope inner("kernel", std::string("inner \"quoted\"")); }
+  }
+
+  auto trace = FlushTrace(&sink_);
+  const auto& events = GetEvents(trace);
+  ASSERT_EQ(events.size(), 3);
+  EXPECT_EQ(GetDropped(trace), 0);
+
+  const auto* event = events[0].getAsObject();
+  EXPECT_EQ(event->getString("name").getValue(), "event");
+  EXPECT_EQ(event->getString("cat").getValue(), "category");
+  EXPECT_EQ(event->getString("ph").getValue(), "i");
+
+  const auto* outer = events[1].getAsObject();
+  EXPECT_EQ(outer->getString("name").getValue(), "outer");
+  EXPECT_FALSE(outer->get("cat"));
+  EXPECT_EQ(outer->getString("ph").getValue(), "X");
+
+  const auto* inner = events[2].getAsObject();
+  EXPECT_EQ(inner->getString("name").getValue(), "inner \"quoted\"");
+  EXPECT_EQ(inner->getString("cat").getValue(), "kernel");
+  EXPECT_EQ(inner->getString("ph").getValue(), "X");
+  EXPECT_EQ(inner->getInteger("tid"), outer->getInteger("tid"));
+
+  // The inner scope is nested in the outer scope.
+  double outer_ts = outer->getNumber("ts").getValue();
+  double inner_ts = inner->getNumber("ts").getValue();
+  EXPECT_LE(outer_ts, inner_ts);
+  EXPECT_LE(inner_ts + inner->getNumber("dur").getValue(),
+            outer_ts + outer->getNumber("dur").getValue());
+
+  // The activities are only flushed once.
+  EXPECT_TRUE(GetEvents(FlushTrace(&sink_)).empty());
+}
+
+TEST_F(RingBufferTracingSinkTest, OpenScope) {
+#ifdef TFRT_DISABLE_TRACING
+  GTEST_SKIP() << "Tracing is disabled";
+#endif
+  TracingRequester requester;
+  TracingScope scope("open");
+
+  auto trace = FlushTrace(&sink_);
+  const auto& events = GetEvents(trace);
+  ASSERT_EQ(events.size(), 1);
+  EXPECT_EQ(events[0].getAsObject()->getString("ph").getValue(), "B");
+}
+
+TEST_F(RingBufferTracingSinkTest, OverwritesOldestActivities) {
+#ifdef TFRT_DISABLE_TRACING
+  GTEST_SKIP() << "Tracing is disabled";
+#endif
+  {
+    TracingRequester requester;
+    TracingScope scope("overwritten");
+    for (int i = 0; i < 20; ++i)
+      RecordTracingEvent([&] { return std::to_string(i); });
+  }
+
+  auto trace = FlushTrace(&sink_);
+  const auto& events = GetEvents(trace);
+  ASSERT_EQ(events.size(), 16);
+  EXPECT_EQ(GetDropped(trace), 5);
+  for (int i = 0; i < 16; ++i) {
+    EXPECT_EQ(events[i].getAsObject()->getString("name").getValue(),
+              std::to_string(i + 4));
+  }
+}
+
+TEST_F(RingBufferTracingSinkTest, TruncatesLongNames) {
+#ifdef TFRT_DISABLE_TRACING
+  GTEST_SKIP() << "Tracing is disabled";
+#endif
+  {
+    TracingRequester requester;
+    RecordTracingEvent(std::string(1000, 'a'));
+  }
+
+  auto trace = FlushTrace(&sink_);
+  const auto& events = GetEvents(trace);
+  ASSERT_EQ(events.size(), 1);
+  EXPECT_EQ(events[0].getAsObject()->getString("name").getValue(),
+            std::string(RingBufferTracingSink::kMaxNameSize, 'a'));
+}
+
+TEST_F(RingBufferTracingSinkTest, InternedNames) {
+#ifdef TFRT_DISABLE_TRACING
+  GTEST_SKIP() << "Tracing is disabled";
+#endif
+  const std::string long_name(1000, 'b');
+  {
+    TracingRequester requester;
+    RecordTracingEvent(InternTracingName("interned event"));
+    // Interned names are not truncated.
+    TracingScope scope("kernel", InternTracingName(long_name));
+  }
+
+  auto trace = FlushTrace(&sink_);
+  const auto& events = GetEvents(trace);
+  ASSERT_EQ(events.size(), 2);
+  EXPECT_EQ(events[0].getAsObject()->getString("name").getValue(),
+            "interned event");
+  EXPECT_EQ(events[1].getAsObject()->getString("name").getValue(), long_name);
+  EXPECT_EQ(events[1].getAsObject()->getString("cat").getValue(), "kernel");
+}
+
+TEST_F(RingBufferTracingSinkTest, SampledRequests) {
+#ifdef TFRT_DISABLE_TRACING
+  GTEST_SKIP() << "Tracing is disabled";
+#endif
+  {
+    ScopedTracingRequest tracing_request(42);
+    RecordTracingEvent("sampled");
+  }
+  RecordTracingEvent("not sampled");
+
+  auto trace = FlushTrace(&sink_);
+  const auto& events = GetEvents(trace);
+  ASSERT_EQ(events.size(), 1);
+  const auto* event = events[0].getAsObject();
+  EXPECT_EQ(event->getString("name").getValue(), "sampled");
+  EXPECT_EQ(event->getObject("args")->getInteger("request_id").getValue(), 42);
+}
+
+TEST_F(RingBufferTracingSinkTest, Threads) {
+#ifdef TFRT_DISABLE_TRACING
+  GTEST_SKIP() << "Tracing is disabled";
+#endif
+  {
+    TracingRequester requester;
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; ++i) {
+      threads.emplace_back([] {
+        for (int j = 0; j < 4; ++j) TracingScope scope("scope");
+      });
+    }
+    for (auto& thread : threads) thread.join();
+  }
+
+  auto trace = FlushTrace(&sink_);
+  const auto& events = GetEvents(trace);
+  ASSERT_EQ(events.size(), 16);
+  std::set<int64_t> tids;
+  for (const auto& event : events)
+    tids.insert(event.getAsObject()->getInteger("tid").getValue());
+  EXPECT_EQ(tids.size(), 4);
+}
+
+TEST_F(RingBufferTracingSinkTest, AlternatingSinks) {
+  // A thread which records into two sinks keeps a single buffer in each.
+  RingBufferTracingSink other_sink(Options(16));
+  for (int i = 0; i < 4; ++i) {
+    sink_.RecordTracingEvent(nullptr, string_view("event"));
+    other_sink.RecordTracingEvent(nullptr, string_view("other_event"));
+  }
+
+  for (auto* sink : {&sink_, &other_sink}) {
+    auto trace = FlushTrace(sink);
+    const auto& events = GetEvents(trace);
+    ASSERT_EQ(events.size(), 4);
+    for (const auto& event : events)
+      EXPECT_EQ(event.getAsObject()->getInteger("tid").getValue(), 1);
+  }
+}
+
+TEST_F(RingBufferTracingSinkTest, ConcurrentFlush) {
+#ifdef TFRT_DISABLE_TRACING
+  GTEST_SKIP() << "Tracing is disabled";
+#endif
+  constexpr int kNumScopes = 100000;
+  int64_t num_flushed = 0;
+  int64_t num_dropped = 0;
+  auto flush = [&] {
+    auto trace = FlushTrace(&sink_);
+    num_flushed += GetEvents(trace).size();
+    num_dropped += GetDropped(trace);
+  };
+  {
+    TracingRequester requester;
+    std::thread thread([] {
+      for (int i = 0; i < kNumScopes; ++i) TracingScope scope("scope");
+    });
+    for (int i = 0; i < 100; ++i) flush();
+    thread.join();
+  }
+  flush();
+
+  // Every activity is either flushed once, or dropped because it was
+  // overwritten or written while it was read.
+  EXPECT_EQ(num_flushed + num_dropped, kNumScopes);
+}
+
+}  // namespace
+}  // namespace tracing
+}  // namespace tfrt
@@ -26,6 +26,7 @@
 #include "tfrt/cpp_tests/error_util.h"
 #include "tfrt/support/logging.h"
 #include "tfrt/support/string_util.h"
+#include "tfrt/tracing/ring_buffer_tracing_sink/ring_buffer_tracing_sink.h"
 #include "tfrt/tracing/tracing.h"
 
 namespace tfrt {
@@ -106,6 +107,42 @@ void BM_StrCatTracingScopes(benchmark::State& state) {
 }
 BENCHMARK(BM_StrCatTracingScopes);
 
+// Measures the overhead of recording scopes into a RingBufferTracingSink,
+// excluding the flush.
+void BM_RingBufferTracingScopes(benchmark::State& state) {
+  RingBufferTracingSink sink(RingBufferTracingSink::Options{});
+  RegisterTracingSink(&sink);
+  TracingRequester requester;
+  for (auto _ : state) {
+    TracingScope("scope");
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_RingBufferTracingScopes);
+
+void BM_RingBufferInternedTracingScopes(benchmark::State& state) {
+  RingBufferTracingSink sink(RingBufferTracingSink::Options{});
+  RegisterTracingSink(&sink);
+  TracingRequester requester;
+  auto name = InternTracingName("scope");
+  for (auto _ : state) {
+    TracingScope scope(name);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_RingBufferInternedTracingScopes);
+
+void BM_RingBufferTracingEvents(benchmark::State& state) {
+  RingBufferTracingSink sink(RingBufferTracingSink::Options{});
+  RegisterTracingSink(&sink);
+  TracingRequester requester;
+  for (auto _ : state) {
+    RecordTracingEvent("event");
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_RingBufferTracingEvents);
+
 }  // namespace
 }  // namespace tracing
 }  // namespace tfrt
@@ -20,6 +20,8 @@
 
 #include "tfrt/tracing/tracing.h"
 
+#include <vector>
+
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "llvm/Support/Error.h"
@@ -44,10 +46,14 @@ class MockTracingSink : TracingSink {
   MOCK_METHOD(void, RecordTracingEvent, (const char*, const char*), (override));
   MOCK_METHOD(void, RecordTracingEvent, (const char*, std::string&&),
               (override));
+  MOCK_METHOD(void, RecordTracingEvent, (const char*, InternedTracingName),
+              (override));
 
   MOCK_METHOD(void, PushTracingScope, (const char*, string_view), (override));
   MOCK_METHOD(void, PushTracingScope, (const char*, const char*), (override));
   MOCK_METHOD(void, PushTracingScope, (const char*, std::string&&), (override));
+  MOCK_METHOD(void, PushTracingScope, (const char*, InternedTracingName),
+              (override));
   MOCK_METHOD(void, PopTracingScope, (), (override));
 };
 
@@ -155,6 +161,73 @@ TEST(TracingTest, Scopes) {
   TracingScope("scope5");  // NOLINT(bugprone-unused-raii)
 }
 
+TEST(TracingTest, InternedNames) {
+  auto name0 = InternTracingName("interned0");
+  auto name1 = InternTracingName(std::string("interned1"));
+  EXPECT_NE(name0, name1);
+  EXPECT_EQ(InternTracingName("interned0"), name0);
+  EXPECT_EQ(GetInternedTracingName(name0), "interned0");
+  EXPECT_EQ(GetInternedTracingName(name1), "interned1");
+
+#ifdef TFRT_DISABLE_TRACING
+  GTEST_SKIP() << "Tracing is disabled";
+#endif
+  InSequence seq;
+  MockTracingSink sink;
+
+  EXPECT_CALL(sink, RequestTracing(true));
+  RequestTracing(true);
+
+  EXPECT_CALL(sink, RecordTracingEvent(IsNull(), name0));
+  RecordTracingEvent(name0);
+
+  EXPECT_CALL(sink, PushTracingScope(TypedEq<const char*>("category"),
+                                     TypedEq<InternedTracingName>(name1)));
+  EXPECT_CALL(sink, PopTracingScope());
+  TracingScope("category", name1);  // NOLINT(bugprone-unused-raii)
+
+  EXPECT_CALL(sink, RequestTracing(false));
+  RequestTracing(false);
+}
+
+TEST(TracingTest, SampledRequests) {
+#ifdef TFRT_DISABLE_TRACING
+  GTEST_SKIP() << "Tracing is disabled";
+#endif
+  InSequence seq;
+  MockTracingSink sink;
+
+  TracingSampler sampler(/*sampling_period=*/3);
+  std::vector<uint64_t> request_ids;
+  for (int i = 0; i < 6; ++i) {
+    if (auto request_id = sampler.Sample()) request_ids.push_back(request_id);
+  }
+  ASSERT_EQ(request_ids.size(), 2);
+  EXPECT_NE(request_ids[0], request_ids[1]);
+  EXPECT_NE(sampler.Sample(/*force=*/true), 0);
+  EXPECT_EQ(TracingSampler(0).Sample(), 0);
+
+  EXPECT_FALSE(IsTracingEnabled());
+  {
+    // Sampled requests are traced without requesting tracing.
+    ScopedTracingRequest tracing_request(request_ids[0]);
+    EXPECT_TRUE(IsTracingEnabled());
+    EXPECT_EQ(GetTracingRequestId(), request_ids[0]);
+
+    EXPECT_CALL(sink,
+                RecordTracingEvent(IsNull(), TypedEq<const char*>("event")));
+    RecordTracingEvent("event");
+
+    {
+      ScopedTracingRequest no_tracing_request(0);
+      EXPECT_FALSE(IsTracingEnabled());
+    }
+    EXPECT_EQ(GetTracingRequestId(), request_ids[0]);
+  }
+  EXPECT_FALSE(IsTracingEnabled());
+  EXPECT_EQ(GetTracingRequestId(), 0);
+}
+
 }  // namespace
 }  // namespace tracing
 }  // namespace tfrt
@@ -46,6 +46,9 @@ enum class HostAllocatorType {
   // Allocator wrapped around profiled malloc and exit(1) on detecting memory
   // leak.
   kLeakCheckMalloc,
+
+  // Allocator with per-thread caches of size classes, backed by malloc.
+  kSizeClassMalloc,
 };
 
 struct RunBefConfig {
@@ -58,6 +61,22 @@ struct RunBefConfig {
   std::string init_function;
   std::string work_queue_type;
   tfrt::HostAllocatorType host_allocator_type;
+  // See ExecutionContext::parallel_dispatch_threshold(). 0 disables parallel
+  // dispatch of ready kernels.
+  size_t parallel_dispatch_threshold = 0;
+  // If true, each function execution allocates from its own ArenaAllocator.
+  // See RequestContext::arena_allocator().
+  bool use_request_arena = false;
+  // Trace one in this number of function executions, regardless of whether
+  // tracing is enabled. 0 disables sampling. See tracing::TracingSampler.
+  uint32_t tracing_sampling_period = 0;
+  // If true, the calls of the kernels of all the executions are aggregated
+  // by kernel, and the profile is printed after all the functions ran. See
+  // KernelProfiler.
+  bool profile_kernels = false;
+  // If not empty, a snapshot of the metrics is written to this file in the
+  // Prometheus text format after all the functions ran.
+  std::string metrics_file;
 };
 
 int RunBefExecutor(const RunBefConfig& run_config);
@@ -350,7 +350,8 @@ template <typename OpHandlerTraits>
   // Finally, run the dispatch function.
   AsyncValueRef<Chain> op_chain;
   {
-    TFRT_TRACE_SCOPE(tfrt::StrCat("RunDispatch: ", op_entry.op_name));
+    // The op name is owned by the op registry, so it is passed without a copy.
+    tracing::TracingScope tracing_scope("RunDispatch", op_entry.op_name);
 
     OpHandlerTraits::Dispatch(op_entry, op_handler_info, arg_tensors, attrs,
                               result_mds, *results, &op_chain, exec_ctx);
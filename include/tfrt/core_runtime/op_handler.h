@@ -25,6 +25,7 @@
 
 #include "llvm/Support/Error.h"
 #include "tfrt/core_runtime/core_runtime_op.h"
+#include "tfrt/metrics/metrics_api.h"
 #include "tfrt/support/error_util.h"
 #include "tfrt/support/forward_decls.h"
 
@@ -56,6 +57,10 @@ class OpHandler {
 
   OpHandler *GetFallback() const { return fallback_; }
 
+  // Counts the ops that CoreRuntime executes with this op handler. Exported as
+  // /tfrt/core_runtime/op_dispatches with an op_handler label.
+  metrics::Counter *dispatch_counter() const { return dispatch_counter_; }
+
   virtual Expected<CoreRuntimeOp> MakeOp(string_view op_name) = 0;
 
   // Copy device tensor to host.
@@ -73,6 +78,7 @@ class OpHandler {
   const std::string name_;
   CoreRuntime *const runtime_;
   OpHandler *const fallback_;
+  metrics::Counter *const dispatch_counter_;
 };
 
 //===----------------------------------------------------------------------===//
@@ -81,7 +87,11 @@ class OpHandler {
 
 inline OpHandler::OpHandler(string_view name, CoreRuntime *runtime,
                             OpHandler *fallback)
-    : name_(name), runtime_(runtime), fallback_(fallback) {}
+    : name_(name),
+      runtime_(runtime),
+      fallback_(fallback),
+      dispatch_counter_(metrics::NewCounter("/tfrt/core_runtime/op_dispatches",
+                                            {{"op_handler", name_}})) {}
 
 }  // namespace tfrt
 
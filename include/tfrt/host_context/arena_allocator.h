@@ -0,0 +1,143 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//===- arena_allocator.h - Request-scoped Arena Allocator -------*- C++ -*-===//
+//
+// This file declares ArenaAllocator, a bump pointer HostAllocator whose memory
+// is released in bulk.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef TFRT_HOST_CONTEXT_ARENA_ALLOCATOR_H_
+#define TFRT_HOST_CONTEXT_ARENA_ALLOCATOR_H_
+
+#include <atomic>
+#include <cstdint>
+
+#include "tfrt/host_context/host_allocator.h"
+#include "tfrt/support/mutex.h"
+#include "tfrt/support/ref_count.h"
+#include "tfrt/support/thread_annotations.h"
+
+namespace tfrt {
+
+// ArenaAllocator carves small allocations out of large blocks with a lock-free
+// bump pointer, and never reuses memory that is deallocated. All the blocks are
+// released together when the arena is destroyed.
+//
+// The arena is reference counted, and every live allocation holds a reference
+// to it. The owner (typically a RequestContext) holds one more reference. This
+// means that the blocks are freed once the owner is gone and the last
+// allocation is deallocated, and an allocation that escapes its request (e.g.
+// an AsyncValue returned to the caller) simply keeps the arena alive instead of
+// dangling.
+//
+// Allocations larger than kMaxAllocationSize are forwarded to the fallback
+// allocator, so that large tensor buffers are returned to the system as soon
+// as they are deallocated.
+//
+// This class is thread-safe.
+class ArenaAllocator final : public HostAllocator,
+                             public ReferenceCounted<ArenaAllocator> {
+ public:
+  // The size of the blocks the arena allocates from the fallback allocator.
+  // Blocks are aligned to their size so that FromPointer can find the arena
+  // that owns an allocation.
+  static constexpr size_t kBlockSize = 64 * 1024;
+
+  // The largest allocation that is served by the arena.
+  static constexpr size_t kMaxAllocationSize = 4 * 1024;
+
+  // `fallback` is used for allocating blocks and for the allocations that are
+  // too large for the arena. It must outlive the arena.
+  explicit ArenaAllocator(HostAllocator* fallback);
+  ~ArenaAllocator() override;
+
+  // Allocate the specified number of bytes with the specified alignment.
+  void* AllocateBytes(size_t size, size_t alignment) override;
+
+  // Deallocate the specified pointer that has the specified size. Memory served
+  // by the arena is not reused, we only drop the reference held by it.
+  void DeallocateBytes(void* ptr, size_t size) override;
+
+  // Allocate the specified number of bytes from the arena. Return nullptr if
+  // the allocation is too large for the arena or a new block can't be
+  // allocated. Memory returned by this method must be deallocated with
+  // DeallocateBytes.
+  void* TryAllocateBytes(size_t size, size_t alignment);
+
+  // Return the arena that served `ptr`. `ptr` must have been returned by
+  // TryAllocateBytes, or by AllocateBytes for a size that is not larger than
+  // kMaxAllocationSize.
+  static ArenaAllocator* FromPointer(const void* ptr) {
+    auto block_address = reinterpret_cast<uintptr_t>(ptr) & ~(kBlockSize - 1);
+    return reinterpret_cast<const Block*>(block_address)->arena;
+  }
+
+  // Return the arena that HostContext allocates AsyncValues from on the
+  // current thread, or nullptr if there is none. See ScopedArenaAllocation.
+  static ArenaAllocator* GetCurrent() { return current_; }
+
+ private:
+  friend class ReferenceCounted<ArenaAllocator>;
+  friend class ScopedArenaAllocation;
+
+  // The header at the start of each block.
+  struct Block {
+    ArenaAllocator* arena;
+    Block* next;
+    // Offset of the first free byte in the block.
+    std::atomic<size_t> offset;
+  };
+
+  // Allocate a new block to replace `full_block` as the current block, unless
+  // another thread has already done it. Return false on allocation failure.
+  bool AddBlock(Block* full_block);
+
+  HostAllocator* const fallback_;
+
+  // Protects the creation of new blocks.
+  mutex mu_;
+  // The list of all blocks, linked through Block::next.
+  Block* blocks_ TFRT_GUARDED_BY(mu_) = nullptr;
+  // The block that allocations are carved from.
+  std::atomic<Block*> current_block_{nullptr};
+
+  static thread_local ArenaAllocator* current_;
+};
+
+// An RAII helper that makes HostContext allocate AsyncValues (and the waiter
+// nodes for them) from `arena` on the current thread for the lifetime of this
+// object. A null `arena` disables arena allocation in this scope. Scopes can be
+// nested.
+class ScopedArenaAllocation {
+ public:
+  explicit ScopedArenaAllocation(ArenaAllocator* arena)
+      : previous_(ArenaAllocator::current_) {
+    ArenaAllocator::current_ = arena;
+  }
+  ~ScopedArenaAllocation() { ArenaAllocator::current_ = previous_; }
+
+  ScopedArenaAllocation(const ScopedArenaAllocation&) = delete;
+  ScopedArenaAllocation& operator=(const ScopedArenaAllocation&) = delete;
+
+ private:
+  ArenaAllocator* const previous_;
+};
+
+}  // namespace tfrt
+
+#endif  // TFRT_HOST_CONTEXT_ARENA_ALLOCATOR_H_
@@ -259,6 +259,7 @@ class AsyncValue {
       : host_context_(host),
         kind_(kind),
         has_vtable_(std::is_polymorphic<T>()),
+        is_arena_allocated_(false),
         type_id_(GetTypeId<T>()),
         waiters_and_state_(WaitersAndState(nullptr, state)) {
     if (AsyncValueAllocationTrackingEnabled())
@@ -269,6 +270,7 @@ class AsyncValue {
       : host_context_(host),
         kind_(kind),
         has_vtable_(false),
+        is_arena_allocated_(false),
         type_id_(0),
         waiters_and_state_(WaitersAndState(nullptr, state)) {
     if (AsyncValueAllocationTrackingEnabled())
@@ -337,8 +339,13 @@ class AsyncValue {
   // has_vtable_ to a global vector<bool> indexed by type_id_.
   const bool has_vtable_ : 1;
 
+  // True if this AsyncValue was allocated from an ArenaAllocator, in which case
+  // its memory and the memory of its waiter nodes are returned to that arena
+  // rather than to the HostContext.
+  bool is_arena_allocated_ : 1;
+
   // Unused padding bits.
-  unsigned unused_ : 5;
+  unsigned unused_ : 4;
 
   // This is a 16-bit value that identifies the type.
   uint16_t type_id_ = 0;
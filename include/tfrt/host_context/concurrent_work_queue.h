@@ -24,9 +24,13 @@
 #ifndef TFRT_HOST_CONTEXT_CONCURRENT_WORK_QUEUE_H_
 #define TFRT_HOST_CONTEXT_CONCURRENT_WORK_QUEUE_H_
 
+#include <chrono>
+#include <cstdint>
 #include <functional>
 #include <memory>
+#include <vector>
 
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/Support/Compiler.h"
 #include "tfrt/host_context/task_function.h"
@@ -35,6 +39,73 @@
 namespace tfrt {
 class AsyncValue;
 
+// Priority of a non-blocking task. Work queues that support priorities run
+// high priority tasks before default priority ones.
+enum class TaskPriority : uint8_t {
+  // Latency-critical work, e.g. the tasks of interactive requests.
+  kHigh = 0,
+  // All other work, e.g. batch processing.
+  kDefault = 1,
+};
+
+// An RAII helper that sets the priority of the non-blocking work enqueued on
+// the current thread without an explicit priority (see
+// HostContext::EnqueueWork).
+class ScopedTaskPriority {
+ public:
+  explicit ScopedTaskPriority(TaskPriority priority) : previous_(current_) {
+    current_ = priority;
+  }
+  ~ScopedTaskPriority() { current_ = previous_; }
+
+  ScopedTaskPriority(const ScopedTaskPriority&) = delete;
+  ScopedTaskPriority& operator=(const ScopedTaskPriority&) = delete;
+
+  // Returns the priority set by the innermost ScopedTaskPriority on the
+  // current thread, or kDefault if there is none.
+  static TaskPriority GetCurrent() { return current_; }
+
+ private:
+  TaskPriority previous_;
+
+  static thread_local TaskPriority current_;
+};
+
+// Statistics of a worker thread of a work queue. Counters are cumulative since
+// the thread started.
+struct WorkerThreadStats {
+  uint64_t num_tasks_executed = 0;
+  // Attempts to steal a task from the queues of the other threads (a single
+  // attempt visits all the other queues until it finds a task).
+  uint64_t num_steal_attempts = 0;
+  uint64_t num_successful_steals = 0;
+  // Steal loops before parking (see WorkerSpinningOptions).
+  uint64_t num_spins = 0;
+  uint64_t num_successful_spins = 0;
+  uint64_t num_parks = 0;
+
+  // Time spent parked waiting for new tasks, and the rest of the lifetime of
+  // the thread, spent running or looking for tasks.
+  std::chrono::nanoseconds parked_time{0};
+  std::chrono::nanoseconds active_time{0};
+
+  // The number of tasks pending in the queue of the thread (an estimate).
+  uint64_t queue_depth = 0;
+};
+
+struct WorkQueueStats {
+  // Threads running non-blocking tasks.
+  std::vector<WorkerThreadStats> worker_threads;
+
+  // Threads running blocking tasks that allow queuing.
+  std::vector<WorkerThreadStats> blocking_threads;
+
+  // Threads started on demand for blocking tasks that don't allow queuing,
+  // and how many of them are idle.
+  int num_dynamic_threads = 0;
+  int num_idle_dynamic_threads = 0;
+};
+
 // This is a pure virtual base class for concurrent work queue implementations.
 // This provides an abstraction for adding work items to a queue to be executed
 // later. Implementation is allowed to execute work items in any order,
@@ -84,6 +155,28 @@ class ConcurrentWorkQueue {
   // thread.
   virtual void AddTask(TaskFunction work) = 0;
 
+  // Enqueue a block of work with the given priority. Thread-safe.
+  //
+  // Implementations that support priorities should run high priority work
+  // before default priority work, without starving the latter. The default
+  // implementation ignores the priority.
+  virtual void AddTaskWithPriority(TaskPriority priority, TaskFunction work) {
+    AddTask(std::move(work));
+  }
+
+  // Enqueue a batch of work with the given priority, moving the tasks out of
+  // `work`. Thread-safe.
+  //
+  // Implementations should make the tasks available to worker threads at a
+  // lower cost than adding them one at a time, e.g. by waking up all the
+  // threads needed to run them at once. The default implementation adds the
+  // tasks one at a time.
+  virtual void AddTasks(TaskPriority priority,
+                        MutableArrayRef<TaskFunction> work) {
+    for (TaskFunction& task : work)
+      AddTaskWithPriority(priority, std::move(task));
+  }
+
   // Enqueue a blocking task. Thread-safe.
   //
   // If `allow_queuing` is false, implementation must guarantee that work will
@@ -117,6 +210,12 @@ class ConcurrentWorkQueue {
   // this work queue. Returns true only for threads executing compute tasks.
   virtual bool IsInWorkerThread() const = 0;
 
+  // Returns the statistics of the threads managed by this work queue. The
+  // counters are read without synchronization, so the values are only
+  // approximately consistent with each other. The default implementation
+  // returns no statistics.
+  virtual WorkQueueStats GetStats() const { return {}; }
+
   ConcurrentWorkQueue() = default;
 
  private:
@@ -148,6 +247,55 @@ std::unique_ptr<ConcurrentWorkQueue> CreateSingleThreadedWorkQueue();
 std::unique_ptr<ConcurrentWorkQueue> CreateMultiThreadedWorkQueue(
     int num_threads, int num_blocking_threads);
 
+// Like CreateMultiThreadedWorkQueue, but places the non-blocking worker threads
+// on the NUMA topology of the machine. Workers are spread evenly over the NUMA
+// nodes and pinned to a CPU, they steal tasks from workers on their own node
+// first, and tasks enqueued from a thread running on a node are pushed to the
+// workers of that node. Blocking threads are not pinned.
+//
+// Requires `num_threads` > 0 and `num_blocking_threads` > 0.
+std::unique_ptr<ConcurrentWorkQueue> CreateNumaAwareMultiThreadedWorkQueue(
+    int num_threads, int num_blocking_threads);
+
+// Non-blocking worker threads that run out of work spin in a steal loop for a
+// while before they park, which reduces the latency of the tasks added shortly
+// after, at the cost of burned CPU cycles. Low-latency serving benefits from
+// more spinning, batch jobs on shared hosts from none.
+struct WorkerSpinningOptions {
+  // The maximum number of threads spinning at the same time. Zero disables
+  // spinning.
+  int max_spinning_threads = 1;
+
+  // The number of steal attempts of a spinning thread before it parks. Zero
+  // selects a default that is inversely proportional to the number of
+  // threads.
+  int spin_count = 0;
+
+  // If true, each thread adapts its spin count to the recent task arrival
+  // rate: it doubles it (up to `spin_count`) when spinning finds a task, and
+  // halves it (down to `spin_count / 16`) when it does not, so that threads
+  // stop burning cycles when tasks arrive rarely. Off by default, so that the
+  // spinning of existing callers is unchanged.
+  bool adaptive = false;
+};
+
+struct MultiThreadedWorkQueueOptions {
+  // See CreateMultiThreadedWorkQueue.
+  int num_threads = 1;
+  int num_blocking_threads = 1;
+
+  // See CreateNumaAwareMultiThreadedWorkQueue.
+  bool numa_aware = false;
+
+  WorkerSpinningOptions spinning;
+};
+
+// Create a multi-threaded work queue with the given options.
+//
+// Requires `num_threads` > 0 and `num_blocking_threads` > 0.
+std::unique_ptr<ConcurrentWorkQueue> CreateMultiThreadedWorkQueue(
+    const MultiThreadedWorkQueueOptions& options);
+
 // A factory function for creating ConcurrentWorkQueue objects. The factory
 // function defines the semantics of the argument string.
 // TODO(pgavin): Consider using a configuration object or other data structure
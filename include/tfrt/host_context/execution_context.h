@@ -23,6 +23,11 @@
 #ifndef TFRT_HOST_CONTEXT_EXECUTION_CONTEXT_H_
 #define TFRT_HOST_CONTEXT_EXECUTION_CONTEXT_H_
 
+#include <cstddef>
+#include <cstdint>
+
+#include "tfrt/host_context/arena_allocator.h"
+#include "tfrt/host_context/concurrent_work_queue.h"
 #include "tfrt/host_context/location.h"
 #include "tfrt/host_context/resource_context.h"
 #include "tfrt/support/ref_count.h"
@@ -31,6 +36,7 @@ namespace tfrt {
 
 class HostContext;
 class ErrorAsyncValue;
+class KernelProfiler;
 
 // A request refers to either a BEFFunction execution or an op execution.
 // RequestContext holds per request information, such as the cancellation status
@@ -41,9 +47,13 @@ class ErrorAsyncValue;
 
 class RequestContext : public ReferenceCounted<RequestContext> {
  public:
+  // If `use_arena_allocator` is true, the request gets its own ArenaAllocator.
+  // See arena_allocator().
   static RCReference<RequestContext> Create(HostContext* host,
-                                            ResourceContext* resource_context) {
-    return TakeRef(new RequestContext(host, resource_context));
+                                            ResourceContext* resource_context,
+                                            bool use_arena_allocator = false) {
+    return TakeRef(
+        new RequestContext(host, resource_context, use_arena_allocator));
   }
   ~RequestContext();
 
@@ -52,6 +62,25 @@ class RequestContext : public ReferenceCounted<RequestContext> {
   HostContext* host() const { return host_; }
   ResourceContext* resource_context() const { return resource_context_; }
 
+  // Return the arena that the executors of this request allocate their state
+  // and AsyncValues from, or nullptr if the request uses the allocator of the
+  // HostContext. The arena is released once this RequestContext and all
+  // the values allocated from the arena are destroyed.
+  ArenaAllocator* arena_allocator() const { return arena_allocator_.get(); }
+
+  // The priority of the non-blocking work of this request. The work enqueued
+  // by the kernels of the request inherits it. Must be set before the request
+  // starts executing.
+  TaskPriority priority() const { return priority_; }
+  void set_priority(TaskPriority priority) { priority_ = priority; }
+
+  // The id of this request if it is sampled for tracing, see
+  // tracing::TracingSampler, or 0 if it is not traced. The work of the request
+  // runs with it as the tracing request of the current thread. Must be set
+  // before the request starts executing.
+  uint64_t tracing_request_id() const { return tracing_request_id_; }
+  void set_tracing_request_id(uint64_t id) { tracing_request_id_ = id; }
+
   // If the request has been canceled, return an ErrorAsyncValue for
   // the cancellation. Otherwise, return nullptr.
   ErrorAsyncValue* GetCancelAsyncValue() const {
@@ -59,11 +88,14 @@ class RequestContext : public ReferenceCounted<RequestContext> {
   }
 
  private:
-  explicit RequestContext(HostContext* host, ResourceContext* resource_context)
-      : host_{host}, resource_context_{resource_context} {}
+  RequestContext(HostContext* host, ResourceContext* resource_context,
+                 bool use_arena_allocator);
 
   HostContext* const host_ = nullptr;
   ResourceContext* const resource_context_ = nullptr;
+  RCReference<ArenaAllocator> arena_allocator_;
+  TaskPriority priority_ = TaskPriority::kDefault;
+  uint64_t tracing_request_id_ = 0;
   std::atomic<ErrorAsyncValue*> cancel_value_{nullptr};
 };
 
@@ -86,11 +118,17 @@ class ExecutionContext {
 
   ExecutionContext(const ExecutionContext& exec_ctx)
       : request_ctx_{exec_ctx.request_ctx_.CopyRef()},
-        location_{exec_ctx.location()} {}
+        location_{exec_ctx.location()},
+        parallel_dispatch_threshold_{exec_ctx.parallel_dispatch_threshold()},
+        kernel_profiler_{exec_ctx.kernel_profiler()},
+        record_function_latency_{exec_ctx.record_function_latency()} {}
 
   ExecutionContext(ExecutionContext&& exec_ctx)
       : request_ctx_{std::move(exec_ctx.request_ctx_)},
-        location_{exec_ctx.location()} {}
+        location_{exec_ctx.location()},
+        parallel_dispatch_threshold_{exec_ctx.parallel_dispatch_threshold()},
+        kernel_profiler_{exec_ctx.kernel_profiler()},
+        record_function_latency_{exec_ctx.record_function_latency()} {}
 
   Location location() const { return location_; }
   HostContext* host() const { return request_ctx_->host(); }
@@ -101,6 +139,38 @@ class ExecutionContext {
 
   void set_location(Location location) { location_ = location; }
   RequestContext* request_ctx() const { return request_ctx_.get(); }
+  TaskPriority priority() const { return request_ctx_->priority(); }
+  uint64_t tracing_request_id() const {
+    return request_ctx_->tracing_request_id();
+  }
+
+  // When more than this number of kernels become ready at once during a BEF
+  // function execution, the executor keeps one of them on the current thread
+  // and dispatches the others to HostContext::EnqueueWork, so that independent
+  // branches of a wide graph run in parallel. The default value 0 disables
+  // this, and all ready kernels are run inline on the current thread.
+  size_t parallel_dispatch_threshold() const {
+    return parallel_dispatch_threshold_;
+  }
+  void set_parallel_dispatch_threshold(size_t threshold) {
+    parallel_dispatch_threshold_ = threshold;
+  }
+
+  // If not null, the BEF executor records the calls of the kernels it runs in
+  // this profiler. See KernelProfiler.
+  KernelProfiler* kernel_profiler() const { return kernel_profiler_; }
+  void set_kernel_profiler(KernelProfiler* profiler) {
+    kernel_profiler_ = profiler;
+  }
+
+  // If true, the BEF executor records the latency of the function it executes
+  // in the /tfrt/bef_executor/function_latency_ns histogram. The executor
+  // clears this flag for the kernels it runs, so only the top-level function
+  // of a request is recorded and not the functions it calls.
+  bool record_function_latency() const { return record_function_latency_; }
+  void set_record_function_latency(bool record) {
+    record_function_latency_ = record;
+  }
 
   ResourceContext* resource_context() const {
     return request_ctx_->resource_context();
@@ -109,6 +179,9 @@ class ExecutionContext {
  private:
   RCReference<RequestContext> request_ctx_;
   Location location_;
+  size_t parallel_dispatch_threshold_ = 0;
+  KernelProfiler* kernel_profiler_ = nullptr;
+  bool record_function_latency_ = false;
 };
 
 }  // namespace tfrt
@@ -78,6 +78,13 @@ class HostAllocator {
 // Create an allocator that just calls malloc/free.
 std::unique_ptr<HostAllocator> CreateMallocAllocator();
 
+// Create an allocator that serves small allocations from per-thread caches of
+// size-segregated free lists, and forwards large allocations to `allocator`.
+// Memory for small allocations is taken from `allocator` in large slabs, which
+// are only released when the returned allocator is destroyed.
+std::unique_ptr<HostAllocator> CreateSizeClassAllocator(
+    std::unique_ptr<HostAllocator> allocator);
+
 // Create an allocator of fixed size for testing.
 std::unique_ptr<HostAllocator> CreateFixedSizeAllocator(size_t capacity = 1024);
 
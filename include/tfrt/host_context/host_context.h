@@ -26,7 +26,9 @@
 #include <type_traits>
 
 #include "llvm/Support/Compiler.h"
+#include "tfrt/host_context/arena_allocator.h"
 #include "tfrt/host_context/async_value_ref.h"
+#include "tfrt/host_context/concurrent_work_queue.h"
 #include "tfrt/host_context/device.h"
 #include "tfrt/host_context/kernel_registry.h"
 #include "tfrt/host_context/timer_queue.h"
@@ -132,6 +134,10 @@ class HostContext {
     Deallocate(t);
   }
 
+  // The AsyncValues made by the methods below are allocated from the current
+  // thread's ArenaAllocator if there is one (see ScopedArenaAllocation), and
+  // from the allocator of this HostContext otherwise.
+
   // Allocate an unconstructed AsyncValueRef. The AsyncValueRef should be made
   // available later by invoking AsyncValueRef::emplace or
   // AsyncValueRef::SetError.
@@ -171,8 +177,25 @@ class HostContext {
   void Quiesce();
 
   // Add some non-blocking work to the work_queue managed by this CPU device.
+  // The work gets the priority of the current thread (see ScopedTaskPriority).
   void EnqueueWork(llvm::unique_function<void()> work);
 
+  // Add some non-blocking work with the given priority to the work_queue
+  // managed by this CPU device. The work runs with `priority` as the priority
+  // of the current thread, so that all the work it enqueues inherits it.
+  void EnqueueWork(TaskPriority priority, llvm::unique_function<void()> work);
+
+  // Add a batch of non-blocking work to the work_queue managed by this CPU
+  // device, moving the work items out of `work`. This is cheaper than adding
+  // the work items one at a time, e.g. for fanning out many small tasks. The
+  // work gets the priority of the current thread (see ScopedTaskPriority).
+  void EnqueueWork(MutableArrayRef<llvm::unique_function<void()>> work);
+
+  // Add a batch of non-blocking work with the given priority to the
+  // work_queue managed by this CPU device (see above).
+  void EnqueueWork(TaskPriority priority,
+                   MutableArrayRef<llvm::unique_function<void()>> work);
+
   // Add some non-blocking work to the work_queue managed by this CPU device.
   // Return AsyncValueRef<R> for work that returns R. R cannot be void.
   //
@@ -221,6 +244,10 @@ class HostContext {
   // by this context. Returns true only for threads executing non-blocking work.
   bool IsInWorkerThread() const;
 
+  // Returns the statistics of the threads of the work queue managed by this
+  // context (see ConcurrentWorkQueue::GetStats).
+  WorkQueueStats GetWorkQueueStats() const;
+
   // Run the specified function when the specified set of AsyncValue's are all
   // resolved.  This is a set-version of "AndThen".
   void RunWhenReady(ArrayRef<AsyncValue*> values,
@@ -281,6 +308,11 @@ class HostContext {
   SharedContext& GetOrCreateSharedContext(int shared_context_id,
                                           SharedContextFactory factory);
 
+  // Allocate and construct an AsyncValue subclass T, preferring the current
+  // thread's ArenaAllocator.
+  template <typename T, typename... Args>
+  T* ConstructAsyncValue(Args&&... args);
+
   //===--------------------------------------------------------------------===//
   // TimerQueue
   //===--------------------------------------------------------------------===//
@@ -303,25 +335,40 @@ class HostContext {
 
 template <typename T, typename... Args>
 AsyncValueRef<T> HostContext::MakeConstructedAsyncValueRef(Args&&... args) {
-  return AsyncValueRef<T>(TakeRef(Construct<internal::ConcreteAsyncValue<T>>(
-      instance_ptr_,
-      typename internal::ConcreteAsyncValue<T>::ConstructedPayload{},
-      std::forward<Args>(args)...)));
+  return AsyncValueRef<T>(
+      TakeRef(ConstructAsyncValue<internal::ConcreteAsyncValue<T>>(
+          instance_ptr_,
+          typename internal::ConcreteAsyncValue<T>::ConstructedPayload{},
+          std::forward<Args>(args)...)));
 }
 
 template <typename T, typename... Args>
 AsyncValueRef<T> HostContext::MakeAvailableAsyncValueRef(Args&&... args) {
-  return AsyncValueRef<T>(TakeRef(Construct<internal::ConcreteAsyncValue<T>>(
-      instance_ptr_,
-      typename internal::ConcreteAsyncValue<T>::ConcretePayload{},
-      std::forward<Args>(args)...)));
+  return AsyncValueRef<T>(
+      TakeRef(ConstructAsyncValue<internal::ConcreteAsyncValue<T>>(
+          instance_ptr_,
+          typename internal::ConcreteAsyncValue<T>::ConcretePayload{},
+          std::forward<Args>(args)...)));
 }
 
 template <typename T>
 AsyncValueRef<T> HostContext::MakeUnconstructedAsyncValueRef() {
-  return AsyncValueRef<T>(TakeRef(Construct<internal::ConcreteAsyncValue<T>>(
-      instance_ptr_,
-      typename internal::ConcreteAsyncValue<T>::UnconstructedPayload{})));
+  return AsyncValueRef<T>(
+      TakeRef(ConstructAsyncValue<internal::ConcreteAsyncValue<T>>(
+          instance_ptr_,
+          typename internal::ConcreteAsyncValue<T>::UnconstructedPayload{})));
+}
+
+template <typename T, typename... Args>
+T* HostContext::ConstructAsyncValue(Args&&... args) {
+  if (ArenaAllocator* arena = ArenaAllocator::GetCurrent()) {
+    if (void* buf = arena->TryAllocateBytes(sizeof(T), alignof(T))) {
+      T* value = new (buf) T(std::forward<Args>(args)...);
+      static_cast<AsyncValue*>(value)->is_arena_allocated_ = true;
+      return value;
+    }
+  }
+  return Construct<T>(std::forward<Args>(args)...);
 }
 
 template <typename SharedContextType>
@@ -0,0 +1,112 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//===- kernel_profiler.h - Kernel Execution Profiler ------------*- C++ -*-===//
+//
+// This file declares KernelProfiler, which aggregates the calls of the kernels
+// run by the BEF executor into a per-kernel profile.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef TFRT_HOST_CONTEXT_KERNEL_PROFILER_H_
+#define TFRT_HOST_CONTEXT_KERNEL_PROFILER_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "tfrt/host_context/location.h"
+#include "tfrt/support/forward_decls.h"
+#include "tfrt/support/mutex.h"
+#include "tfrt/support/thread_annotations.h"
+
+namespace tfrt {
+
+// KernelProfiler aggregates the calls of each kernel over many executions: the
+// number of calls and errors, and the distribution of their wall times. It is
+// enabled for an execution with ExecutionContext::set_kernel_profiler().
+//
+// The wall time of a call is the time until the kernel returns, which does not
+// include the asynchronous work that the kernel leaves behind. A call is an
+// error if one of the results of the kernel is an error when it returns.
+//
+// Each thread records the calls into its own table, so that recording takes no
+// contended lock. The tables are merged by GetProfile().
+class KernelProfiler {
+ public:
+  // The aggregated calls of a kernel.
+  struct KernelProfile {
+    std::string kernel_name;
+    int64_t num_calls = 0;
+    int64_t num_errors = 0;
+    int64_t total_ns = 0;
+    // Approximate, within 1/8 of the value.
+    int64_t p99_ns = 0;
+    int64_t max_ns = 0;
+    // The location of the slowest call, if the kernel has one.
+    DecodedLocation max_location;
+  };
+
+  KernelProfiler();
+  ~KernelProfiler();
+
+  // This class is not copyable or movable.
+  KernelProfiler(const KernelProfiler&) = delete;
+  KernelProfiler& operator=(const KernelProfiler&) = delete;
+
+  // Records a call of the kernel with `kernel_name`. Calls with the same
+  // `kernel_name` pointer are aggregated, so the name should be interned, e.g.
+  // by the BEF file. It is copied, so it needs not outlive the profiler.
+  void RecordKernelCall(const char* kernel_name, Location location,
+                        int64_t duration_ns, bool is_error)
+      TFRT_EXCLUDES(mu_);
+
+  // Returns the profile of the kernels called so far, merged by kernel name
+  // and sorted by decreasing total time.
+  std::vector<KernelProfile> GetProfile() const TFRT_EXCLUDES(mu_);
+
+  // Writes the result of GetProfile() as a table.
+  void PrintProfile(raw_ostream& os) const;
+
+  // Returns the number of threads which recorded calls.
+  size_t GetNumThreads() const TFRT_EXCLUDES(mu_);
+
+ private:
+  struct ThreadTable;
+
+  // Returns the table of the calling thread, which is created on first use.
+  // The table is cached in a thread_local for the last profiler the thread
+  // used, and looked up in thread_tables_ when the cache holds another
+  // profiler.
+  ThreadTable* GetThreadTable() TFRT_EXCLUDES(mu_);
+
+  // Identifies this profiler in the cache of the table of a thread.
+  const uint64_t id_;
+
+  mutable mutex mu_;
+  // The tables of all the threads which recorded calls.
+  std::vector<std::unique_ptr<ThreadTable>> tables_ TFRT_GUARDED_BY(mu_);
+  // The table of each thread in tables_.
+  std::unordered_map<std::thread::id, ThreadTable*> thread_tables_
+      TFRT_GUARDED_BY(mu_);
+};
+
+}  // namespace tfrt
+
+#endif  // TFRT_HOST_CONTEXT_KERNEL_PROFILER_H_
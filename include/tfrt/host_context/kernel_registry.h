@@ -46,6 +46,15 @@ using SyncKernelImplementation = void (*)(SyncKernelFrame* frame);
 using KernelImplementation =
     llvm::PointerUnion<AsyncKernelImplementation, SyncKernelImplementation>;
 
+// The cost class of a kernel, which is used by the executor to schedule it.
+// Cheap kernels are run inline on the thread that makes them ready. Expensive
+// kernels are dispatched to the work queue when the thread has other kernels to
+// run, so that they do not delay cheap kernels on the critical path.
+enum class KernelCost : uint8_t {
+  kCheap = 0,
+  kExpensive = 1,
+};
+
 namespace internal {
 
 template <typename TraitT>
@@ -63,7 +72,8 @@ class KernelRegistry {
 
   // TODO: Rename AddKernel to AddAsyncKernel. This will involve touching a
   // large number of files, so it is better to do this in a separate CL.
-  void AddKernel(string_view name, AsyncKernelImplementation fn);
+  void AddKernel(string_view name, AsyncKernelImplementation fn,
+                 KernelCost cost = KernelCost::kCheap);
   void AddSyncKernel(string_view name, SyncKernelImplementation fn);
 
   template <typename KernelTraitT>
@@ -73,6 +83,10 @@ class KernelRegistry {
 
   KernelImplementation GetKernel(string_view name) const;
 
+  // Return the cost class the kernel was registered with. Unknown kernels are
+  // cheap.
+  KernelCost GetKernelCost(string_view name) const;
+
   TypeName GetType(string_view type) const;
 
  private:
@@ -201,7 +201,10 @@ AsyncValueRef<R> ParallelFor::Execute(
       // their asynchronous results are completed. When all block results are
       // ready, call `on_done` function to compute a value for `result`.
       [host = host_, ctx = std::move(ctx)]() mutable -> void {
-        host->RunWhenReady(ctx->BlockResults(), [host, ctx = std::move(ctx)]() {
+        // Collect the block results before `ctx` is moved into the callback,
+        // function arguments are evaluated in an unspecified order.
+        llvm::SmallVector<AsyncValue*, 32> block_results = ctx->BlockResults();
+        host->RunWhenReady(block_results, [host, ctx = std::move(ctx)]() {
           R result = ctx->on_done(ctx->block_results);
           ctx->result.emplace(std::move(result));
         });
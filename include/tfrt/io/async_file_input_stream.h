@@ -0,0 +1,100 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//===- async_file_input_stream.h --------------------------------*- C++ -*-===//
+//
+// This file declares AsyncFileInputStream which reads a local file ahead of
+// its reader with asynchronous reads.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef TFRT_IO_ASYNC_FILE_INPUT_STREAM_H_
+#define TFRT_IO_ASYNC_FILE_INPUT_STREAM_H_
+
+#include <memory>
+#include <vector>
+
+#include "tfrt/host_context/async_value_ref.h"
+#include "tfrt/io/async_file_reader.h"
+#include "tfrt/io/input_stream.h"
+#include "tfrt/support/error_util.h"
+#include "tfrt/support/forward_decls.h"
+
+namespace tfrt {
+namespace io {
+
+// AsyncFileInputStream splits the file into chunks and keeps reads of the next
+// `num_chunks` chunks in flight on an AsyncFileReader. Read() copies from the
+// chunks that are already read, and only waits if the reader got ahead of the
+// reads. This way a single thread parsing a file rarely waits for the disk,
+// and the reads of many streams share a few threads.
+class AsyncFileInputStream : public InputStream {
+ public:
+  // Opens the file at `path` and starts reading its first chunks. Returns an
+  // error if the file can't be opened.
+  static llvm::Expected<std::unique_ptr<AsyncFileInputStream>> Open(
+      string_view path, size_t chunk_size, int num_chunks,
+      AsyncFileReader* reader, HostContext* host);
+
+  // Waits for the reads in flight, which write into the chunks.
+  ~AsyncFileInputStream() override;
+
+  // This class is not copyable or movable.
+  AsyncFileInputStream(const AsyncFileInputStream&) = delete;
+  AsyncFileInputStream& operator=(const AsyncFileInputStream&) = delete;
+
+  // Copies the next bytes out of the chunks. This blocks if the next chunk is
+  // not read yet, so it should not be called by a non-blocking work queue
+  // thread.
+  llvm::Expected<size_t> Read(char* buf, size_t count) override;
+
+  llvm::Expected<size_t> Tell() override { return pos_; }
+
+ private:
+  struct Chunk {
+    char* data = nullptr;
+    // Resolves to the number of bytes read into `data`.
+    AsyncValueRef<size_t> size;
+  };
+
+  AsyncFileInputStream(llvm::sys::fs::file_t file, size_t chunk_size,
+                       int num_chunks, AsyncFileReader* reader,
+                       HostContext* host);
+
+  // Starts reading the chunk at `next_offset_` into `chunk`.
+  void StartRead(Chunk* chunk);
+
+  llvm::sys::fs::file_t file_;
+  const size_t chunk_size_;
+  AsyncFileReader* reader_;
+  HostContext* host_;
+
+  // The chunks are read in a round robin order. chunks_[current_] is the chunk
+  // being consumed.
+  std::vector<Chunk> chunks_;
+  int current_ = 0;
+  // The position in the current chunk of the next byte to be read.
+  size_t chunk_pos_ = 0;
+  // The offset in the file of the next chunk to start reading.
+  uint64_t next_offset_ = 0;
+  // The position of the next byte to be read.
+  size_t pos_ = 0;
+};
+
+}  // namespace io
+}  // namespace tfrt
+
+#endif  // TFRT_IO_ASYNC_FILE_INPUT_STREAM_H_
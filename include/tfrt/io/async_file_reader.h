@@ -0,0 +1,77 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//===- async_file_reader.h --------------------------------------*- C++ -*-===//
+//
+// This file declares AsyncFileReader which reads ranges of local files
+// asynchronously.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef TFRT_IO_ASYNC_FILE_READER_H_
+#define TFRT_IO_ASYNC_FILE_READER_H_
+
+#include <cstdint>
+#include <memory>
+
+#include "llvm/Support/FileSystem.h"
+#include "tfrt/host_context/async_value_ref.h"
+
+namespace tfrt {
+
+class HostContext;
+
+namespace io {
+
+// AsyncFileReader submits positional reads of local files without blocking
+// the calling thread, so that a few threads can keep many reads in flight.
+//
+// On Linux reads are submitted to an io_uring, and a single completion thread
+// per reader resolves the results of all the reads. If io_uring is not
+// available (e.g. on other platforms, old kernels or in sandboxes that forbid
+// the syscalls), the reader falls back to a pread in the calling thread and
+// returns an available result.
+class AsyncFileReader {
+ public:
+  // Returns the reader shared by the process, created on first use.
+  static AsyncFileReader* GetDefault();
+
+  // Creates a reader that keeps at most `queue_depth` reads in flight. Reads
+  // submitted when the queue is full are served by pread in the calling
+  // thread. If `use_io_uring` is false, all reads are served by pread.
+  static std::unique_ptr<AsyncFileReader> Create(unsigned queue_depth,
+                                                 bool use_io_uring = true);
+
+  virtual ~AsyncFileReader() = default;
+
+  // Returns true if the reads are served by io_uring.
+  virtual bool IsAsync() const = 0;
+
+  // Reads `count` bytes at `offset` of `file` into `buf`, and resolves the
+  // result to the number of bytes read, which is less than `count` only at the
+  // end of the file. `buf` must stay valid until the result is available.
+  //
+  // The result might be resolved on the completion thread of the reader, so
+  // the waiters of the result should be cheap or enqueue their work.
+  virtual AsyncValueRef<size_t> ReadAt(llvm::sys::fs::file_t file,
+                                       uint64_t offset, char* buf,
+                                       size_t count, HostContext* host) = 0;
+};
+
+}  // namespace io
+}  // namespace tfrt
+
+#endif  // TFRT_IO_ASYNC_FILE_READER_H_
@@ -0,0 +1,77 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//===- mapped_file_input_stream.h -------------------------------*- C++ -*-===//
+//
+// This file declares MappedFileInputStream which reads a local file through a
+// read-only memory mapping.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef TFRT_IO_MAPPED_FILE_INPUT_STREAM_H_
+#define TFRT_IO_MAPPED_FILE_INPUT_STREAM_H_
+
+#include <memory>
+
+#include "tfrt/host_context/host_buffer.h"
+#include "tfrt/io/input_stream.h"
+#include "tfrt/support/error_util.h"
+#include "tfrt/support/forward_decls.h"
+
+namespace tfrt {
+namespace io {
+
+// MappedFileInputStream maps the whole file into memory when it is opened.
+// Besides the InputStream interface, which copies the bytes out of the
+// mapping, it gives readers access to the mapped bytes in place, so that large
+// files can be read without copying them through intermediate buffers.
+class MappedFileInputStream : public InputStream {
+ public:
+  // Maps the file at `path`. Returns an error if the file can't be opened or
+  // mapped.
+  static llvm::Expected<std::unique_ptr<MappedFileInputStream>> Open(
+      string_view path);
+
+  // This class is not copyable or movable.
+  MappedFileInputStream(const MappedFileInputStream&) = delete;
+  MappedFileInputStream& operator=(const MappedFileInputStream&) = delete;
+
+  llvm::Expected<size_t> Read(char* buf, size_t count) override;
+
+  llvm::Expected<size_t> Tell() override { return pos_; }
+
+  // Advances the stream by up to `count` bytes like Read(), but returns the
+  // bytes in place instead of copying them. The returned bytes stay valid as
+  // long as the stream or a reference to its buffer() is alive.
+  ArrayRef<char> ReadInPlace(size_t count);
+
+  // The contents of the file. Slices of the buffer (see
+  // HostBuffer::CreateFromExternal) keep the mapping alive.
+  const RCReference<HostBuffer>& buffer() const { return buffer_; }
+
+ private:
+  explicit MappedFileInputStream(RCReference<HostBuffer> buffer)
+      : buffer_(std::move(buffer)) {}
+
+  RCReference<HostBuffer> buffer_;
+  // The position of the next byte to be read.
+  size_t pos_ = 0;
+};
+
+}  // namespace io
+}  // namespace tfrt
+
+#endif  // TFRT_IO_MAPPED_FILE_INPUT_STREAM_H_
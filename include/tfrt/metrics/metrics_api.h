@@ -23,12 +23,17 @@
 #ifndef TFRT_METRICS_METRICS_API_H_
 #define TFRT_METRICS_METRICS_API_H_
 
+#include <cstdint>
 #include <string>
+#include <utility>
 #include <vector>
 
 namespace tfrt {
 namespace metrics {
 
+// The labels of a metric as (key, value) pairs, e.g. {{"op_handler", "cpu"}}.
+using MetricLabels = std::vector<std::pair<std::string, std::string>>;
+
 template <typename T>
 class Gauge {
  public:
@@ -37,9 +42,37 @@ class Gauge {
   virtual void SetValue(T value) = 0;
 };
 
+// A count that only goes up, e.g. of events or bytes.
+class Counter {
+ public:
+  virtual ~Counter() {}
+
+  virtual void IncrementBy(int64_t value) = 0;
+  void Increment() { IncrementBy(1); }
+};
+
+// A distribution of non-negative values, e.g. latencies.
+class Histogram {
+ public:
+  virtual ~Histogram() {}
+
+  virtual void Record(int64_t value) = 0;
+};
+
+// The functions below return the metric with the given name and labels. The
+// metrics are owned by the implementation and live until the process exits.
+// Updating a metric must be cheap and thread-safe, so that kernels can update
+// them on their hot paths.
+
+// Returns a new gauge with the given name. Implementations provide `T` =
+// std::string and int64_t.
 template <typename T>
 Gauge<T>* NewGauge(std::string name);
 
+Counter* NewCounter(std::string name, MetricLabels labels = {});
+
+Histogram* NewHistogram(std::string name, MetricLabels labels = {});
+
 }  // namespace metrics
 }  // namespace tfrt
 
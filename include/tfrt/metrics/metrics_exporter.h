@@ -0,0 +1,79 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//===- metrics_exporter.h ---------------------------------------*- C++ -*-===//
+//
+// This file declares the exporters of the built-in metrics implementation.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef TFRT_METRICS_METRICS_EXPORTER_H_
+#define TFRT_METRICS_METRICS_EXPORTER_H_
+
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "llvm/ADT/ArrayRef.h"
+#include "tfrt/metrics/metrics_registry.h"
+#include "tfrt/support/forward_decls.h"
+
+namespace tfrt {
+namespace metrics {
+
+// Writes `metrics` in the Prometheus text exposition format. The characters of
+// the names which are not valid in Prometheus metric names, e.g. '/', are
+// replaced by '_'. String gauges are written as a gauge with value 1 and the
+// string as a "value" label. The buckets of histograms are written up to the
+// last non-empty one, followed by the +Inf bucket.
+void WritePrometheusText(ArrayRef<MetricSnapshot> metrics, raw_ostream& os);
+
+// Writes a snapshot of all the metrics to the file at `path` in the Prometheus
+// text format. The file is written next to `path` and renamed, so that readers
+// of `path`, e.g. the node exporter textfile collector, never read a partial
+// snapshot.
+Error WriteMetricsFile(string_view path);
+
+// Serves snapshots of all the metrics on a Unix domain socket: every client
+// which connects to the socket reads a snapshot in the Prometheus text format,
+// until the server closes the connection, e.g. with `socat - UNIX:<path>`.
+class MetricsSocketServer {
+ public:
+  // Starts serving on a new socket at `path`.
+  static Expected<std::unique_ptr<MetricsSocketServer>> Create(
+      string_view path);
+
+  // Stops serving and removes the socket.
+  ~MetricsSocketServer();
+
+  // This class is not copyable or movable.
+  MetricsSocketServer(const MetricsSocketServer&) = delete;
+  MetricsSocketServer& operator=(const MetricsSocketServer&) = delete;
+
+ private:
+  MetricsSocketServer(std::string path, int socket_fd);
+
+  void Serve();
+
+  const std::string path_;
+  const int socket_fd_;
+  std::thread thread_;
+};
+
+}  // namespace metrics
+}  // namespace tfrt
+
+#endif  // TFRT_METRICS_METRICS_EXPORTER_H_
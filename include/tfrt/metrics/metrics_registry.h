@@ -0,0 +1,87 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//===- metrics_registry.h ---------------------------------------*- C++ -*-===//
+//
+// This file declares the snapshot API of the built-in metrics implementation.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef TFRT_METRICS_METRICS_REGISTRY_H_
+#define TFRT_METRICS_METRICS_REGISTRY_H_
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "tfrt/metrics/metrics_api.h"
+
+namespace tfrt {
+namespace metrics {
+
+// The value of a metric at the time of a snapshot.
+struct MetricSnapshot {
+  enum class Kind { kCounter, kGauge, kHistogram };
+
+  // The values in a histogram bucket, which are all in
+  // [lower_bound, upper_bound].
+  struct Bucket {
+    int64_t lower_bound;
+    int64_t upper_bound;
+    uint64_t count;
+  };
+
+  std::string name;
+  MetricLabels labels;
+  Kind kind;
+
+  // The value of a counter or an int64_t gauge.
+  int64_t value = 0;
+  // The value of a std::string gauge.
+  bool is_string = false;
+  std::string string_value;
+
+  // The buckets of a histogram in increasing order, up to the last non-empty
+  // bucket, and the number and sum of its values.
+  std::vector<Bucket> buckets;
+  uint64_t count = 0;
+  int64_t sum = 0;
+};
+
+// Returns a snapshot of all the metrics, sorted by name and labels. The
+// collectors are run first. The metrics are read without stopping their
+// updates, so the snapshot of a histogram may miss values recorded
+// concurrently.
+//
+// The functions in this file are only provided by the built-in metrics
+// implementation, i.e. if ENABLE_TFRT_METRICS is not defined.
+std::vector<MetricSnapshot> GetMetricsSnapshot();
+
+// Adds a collector, which GetMetricsSnapshot() calls before it reads the
+// metrics, so that the metrics which are sampled rather than updated, e.g. the
+// gauges of the statistics of a work queue, are current in every snapshot.
+// `collector` must not take a snapshot. Returns the id to remove it with.
+int64_t AddMetricsCollector(std::function<void()> collector);
+
+// Removes the collector with `id`. When this function returns, the collector
+// is not running and will not be called again.
+void RemoveMetricsCollector(int64_t id);
+
+}  // namespace metrics
+}  // namespace tfrt
+
+#endif  // TFRT_METRICS_METRICS_REGISTRY_H_
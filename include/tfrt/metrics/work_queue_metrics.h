@@ -0,0 +1,61 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//===- work_queue_metrics.h -------------------------------------*- C++ -*-===//
+//
+// This file declares the export of work queue statistics to metrics.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef TFRT_METRICS_WORK_QUEUE_METRICS_H_
+#define TFRT_METRICS_WORK_QUEUE_METRICS_H_
+
+#include <cstdint>
+
+namespace tfrt {
+
+class HostContext;
+
+namespace metrics {
+
+// Sets the /tfrt/work_queue/* gauges to the statistics of the work queue of
+// `host`, summed over the worker threads (see HostContext::GetWorkQueueStats).
+// The statistics are sampled when this function is called, see
+// WorkQueueMetricsCollector to sample them in every snapshot.
+void ExportWorkQueueMetrics(const HostContext& host);
+
+// Calls ExportWorkQueueMetrics(host) whenever a snapshot of the built-in
+// metrics is taken (see GetMetricsSnapshot), e.g. by WriteMetricsFile() or a
+// MetricsSocketServer, until this object is destroyed. `host` must outlive
+// this object.
+class WorkQueueMetricsCollector {
+ public:
+  explicit WorkQueueMetricsCollector(const HostContext& host);
+  ~WorkQueueMetricsCollector();
+
+  // This class is not copyable or movable.
+  WorkQueueMetricsCollector(const WorkQueueMetricsCollector&) = delete;
+  WorkQueueMetricsCollector& operator=(const WorkQueueMetricsCollector&) =
+      delete;
+
+ private:
+  int64_t collector_id_;
+};
+
+}  // namespace metrics
+}  // namespace tfrt
+
+#endif  // TFRT_METRICS_WORK_QUEUE_METRICS_H_
@@ -0,0 +1,122 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//===- ring_buffer_tracing_sink.h - Ring Buffer Tracing Sink ----*- C++ -*-===//
+//
+// This file declares a tracing sink which records activities into per-thread
+// ring buffers and exports them in the Chrome trace event format.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef TFRT_TRACING_RING_BUFFER_TRACING_SINK_H_
+#define TFRT_TRACING_RING_BUFFER_TRACING_SINK_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "tfrt/support/mutex.h"
+#include "tfrt/support/thread_annotations.h"
+#include "tfrt/tracing/tracing.h"
+
+namespace tfrt {
+namespace tracing {
+
+// RingBufferTracingSink records the activities of each thread into a ring
+// buffer that is allocated when the thread records its first activity. After
+// that, recording an activity takes no lock and allocates no memory: when the
+// buffer of a thread is full, its oldest activities are overwritten, and names
+// longer than kMaxNameSize are truncated. Interned names are stored as their
+// ids and are not copied. Categories are stored as pointers and must outlive
+// the sink.
+//
+// Flush() writes the activities recorded since the last flush as a Chrome
+// trace event JSON object, which can be loaded by chrome://tracing and
+// ui.perfetto.dev. It may run concurrently with the threads recording
+// activities, activities overwritten while they are read are skipped. Scopes
+// which are still open are written as begin events without an end. The
+// activities of sampled requests have the request id in their arguments.
+class RingBufferTracingSink : public TracingSink {
+ public:
+  // The maximum number of bytes of a name that are recorded.
+  static constexpr size_t kMaxNameSize = 79;
+
+  struct Options {
+    // The number of activities each thread keeps, rounded up to a power of
+    // two.
+    size_t capacity_per_thread = 1 << 12;
+    // If not empty, the trace is flushed to this file whenever tracing is
+    // disabled.
+    std::string output_path;
+  };
+
+  explicit RingBufferTracingSink(Options options);
+  ~RingBufferTracingSink() override;
+
+  // This class is not copyable or movable.
+  RingBufferTracingSink(const RingBufferTracingSink&) = delete;
+  RingBufferTracingSink& operator=(const RingBufferTracingSink&) = delete;
+
+  Error RequestTracing(bool enable) override;
+  void RecordTracingEvent(const char* category, string_view name) override;
+  void RecordTracingEvent(const char* category,
+                          InternedTracingName name) override;
+  void PushTracingScope(const char* category, string_view name) override;
+  void PushTracingScope(const char* category,
+                        InternedTracingName name) override;
+  void PopTracingScope() override;
+
+  // Writes the activities recorded since the last flush to `os` in the Chrome
+  // trace event format.
+  void Flush(raw_ostream& os) TFRT_EXCLUDES(mu_);
+  // Like above, but writes the activities to the file at `path`.
+  Error Flush(string_view path) TFRT_EXCLUDES(mu_);
+
+ private:
+  struct ThreadBuffer;
+
+  template <typename Name>
+  void RecordEvent(const char* category, Name name);
+  template <typename Name>
+  void PushScope(const char* category, Name name);
+
+  // Returns the buffer of the calling thread, which is created on first use.
+  // The buffer is cached in a thread_local for the last sink the thread used,
+  // and looked up in thread_buffers_ when the cache holds another sink.
+  ThreadBuffer* GetThreadBuffer() TFRT_EXCLUDES(mu_);
+
+  const Options options_;
+  // Identifies this sink in the cache of the buffer of a thread.
+  const uint64_t id_;
+  const size_t capacity_;
+
+  mutex mu_;
+  // The buffers of all the threads which recorded activities. The buffers of
+  // exited threads are kept so that their activities can be flushed.
+  std::vector<std::unique_ptr<ThreadBuffer>> buffers_ TFRT_GUARDED_BY(mu_);
+  // The buffer of each thread in buffers_. A thread which gets the id of an
+  // exited thread continues its buffer.
+  std::unordered_map<std::thread::id, ThreadBuffer*> thread_buffers_
+      TFRT_GUARDED_BY(mu_);
+};
+
+}  // namespace tracing
+}  // namespace tfrt
+
+#endif  // TFRT_TRACING_RING_BUFFER_TRACING_SINK_H_
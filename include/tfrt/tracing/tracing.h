@@ -32,6 +32,30 @@
 namespace tfrt {
 namespace tracing {
 
+// The id of a name registered with InternTracingName(). Recording an interned
+// name passes this id instead of the string, so that sinks can store the id
+// and only look up the name when they export their activities.
+struct InternedTracingName {
+  uint32_t id;
+};
+
+inline bool operator==(InternedTracingName a, InternedTracingName b) {
+  return a.id == b.id;
+}
+inline bool operator!=(InternedTracingName a, InternedTracingName b) {
+  return !(a == b);
+}
+
+// Registers `name` and returns its id. Interning the same name again returns
+// the same id. Interned names are never released, so only names from a bounded
+// set should be interned, e.g. when a kernel or op is registered or loaded,
+// not per invocation. This function takes a lock and is thread-safe.
+InternedTracingName InternTracingName(string_view name);
+
+// Returns the name of `name`. This function takes no lock. The returned string
+// is valid for the lifetime of the process.
+string_view GetInternedTracingName(InternedTracingName name);
+
 class TracingSink {
  public:
   virtual ~TracingSink();
@@ -40,6 +64,9 @@ class TracingSink {
   // recording has been disabled. Pending tracing scopes will still be popped
   // even after tracing has been disabled. If the function returns an error,
   // trace recording will not be enabled.
+  //
+  // The activities of sampled requests (see TracingSampler) are recorded even
+  // if tracing is not enabled. Sinks can tag them with GetTracingRequestId().
   virtual Error RequestTracing(bool enable) = 0;
 
   // Records an instant event for the calling thread.
@@ -57,6 +84,9 @@ class TracingSink {
   virtual void RecordTracingEvent(const char* category, std::string&& name);
   virtual void PushTracingScope(const char* category, const char* name);
   virtual void PushTracingScope(const char* category, std::string&& name);
+  virtual void RecordTracingEvent(const char* category,
+                                  InternedTracingName name);
+  virtual void PushTracingScope(const char* category, InternedTracingName name);
 };
 
 namespace internal {
@@ -65,6 +95,12 @@ extern TracingSink* kTracingSink;
 // Counter whether tracing is currently enabled. If positive, tracing events and
 // scopes should be sent to the sink.
 extern std::atomic<int> kIsTracingEnabled;
+// The id of the sampled request executed by the calling thread, or 0.
+extern thread_local uint64_t kTracingRequestId;
+// Whether any thread has executed a sampled request. Until then
+// kTracingRequestId is 0 on all threads and is not read, because reading a
+// thread_local can cost a call in a shared library.
+extern std::atomic<bool> kHasSampledRequests;
 }  // namespace internal
 
 // Registers the tracing sink. Only one sink can be registered at any time.
@@ -72,15 +108,75 @@ extern std::atomic<int> kIsTracingEnabled;
 void RegisterTracingSink(TracingSink* tracing_sink);
 
 #ifndef TFRT_DISABLE_TRACING
-// Returns whether tracing is currently enabled.
+// Returns the id of the sampled request executed by the calling thread, or 0
+// if the thread does not execute a sampled request.
+inline uint64_t GetTracingRequestId() {
+  // A thread sets kHasSampledRequests before its first sampled request, so it
+  // never misses its own request id.
+  if (!internal::kHasSampledRequests.load(std::memory_order_relaxed)) return 0;
+  return internal::kTracingRequestId;
+}
+
+// Returns whether tracing is currently enabled, or the calling thread executes
+// a sampled request. The global switch is checked first, and the request id
+// is only read once requests have been sampled.
 inline bool IsTracingEnabled() {
-  return internal::kIsTracingEnabled.load(std::memory_order_acquire) > 0;
+  return internal::kIsTracingEnabled.load(std::memory_order_acquire) > 0 ||
+         GetTracingRequestId() != 0;
 }
 #else  // TFRT_DISABLE_TRACING
-// Always return false because tracing is disabled at compile time.
+// Always return 0 and false because tracing is disabled at compile time.
+constexpr inline uint64_t GetTracingRequestId() { return 0; }
 constexpr inline bool IsTracingEnabled() { return false; }
 #endif
 
+// RAII class that sets the sampled request executed by the calling thread. The
+// runtime sets it wherever it runs the work of a request, and work enqueued
+// with HostContext::EnqueueWork() or AsyncValue::AndThen() inherits it, so all
+// the activities of a sampled request are recorded on any thread.
+class ScopedTracingRequest {
+  // No copy or assignment.
+  ScopedTracingRequest(const ScopedTracingRequest&) = delete;
+  void operator=(const ScopedTracingRequest&) = delete;
+
+ public:
+#ifndef TFRT_DISABLE_TRACING
+  explicit ScopedTracingRequest(uint64_t request_id)
+      : previous_(internal::kTracingRequestId) {
+    if (request_id != 0 &&
+        !internal::kHasSampledRequests.load(std::memory_order_relaxed)) {
+      internal::kHasSampledRequests.store(true, std::memory_order_relaxed);
+    }
+    internal::kTracingRequestId = request_id;
+  }
+  ~ScopedTracingRequest() { internal::kTracingRequestId = previous_; }
+
+ private:
+  const uint64_t previous_;
+#else  // TFRT_DISABLE_TRACING
+  explicit ScopedTracingRequest(uint64_t) {}
+#endif
+};
+
+// Decides which requests are traced. Requests which are not sampled only pay
+// for checking that their request id is 0 when they record activities, and
+// for a load of a global flag while no request has been sampled.
+class TracingSampler {
+ public:
+  // Samples one in `sampling_period` requests, or none if it is 0.
+  explicit TracingSampler(uint32_t sampling_period)
+      : sampling_period_(sampling_period) {}
+
+  // Returns a new request id if the request is sampled, or 0 otherwise. If
+  // `force` is true, the request is sampled regardless of the period. Requests
+  // are never sampled if no tracing sink is registered.
+  uint64_t Sample(bool force = false);
+
+ private:
+  const uint32_t sampling_period_;
+  std::atomic<uint64_t> num_requests_{0};
+};
+
 // Requests the tracing sink to enable or disable tracing.
 void RequestTracing(bool enable);
 
@@ -117,6 +213,13 @@ inline void RecordTracingEvent(const char* category, std::string&& name) {
 inline void RecordTracingEvent(std::string&& name) {
   RecordTracingEvent(nullptr, std::move(name));
 }
+inline void RecordTracingEvent(const char* category, InternedTracingName name) {
+  if (IsTracingEnabled())
+    internal::kTracingSink->RecordTracingEvent(category, name);
+}
+inline void RecordTracingEvent(InternedTracingName name) {
+  RecordTracingEvent(nullptr, name);
+}
 template <typename F>
 void RecordTracingEvent(const char* category, F&& get_name) {
   if (IsTracingEnabled())
@@ -151,6 +254,12 @@ class TracingScope {
   }
   explicit TracingScope(std::string&& name)
       : TracingScope(nullptr, std::move(name)) {}
+  TracingScope(const char* category, InternedTracingName name)
+      : enabled_(IsTracingEnabled()) {
+    if (enabled_) internal::kTracingSink->PushTracingScope(category, name);
+  }
+  explicit TracingScope(InternedTracingName name)
+      : TracingScope(nullptr, name) {}
   template <typename F>
   TracingScope(const char* category, F&& get_name)
       : enabled_(IsTracingEnabled()) {
@@ -182,6 +291,9 @@ class TracingScope {
 // `SCOPE` marks an activity with start and end, while `EVENT` marks a single
 // time point. The recommendation is to use `*_SCOPE` when the tracing activity
 // is long enough (~100ns) and `*_EVENT` otherwise.
+//
+// The `id` can be a string or an InternedTracingName. Hot code paths should
+// pass interned names, which sinks can record without copying the name.
 
 #ifndef TFRT_DISABLE_TRACING
 #define TFRT_TRACE_SCOPE(id) \
@@ -19,17 +19,23 @@
 //===----------------------------------------------------------------------===//
 
 #include <atomic>
+#include <chrono>
 #include <cstdint>
 #include <cstdio>
+#include <limits>
 
 #include "bef_file_impl.h"
 #include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/SmallVector.h"
+#include "tfrt/host_context/arena_allocator.h"
 #include "tfrt/host_context/async_value.h"
 #include "tfrt/host_context/concurrent_work_queue.h"
+#include "tfrt/host_context/execution_context.h"
 #include "tfrt/host_context/host_context.h"
 #include "tfrt/host_context/kernel_frame.h"
+#include "tfrt/host_context/kernel_profiler.h"
 #include "tfrt/host_context/location.h"
+#include "tfrt/metrics/metrics_api.h"
 #include "tfrt/support/bef_encoding.h"
 #include "tfrt/support/bef_reader.h"
 #include "tfrt/support/forward_decls.h"
@@ -50,14 +56,20 @@ namespace tfrt {
 
 namespace {
 
-AsyncValue* GetRegisterValue(const BEFFileImpl::RegisterInfo& reg) {
-  return reg.value.load(std::memory_order_acquire);
+// The per-execution contents of a register. The immutable information of the
+// register, e.g. its user_count, is in the BEFFileImpl::RegisterInfo decoded
+// once per BEFFunction.
+using RegisterValue = std::atomic<AsyncValue*>;
+
+AsyncValue* GetRegisterValue(const RegisterValue& reg_value) {
+  return reg_value.load(std::memory_order_acquire);
 }
 
-AsyncValue* GetOrCreateRegisterValue(BEFFileImpl::RegisterInfo* reg,
+AsyncValue* GetOrCreateRegisterValue(const BEFFileImpl::RegisterInfo& reg,
+                                     RegisterValue* reg_value,
                                      HostContext* host) {
   // In the normal case, just load the pointer and return it.
-  AsyncValue* value = reg->value.load(std::memory_order_acquire);
+  AsyncValue* value = reg_value->load(std::memory_order_acquire);
   if (value) return value;
 
   // If it doesn't exist, we create an IndirectAsyncValue for this.  We have to
@@ -72,13 +84,13 @@ AsyncValue* GetOrCreateRegisterValue(BEFFileImpl::RegisterInfo* reg,
   // as it's used. indirect_value starts with 1 reference, and setting this
   // register will count as an additional use (+1), so add user_count refs,
   // bringing its refcount to (user_count + 1).
-  indirect_value->AddRef(reg->user_count);
-  if (!reg->value.compare_exchange_strong(existing, indirect_value,
+  indirect_value->AddRef(reg.user_count);
+  if (!reg_value->compare_exchange_strong(existing, indirect_value,
                                           std::memory_order_release,
                                           std::memory_order_acquire)) {
     // If result_reg already got a result, then we don't need the
     // IndirectAsyncValue after all. Decrease refcount back to 0.
-    indirect_value->DropRef(reg->user_count + 1);
+    indirect_value->DropRef(reg.user_count + 1);
     return existing;
   } else {
     return indirect_value;
@@ -94,10 +106,10 @@ AsyncValue* GetOrCreateRegisterValue(BEFFileImpl::RegisterInfo* reg,
 // error, we want it out of line.
 LLVM_ATTRIBUTE_NOINLINE
 void SetKernelsWithErrorInputReady(
-    MutableArrayRef<BEFFileImpl::KernelInfo> kernel_infos,
+    MutableArrayRef<std::atomic<int>> arguments_not_ready_counts,
     ArrayRef<uint32_t> kernels_with_error_input) {
   for (auto kernel_id : kernels_with_error_input) {
-    auto& arguments_not_ready = kernel_infos[kernel_id].arguments_not_ready;
+    auto& arguments_not_ready = arguments_not_ready_counts[kernel_id];
     int not_ready_count = arguments_not_ready.load(std::memory_order_acquire);
     while (not_ready_count > 1) {
       if (arguments_not_ready.compare_exchange_weak(not_ready_count, 1,
@@ -108,12 +120,12 @@ void SetKernelsWithErrorInputReady(
   }
 }
 
-AsyncValue* SetRegisterValue(BEFFileImpl::RegisterInfo* reg,
-                             AsyncValue* new_value,
+AsyncValue* SetRegisterValue(const BEFFileImpl::RegisterInfo& reg,
+                             RegisterValue* reg_value, AsyncValue* new_value,
                              bool* register_already_set) {
-  assert(reg->user_count > 0 &&
+  assert(reg.user_count > 0 &&
          "No need to set register value if it is not being used by anyone.");
-  // Atomically set reg->value to new_value.
+  // Atomically set reg_value to new_value.
   AsyncValue* existing = nullptr;
   // Speculatively set refcount in the expectation that compare_exchange
   // succeeds (see b/142802684). Specifically:
@@ -123,8 +135,8 @@ AsyncValue* SetRegisterValue(BEFFileImpl::RegisterInfo* reg,
   //
   // Setting a register counts as an additional use (+1), but we are setting
   // the register right now (-1), so we can skip that AddRef/DropRef pair.
-  new_value->AddRef(reg->user_count - 1);
-  if (!reg->value.compare_exchange_strong(existing, new_value,
+  new_value->AddRef(reg.user_count - 1);
+  if (!reg_value->compare_exchange_strong(existing, new_value,
                                           std::memory_order_release,
                                           std::memory_order_acquire)) {
     // If there was already a value in it, it must be a IndirectAsyncValue. We
@@ -132,7 +144,7 @@ AsyncValue* SetRegisterValue(BEFFileImpl::RegisterInfo* reg,
     auto indirect_value = cast<IndirectAsyncValue>(existing);
 
     // Speculative AddRef above proved unneeded, so revert it.
-    new_value->DropRef(reg->user_count - 1);
+    new_value->DropRef(reg.user_count - 1);
 
     // Give our +1 reference to 'new_value' to the indirect_value, since we are
     // not storing it in our register file.
@@ -149,6 +161,14 @@ AsyncValue* SetRegisterValue(BEFFileImpl::RegisterInfo* reg,
   return new_value;
 }
 
+// Return the allocator for the per-execution state of the request. This is the
+// request's arena if it has one.
+HostAllocator* GetExecutionAllocator(const ExecutionContext& exec_ctx) {
+  if (ArenaAllocator* arena = exec_ctx.request_ctx()->arena_allocator())
+    return arena;
+  return exec_ctx.host()->allocator();
+}
+
 }  // namespace
 
 class BEFLocationHandler final : public LocationHandler,
@@ -181,22 +201,33 @@ class BEFExecutor final : public ReferenceCounted<BEFExecutor> {
                       MutableArrayRef<RCReference<AsyncValue>> results);
 
   /// When the last reference to the BEFExecutor is dropped, we deallocate
-  /// ourself.  The memory for this class is managed through the HostAllocator
-  /// managed by the HostContext.
+  /// ourself.  The memory for this class is managed through the request's
+  /// ArenaAllocator if it has one, and through the HostAllocator managed by the
+  /// HostContext otherwise.
   void Destroy() {
-    auto host = this->GetHost();
+    auto allocator = allocator_;
     this->~BEFExecutor();
-    host->Deallocate<BEFExecutor>(this);
+    allocator->Deallocate<BEFExecutor>(this);
   }
 
  private:
-  BEFExecutor(ExecutionContext exec_ctx, BEFFileImpl* bef_file);
+  BEFExecutor(ExecutionContext exec_ctx, const BEFFunction& fn);
   ~BEFExecutor();
 
   void Execute(bool has_arguments_pseudo_kernel);
 
  private:
   void DecrementArgumentsNotReadyCounts(SmallVectorImpl<unsigned>* kernel_ids);
+  void DispatchReadyKernels(KernelFrameBuilder* kernel_frame,
+                            SmallVectorImpl<unsigned>* kernel_ids);
+  void EnqueueReadyKernel(unsigned kernel_id);
+  llvm::unique_function<void()> MakeReadyKernelWork(unsigned kernel_id);
+  bool IsExpensiveKernel(unsigned kernel_id) const;
+  void ProcessReadyKernel(unsigned kernel_id, KernelFrameBuilder* kernel_frame,
+                          SmallVectorImpl<unsigned>* kernel_ids);
+  void RunProfiledKernel(AsyncKernelImplementation kernel_fn,
+                         uint32_t kernel_code, KernelFrameBuilder* kernel_frame,
+                         KernelProfiler* profiler);
   void ProcessArgumentsPseudoKernel(SmallVectorImpl<unsigned>* kernel_ids);
   void ProcessUsedBys(const BEFKernel& kernel, int kernel_id, int result_number,
                       AsyncValue* result, int* entry_offset,
@@ -205,14 +236,22 @@ class BEFExecutor final : public ReferenceCounted<BEFExecutor> {
   HostContext* GetHost() const { return exec_ctx_.host(); }
   BEFFileImpl* BefFile() const { return location_handler_->BefFile(); }
 
-  ArrayRef<uint32_t> kernels() { return function_info_.kernels; }
+  ArrayRef<uint32_t> kernels() const { return function_info_.kernels; }
+
+  ArrayRef<BEFFileImpl::RegisterInfo> register_infos() const {
+    return function_info_.register_infos;
+  }
+
+  ArrayRef<BEFFileImpl::KernelInfo> kernel_infos() const {
+    return function_info_.kernel_infos;
+  }
 
-  MutableArrayRef<BEFFileImpl::RegisterInfo> register_infos() {
-    return function_info_.register_infos.mutable_array();
+  MutableArrayRef<RegisterValue> register_values() {
+    return register_values_.mutable_array();
   }
 
-  MutableArrayRef<BEFFileImpl::KernelInfo> kernel_infos() {
-    return function_info_.kernel_infos.mutable_array();
+  MutableArrayRef<std::atomic<int>> arguments_not_ready() {
+    return arguments_not_ready_.mutable_array();
   }
 
  private:
@@ -221,11 +260,28 @@ class BEFExecutor final : public ReferenceCounted<BEFExecutor> {
   /// The execution context for this BEFExecutor.
   ExecutionContext exec_ctx_;
 
-  /// Decoded BEFFunction
-  BEFFileImpl::FunctionInfo function_info_;
+  /// The allocator for this BEFExecutor and its per-execution state.
+  HostAllocator* const allocator_;
+
+  /// Decoded BEFFunction. This is owned by the BEFFunction, which is kept
+  /// alive by location_handler_ through the BEF file.
+  const BEFFileImpl::FunctionInfo& function_info_;
+
+  /// The contents of the registers in this execution, indexed by register
+  /// number.
+  BEFInfoArray<RegisterValue, 48> register_values_;
+
+  /// The number of arguments that are still waiting to come in before each
+  /// kernel can start, indexed by kernel number.
+  BEFInfoArray<std::atomic<int>, 16> arguments_not_ready_;
 
   /// Make sure location handler is alive as long as there is pending execution.
   RCReference<BEFLocationHandler> location_handler_;
+
+  /// Whether this execution records the function latency metric, and when it
+  /// started. See ExecutionContext::record_function_latency().
+  bool record_latency_ = false;
+  std::chrono::steady_clock::time_point start_time_;
 };
 
 //===----------------------------------------------------------------------===//
@@ -273,7 +329,7 @@ void BEFExecutor::ProcessUsedBys(const BEFKernel& kernel, int kernel_id,
           os.str().c_str());
     }
 #endif
-    SetKernelsWithErrorInputReady(kernel_infos(), used_bys);
+    SetKernelsWithErrorInputReady(arguments_not_ready(), used_bys);
   }
 
   // If this result is already available (because the kernel produced its
@@ -348,7 +404,8 @@ void BEFExecutor::ProcessArgumentsPseudoKernel(
   assert(kernel.num_functions() == 0);
   assert(kernel.num_results() != 0);
 
-  MutableArrayRef<BEFFileImpl::RegisterInfo> register_array = register_infos();
+  ArrayRef<BEFFileImpl::RegisterInfo> register_array = register_infos();
+  MutableArrayRef<RegisterValue> register_value_array = register_values();
 
   // The kernel body of argument pseudo kernel contains only results and
   // used_bys.
@@ -356,11 +413,11 @@ void BEFExecutor::ProcessArgumentsPseudoKernel(
   // Move offset to the start of used_bys.
   int used_by_offset = results.size();
   for (int result_number = 0; result_number < results.size(); ++result_number) {
-    auto& result_register = register_array[results[result_number]];
+    auto result_reg_idx = results[result_number];
     // TODO(chky): mlir_to_bef should not emit used args.
-    if (result_register.user_count == 0) continue;
+    if (register_array[result_reg_idx].user_count == 0) continue;
 
-    AsyncValue* result = GetRegisterValue(result_register);
+    AsyncValue* result = GetRegisterValue(register_value_array[result_reg_idx]);
     assert(result && "Argument AsyncValue is not set.");
 
     // Process users of this result.
@@ -384,151 +441,301 @@ void BEFExecutor::MaybeAddRefForResult(AsyncValue* result) {
 /// from the end of the vector to the start - worklist style.
 void BEFExecutor::DecrementArgumentsNotReadyCounts(
     SmallVectorImpl<unsigned>* kernel_ids) {
+  // The AsyncValues made by the kernels of this request are allocated from the
+  // request's arena, if it has one.
+  ScopedArenaAllocation arena_scope(exec_ctx_.request_ctx()->arena_allocator());
+  // The work enqueued by the kernels of this request inherits its priority,
+  // and its tracing request if it is sampled.
+  ScopedTaskPriority task_priority(exec_ctx_.priority());
+  tracing::ScopedTracingRequest tracing_request(
+      exec_ctx_.tracing_request_id());
+
   KernelFrameBuilder kernel_frame(exec_ctx_);
   kernel_frame.SetAttributeSection(BefFile()->attribute_section_);
 
-  MutableArrayRef<BEFFileImpl::KernelInfo> kernel_array = kernel_infos();
-  MutableArrayRef<BEFFileImpl::RegisterInfo> register_array = register_infos();
+  MutableArrayRef<std::atomic<int>> arguments_not_ready_array =
+      arguments_not_ready();
+
+  // Only the kernels in the worklist can become ready, so the worklist needs to
+  // be larger than the parallel dispatch threshold before we try dispatching
+  // ready kernels in parallel.
+  size_t max_inline_worklist_size = exec_ctx_.parallel_dispatch_threshold();
+  if (max_inline_worklist_size == 0)
+    max_inline_worklist_size = std::numeric_limits<size_t>::max();
+
+  const bool has_expensive_kernels = BefFile()->has_expensive_kernels_;
 
   while (!kernel_ids->empty()) {
+    if (kernel_ids->size() > max_inline_worklist_size) {
+      DispatchReadyKernels(&kernel_frame, kernel_ids);
+      continue;
+    }
+
     auto kernel_id = kernel_ids->pop_back_val();
-    assert(kernel_id < kernel_array.size() && "invalid kernel ID");
+    assert(kernel_id < arguments_not_ready_array.size() && "invalid kernel ID");
 
     // Decrement the count and see if we're ready to run.  If not, then we're
     // done with the kernel.
-    if (kernel_array[kernel_id].arguments_not_ready.fetch_sub(1) != 1) continue;
-
-    assert(kernel_array[kernel_id].offset % kKernelEntryAlignment == 0);
-    BEFKernel kernel(kernels().data() +
-                     kernel_array[kernel_id].offset / kKernelEntryAlignment);
-
-    // Keep track of whether we saw any error arguments. If so, we propagate the
-    // error to the results automatically. Initialize it with the cancel async
-    // value if the execution has been canceled.
-    AsyncValue* any_error_argument = exec_ctx_.GetCancelAsyncValue();
-
-    // Process the kernel record to get information about what argument
-    // registers, result registers, and attributes should be passed.
-    kernel_frame.Reset();
-
-    // Find the kernel implementation of this kernel.
-    AsyncKernelImplementation kernel_fn =
-        BefFile()->GetAsyncKernel(kernel.kernel_code());
-
-    // Check the low bit of special_metadata, which indicates if the kernel
-    // is non-strict.
-    bool is_nonstrict_kernel =
-        static_cast<bool>(kernel.special_metadata() &
-                          static_cast<uint32_t>(SpecialAttribute::kNonStrict));
-    DEBUG_PRINT("Run %skernel %u %s\n",
-                is_nonstrict_kernel ? "non-strict " : "", kernel_id,
-                BefFile()->GetKernelName(kernel.kernel_code()));
-
-    // Set up operands.
-    int entry_offset = 0;
-    auto arguments =
-        kernel.GetKernelEntries(entry_offset, kernel.num_arguments());
-    for (auto reg_idx : arguments) {
-      BEFFileImpl::RegisterInfo& reg = register_array[reg_idx];
-
-      // The argument register may not be available if this is a non-strict
-      // kernel that is starting before all operands are available. In that
-      // case, we use an IndirectAsyncValue so it can be resolved later.
-      AsyncValue* value = GetOrCreateRegisterValue(&reg, GetHost());
-      // TODO(b/142757465): remove arguments_and_results_ vector in KernelFrame.
-      kernel_frame.AddArg(value);
-      if (value->IsError()) any_error_argument = value;
+    if (arguments_not_ready_array[kernel_id].fetch_sub(1) != 1) continue;
+
+    // If there are other kernels to process, dispatch expensive kernels to the
+    // work queue so that they do not delay the cheap ones. Otherwise, run them
+    // inline to avoid a thread hop.
+    if (has_expensive_kernels && !kernel_ids->empty() &&
+        IsExpensiveKernel(kernel_id)) {
+      EnqueueReadyKernel(kernel_id);
+      continue;
     }
 
+    ProcessReadyKernel(kernel_id, &kernel_frame, kernel_ids);
+  }
+}
+
+/// Return true if the kernel is registered as an expensive kernel.
+bool BEFExecutor::IsExpensiveKernel(unsigned kernel_id) const {
+  BEFKernel kernel(kernels().data() +
+                   kernel_infos()[kernel_id].offset / kKernelEntryAlignment);
+  return BefFile()->GetKernelCost(kernel.kernel_code()) ==
+         KernelCost::kExpensive;
+}
+
+/// Run the specified ready kernel and the kernels that become ready after it on
+/// a work queue thread.
+void BEFExecutor::EnqueueReadyKernel(unsigned kernel_id) {
+  GetHost()->EnqueueWork(exec_ctx_.priority(), MakeReadyKernelWork(kernel_id));
+}
+
+/// Return the work that runs the specified ready kernel and the kernels that
+/// become ready after it.
+llvm::unique_function<void()> BEFExecutor::MakeReadyKernelWork(
+    unsigned kernel_id) {
+  // Keep this executor alive until the kernel runs.
+  AddRef();
+  return [this, kernel_id] {
+    ScopedArenaAllocation arena_scope(
+        exec_ctx_.request_ctx()->arena_allocator());
+    KernelFrameBuilder kernel_frame(exec_ctx_);
+    kernel_frame.SetAttributeSection(BefFile()->attribute_section_);
+
+    SmallVector<unsigned, 16> kernel_ids;
+    ProcessReadyKernel(kernel_id, &kernel_frame, &kernel_ids);
+    DecrementArgumentsNotReadyCounts(&kernel_ids);
+    DropRef();
+  };
+}
+
+/// Decrement arguments_not_ready counters for all kernels in the worklist. If
+/// more than parallel_dispatch_threshold kernels are ready to run, dispatch all
+/// but one of them to the work queue and run the remaining one inline to avoid
+/// a thread hop. Otherwise, run all of them inline.
+void BEFExecutor::DispatchReadyKernels(KernelFrameBuilder* kernel_frame,
+                                       SmallVectorImpl<unsigned>* kernel_ids) {
+  MutableArrayRef<std::atomic<int>> arguments_not_ready_array =
+      arguments_not_ready();
+
+  SmallVector<unsigned, 16> ready_kernel_ids;
+  for (auto kernel_id : *kernel_ids) {
+    assert(kernel_id < arguments_not_ready_array.size() && "invalid kernel ID");
+    if (arguments_not_ready_array[kernel_id].fetch_sub(1) == 1)
+      ready_kernel_ids.push_back(kernel_id);
+  }
+  kernel_ids->clear();
+
+  assert(exec_ctx_.parallel_dispatch_threshold() > 0);
+  if (ready_kernel_ids.size() > exec_ctx_.parallel_dispatch_threshold()) {
+    // Keep the kernel at the back of the worklist, which would have been run
+    // first, on the current thread.
+    auto inline_kernel_id = ready_kernel_ids.pop_back_val();
+
+    // Enqueue the other kernels in one batch, which wakes up the worker
+    // threads to run them at once.
+    SmallVector<llvm::unique_function<void()>, 16> work;
+    work.reserve(ready_kernel_ids.size());
+    for (auto kernel_id : ready_kernel_ids)
+      work.push_back(MakeReadyKernelWork(kernel_id));
+    GetHost()->EnqueueWork(exec_ctx_.priority(), work);
+
+    ProcessReadyKernel(inline_kernel_id, kernel_frame, kernel_ids);
+    return;
+  }
+
+  // Run the ready kernels in the same order as the worklist would have. The
+  // users of their results are added to the worklist for the caller.
+  while (!ready_kernel_ids.empty()) {
+    ProcessReadyKernel(ready_kernel_ids.pop_back_val(), kernel_frame,
+                       kernel_ids);
+  }
+}
+
+/// Run `kernel_fn` and record its call in `profiler`, see KernelProfiler.
+void BEFExecutor::RunProfiledKernel(AsyncKernelImplementation kernel_fn,
+                                    uint32_t kernel_code,
+                                    KernelFrameBuilder* kernel_frame,
+                                    KernelProfiler* profiler) {
+  const auto start_time = std::chrono::steady_clock::now();
+  kernel_fn(kernel_frame);
+  const int64_t duration_ns =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now() - start_time)
+          .count();
+
+  bool is_error = false;
+  for (size_t i = 0, e = kernel_frame->GetNumResults(); i != e; ++i) {
+    AsyncValue* result = kernel_frame->GetResultAt(i);
+    if (result && result->IsError()) is_error = true;
+  }
+  profiler->RecordKernelCall(BefFile()->GetKernelName(kernel_code),
+                             kernel_frame->GetLocation(), duration_ns,
+                             is_error);
+}
+
+/// Run the specified kernel whose arguments are all ready (or that is
+/// non-strict), and add the users of its available results to the worklist.
+void BEFExecutor::ProcessReadyKernel(unsigned kernel_id,
+                                     KernelFrameBuilder* kernel_frame,
+                                     SmallVectorImpl<unsigned>* kernel_ids) {
+  ArrayRef<BEFFileImpl::KernelInfo> kernel_array = kernel_infos();
+  ArrayRef<BEFFileImpl::RegisterInfo> register_array = register_infos();
+  MutableArrayRef<RegisterValue> register_value_array = register_values();
+
+  assert(kernel_array[kernel_id].offset % kKernelEntryAlignment == 0);
+  BEFKernel kernel(kernels().data() +
+                   kernel_array[kernel_id].offset / kKernelEntryAlignment);
+
+  // Keep track of whether we saw any error arguments. If so, we propagate the
+  // error to the results automatically. Initialize it with the cancel async
+  // value if the execution has been canceled.
+  AsyncValue* any_error_argument = exec_ctx_.GetCancelAsyncValue();
+
+  // Process the kernel record to get information about what argument
+  // registers, result registers, and attributes should be passed.
+  kernel_frame->Reset();
+
+  // Find the kernel implementation of this kernel.
+  AsyncKernelImplementation kernel_fn =
+      BefFile()->GetAsyncKernel(kernel.kernel_code());
+
+  // Check the low bit of special_metadata, which indicates if the kernel
+  // is non-strict.
+  bool is_nonstrict_kernel =
+      static_cast<bool>(kernel.special_metadata() &
+                        static_cast<uint32_t>(SpecialAttribute::kNonStrict));
+  DEBUG_PRINT("Run %skernel %u %s\n",
+              is_nonstrict_kernel ? "non-strict " : "", kernel_id,
+              BefFile()->GetKernelName(kernel.kernel_code()));
+
+  // Set up operands.
+  int entry_offset = 0;
+  auto arguments =
+      kernel.GetKernelEntries(entry_offset, kernel.num_arguments());
+  for (auto reg_idx : arguments) {
+    // The argument register may not be available if this is a non-strict
+    // kernel that is starting before all operands are available. In that
+    // case, we use an IndirectAsyncValue so it can be resolved later.
+    AsyncValue* value = GetOrCreateRegisterValue(
+        register_array[reg_idx], &register_value_array[reg_idx], GetHost());
     // TODO(b/142757465): remove arguments_and_results_ vector in KernelFrame.
-    kernel_frame.SetNumResults(kernel.num_results());
-
-    // Set up attributes.
-    entry_offset += arguments.size();
-    auto attributes =
-        kernel.GetKernelEntries(entry_offset, kernel.num_attributes());
-    for (auto attribute_offset : attributes) {
-      // We pass the pointer here because this attribute could be an array of
-      // size 0.
-      kernel_frame.AddAttribute(BefFile()->attribute_section_.data() +
-                                attribute_offset);
-    }
+    kernel_frame->AddArg(value);
+    if (value->IsError()) any_error_argument = value;
+  }
 
-    // Set up functions.
-    entry_offset += attributes.size();
-    auto functions =
-        kernel.GetKernelEntries(entry_offset, kernel.num_functions());
-    for (auto fn_idx : functions) {
-      // Functions are passed as their corresponding `Function`.
-      kernel_frame.AddAttribute(BefFile()->functions_[fn_idx].get());
-    }
+  // TODO(b/142757465): remove arguments_and_results_ vector in KernelFrame.
+  kernel_frame->SetNumResults(kernel.num_results());
+
+  // Set up attributes.
+  entry_offset += arguments.size();
+  auto attributes =
+      kernel.GetKernelEntries(entry_offset, kernel.num_attributes());
+  for (auto attribute_offset : attributes) {
+    // We pass the pointer here because this attribute could be an array of
+    // size 0.
+    kernel_frame->AddAttribute(BefFile()->attribute_section_.data() +
+                               attribute_offset);
+  }
 
-    // If all arguments are good or if the kernel is non-strict, run the
-    // function.
-    if (any_error_argument == nullptr || is_nonstrict_kernel) {
-      // Get the location to pass down to the kernels so they can report an
-      // error.
-      kernel_frame.SetLocation(
-          {location_handler_.get(), kernel.kernel_location()});
-
-      // kernel_fn should populate results in kernel_frame with pointers to
-      // AsyncValue before it returns.
-      {
-        TFRT_TRACE_KERNEL_SCOPE(BefFile()->GetKernelName(kernel.kernel_code()));
-        kernel_fn(&kernel_frame);
-      }
-    } else {
-      // Otherwise, automatically propagate errors to the result values.
-      for (size_t i = 0, e = kernel_frame.GetNumResults(); i != e; ++i) {
-        kernel_frame.SetResultAt(i, FormRef(any_error_argument));
+  // Set up functions.
+  entry_offset += attributes.size();
+  auto functions =
+      kernel.GetKernelEntries(entry_offset, kernel.num_functions());
+  for (auto fn_idx : functions) {
+    // Functions are passed as their corresponding `Function`.
+    kernel_frame->AddAttribute(BefFile()->functions_[fn_idx].get());
+  }
+
+  // If all arguments are good or if the kernel is non-strict, run the
+  // function.
+  if (any_error_argument == nullptr || is_nonstrict_kernel) {
+    // Get the location to pass down to the kernels so they can report an
+    // error.
+    kernel_frame->SetLocation(
+        {location_handler_.get(), kernel.kernel_location()});
+
+    // kernel_fn should populate results in kernel_frame with pointers to
+    // AsyncValue before it returns.
+    {
+      TFRT_TRACE_KERNEL_SCOPE(
+          BefFile()->GetKernelTracingName(kernel.kernel_code()));
+      if (KernelProfiler* profiler = exec_ctx_.kernel_profiler()) {
+        RunProfiledKernel(kernel_fn, kernel.kernel_code(), kernel_frame,
+                          profiler);
+      } else {
+        kernel_fn(kernel_frame);
       }
     }
+  } else {
+    // Otherwise, automatically propagate errors to the result values.
+    for (size_t i = 0, e = kernel_frame->GetNumResults(); i != e; ++i) {
+      kernel_frame->SetResultAt(i, FormRef(any_error_argument));
+    }
+  }
 
-    // Now that the kernel had a chance to look at the arguments, we're done
-    // with them, so they can potentially be deallocated if this was the last
-    // kernel to use them.
-    for (auto* arg : kernel_frame.GetArguments()) arg->DropRef();
-
-    // The following loop iterates over all results of the kernel. If a result
-    // has no users, it will be skipped. If the kernel immediately completed a
-    // result, then we can mark all kernels using it as ready to go, otherwise
-    // we need to enqueue them on their unavailable operands.
-
-    // Move entry offset to start of results.
-    entry_offset += functions.size();
-    auto results = kernel.GetKernelEntries(entry_offset, kernel.num_results());
-    // Move entry offset to start of all used_bys.
-    entry_offset += results.size();
-    for (int result_number = 0; result_number < results.size();
-         ++result_number) {
-      auto& result_register = register_array[results[result_number]];
-
-      // This kernel is not a pesudo kernel, assert the result register is
-      // either unset or an IndirectAsyncValue.
-      assert(GetRegisterValue(result_register) == nullptr ||
-             GetRegisterValue(result_register)->IsUnresolvedIndirect());
-
-      // Copy back the result AsyncValue to this result register.
-      AsyncValue* result = kernel_frame.GetResultAt(result_number);
-      assert(result && "Kernel did not set result AsyncValue");
-      if (result_register.user_count == 0) {
-        MaybeAddRefForResult(result);
-        // If no one uses this result, skip storing the value in the register.
-        // We must drop our +1 ref.
-        result->DropRef();
-        continue;
-      }
+  // Now that the kernel had a chance to look at the arguments, we're done
+  // with them, so they can potentially be deallocated if this was the last
+  // kernel to use them.
+  for (auto* arg : kernel_frame->GetArguments()) arg->DropRef();
+
+  // The following loop iterates over all results of the kernel. If a result
+  // has no users, it will be skipped. If the kernel immediately completed a
+  // result, then we can mark all kernels using it as ready to go, otherwise
+  // we need to enqueue them on their unavailable operands.
+
+  // Move entry offset to start of results.
+  entry_offset += functions.size();
+  auto results = kernel.GetKernelEntries(entry_offset, kernel.num_results());
+  // Move entry offset to start of all used_bys.
+  entry_offset += results.size();
+  for (int result_number = 0; result_number < results.size();
+       ++result_number) {
+    auto result_reg_idx = results[result_number];
+    const auto& result_register = register_array[result_reg_idx];
+    auto& result_register_value = register_value_array[result_reg_idx];
+
+    // This kernel is not a pesudo kernel, assert the result register is
+    // either unset or an IndirectAsyncValue.
+    assert(GetRegisterValue(result_register_value) == nullptr ||
+           GetRegisterValue(result_register_value)->IsUnresolvedIndirect());
+
+    // Copy back the result AsyncValue to this result register.
+    AsyncValue* result = kernel_frame->GetResultAt(result_number);
+    assert(result && "Kernel did not set result AsyncValue");
+    if (result_register.user_count == 0) {
+      MaybeAddRefForResult(result);
+      // If no one uses this result, skip storing the value in the register.
+      // We must drop our +1 ref.
+      result->DropRef();
+      continue;
+    }
 
-      bool register_already_set;
-      auto* register_value =
-          SetRegisterValue(&result_register, result, &register_already_set);
-      // Process users of this result.
-      ProcessUsedBys(kernel, kernel_id, result_number, register_value,
-                     &entry_offset, kernel_ids);
+    bool register_already_set;
+    auto* register_value =
+        SetRegisterValue(result_register, &result_register_value, result,
+                         &register_already_set);
+    // Process users of this result.
+    ProcessUsedBys(kernel, kernel_id, result_number, register_value,
+                   &entry_offset, kernel_ids);
 
-      // DropRef since we no longer need the IndirectAsyncValue in the register.
-      if (register_already_set) register_value->DropRef();
-    }
+    // DropRef since we no longer need the IndirectAsyncValue in the register.
+    if (register_already_set) register_value->DropRef();
   }
 }
 
@@ -536,18 +743,53 @@ void BEFExecutor::DecrementArgumentsNotReadyCounts(
 // Executor Setup
 //===----------------------------------------------------------------------===//
 
-BEFExecutor::BEFExecutor(ExecutionContext exec_ctx, BEFFileImpl* bef_file)
+BEFExecutor::BEFExecutor(ExecutionContext exec_ctx, const BEFFunction& fn)
     : exec_ctx_(std::move(exec_ctx)),
+      allocator_(GetExecutionAllocator(exec_ctx_)),
+      function_info_(fn.function_info()),
       location_handler_(TakeRef(exec_ctx_.host()->Construct<BEFLocationHandler>(
-          exec_ctx_.host(), bef_file))) {}
+          exec_ctx_.host(), fn.bef_file()))) {
+  if (exec_ctx_.record_function_latency()) {
+    record_latency_ = true;
+    start_time_ = std::chrono::steady_clock::now();
+    // Functions called by our kernels are not top-level executions.
+    exec_ctx_.set_record_function_latency(false);
+  }
 
-BEFExecutor::~BEFExecutor() {}
+  // Set up the per-execution state from the decoded function in one pass. All
+  // registers start out empty.
+  register_values_.resize(function_info_.register_infos.size(), allocator_);
+  for (auto& reg_value : register_values())
+    new (&reg_value) RegisterValue(nullptr);
+
+  // We initialize each kernel's arguments_not_ready count to "num_operands + 1"
+  // so we can drop the last count in Execute().
+  arguments_not_ready_.resize(function_info_.kernel_infos.size(), allocator_);
+  MutableArrayRef<std::atomic<int>> arguments_not_ready_array =
+      arguments_not_ready();
+  for (size_t i = 0, e = arguments_not_ready_array.size(); i != e; ++i) {
+    new (&arguments_not_ready_array[i])
+        std::atomic<int>(function_info_.kernel_infos[i].num_operands + 1);
+  }
+}
+
+// The executor is destroyed once all the kernels of the function have run and
+// its results are available, so this records the latency of the execution.
+BEFExecutor::~BEFExecutor() {
+  if (!record_latency_) return;
+  static auto* latency_histogram =
+      metrics::NewHistogram("/tfrt/bef_executor/function_latency_ns");
+  latency_histogram->Record(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now() - start_time_)
+          .count());
+}
 
 void BEFExecutor::Execute(bool has_arguments_pseudo_kernel) {
-  MutableArrayRef<BEFFileImpl::KernelInfo> kernel_array = kernel_infos();
+  ArrayRef<BEFFileImpl::KernelInfo> kernel_array = kernel_infos();
 
-  // InitializeKernels initialized each KernelInfo::arguments_not_ready to one
-  // plus the number of arguments. This means that as we walk the list to drop
+  // The constructor initialized each arguments_not_ready count to one plus the
+  // number of arguments. This means that as we walk the list to drop
   // the argument count, if we hit zero then it is time for us to trigger the
   // computation. This arrangement is nice because any sync or async kernel that
   // immediately produces results will immediately unblock subsequent kernels to
@@ -575,18 +817,18 @@ void BEFExecutor::Execute(bool has_arguments_pseudo_kernel) {
   DecrementArgumentsNotReadyCounts(&kernel_ids_to_visit);
 }
 
-// Set RegisterInfo::value for argument registers.
+// Set the register values for argument registers.
 static void InitializeArgumentRegisters(
     ArrayRef<AsyncValue*> arguments,
-    MutableArrayRef<BEFFileImpl::RegisterInfo> register_infos) {
-  for (size_t i = 0, e = register_infos.size(); i != e; ++i) {
-    if (i < arguments.size()) {
-      AsyncValue* value = arguments[i];
-      // Add user_count refs to the arg. Corresponding DropRefs will occur as
-      // this arg is used.
-      value->AddRef(register_infos[i].user_count);
-      register_infos[i].value = value;
-    }
+    ArrayRef<BEFFileImpl::RegisterInfo> register_infos,
+    MutableArrayRef<RegisterValue> register_values) {
+  assert(arguments.size() <= register_infos.size());
+  for (size_t i = 0, e = arguments.size(); i != e; ++i) {
+    AsyncValue* value = arguments[i];
+    // Add user_count refs to the arg. Corresponding DropRefs will occur as
+    // this arg is used.
+    value->AddRef(register_infos[i].user_count);
+    register_values[i] = value;
   }
 }
 
@@ -596,27 +838,22 @@ void BEFExecutor::Execute(ExecutionContext exec_ctx, const BEFFunction& fn,
   DEBUG_PRINT("Execute function %s start\n",
               fn.name().empty() ? "(unknown)" : fn.name().str().c_str());
 
-  BEFFileImpl* bef_file = fn.bef_file();
   assert(arguments.size() == fn.argument_types().size() &&
          "incorrect number of arguments passed to function call");
   assert(results.size() == fn.result_types().size() &&
          "incorrect number of results passed to function call");
 
   HostContext* host = exec_ctx.host();
-  auto* exec_ptr = host->Allocate<BEFExecutor>();
-  auto* exec = new (exec_ptr) BEFExecutor(std::move(exec_ctx), bef_file);
-
-  size_t location_offset;
-  SmallVector<size_t, 4> result_regs;
-  bool success = bef_file->ReadFunction(fn.function_offset(), fn.result_types(),
-                                        &location_offset, &exec->function_info_,
-                                        &result_regs, host->allocator());
-  if (!success) return;
+  auto* exec_ptr = GetExecutionAllocator(exec_ctx)->Allocate<BEFExecutor>();
+  auto* exec = new (exec_ptr) BEFExecutor(std::move(exec_ctx), fn);
+
+  ArrayRef<size_t> result_regs = fn.function_info().result_regs;
   assert(result_regs.size() == fn.result_types().size());
 
-  MutableArrayRef<BEFFileImpl::RegisterInfo> register_array =
-      exec->register_infos();
-  InitializeArgumentRegisters(arguments, register_array);
+  ArrayRef<BEFFileImpl::RegisterInfo> register_array = exec->register_infos();
+  MutableArrayRef<RegisterValue> register_value_array =
+      exec->register_values();
+  InitializeArgumentRegisters(arguments, register_array, register_value_array);
 
   // Kick off BEF execution starting from ready kernels.
   exec->Execute(!arguments.empty());
@@ -631,8 +868,9 @@ void BEFExecutor::Execute(ExecutionContext exec_ctx, const BEFFunction& fn,
   // IndirectAsyncValue to point to the actual value.
   for (size_t i = 0, e = results.size(); i != e; ++i) {
     assert(!results[i] && "result AsyncValue is not nullptr");
-    BEFFileImpl::RegisterInfo& result_reg = register_array[result_regs[i]];
-    AsyncValue* value = GetOrCreateRegisterValue(&result_reg, host);
+    AsyncValue* value = GetOrCreateRegisterValue(
+        register_array[result_regs[i]], &register_value_array[result_regs[i]],
+        host);
     results[i] = TakeRef(value);
   }
 
@@ -59,7 +59,7 @@ class BEFFileReader : public BEFReader {
       : BEFReader(file), registry_(registry), bef_file_(bef_file) {}
 
   bool ReadNextSection();
-  bool ReadKernelsSection(HostAllocator* host_allocator);
+  bool ReadKernelsSection();
   bool ReadTypesSection();
   bool ReadFunctionIndexSection();
 
@@ -67,8 +67,7 @@ class BEFFileReader : public BEFReader {
   bool ReadFunctionIndexSectionInternal(
       SmallVectorImpl<FunctionIndex>* function_indices);
   bool ReadFormatVersionSection();
-  bool DiagnoseUnknownKernel(size_t kernel_idx, const char* kernel_name,
-                             HostAllocator* host_allocator);
+  bool DiagnoseUnknownKernel(size_t kernel_idx, const char* kernel_name);
 
   // These are things set up at construction time.
   KernelRegistry* registry_;
@@ -174,8 +173,7 @@ bool BEFFileReader::ReadFormatVersionSection() {
 //
 // If we can't find a nice location, we can fallback to a poor location.
 bool BEFFileReader::DiagnoseUnknownKernel(size_t kernel_idx,
-                                          const char* kernel_name,
-                                          HostAllocator* host_allocator) {
+                                          const char* kernel_name) {
   std::string error_message =
       "unknown kernel name '" + std::string(kernel_name) + "'";
 
@@ -190,24 +188,16 @@ bool BEFFileReader::DiagnoseUnknownKernel(size_t kernel_idx,
   // The unknown kernel must be referenced by some function in the program,
   // and each kernel record has location info.  Scan through to see if we can
   // figure out where the reference is coming from.
-  SmallVector<size_t, 4> result_regs;
-
   for (const auto& function_index : function_indices) {
     if (function_index.kind == FunctionKind::kNativeFunction) continue;
 
     BEFFileImpl::FunctionInfo function_info;
-
-    result_regs.clear();
-    size_t location_offset;
     bool success = bef_file_->ReadFunction(
-        function_index.function_offset, function_index.results,
-        &location_offset, &function_info, &result_regs, host_allocator);
+        function_index.function_offset, function_index.results, &function_info);
     if (!success) continue;
 
     // Decode all of the kernels to see if any refers to our unknown kernel.
-    MutableArrayRef<BEFFileImpl::KernelInfo> kernel_infos_array =
-        function_info.kernel_infos.mutable_array();
-    for (const auto& kernel_info : kernel_infos_array) {
+    for (const auto& kernel_info : function_info.kernel_infos) {
       assert(kernel_info.offset % kKernelEntryAlignment == 0);
       BEFKernel kernel(function_info.kernels.data() +
                        kernel_info.offset / kKernelEntryAlignment);
@@ -231,7 +221,7 @@ bool BEFFileReader::DiagnoseUnknownKernel(size_t kernel_idx,
 
 // Read the Kernels section from a BEF file, resolving the kernels and
 // returning false on success.  Emit an error and return true on failure.
-bool BEFFileReader::ReadKernelsSection(HostAllocator* host_allocator) {
+bool BEFFileReader::ReadKernelsSection() {
   auto format_error = [&]() -> bool {
     bef_file_->EmitFormatError("invalid Kernels section in BEF file");
     return true;
@@ -243,6 +233,8 @@ bool BEFFileReader::ReadKernelsSection(HostAllocator* host_allocator) {
   if (reader.ReadInt(&num_kernels)) return format_error();
 
   bef_file_->kernels_.reserve(num_kernels);
+  bef_file_->kernel_names_.reserve(num_kernels);
+  bef_file_->kernel_costs_.reserve(num_kernels);
   while (num_kernels--) {
     // Each kernel is encoded as an offset into the string table of the
     // kernel name.
@@ -259,12 +251,23 @@ bool BEFFileReader::ReadKernelsSection(HostAllocator* host_allocator) {
 
     auto kernel = registry_->GetKernel(kernel_name);
     if (kernel.isNull()) {
-      return DiagnoseUnknownKernel(bef_file_->kernels_.size(), kernel_name,
-                                   host_allocator);
+      return DiagnoseUnknownKernel(bef_file_->kernels_.size(), kernel_name);
     }
 
     // Otherwise remember it.
     bef_file_->kernels_.push_back(kernel);
+    bef_file_->kernel_names_.push_back(kernel_name);
+
+    auto kernel_cost = registry_->GetKernelCost(kernel_name);
+    bef_file_->kernel_costs_.push_back(kernel_cost);
+    if (kernel_cost != KernelCost::kCheap)
+      bef_file_->has_expensive_kernels_ = true;
+
+#ifndef TFRT_DISABLE_TRACING
+    // Intern the name once, so that tracing a kernel doesn't copy its name.
+    bef_file_->kernel_tracing_names_.push_back(
+        tracing::InternTracingName(kernel_name));
+#endif
   }
 
   return false;
@@ -393,6 +396,8 @@ bool BEFFileReader::ReadFunctionIndexSection() {
         auto bef_function = std::make_unique<BEFFunction>(
             name, function_index.arguments, function_index.results,
             function_index.function_offset, bef_file_);
+        // Init() has already emitted an error on failure.
+        if (!bef_function->Init()) return true;
         bef_file_->functions_.push_back(std::move(bef_function));
         break;
       }
@@ -452,7 +457,7 @@ RCReference<BEFFile> BEFFile::Open(ArrayRef<uint8_t> file,
 
   // Now that we've figured out the contents of the sections, resolve some
   // things.
-  if (reader.ReadKernelsSection(host_allocator) || reader.ReadTypesSection() ||
+  if (reader.ReadKernelsSection() || reader.ReadTypesSection() ||
       reader.ReadFunctionIndexSection())
     return {};
 
@@ -473,10 +478,7 @@ void BEFFileImpl::EmitFormatError(const char* message) {
 // reporting error via EmitFormatError to make the API more natural.
 bool BEFFileImpl::ReadFunction(size_t function_offset,
                                ArrayRef<TypeName> results,
-                               size_t* location_offset,
-                               FunctionInfo* function_info,
-                               SmallVectorImpl<size_t>* result_regs,
-                               HostAllocator* host_allocator) {
+                               FunctionInfo* function_info) {
   auto format_error = [&]() -> bool {
     EmitFormatError("invalid Function section in BEF file");
     return false;
@@ -487,44 +489,40 @@ bool BEFFileImpl::ReadFunction(size_t function_offset,
   BEFReader reader(function_section_.drop_front(function_offset));
 
   // First we have the location info and register info table.
-  size_t num_registers;
-  if (reader.ReadInt(location_offset) || reader.ReadInt(&num_registers))
+  size_t location_offset, num_registers;
+  if (reader.ReadInt(&location_offset) || reader.ReadInt(&num_registers))
     return format_error();
 
-  function_info->register_infos.resize(num_registers, host_allocator);
-  auto* register_info_ptr =
-      function_info->register_infos.mutable_array().data();
-  unsigned register_idx = 0;
+  function_info->register_infos.reserve(num_registers);
   while (num_registers--) {
     size_t user_count;
     if (reader.ReadInt(&user_count)) return format_error();
-    new (register_info_ptr + register_idx) RegisterInfo(user_count);
-    ++register_idx;
+    function_info->register_infos.push_back(
+        RegisterInfo{static_cast<unsigned>(user_count)});
   }
 
   // Next we have the kernel index table.
   size_t num_kernels;
   if (reader.ReadInt(&num_kernels)) return format_error();
 
-  function_info->kernel_infos.resize(num_kernels, host_allocator);
-  auto* kernel_info_ptr = function_info->kernel_infos.mutable_array().data();
-  unsigned kernel_idx = 0;
+  function_info->kernel_infos.reserve(num_kernels);
   while (num_kernels--) {
     size_t offset, num_operands;
     if (reader.ReadInt(&offset) || reader.ReadInt(&num_operands))
       return format_error();
-    new (kernel_info_ptr + kernel_idx)
-        KernelInfo(unsigned(offset), unsigned(num_operands));
-    ++kernel_idx;
+    function_info->kernel_infos.push_back(
+        KernelInfo{static_cast<unsigned>(offset),
+                   static_cast<unsigned>(num_operands)});
   }
 
   // Read the result registers.
-  result_regs->reserve(results.size());
+  function_info->result_regs.reserve(results.size());
   for (unsigned i = 0, e = results.size(); i != e; ++i) {
     size_t result_reg;
-    if (reader.ReadInt(&result_reg) || result_reg >= num_registers)
+    if (reader.ReadInt(&result_reg) ||
+        result_reg >= function_info->register_infos.size())
       return format_error();
-    result_regs->push_back(result_reg);
+    function_info->result_regs.push_back(result_reg);
   }
 
   // Kernels are aligned to kKernelEntryAlignment.
@@ -565,7 +563,7 @@ DecodedLocation BEFFileImpl::DecodeLocation(size_t location_position_offset) {
       reinterpret_cast<const char*>(location_filenames_section_.data()),
       location_filenames_section_.size());
   // Skip over file_idx number of entries.
-  while (file_idx && !filenames.empty()) {
+  for (; file_idx && !filenames.empty(); --file_idx) {
     auto next_end = filenames.find('\0');
     if (next_end == string_view::npos)
       filenames = "";
@@ -580,29 +578,7 @@ DecodedLocation BEFFileImpl::DecodeLocation(size_t location_position_offset) {
   return result;
 }
 
-const char* BEFFileImpl::GetKernelName(size_t kernel_id) {
-  // If this is the first time we've been called, decode kernels_section_ and
-  // initialize kernel_names_.
-  if (kernel_names_.empty()) {
-    BEFReader reader(kernels_section_);
-
-    size_t num_kernels;
-    if (reader.ReadInt(&num_kernels)) return "(failed to decode num_kernels)";
-
-    kernel_names_.reserve(num_kernels);
-    while (num_kernels--) {
-      size_t kernel_name_offset;
-
-      const char* kernel_name = "(failed to read kernel_name)";
-      if (!reader.ReadInt(&kernel_name_offset) &&
-          kernel_name_offset < string_section_.size())
-        kernel_name =
-            reinterpret_cast<const char*>(&string_section_[kernel_name_offset]);
-
-      kernel_names_.push_back(kernel_name);
-    }
-  }
-
+const char* BEFFileImpl::GetKernelName(size_t kernel_id) const {
   if (kernel_id >= kernel_names_.size()) return "(invalid kernel_id)";
 
   return kernel_names_[kernel_id];
@@ -626,6 +602,13 @@ const Function* BEFFile::GetFunction(string_view function_name) const {
   return impl->functions_[it->second].get();
 }
 
+bool BEFFunction::Init() {
+  assert(function_info_.register_infos.empty());
+  assert(function_info_.kernel_infos.empty());
+  return bef_file_->ReadFunction(function_offset_, result_types(),
+                                 &function_info_);
+}
+
 Expected<std::unique_ptr<SyncBEFFunction>> SyncBEFFunction::Create(
     string_view name, ArrayRef<TypeName> arguments, ArrayRef<TypeName> results,
     size_t function_offset, BEFFileImpl* bef_file) {
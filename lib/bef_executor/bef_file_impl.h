@@ -35,6 +35,7 @@
 #include "tfrt/host_context/kernel_registry.h"
 #include "tfrt/host_context/native_function.h"
 #include "tfrt/support/forward_decls.h"
+#include "tfrt/tracing/tracing.h"
 
 namespace tfrt {
 
@@ -102,6 +103,120 @@ class BEFInfoArray {
   HostArray<InfoT> host_array_;
 };
 
+// This class is the implementation details behind the BEFFile::Open method,
+// which maintains all the state necessary for the BEFExecutor.  It is fully
+// public because it is a private implementation detail within this library.
+class BEFFileImpl : public BEFFile {
+ public:
+  ~BEFFileImpl() override;
+
+  explicit BEFFileImpl(ErrorHandler error_handler);
+
+  // Emit an error message about a malformed BEF file.
+  void EmitFormatError(const char* message);
+
+  // When decoding a function info descriptor, this describes each register.
+  struct RegisterInfo {
+    // This is the number of uses of the register in the program.  The value
+    // may be deallocated when this number of uses are complete.
+    unsigned user_count;
+  };
+
+  // When decoding the kernel table for a function, we get the offset of
+  // each kernel as well as the number of operands it has.
+  //
+  // The executor uses this table, indexed by kernel number, to know where to
+  // find each kernel in the kernels section, and to know how many arguments
+  // need to come in before the kernel can start.
+  struct KernelInfo {
+    unsigned offset;
+    unsigned num_operands;
+  };
+
+  // Decoded BEFFunction information. This is immutable once decoded and it is
+  // shared by all executions of the function. The per-execution state, e.g.
+  // register values and the arguments_not_ready counts, is kept by BEFExecutor.
+  struct FunctionInfo {
+    // This ArrayRef contains kernel entries of all kernels of this function.
+    ArrayRef<uint32_t> kernels;
+    // This is an array of descriptors for all of our registers, indexed by
+    // their register number.
+    SmallVector<RegisterInfo, 16> register_infos;
+    // This is an array of descriptors for all of the kernels in this function,
+    // indexed by the kernel number.
+    SmallVector<KernelInfo, 8> kernel_infos;
+    // This is an array of register index for the result registers.
+    SmallVector<size_t, 4> result_regs;
+  };
+
+  // Decode the specified BEFFunction into the FunctionInfo.
+  //
+  // On error, an error is emitted and false is returned.
+  //
+  // ReadFunction is invoked once per BEFFunction when the BEF file is opened,
+  // and the decoded information is cached in the BEFFunction object.
+  bool ReadFunction(size_t function_offset, ArrayRef<TypeName> results,
+                    FunctionInfo* function_info);
+
+  // Given an offset into the LocationPositions section, decode it and return
+  // a DecodedDiagnostic.
+  DecodedLocation DecodeLocation(size_t location_position_offset);
+
+  // Returns the name of the kernel with `kernel_id`, i.e. kernel_code. The
+  // name lives as long as this BEF file.
+  const char* GetKernelName(size_t kernel_id) const;
+
+  AsyncKernelImplementation GetAsyncKernel(uint32_t kernel_code) const {
+    KernelImplementation kernel_impl = kernels_[kernel_code];
+    assert(kernel_impl.is<AsyncKernelImplementation>());
+    return kernel_impl.get<AsyncKernelImplementation>();
+  }
+
+  SyncKernelImplementation GetSyncKernel(uint32_t kernel_code) const {
+    KernelImplementation kernel_impl = kernels_[kernel_code];
+    assert(kernel_impl.is<SyncKernelImplementation>());
+    return kernel_impl.get<SyncKernelImplementation>();
+  }
+
+  KernelCost GetKernelCost(uint32_t kernel_code) const {
+    return kernel_costs_[kernel_code];
+  }
+
+  // Returns the interned name of a kernel for tracing. Only valid if tracing is
+  // not disabled at compile time.
+  tracing::InternedTracingName GetKernelTracingName(
+      uint32_t kernel_code) const {
+    return kernel_tracing_names_[kernel_code];
+  }
+
+  ArrayRef<uint8_t> function_section() const { return function_section_; }
+
+  ErrorHandler error_handler_;
+
+  ArrayRef<uint8_t> location_filenames_section_;
+  ArrayRef<uint8_t> location_positions_section_;
+  ArrayRef<uint8_t> string_section_;
+  ArrayRef<uint8_t> attribute_section_;
+  ArrayRef<uint8_t> kernels_section_;
+  ArrayRef<uint8_t> types_section_;
+  ArrayRef<uint8_t> function_section_;
+  ArrayRef<uint8_t> function_index_section_;
+  SmallVector<KernelImplementation, 8> kernels_;
+  // The cost class of each kernel, indexed by kernel_code.
+  SmallVector<KernelCost, 8> kernel_costs_;
+  // True if any kernel in kernels_ is not cheap.
+  bool has_expensive_kernels_ = false;
+  // The interned name of each kernel, indexed by kernel_code. Empty if tracing
+  // is disabled at compile time.
+  SmallVector<tracing::InternedTracingName, 8> kernel_tracing_names_;
+  SmallVector<TypeName, 8> type_names_;
+  llvm::StringMap<size_t> function_symbol_table_;
+  SmallVector<std::unique_ptr<Function>, 8> functions_;
+
+  // The name of each kernel, indexed by kernel_code.
+  SmallVector<const char*, 8> kernel_names_;
+};
+
 // This class implements Function for BEF files.
 class BEFFunction : public Function {
  public:
@@ -115,11 +230,24 @@ class BEFFunction : public Function {
   BEFFunction(BEFFunction&& other)
       : Function(std::move(other)),
         function_offset_(other.function_offset_),
-        bef_file_(other.bef_file_) {}
+        bef_file_(other.bef_file_),
+        function_info_(std::move(other.function_info_)) {}
+
+  // Read the register and kernel information for the function. We cache this
+  // information in BEFFunction to avoid repeatedly reading this information
+  // for every function execution.
+  //
+  // On error, an error is emitted and false is returned.
+  bool Init();
 
   size_t function_offset() const { return function_offset_; }
   BEFFileImpl* bef_file() const { return bef_file_; }
 
+  // Return the decoded register and kernel information for this function.
+  const BEFFileImpl::FunctionInfo& function_info() const {
+    return function_info_;
+  }
+
   void Execute(const ExecutionContext& exec_ctx,
                ArrayRef<AsyncValue*> arguments,
                MutableArrayRef<RCReference<AsyncValue>> results) const override;
@@ -129,6 +257,9 @@ class BEFFunction : public Function {
  protected:
   size_t function_offset_;
   BEFFileImpl* bef_file_;
+
+ private:
+  BEFFileImpl::FunctionInfo function_info_;
 };
 
 // This class implements SyncFunction for BEF files.
@@ -197,123 +328,6 @@ class SyncBEFFunction final : public BEFFunction {
   SmallVector<uint32_t, 4> result_regs_;
 };
 
-// This class is the implementation details behind the BEFFile::Open method,
-// which maintains all the state necessary for the BEFExecutor.  It is fully
-// public because it is a private implementation detail within this library.
-class BEFFileImpl : public BEFFile {
- public:
-  ~BEFFileImpl() override;
-
-  explicit BEFFileImpl(ErrorHandler error_handler);
-
-  // Emit an error message about a malformed BEF file.
-  void EmitFormatError(const char* message);
-
-  // When decoding a function info descriptor, this describes each register.
-  struct RegisterInfo {
-    // This is the number of uses of the register in the program.  The value
-    // may be deallocated when this number of uses are complete.
-    const unsigned user_count;
-    // 'value' is not used by BEFFileImpl. BEFExecutor takes ownership of
-    // RegisterInfo, and uses 'value' to track the register's contents as it
-    // executes a function.
-    std::atomic<AsyncValue*> value{nullptr};
-
-    explicit RegisterInfo(unsigned user_count) : user_count(user_count) {}
-  };
-
-  // When decoding the kernel table for a function, we get the offset of
-  // each kernel as well as the number of operands it has.
-  //
-  // The executor keeps an array of these, indexed by kernel number to know
-  // where to find each kernel in the kernels section, and to know how many
-  // arguments are still waiting to come in before the kernel can start.
-  //
-  // This struct is defined here, because ReadFunction() below will populate it.
-  struct KernelInfo {
-    unsigned offset;
-    std::atomic<int> arguments_not_ready;
-
-    // We initialize the ready list to "num_operands + 1" so we can drop the
-    // last count in the executor constructor.
-    KernelInfo(unsigned offset, unsigned num_operands)
-        : offset(offset), arguments_not_ready(num_operands + 1) {}
-  };
-
-  using RegisterInfoArray = BEFInfoArray<BEFFileImpl::RegisterInfo, 24>;
-  using KernelInfoArray = BEFInfoArray<BEFFileImpl::KernelInfo, 8>;
-
-  // Decoded BEFFunction information.
-  struct FunctionInfo {
-    // This ArrayRef contains kernel entries of all kernels of this function.
-    ArrayRef<uint32_t> kernels;
-    // This is an array of descriptors for all of the kernels in this function,
-    // indexed by the kernel number.
-    RegisterInfoArray register_infos;
-    // This is an array of descriptors for all of our registers, indexed by
-    // their register number.
-    KernelInfoArray kernel_infos;
-  };
-
-  // Decode the specified BEFFunction into the FunctionInfo. `host_allocator` is
-  // used for the heap-allocated buffer that backs info arrays in FunctionInfo.
-  //
-  // On error, an error is emitted and false is returned.
-  //
-  // ReadFunction is invoked for every BEFFunction execution. We can consider
-  // caching the kernel and register information in the BEFFunction object to
-  // avoid repeadly reading the same information from the BEF file. However, in
-  // the current implementation, we couple BEFExecutor states, e.g. AsyncValue
-  // for RegisterInfo, with the function reading. Caching kernel and register
-  // information would require us to avoid such coupling which can adversely
-  // affect the performance.
-  bool ReadFunction(size_t function_offset, ArrayRef<TypeName> results,
-                    size_t* location_offset, FunctionInfo* function_info,
-                    SmallVectorImpl<size_t>* result_regs,
-                    HostAllocator* host_allocator);
-
-  // Given an offset into the LocationPositions section, decode it and return
-  // a DecodedDiagnostic.
-  DecodedLocation DecodeLocation(size_t location_position_offset);
-
-  // Only used for debugging. Populates kernel_names_ on first call, which is
-  // slow.
-  const char* GetKernelName(size_t kernel_id);
-
-  AsyncKernelImplementation GetAsyncKernel(uint32_t kernel_code) const {
-    KernelImplementation kernel_impl = kernels_[kernel_code];
-    assert(kernel_impl.is<AsyncKernelImplementation>());
-    return kernel_impl.get<AsyncKernelImplementation>();
-  }
-
-  SyncKernelImplementation GetSyncKernel(uint32_t kernel_code) const {
-    KernelImplementation kernel_impl = kernels_[kernel_code];
-    assert(kernel_impl.is<SyncKernelImplementation>());
-    return kernel_impl.get<SyncKernelImplementation>();
-  }
-
-  ArrayRef<uint8_t> function_section() const { return function_section_; }
-
-  ErrorHandler error_handler_;
-
-  ArrayRef<uint8_t> location_filenames_section_;
-  ArrayRef<uint8_t> location_positions_section_;
-  ArrayRef<uint8_t> string_section_;
-  ArrayRef<uint8_t> attribute_section_;
-  ArrayRef<uint8_t> kernels_section_;
-  ArrayRef<uint8_t> types_section_;
-  ArrayRef<uint8_t> function_section_;
-  ArrayRef<uint8_t> function_index_section_;
-  SmallVector<KernelImplementation, 8> kernels_;
-  SmallVector<TypeName, 8> type_names_;
-  llvm::StringMap<size_t> function_symbol_table_;
-  SmallVector<std::unique_ptr<Function>, 8> functions_;
-
-  // Maps from kernel_id to the name of the kernel. Only nonempty when
-  // debugging.
-  std::vector<const char*> kernel_names_;
-};
-
 }  // namespace tfrt
 
 #endif  // TFRT_LIB_BEF_EXECUTOR_BEF_FILE_IMPL_H_
@@ -39,17 +39,23 @@
 #include "tfrt/host_context/function.h"
 #include "tfrt/host_context/host_allocator.h"
 #include "tfrt/host_context/host_context.h"
+#include "tfrt/host_context/kernel_profiler.h"
 #include "tfrt/host_context/kernel_registry.h"
 #include "tfrt/host_context/location.h"
 #include "tfrt/host_context/profiled_allocator.h"
 #include "tfrt/host_context/resource_context.h"
 #include "tfrt/metrics/metrics_api.h"
+#include "tfrt/metrics/metrics_exporter.h"
+#include "tfrt/metrics/work_queue_metrics.h"
 #include "tfrt/support/mutex.h"
 #include "tfrt/support/string_util.h"
 #include "tfrt/tracing/tracing.h"
 
 namespace tfrt {
-static void RunBefFunction(HostContext* host, const Function* function);
+static void RunBefFunction(HostContext* host, const Function* function,
+                           const RunBefConfig& run_config,
+                           tracing::TracingSampler* sampler,
+                           KernelProfiler* kernel_profiler);
 
 int RunBefExecutor(const RunBefConfig& run_config) {
   TFRT_TRACE_SCOPE("Bef Executor");
@@ -112,6 +118,10 @@ int RunBefExecutor(const RunBefConfig& run_config) {
       host_allocator = CreateMallocAllocator();
       host_allocator = CreateLeakCheckAllocator(std::move(host_allocator));
       tfrt::outs() << "Choosing memory leak check allocator.\n";
+      break;
+    case HostAllocatorType::kSizeClassMalloc:
+      host_allocator = CreateSizeClassAllocator(CreateMallocAllocator());
+      tfrt::outs() << "Choosing size class allocator based on malloc.\n";
   }
   tfrt::outs().flush();
 
@@ -150,6 +160,8 @@ int RunBefExecutor(const RunBefConfig& run_config) {
   }
 
   auto* host = core_rt.get()->GetHostContext();
+  // The work queue gauges are refreshed in every snapshot of the metrics.
+  metrics::WorkQueueMetricsCollector work_queue_metrics(*host);
 
   // If there are any libraries specified, load them and see if they have a
   // kernel registration function.
@@ -198,17 +210,35 @@ int RunBefExecutor(const RunBefConfig& run_config) {
     }
   }
 
+  tracing::TracingSampler sampler(run_config.tracing_sampling_period);
+  std::unique_ptr<KernelProfiler> kernel_profiler;
+  if (run_config.profile_kernels)
+    kernel_profiler = std::make_unique<KernelProfiler>();
+
   // Run the init function first if exists.
   auto init_function = bef->GetFunction(run_config.init_function);
 
   if (init_function) {
-    RunBefFunction(host, init_function);
+    RunBefFunction(host, init_function, run_config, &sampler,
+                   kernel_profiler.get());
   }
 
   // Loop over each of the functions, running each as a standalone testcase.
   for (auto* fn : function_list) {
     if (fn != init_function) {
-      RunBefFunction(host, fn);
+      RunBefFunction(host, fn, run_config, &sampler,
+                     kernel_profiler.get());
+    }
+  }
+  if (kernel_profiler) {
+    tfrt::outs() << "--- Kernel profile:\n";
+    kernel_profiler->PrintProfile(tfrt::outs());
+  }
+  if (!run_config.metrics_file.empty()) {
+    if (auto error = metrics::WriteMetricsFile(run_config.metrics_file)) {
+      llvm::errs() << run_config.program_name << ": couldn't write metrics: "
+                   << llvm::toString(std::move(error)) << "\n";
+      return 1;
     }
   }
 
@@ -218,7 +248,13 @@ int RunBefExecutor(const RunBefConfig& run_config) {
   return mlir::failed(source_mgr_handler.verify());
 }
 
-static void RunBefFunctionHelper(HostContext* host, const Function* function) {
+static void RunBefFunctionHelper(HostContext* host, const Function* function,
+                                 const RunBefConfig& run_config,
+                                 tracing::TracingSampler* sampler,
+                                 KernelProfiler* kernel_profiler) {
+  // Trace the whole execution of the function if it is sampled.
+  const uint64_t tracing_request_id = sampler->Sample();
+  tracing::ScopedTracingRequest tracing_request(tracing_request_id);
   TFRT_TRACE_KERNEL_SCOPE(StrCat("Function: ", function->name()));
   // If the function takes arguments, then we can't run it from this driver.
   if (!function->argument_types().empty()) {
@@ -246,9 +282,14 @@ static void RunBefFunctionHelper(HostContext* host, const Function* function) {
   // If any kernel calls RequestContext::Cancel, it will create an extra async
   // value that's stored inside RequestContext which is destroyed only when
   // RequestContext is destroyed.
-  RCReference<RequestContext> req_ctx =
-      tfrt::RequestContext::Create(host, &resource_context);
+  RCReference<RequestContext> req_ctx = tfrt::RequestContext::Create(
+      host, &resource_context, run_config.use_request_arena);
+  req_ctx->set_tracing_request_id(tracing_request_id);
   ExecutionContext exec_ctx{std::move(req_ctx)};
+  exec_ctx.set_parallel_dispatch_threshold(
+      run_config.parallel_dispatch_threshold);
+  exec_ctx.set_kernel_profiler(kernel_profiler);
+  exec_ctx.set_record_function_latency(!run_config.metrics_file.empty());
 
   function->Execute(exec_ctx, /*arguments=*/{}, results);
 
@@ -298,14 +339,17 @@ static void RunBefFunctionHelper(HostContext* host, const Function* function) {
   results.clear();
 }
 
-static void RunBefFunction(HostContext* host, const Function* function) {
+static void RunBefFunction(HostContext* host, const Function* function,
+                           const RunBefConfig& run_config,
+                           tracing::TracingSampler* sampler,
+                           KernelProfiler* kernel_profiler) {
   // Async value leak check before and after running the function.
   size_t before_num_values;
   if (AsyncValue::AsyncValueAllocationTrackingEnabled())
     before_num_values = AsyncValue::GetNumAsyncValueInstances();
 
   // Actually run the function.
-  RunBefFunctionHelper(host, function);
+  RunBefFunctionHelper(host, function, run_config, sampler, kernel_profiler);
 
   if (AsyncValue::AsyncValueAllocationTrackingEnabled()) {
     auto after_num_values = AsyncValue::GetNumAsyncValueInstances();
@@ -130,6 +130,7 @@ void CoreRuntime::Impl::Execute(const ExecutionContext& exec_ctx,
   // Ask the op_handler to execute the op.  If successful, we're done.
   auto op_handle = op_handler->MakeOp(op_name);
   if (op_handle) {
+    op_handler->dispatch_counter()->Increment();
     op_handle.get()(exec_ctx, arguments, attrs, results, chain);
     return;
   }
@@ -292,18 +293,28 @@ void CoreRuntime::Execute(const ExecutionContext& exec_ctx, string_view op_name,
 
 Expected<CoreRuntimeOp> CoreRuntime::MakeOp(string_view op_name,
                                             OpHandler* op_handler) {
-#ifdef TFRT_DISABLE_TRACING
-  return op_handler->MakeOp(op_name);
-#else  // TFRT_DISABLE_TRACING
   auto op = op_handler->MakeOp(op_name);
   if (!op) return op;
   bool is_fallback = op->IsFallback();
-  // TODO(b/155801998): Avoid this string copy.
+  auto* dispatch_counter = op_handler->dispatch_counter();
+#ifdef TFRT_DISABLE_TRACING
+  return CoreRuntimeOp(
+      [dispatch_counter, op = std::move(op.get())](
+          const OpInvocation& invocation) mutable {
+        dispatch_counter->Increment();
+        op(invocation);
+      },
+      is_fallback);
+#else  // TFRT_DISABLE_TRACING
+  // Intern the name when the op is made, so that tracing an invocation doesn't
+  // build and copy the name.
+  auto tracing_name = tracing::InternTracingName(
+      StrCat(op_name, "#op_handler=", op_handler->GetName()));
   return CoreRuntimeOp(
-      [op_name = op_name.str(), op = std::move(op.get()),
-       op_handler](const OpInvocation& invocation) mutable {
-        TFRT_TRACE_KERNEL_SCOPE(
-            StrCat(op_name, "#op_handler=", op_handler->GetName()));
+      [dispatch_counter, tracing_name, op = std::move(op.get())](
+          const OpInvocation& invocation) mutable {
+        dispatch_counter->Increment();
+        TFRT_TRACE_KERNEL_SCOPE(tracing_name);
         op(invocation);
       },
       is_fallback);
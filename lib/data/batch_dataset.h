@@ -25,9 +25,12 @@
 #ifndef TFRT_DATA_BATCH_DATASET_H_
 #define TFRT_DATA_BATCH_DATASET_H_
 
+#include <algorithm>
+
 #include "dataset.h"
 #include "llvm/ADT/SmallVector.h"
 #include "tfrt/host_context/execution_context.h"
+#include "tfrt/host_context/parallel_for.h"
 #include "tfrt/support/error_util.h"
 #include "tfrt/support/forward_decls.h"
 #include "tfrt/support/ref_count.h"
@@ -92,25 +95,25 @@ SmallVector<AsyncValueRef<TensorMetadata>, 4> GetInputMetadata(
   return metadatas;
 }
 
-// Copy bytes of `src` to the index-th element of `dst`. This is useful to batch
-// multiple scalar values into a DenseHostTenor.
+// Returns the bytes of `value` that are copied into a slice of a batch.
 template <typename T>
-void CopyDataHelper(T* src, DenseHostTensor* dst, int index) {
-  int data_size = sizeof(*src);
-  char* dst_ptr = static_cast<char*>(dst->data()) + index * data_size;
-  std::memcpy(dst_ptr, src, data_size);
+const void* GetSliceData(const T& value) {
+  return &value;
 }
 
-// Copy bytes of `src` to the index-th element of `dst`. This is useful to batch
-// multiple DenseHostTensors into a DenseHostTenor.
 template <>
-inline void CopyDataHelper<DenseHostTensor>(DenseHostTensor* src,
-                                            DenseHostTensor* dst, int index) {
-  int data_size = src->DataSizeInBytes();
-  char* dst_ptr = static_cast<char*>(dst->data()) + index * data_size;
-  std::memcpy(dst_ptr, src->data(), data_size);
+inline const void* GetSliceData<DenseHostTensor>(const DenseHostTensor& value) {
+  return value.data();
 }
 
+// The slices of a batch are copied in chunks of at most kBatchCopyChunkBytes,
+// so that a chunk stays in the L2 cache of the thread that copies it. The
+// chunks of the inputs that are available together are copied in parallel by
+// blocks of at least kMinBatchCopyBlockBytes, so that small batches are copied
+// by a single thread.
+constexpr size_t kBatchCopyChunkBytes = 256 * 1024;
+constexpr size_t kMinBatchCopyBlockBytes = 1024 * 1024;
+
 struct CounterAndError {
   explicit CounterAndError(uint32_t size)
       : unavailable_num(size), eof_num(0), initial_batch_size(size) {}
@@ -148,13 +151,147 @@ static llvm::Expected<DenseHostTensor> TruncateTensor(
   return std::move(output_tensor);
 }
 
-// Copies buffer from `input_value` (which is a DenseHostTensor) into
-// the `slice_index`-th slice of `result_buffer` when it is ready and decrements
-// the counter or forwards an error to `counter_and_error`. Additionally checks
-// that the metadata of `input_value` matches `expected_metadata`. When the
-// unavailable_num of `counter_and_error` reaches 0, which means that all slices
-// have been copied, move the the first (initial_batch_size - eof_num) rows of
-// the `result_buffer` to `result` and make `result` available.
+// Records `error_value` as the error of the batch in `counter_and_error`, and
+// takes over its reference. Only the first error of a batch is kept.
+static void SetSliceError(AsyncValue* error_value,
+                          CounterAndError* counter_and_error) {
+  AsyncValue* null_value = nullptr;
+  // Use memory_order_release for the success case so that error_value is
+  // visible to other threads when they load with memory_order_acquire. For
+  // the failure case, we do not care about expected_value, so we can use
+  // memory_order_relaxed.
+  if (!counter_and_error->error.compare_exchange_strong(
+          null_value, error_value, std::memory_order_release,
+          std::memory_order_relaxed)) {
+    error_value->DropRef();
+  }
+}
+
+// Records the eof or the error of an input of a batch in `counter_and_error`.
+// Returns true if the input is a value to copy into the batch instead. The
+// eof and the value of the input must be available.
+template <typename T>
+bool CheckSliceInput(RCReference<AsyncValue>* input_value,
+                     AsyncValueRef<bool>* input_eof,
+                     const AsyncValueRef<TensorMetadata>& expected_metadata,
+                     CounterAndError* counter_and_error) {
+  if (!input_eof->IsError() && input_eof->get()) {
+    counter_and_error->eof_num.fetch_add(1);
+    return false;
+  }
+  if (input_eof->IsError() || (*input_value)->IsError()) {
+    SetSliceError(
+        input_eof->IsError() ? input_eof->release() : input_value->release(),
+        counter_and_error);
+    return false;
+  }
+  // Verify that the input_value's metadata equals the expected_metadata.
+  // IDEA(donglin): Do this check only in DEBUG mode.
+  assert(GetMetadataFromValue((*input_value)->get<T>()) ==
+         expected_metadata.get());
+  return true;
+}
+
+// Decrements the unavailable_num of `counter_and_error` by `num_slices`. When
+// it reaches 0, which means that all slices have been copied, moves the first
+// (initial_batch_size - eof_num) rows of the `result_buffer` to `result` and
+// makes `result` available.
+static void FinishSlices(size_t num_slices,
+                         const AsyncValueRef<DenseHostTensor>& result_buffer,
+                         const RCReference<AsyncValue>& result,
+                         CounterAndError* counter_and_error,
+                         const ExecutionContext& exec_ctx) {
+  auto unavailable_num =
+      counter_and_error->unavailable_num.fetch_sub(num_slices) - num_slices;
+  if (unavailable_num != 0) return;
+
+  // Use memory_order_consume so that writes to this atomic variable from
+  // other threads are visible to this thread.
+  auto* error_value = counter_and_error->error.load(std::memory_order_consume);
+  auto eof_num = counter_and_error->eof_num.load(std::memory_order_consume);
+  auto batch_size = counter_and_error->initial_batch_size - eof_num;
+  // Forward the error if any, otherwise move `result_buffer` to `result`.
+  if (error_value != nullptr) {
+    result->SetError(error_value->GetError());
+    error_value->DropRef();
+  } else if (batch_size == 0) {
+    auto error =
+        exec_ctx.host()->MakeErrorAsyncValueRef("iterator reached end");
+    result->SetError(error->GetError());
+  } else if (eof_num == 0) {
+    result->emplace<DenseHostTensor>(std::move(result_buffer.get()));
+  } else {
+    auto output_tensor =
+        TruncateTensor(result_buffer.get(), batch_size, exec_ctx);
+    if (!output_tensor) {
+      auto error = EmitError(exec_ctx, StrCat(output_tensor.takeError()));
+      result->SetError(error);
+    } else {
+      result->emplace<DenseHostTensor>(std::move(*output_tensor));
+    }
+  }
+  delete counter_and_error;
+}
+
+// Copies the available `input_values` into the slices of `result_buffer` given
+// by `slice_indices`, and then calls FinishSlices() for them. The copies are
+// split into chunks that are copied in parallel if there are enough of them,
+// see kBatchCopyChunkBytes.
+template <typename T>
+void CopySlices(SmallVector<RCReference<AsyncValue>, 4> input_values,
+                SmallVector<size_t, 4> slice_indices,
+                AsyncValueRef<DenseHostTensor> result_buffer,
+                RCReference<AsyncValue> result,
+                CounterAndError* counter_and_error,
+                const ExecutionContext& exec_ctx) {
+  const size_t num_slices = input_values.size();
+  const size_t slice_size = result_buffer->DataSizeInBytes() /
+                            counter_and_error->initial_batch_size;
+  if (slice_size == 0) {
+    FinishSlices(num_slices, result_buffer, result, counter_and_error,
+                 exec_ctx);
+    return;
+  }
+
+  const size_t chunks_per_slice =
+      (slice_size + kBatchCopyChunkBytes - 1) / kBatchCopyChunkBytes;
+  const size_t chunk_size =
+      (slice_size + chunks_per_slice - 1) / chunks_per_slice;
+  char* batch_data = static_cast<char*>(result_buffer->data());
+
+  auto compute = [input_values = std::move(input_values),
+                  slice_indices = std::move(slice_indices), slice_size,
+                  chunks_per_slice, chunk_size,
+                  batch_data](size_t begin, size_t end) {
+    for (size_t chunk = begin; chunk < end; ++chunk) {
+      size_t i = chunk / chunks_per_slice;
+      size_t offset = (chunk % chunks_per_slice) * chunk_size;
+      size_t size = std::min(chunk_size, slice_size - offset);
+      const char* src =
+          static_cast<const char*>(GetSliceData(input_values[i]->get<T>())) +
+          offset;
+      char* dst = batch_data + slice_indices[i] * slice_size + offset;
+      std::memcpy(dst, src, size);
+    }
+  };
+  auto on_done = [num_slices, result_buffer = std::move(result_buffer),
+                  result = std::move(result), counter_and_error, exec_ctx]() {
+    FinishSlices(num_slices, result_buffer, result, counter_and_error,
+                 exec_ctx);
+  };
+
+  auto min_block_chunks = std::max<size_t>(
+      kMinBatchCopyBlockBytes / chunk_size, 1);
+  ParallelFor(exec_ctx.host())
+      .Execute(num_slices * chunks_per_slice,
+               ParallelFor::BlockSizes::Min(min_block_chunks),
+               std::move(compute), std::move(on_done));
+}
+
+// Copies `input_value` into the `slice_index`-th slice of `result_buffer` when
+// it is ready, or records its eof or error in `counter_and_error`. The copy
+// runs on the thread that makes the input available, which likely has the
+// input in its cache.
 template <typename T>
 void CopySlice(RCReference<AsyncValue> input_value,
                AsyncValueRef<bool> input_eof,
@@ -175,62 +312,16 @@ void CopySlice(RCReference<AsyncValue> input_value,
                    result_buffer = std::move(result_buffer),
                    result = std::move(result), slice_index, counter_and_error,
                    exec_ctx]() mutable {
-    if (!input_eof.IsError() && input_eof.get()) {
-      counter_and_error->eof_num.fetch_add(1);
-    } else if (input_eof.IsError() || input_value->IsError()) {
-      AsyncValue* null_value = nullptr;
-      AsyncValue* error_value =
-          input_eof.IsError() ? input_eof.release() : input_value.release();
-      // Set error if it hasn't already been set.
-      //
-      // Use memory_order_release for the success case so that error_value is
-      // visible to other threads when they load with memory_order_acquire. For
-      // the failure case, we do not care about expected_value, so we can use
-      // memory_order_relaxed.
-      if (!counter_and_error->error.compare_exchange_strong(
-              null_value, error_value, std::memory_order_release,
-              std::memory_order_relaxed)) {
-        error_value->DropRef();
-      }
-    } else {
-      // Verify that the input_value's metadata equals the expected_metadata.
-      // IDEA(donglin): Do this check only in DEBUG mode.
-      assert(GetMetadataFromValue(input_value->get<T>()) ==
-             expected_metadata.get());
-      CopyDataHelper<T>(&input_value->get<T>(), &result_buffer.get(),
-                        slice_index);
-    }
-
-    auto unavailable_num = counter_and_error->unavailable_num.fetch_sub(1) - 1;
-    if (unavailable_num == 0) {
-      // Use memory_order_consume so that writes to this atomic variable from
-      // other threads are visible to this thread.
-      auto* error_value =
-          counter_and_error->error.load(std::memory_order_consume);
-      auto eof_num = counter_and_error->eof_num.load(std::memory_order_consume);
-      auto batch_size = counter_and_error->initial_batch_size - eof_num;
-      // Forward the error if any, otherwise move `result_buffer` to `result`.
-      if (error_value != nullptr) {
-        result->SetError(error_value->GetError());
-        error_value->DropRef();
-      } else if (batch_size == 0) {
-        auto error =
-            exec_ctx.host()->MakeErrorAsyncValueRef("iterator reached end");
-        result->SetError(error->GetError());
-      } else if (eof_num == 0) {
-        result->emplace<DenseHostTensor>(std::move(result_buffer.get()));
-      } else {
-        auto output_tensor =
-            TruncateTensor(result_buffer.get(), batch_size, exec_ctx);
-        if (!output_tensor) {
-          auto error = EmitError(exec_ctx, StrCat(output_tensor.takeError()));
-          result->SetError(error);
-        } else {
-          result->emplace<DenseHostTensor>(std::move(*output_tensor));
-        }
-      }
-      delete counter_and_error;
+    if (!CheckSliceInput<T>(&input_value, &input_eof, expected_metadata,
+                            counter_and_error)) {
+      FinishSlices(1, result_buffer, result, counter_and_error, exec_ctx);
+      return;
     }
+    SmallVector<RCReference<AsyncValue>, 4> input_values;
+    input_values.push_back(std::move(input_value));
+    CopySlices<T>(std::move(input_values), {slice_index},
+                  std::move(result_buffer), std::move(result),
+                  counter_and_error, exec_ctx);
   };
 
   exec_ctx.host()->RunWhenReady(async_value_ptrs, std::move(callback));
@@ -254,13 +345,32 @@ void CopyComponent(SmallVector<RCReference<AsyncValue>, 4> input_values,
       return;
     }
     auto* counter_and_error = new CounterAndError(input_values.size());
-    // Otherwise, when each input is ready, copy it to `result_buffer`. When all
-    // inputs are copied, move `result_buffer` to `result`.
+    // The inputs that are already available are copied together in parallel.
+    // The other inputs are copied to `result_buffer` when each of them is
+    // ready. When all inputs are copied, move `result_buffer` to `result`.
+    //
+    // The unavailable_num of `counter_and_error` can't reach 0 before the
+    // available inputs are copied, since they are only counted after the copy.
+    SmallVector<RCReference<AsyncValue>, 4> available_values;
+    SmallVector<size_t, 4> available_indices;
     for (size_t i = 0, e = input_values.size(); i < e; ++i) {
-      CopySlice<T>(std::move(input_values[i]), std::move(input_eofs[i]),
-                   expected_metadata.CopyRef(), result_buffer.CopyRef(),
-                   result.CopyRef(), counter_and_error, /*slice_index=*/i,
-                   exec_ctx);
+      if (!input_values[i]->IsAvailable() || !input_eofs[i].IsAvailable()) {
+        CopySlice<T>(std::move(input_values[i]), std::move(input_eofs[i]),
+                     expected_metadata.CopyRef(), result_buffer.CopyRef(),
+                     result.CopyRef(), counter_and_error, /*slice_index=*/i,
+                     exec_ctx);
+      } else if (CheckSliceInput<T>(&input_values[i], &input_eofs[i],
+                                    expected_metadata, counter_and_error)) {
+        available_values.push_back(std::move(input_values[i]));
+        available_indices.push_back(i);
+      } else {
+        FinishSlices(1, result_buffer, result, counter_and_error, exec_ctx);
+      }
+    }
+    if (!available_values.empty()) {
+      CopySlices<T>(std::move(available_values), std::move(available_indices),
+                    std::move(result_buffer), std::move(result),
+                    counter_and_error, exec_ctx);
     }
   });
 }
@@ -427,9 +537,6 @@ RCReference<Iterator> BatchDataset<T...>::MakeIterator() {
   return TakeRef(host_->Construct<BatchDatasetIterator<T...>>(FormRef(this)));
 }
 
-// IDEA(donglin): Consider scheduling the batch operation to the background
-// threadpool explicitly. This can prevent GetNext() from doing memory copy
-// synchronously regardless of whether the input values are available.
 template <typename... T>
 IterationResult BatchDatasetIterator<T...>::GetNext(
     const ExecutionContext& exec_ctx) {
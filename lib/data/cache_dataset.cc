@@ -0,0 +1,182 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+//===- cache_dataset.cc ---------------------------------------------------===//
+//
+// This file implements CacheDataset class which caches the elements of its
+// input dataset in memory or in a file on the first pass over them.
+//
+//===----------------------------------------------------------------------===//
+
+#include "cache_dataset.h"
+
+#include "llvm/Support/FileSystem.h"
+#include "tfrt/support/error_util.h"
+#include "tfrt/support/logging.h"
+
+namespace tfrt {
+namespace data {
+
+//===----------------------------------------------------------------------===//
+// CacheDataset methods
+//===----------------------------------------------------------------------===//
+CacheDataset::CacheDataset(RCReference<Dataset> input_dataset,
+                           std::string filename, int32_t num_worker_threads,
+                           HostContext* host)
+    : input_dataset_(std::move(input_dataset)),
+      filename_(std::move(filename)),
+      num_worker_threads_(num_worker_threads),
+      host_(host),
+      allocator_(host->allocator()) {
+  // A cache file written by an earlier run is reused.
+  if (!filename_.empty() && llvm::sys::fs::exists(filename_))
+    file_state_ = FileState::kWritten;
+}
+
+RCReference<Iterator> CacheDataset::MakeIterator() {
+  if (filename_.empty())
+    return TakeRef(host_->Construct<CacheDatasetIterator>(FormRef(this)));
+
+  {
+    mutex_lock lock(mu_);
+    if (file_state_ == FileState::kWritten) {
+      auto reader = CacheFileReader::Open(filename_);
+      if (reader) {
+        return TakeRef(host_->Construct<CacheFileIterator>(
+            FormRef(this), std::move(*reader)));
+      }
+      TFRT_LOG(WARNING) << "Failed to read the cache file, rewriting it: "
+                        << StrCat(reader.takeError());
+      file_state_ = FileState::kNotWritten;
+    }
+    // Another iterator is writing the cache file.
+    if (file_state_ == FileState::kWriting) {
+      return TakeRef(
+          host_->Construct<CacheDatasetIterator>(FormRef(this), nullptr));
+    }
+    file_state_ = FileState::kWriting;
+  }
+
+  auto writer = CacheFileWriter::Create(
+      filename_, host_,
+      [dataset = FormRef(this)](bool written) mutable {
+        dataset->FinishWriting(written);
+      });
+  if (!writer) {
+    TFRT_LOG(WARNING) << "Not caching the dataset: "
+                      << StrCat(writer.takeError());
+    FinishWriting(false);
+    return TakeRef(
+        host_->Construct<CacheDatasetIterator>(FormRef(this), nullptr));
+  }
+  return TakeRef(host_->Construct<CacheDatasetIterator>(FormRef(this),
+                                                        std::move(*writer)));
+}
+
+IterationResult CacheDataset::GetCachedElement(
+    size_t index, const ExecutionContext& exec_ctx) {
+  size_t first_new_index;
+  SmallVector<AsyncValueRef<bool>, 4> new_eofs;
+  llvm::Optional<IterationResult> result;
+  {
+    mutex_lock lock(mu_);
+    // All the elements after the end are the end.
+    if (end_index_.hasValue() && index > *end_index_) index = *end_index_;
+    if (!input_iterator_ && !end_index_.hasValue())
+      input_iterator_ = input_dataset_->MakeIterator();
+    first_new_index = elements_.size();
+    while (elements_.size() <= index) {
+      elements_.push_back(input_iterator_->GetNext(exec_ctx));
+      new_eofs.push_back(elements_.back().eof.CopyRef());
+    }
+    result.emplace(elements_[index].CopyRef());
+  }
+
+  // The callbacks can run synchronously, so they are added without the lock.
+  for (size_t i = 0; i < new_eofs.size(); ++i) {
+    auto& eof = new_eofs[i];
+    eof.AndThen([dataset = FormRef(this), index = first_new_index + i,
+                 eof = eof.CopyRef()] {
+      if (!eof.IsError() && eof.get()) dataset->SetEnd(index);
+    });
+  }
+  return std::move(*result);
+}
+
+void CacheDataset::SetEnd(size_t index) {
+  // The input iterator and the elements requested after the end are released
+  // without the lock.
+  RCReference<Iterator> input_iterator;
+  std::vector<IterationResult> elements_after_end;
+  {
+    mutex_lock lock(mu_);
+    if (end_index_.hasValue() && *end_index_ <= index) return;
+    end_index_ = index;
+    input_iterator = std::move(input_iterator_);
+    elements_after_end.assign(
+        std::make_move_iterator(elements_.begin() + index + 1),
+        std::make_move_iterator(elements_.end()));
+    elements_.erase(elements_.begin() + index + 1, elements_.end());
+  }
+}
+
+void CacheDataset::FinishWriting(bool written) {
+  mutex_lock lock(mu_);
+  file_state_ = written ? FileState::kWritten : FileState::kNotWritten;
+}
+
+//===----------------------------------------------------------------------===//
+// CacheDatasetIterator methods
+//===----------------------------------------------------------------------===//
+IterationResult CacheDatasetIterator::GetNext(
+    const ExecutionContext& exec_ctx) {
+  if (!input_iterator_)
+    return parent_dataset_->GetCachedElement(next_index_++, exec_ctx);
+
+  auto result = input_iterator_->GetNext(exec_ctx);
+  if (writer_) {
+    writer_->Add(result.CopyRef());
+    // The writer ignores the elements after the end.
+    if (result.eof.IsConcrete() && result.eof.get()) writer_.reset();
+  }
+  return result;
+}
+
+//===----------------------------------------------------------------------===//
+// CacheFileIterator methods
+//===----------------------------------------------------------------------===//
+IterationResult CacheFileIterator::GetNextElement(
+    const ExecutionContext& exec_ctx) {
+  HostContext* host = exec_ctx.host();
+  // Do not decode location or emit errors because the local handler might have
+  // been freed.
+  const size_t arity = reader_->arity();
+  if (reached_end_) return IterationResult::Eof(host, arity);
+
+  llvm::SmallVector<RCReference<AsyncValue>, 4> values;
+  auto has_element = reader_->ReadElement(host, &values);
+  if (!has_element) {
+    reached_end_ = true;
+    auto error = host->MakeErrorAsyncValueRef(StrCat(has_element.takeError()));
+    return IterationResult::Error(std::move(error), arity);
+  }
+  if (!*has_element) {
+    reached_end_ = true;
+    return IterationResult::Eof(host, arity);
+  }
+  return IterationResult::Values(std::move(values), host);
+}
+
+}  // namespace data
+}  // namespace tfrt
@@ -0,0 +1,184 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//===- cache_dataset.h ------------------------------------------*- C++ -*-===//
+//
+// This file declares CacheDataset class which caches the elements of its input
+// dataset in memory or in a file on the first pass over them.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef TFRT_LIB_DATA_CACHE_DATASET_H_
+#define TFRT_LIB_DATA_CACHE_DATASET_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "cache_file.h"
+#include "dataset.h"
+#include "io.h"
+#include "llvm/ADT/Optional.h"
+#include "tfrt/support/forward_decls.h"
+#include "tfrt/support/mutex.h"
+#include "tfrt/support/thread_annotations.h"
+
+namespace tfrt {
+namespace data {
+
+class CacheDatasetIterator;
+class CacheFileIterator;
+
+// CacheDataset caches the elements of its input dataset, so that the input is
+// only computed once for all the iterators of the dataset (e.g. all the epochs
+// of a RepeatDataset over it).
+//
+// If `filename` is empty, the elements are cached in memory as references to
+// their values. The iterators share a single input iterator and read the
+// elements at their own pace, so an iterator can read the elements that
+// another one has requested from the input while it is still running.
+//
+// Otherwise the elements are written to the cache file at `filename` by the
+// first iterator, which returns the input elements as they are written. The
+// later iterators read the memory-mapped cache file, or the input dataset if
+// the file is still being written. If the file already exists, the input
+// dataset is not used at all. See cache_file.h for the values that can be
+// cached in a file. If the input has an error or a value that can't be
+// cached, no cache file is written and the next iterator tries again.
+class CacheDataset : public Dataset {
+ public:
+  explicit CacheDataset(RCReference<Dataset> input_dataset,
+                        std::string filename, int32_t num_worker_threads,
+                        HostContext* host);
+
+  // This class is not copyable or movable.
+  CacheDataset(const CacheDataset&) = delete;
+  CacheDataset& operator=(const CacheDataset&) = delete;
+
+  RCReference<Iterator> MakeIterator() override;
+
+ private:
+  // Allow iterator to rely on private data members of this dataset.
+  friend class CacheDatasetIterator;
+  friend class CacheFileIterator;
+
+  enum class FileState { kNotWritten, kWriting, kWritten };
+
+  void Destroy() override {
+    internal::DestroyImpl<CacheDataset>(this, allocator_);
+  }
+
+  // Returns the element at `index` of the memory cache, requesting the
+  // elements up to `index` from the input if they are not cached yet.
+  IterationResult GetCachedElement(size_t index,
+                                   const ExecutionContext& exec_ctx)
+      TFRT_EXCLUDES(mu_);
+
+  // Records that the element at `index` of the memory cache is the end of the
+  // input.
+  void SetEnd(size_t index) TFRT_EXCLUDES(mu_);
+
+  // Called by the CacheFileWriter of the first file iterator.
+  void FinishWriting(bool written) TFRT_EXCLUDES(mu_);
+
+  RCReference<Dataset> input_dataset_;
+  const std::string filename_;
+  const int32_t num_worker_threads_;
+  HostContext* host_;
+  HostAllocator* allocator_;
+
+  mutex mu_;
+  // The state of the memory cache. The input_iterator_ is released once the
+  // end of the input is known.
+  RCReference<Iterator> input_iterator_ TFRT_GUARDED_BY(mu_);
+  // The elements requested from the input_iterator_, in order.
+  std::vector<IterationResult> elements_ TFRT_GUARDED_BY(mu_);
+  // The index of the first element whose eof is true, once it is known.
+  llvm::Optional<size_t> end_index_ TFRT_GUARDED_BY(mu_);
+  // The state of the cache file.
+  FileState file_state_ TFRT_GUARDED_BY(mu_) = FileState::kNotWritten;
+};
+
+// CacheDatasetIterator reads the memory cache of its dataset, or reads its
+// input dataset directly while the cache file is written or is being written.
+class CacheDatasetIterator : public Iterator {
+ public:
+  // Reads the memory cache.
+  explicit CacheDatasetIterator(RCReference<CacheDataset> parent_dataset)
+      : Iterator(), parent_dataset_(std::move(parent_dataset)) {}
+
+  // Reads the input dataset, and writes its elements with `writer` unless it
+  // is nullptr.
+  explicit CacheDatasetIterator(RCReference<CacheDataset> parent_dataset,
+                                std::shared_ptr<CacheFileWriter> writer)
+      : Iterator(),
+        parent_dataset_(std::move(parent_dataset)),
+        input_iterator_(parent_dataset_->input_dataset_->MakeIterator()),
+        writer_(std::move(writer)) {}
+
+  // This class is not copyable or movable.
+  CacheDatasetIterator(const CacheDatasetIterator&) = delete;
+  CacheDatasetIterator& operator=(const CacheDatasetIterator&) = delete;
+
+  IterationResult GetNext(const ExecutionContext& exec_ctx) override;
+
+ private:
+  void Destroy() override {
+    internal::DestroyImpl<CacheDatasetIterator>(this,
+                                                parent_dataset_->allocator_);
+  }
+
+  RCReference<CacheDataset> parent_dataset_;
+  // The index of the next element of the memory cache.
+  size_t next_index_ = 0;
+  // The input iterator, if the memory cache is not used.
+  RCReference<Iterator> input_iterator_;
+  std::shared_ptr<CacheFileWriter> writer_;
+};
+
+// CacheFileIterator reads the elements of a cache file, prefetching them on
+// blocking threads.
+class CacheFileIterator : public io::PrefetchingIterator {
+ public:
+  explicit CacheFileIterator(RCReference<CacheDataset> parent_dataset,
+                             std::unique_ptr<CacheFileReader> reader)
+      : io::PrefetchingIterator(parent_dataset->num_worker_threads_,
+                                reader->arity()),
+        parent_dataset_(std::move(parent_dataset)),
+        reader_(std::move(reader)) {}
+
+  // This class is not copyable or movable.
+  CacheFileIterator(const CacheFileIterator&) = delete;
+  CacheFileIterator& operator=(const CacheFileIterator&) = delete;
+
+ protected:
+  IterationResult GetNextElement(const ExecutionContext& exec_ctx) final;
+
+ private:
+  void Destroy() override {
+    internal::DestroyImpl<CacheFileIterator>(this, parent_dataset_->allocator_);
+  }
+
+  RCReference<CacheDataset> parent_dataset_;
+  std::unique_ptr<CacheFileReader> reader_;
+  // True after the end of the file or an error.
+  bool reached_end_ = false;
+};
+
+}  // namespace data
+}  // namespace tfrt
+
+#endif  // TFRT_LIB_DATA_CACHE_DATASET_H_
@@ -0,0 +1,377 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+//===- cache_file.cc ------------------------------------------------------===//
+//
+// This file implements CacheFileWriter and CacheFileReader, which write the
+// elements of a dataset to a cache file and read them back.
+//
+//===----------------------------------------------------------------------===//
+
+#include "cache_file.h"
+
+#include <cstring>
+
+#include "llvm/Support/EndianStream.h"
+#include "llvm/Support/FileSystem.h"
+#include "tfrt/host_context/host_buffer.h"
+#include "tfrt/host_context/host_context.h"
+#include "tfrt/support/error_util.h"
+#include "tfrt/support/logging.h"
+#include "tfrt/support/raw_coding.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+
+namespace tfrt {
+namespace data {
+
+// The size of the header and of the fields before the data of a value.
+constexpr size_t kHeaderSize = 16;
+constexpr size_t kValueAlignment = 8;
+
+// The dtypes of the DenseHostTensors that can be cached. String is the last
+// kind, and its tensors are not DenseHostTensors.
+static bool IsSupportedDType(DType dtype) {
+  return dtype.kind() > DType::Unsupported && dtype.kind() < DType::String;
+}
+
+static size_t PaddingSize(size_t pos, size_t alignment) {
+  return (alignment - pos % alignment) % alignment;
+}
+
+//===----------------------------------------------------------------------===//
+// CacheFileWriter methods
+//===----------------------------------------------------------------------===//
+llvm::Expected<std::shared_ptr<CacheFileWriter>> CacheFileWriter::Create(
+    string_view path, HostContext* host,
+    llvm::unique_function<void(bool)> done) {
+  int fd;
+  llvm::SmallString<128> temp_path;
+  std::error_code ec = llvm::sys::fs::createUniqueFile(
+      path + ".tmp-%%%%%%%%", fd, temp_path);
+  if (ec) {
+    return MakeStringError("failed to create a cache file next to ", path,
+                           ": ", ec.message());
+  }
+  auto os = std::make_unique<llvm::raw_fd_ostream>(fd, /*shouldClose=*/true);
+  return std::shared_ptr<CacheFileWriter>(
+      new CacheFileWriter(path.str(), temp_path.str().str(), std::move(os),
+                          host, std::move(done)));
+}
+
+CacheFileWriter::CacheFileWriter(std::string path, std::string temp_path,
+                                 std::unique_ptr<llvm::raw_fd_ostream> os,
+                                 HostContext* host,
+                                 llvm::unique_function<void(bool)> done)
+    : path_(std::move(path)),
+      temp_path_(std::move(temp_path)),
+      host_(host),
+      done_(std::move(done)),
+      os_(std::move(os)) {}
+
+CacheFileWriter::~CacheFileWriter() {
+  Fail("the iterator was destroyed before the end");
+}
+
+void CacheFileWriter::Add(IterationResult element) {
+  {
+    mutex_lock lock(mu_);
+    queue_.push(std::move(element));
+    if (writing_) return;
+    writing_ = true;
+  }
+  // The elements are written by a single blocking task at a time, which takes
+  // a reference to this writer until the queue is empty.
+  bool enqueued = host_->EnqueueBlockingWork(
+      [writer = shared_from_this()] { writer->WriteElements(); });
+  if (!enqueued) {
+    {
+      mutex_lock lock(mu_);
+      queue_ = {};
+      writing_ = false;
+    }
+    Fail("the blocking work queue is full");
+  }
+}
+
+void CacheFileWriter::WriteElements() {
+  while (true) {
+    llvm::Optional<IterationResult> element;
+    {
+      mutex_lock lock(mu_);
+      if (queue_.empty()) {
+        writing_ = false;
+        return;
+      }
+      element.emplace(std::move(queue_.front()));
+      queue_.pop();
+    }
+    if (stopped_) continue;
+
+    SmallVector<RCReference<AsyncValue>, 4> values;
+    for (auto& value : element->values) values.push_back(value.CopyRef());
+    values.push_back(element->eof.CopyRCRef());
+    host_->Await(values);
+
+    if (element->eof.IsError()) {
+      Fail(element->eof.GetError().message);
+    } else if (element->eof.get()) {
+      Finish(element->values.size());
+    } else {
+      WriteHeader(element->values.size());
+      for (auto& value : element->values) {
+        if (auto error = WriteValue(*value)) {
+          Fail(StrCat(error));
+          break;
+        }
+      }
+    }
+  }
+}
+
+void CacheFileWriter::WriteHeader(size_t arity) {
+  if (header_written_) return;
+  header_written_ = true;
+  os_->write(kCacheFileMagic, sizeof(kCacheFileMagic));
+  llvm::support::endian::write<uint32_t>(*os_, arity, llvm::support::little);
+  llvm::support::endian::write<uint32_t>(*os_, 0, llvm::support::little);
+}
+
+llvm::Error CacheFileWriter::WriteValue(const AsyncValue& value) {
+  using llvm::support::little;
+  namespace endian = ::llvm::support::endian;
+
+  if (value.IsError()) return MakeStringError(value.GetError().message);
+
+  auto write_bytes = [this](CacheValueType type, const void* data,
+                            size_t size) {
+    endian::write<uint32_t>(*os_, static_cast<uint32_t>(type), little);
+    endian::write<uint32_t>(*os_, 0, little);
+    endian::write<uint64_t>(*os_, size, little);
+    os_->write(static_cast<const char*>(data), size);
+  };
+  auto write_scalar = [this](CacheValueType type, const auto& scalar) {
+    endian::write<uint32_t>(*os_, static_cast<uint32_t>(type), little);
+    endian::write<uint32_t>(*os_, 0, little);
+    endian::write(*os_, scalar, little);
+  };
+
+  if (value.IsType<std::string>()) {
+    const auto& str = value.get<std::string>();
+    write_bytes(CacheValueType::kString, str.data(), str.size());
+  } else if (value.IsType<RCReference<HostBuffer>>()) {
+    const auto& buffer = value.get<RCReference<HostBuffer>>();
+    write_bytes(CacheValueType::kHostBuffer, buffer->data(), buffer->size());
+  } else if (value.IsType<DenseHostTensor>()) {
+    const auto& tensor = value.get<DenseHostTensor>();
+    if (!IsSupportedDType(tensor.dtype())) {
+      return MakeStringError("tensors of dtype ", tensor.dtype(),
+                             " can't be cached to a file");
+    }
+    SmallVector<ssize_t, 4> dims;
+    tensor.shape().GetDimensions(&dims);
+    endian::write<uint32_t>(
+        *os_, static_cast<uint32_t>(CacheValueType::kDenseHostTensor), little);
+    endian::write<uint32_t>(*os_, tensor.dtype().kind(), little);
+    endian::write<uint64_t>(*os_, dims.size(), little);
+    for (ssize_t dim : dims) endian::write<int64_t>(*os_, dim, little);
+    endian::write<uint64_t>(*os_, tensor.DataSizeInBytes(), little);
+    WritePadding(kCacheFileTensorAlignment);
+    os_->write(static_cast<const char*>(tensor.data()),
+               tensor.DataSizeInBytes());
+  } else if (value.IsType<int32_t>()) {
+    write_scalar(CacheValueType::kInt32, value.get<int32_t>());
+  } else if (value.IsType<int64_t>()) {
+    write_scalar(CacheValueType::kInt64, value.get<int64_t>());
+  } else if (value.IsType<float>()) {
+    write_scalar(CacheValueType::kFloat, value.get<float>());
+  } else if (value.IsType<double>()) {
+    write_scalar(CacheValueType::kDouble, value.get<double>());
+  } else {
+    return MakeStringError("values of this type can't be cached to a file");
+  }
+  WritePadding(kValueAlignment);
+  return llvm::Error::success();
+}
+
+void CacheFileWriter::WritePadding(size_t alignment) {
+  static constexpr char kZeros[kCacheFileTensorAlignment] = {};
+  os_->write(kZeros, PaddingSize(os_->tell(), alignment));
+}
+
+void CacheFileWriter::Finish(size_t arity) {
+  // The header is not written yet if the dataset is empty.
+  WriteHeader(arity);
+  os_->close();
+  if (os_->has_error()) {
+    std::string message = os_->error().message();
+    os_->clear_error();
+    return Fail(message);
+  }
+  if (std::error_code ec = llvm::sys::fs::rename(temp_path_, path_))
+    return Fail(ec.message());
+
+  stopped_ = true;
+  done_(true);
+}
+
+void CacheFileWriter::Fail(string_view reason) {
+  if (stopped_) return;
+  TFRT_LOG(WARNING) << "Not caching the dataset to " << path_ << ": "
+                    << reason;
+  if (os_) {
+    os_->close();
+    os_->clear_error();
+  }
+  llvm::sys::fs::remove(temp_path_);
+  stopped_ = true;
+  done_(false);
+}
+
+//===----------------------------------------------------------------------===//
+// CacheFileReader methods
+//===----------------------------------------------------------------------===//
+llvm::Expected<std::unique_ptr<CacheFileReader>> CacheFileReader::Open(
+    string_view path) {
+  auto stream = MappedFileInputStream::Open(path);
+  if (!stream) return stream.takeError();
+
+  ArrayRef<char> header = (*stream)->ReadInPlace(kHeaderSize);
+  if (header.size() != kHeaderSize ||
+      std::memcmp(header.data(), kCacheFileMagic, sizeof(kCacheFileMagic))) {
+    return MakeStringError("not a cache file: ", path);
+  }
+  size_t arity = DecodeFixed32(header.data() + sizeof(kCacheFileMagic));
+  return std::unique_ptr<CacheFileReader>(
+      new CacheFileReader(std::move(*stream), arity));
+}
+
+llvm::Expected<bool> CacheFileReader::ReadElement(
+    HostContext* host, SmallVectorImpl<RCReference<AsyncValue>>* values) {
+  if (*stream_->Tell() == stream_->buffer()->size()) return false;
+  for (size_t i = 0; i < arity_; ++i) {
+    auto value = ReadValue(host);
+    if (!value) return value.takeError();
+    values->push_back(std::move(*value));
+  }
+  return true;
+}
+
+llvm::Expected<RCReference<AsyncValue>> CacheFileReader::ReadValue(
+    HostContext* host) {
+  auto fields = ReadBytes(8);
+  if (!fields) return fields.takeError();
+  auto type = static_cast<CacheValueType>(DecodeFixed32(fields->data()));
+
+  RCReference<AsyncValue> value;
+  switch (type) {
+    case CacheValueType::kString:
+    case CacheValueType::kHostBuffer: {
+      auto size = ReadBytes(8);
+      if (!size) return size.takeError();
+      size_t offset = *stream_->Tell();
+      auto bytes = ReadBytes(DecodeFixed64(size->data()));
+      if (!bytes) return bytes.takeError();
+      if (type == CacheValueType::kString) {
+        value = host->MakeAvailableAsyncValueRef<std::string>(bytes->begin(),
+                                                              bytes->end())
+                    .ReleaseRCRef();
+      } else {
+        value = host->MakeAvailableAsyncValueRef<RCReference<HostBuffer>>(
+                        HostBuffer::CreateFromExternal(
+                            stream_->buffer().CopyRef(), offset, bytes->size()))
+                    .ReleaseRCRef();
+      }
+      break;
+    }
+    case CacheValueType::kDenseHostTensor: {
+      DType dtype(static_cast<DType::Kind>(DecodeFixed32(fields->data() + 4)));
+      auto rank = ReadBytes(8);
+      if (!rank) return rank.takeError();
+      auto dims_bytes = ReadBytes(DecodeFixed64(rank->data()) * 8);
+      if (!dims_bytes) return dims_bytes.takeError();
+      SmallVector<ssize_t, 4> dims;
+      for (size_t i = 0; i < dims_bytes->size(); i += 8) {
+        dims.push_back(
+            static_cast<int64_t>(DecodeFixed64(dims_bytes->data() + i)));
+        if (dims.back() < 0) return MakeStringError("invalid cache file");
+      }
+      auto size = ReadBytes(8);
+      if (!size) return size.takeError();
+      if (auto error = SkipPadding(kCacheFileTensorAlignment))
+        return std::move(error);
+      size_t offset = *stream_->Tell();
+      auto data = ReadBytes(DecodeFixed64(size->data()));
+      if (!data) return data.takeError();
+
+      TensorMetadata metadata(dtype, dims);
+      if (!IsSupportedDType(dtype) ||
+          metadata.GetHostSizeInBytes() != data->size()) {
+        return MakeStringError("invalid cache file");
+      }
+      value = host->MakeAvailableAsyncValueRef<DenseHostTensor>(
+                      metadata, HostBuffer::CreateFromExternal(
+                                    stream_->buffer().CopyRef(), offset,
+                                    data->size()))
+                  .ReleaseRCRef();
+      break;
+    }
+    case CacheValueType::kInt32:
+    case CacheValueType::kInt64:
+    case CacheValueType::kFloat:
+    case CacheValueType::kDouble: {
+      auto bytes = ReadBytes(8);
+      if (!bytes) return bytes.takeError();
+      // The scalars are little-endian, so the narrower ones are in the low
+      // bytes.
+      uint64_t raw = DecodeFixed64(bytes->data());
+      if (type == CacheValueType::kInt32) {
+        value = host->MakeAvailableAsyncValueRef<int32_t>(raw).ReleaseRCRef();
+      } else if (type == CacheValueType::kInt64) {
+        value = host->MakeAvailableAsyncValueRef<int64_t>(raw).ReleaseRCRef();
+      } else if (type == CacheValueType::kFloat) {
+        uint32_t raw32 = raw;
+        float scalar;
+        std::memcpy(&scalar, &raw32, sizeof(scalar));
+        value = host->MakeAvailableAsyncValueRef<float>(scalar).ReleaseRCRef();
+      } else {
+        double scalar;
+        std::memcpy(&scalar, &raw, sizeof(scalar));
+        value =
+            host->MakeAvailableAsyncValueRef<double>(scalar).ReleaseRCRef();
+      }
+      break;
+    }
+    default:
+      return MakeStringError("invalid value type ",
+                             static_cast<uint32_t>(type), " in cache file");
+  }
+  if (auto error = SkipPadding(kValueAlignment)) return std::move(error);
+  return std::move(value);
+}
+
+llvm::Expected<ArrayRef<char>> CacheFileReader::ReadBytes(size_t count) {
+  ArrayRef<char> bytes = stream_->ReadInPlace(count);
+  if (bytes.size() != count) return MakeStringError("truncated cache file");
+  return bytes;
+}
+
+llvm::Error CacheFileReader::SkipPadding(size_t alignment) {
+  size_t pos = *stream_->Tell();
+  auto padding = ReadBytes(PaddingSize(pos, alignment));
+  if (!padding) return padding.takeError();
+  return llvm::Error::success();
+}
+
+}  // namespace data
+}  // namespace tfrt
@@ -0,0 +1,168 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//===- cache_file.h ---------------------------------------------*- C++ -*-===//
+//
+// This file declares CacheFileWriter and CacheFileReader, which write the
+// elements of a dataset to a cache file and read them back.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef TFRT_LIB_DATA_CACHE_FILE_H_
+#define TFRT_LIB_DATA_CACHE_FILE_H_
+
+#include <memory>
+#include <queue>
+#include <string>
+
+#include "dataset.h"
+#include "llvm/Support/raw_ostream.h"
+#include "tfrt/io/mapped_file_input_stream.h"
+#include "tfrt/support/forward_decls.h"
+#include "tfrt/support/mutex.h"
+#include "tfrt/support/thread_annotations.h"
+
+namespace tfrt {
+namespace data {
+
+using ::tfrt::io::MappedFileInputStream;
+
+// A cache file holds the elements of a dataset in order. All the integers are
+// little-endian.
+//
+//   header:  the 8 bytes of kCacheFileMagic, uint32 arity, uint32 zero.
+//   element: `arity` values, each a uint32 type tag followed by:
+//     kString, kHostBuffer: uint32 zero, uint64 size, `size` bytes.
+//     kDenseHostTensor: uint32 dtype kind, uint64 rank, int64 dims[rank],
+//       uint64 size, padding to kCacheFileTensorAlignment, `size` bytes.
+//     kInt32, kInt64, kFloat, kDouble: uint32 zero, the value.
+//   Each value is padded to a multiple of 8 bytes.
+//
+// The tensor bytes are aligned in the file, so that the tensors read from a
+// memory-mapped file can refer to the mapping instead of being copied.
+constexpr char kCacheFileMagic[8] = {'T', 'F', 'R', 'T', 'C', 'A', 'C', '1'};
+constexpr size_t kCacheFileTensorAlignment = 64;
+
+enum class CacheValueType : uint32_t {
+  kString = 1,
+  kHostBuffer = 2,
+  kDenseHostTensor = 3,
+  kInt32 = 4,
+  kInt64 = 5,
+  kFloat = 6,
+  kDouble = 7,
+};
+
+// CacheFileWriter writes the elements of a dataset to a temporary file in
+// blocking tasks, as their values become available, and renames it to the
+// cache file after the end of the dataset is written. The cache file is
+// therefore either complete or absent.
+//
+// Writing stops if an element has an error or a value of a type that can't be
+// written to a cache file, or if the writer is destroyed before the end of the
+// dataset is added.
+class CacheFileWriter : public std::enable_shared_from_this<CacheFileWriter> {
+ public:
+  // `done` is called once, with true after the cache file is renamed, or with
+  // false if writing stopped.
+  static llvm::Expected<std::shared_ptr<CacheFileWriter>> Create(
+      string_view path, HostContext* host,
+      llvm::unique_function<void(bool)> done);
+
+  // Removes the temporary file if the end of the dataset was not written.
+  ~CacheFileWriter();
+
+  // This class is not copyable or movable.
+  CacheFileWriter(const CacheFileWriter&) = delete;
+  CacheFileWriter& operator=(const CacheFileWriter&) = delete;
+
+  // Adds the next element of the dataset. Elements added after the end of the
+  // dataset are ignored.
+  void Add(IterationResult element) TFRT_EXCLUDES(mu_);
+
+ private:
+  CacheFileWriter(std::string path, std::string temp_path,
+                  std::unique_ptr<llvm::raw_fd_ostream> os, HostContext* host,
+                  llvm::unique_function<void(bool)> done);
+
+  // Writes the queued elements, waiting for their values. Runs in a blocking
+  // task.
+  void WriteElements() TFRT_EXCLUDES(mu_);
+
+  void WriteHeader(size_t arity);
+  llvm::Error WriteValue(const AsyncValue& value);
+  void WritePadding(size_t alignment);
+
+  // Renames the temporary file to the cache file.
+  void Finish(size_t arity);
+  // Stops writing and removes the temporary file.
+  void Fail(string_view reason);
+
+  const std::string path_;
+  const std::string temp_path_;
+  HostContext* host_;
+  llvm::unique_function<void(bool)> done_;
+
+  // The state below is only accessed by the blocking task of WriteElements(),
+  // or while no such task runs.
+  std::unique_ptr<llvm::raw_fd_ostream> os_;
+  bool header_written_ = false;
+  bool stopped_ = false;
+
+  mutex mu_;
+  // The elements added and not written yet.
+  std::queue<IterationResult> queue_ TFRT_GUARDED_BY(mu_);
+  // True if a blocking task is writing the queue_.
+  bool writing_ TFRT_GUARDED_BY(mu_) = false;
+};
+
+// CacheFileReader reads the elements of a cache file from its memory mapping.
+// Strings are copied out of the mapping, while HostBuffers and the data of
+// DenseHostTensors are slices of the mapping.
+class CacheFileReader {
+ public:
+  // Maps the cache file at `path` and reads its header.
+  static llvm::Expected<std::unique_ptr<CacheFileReader>> Open(
+      string_view path);
+
+  // The number of values of each element.
+  size_t arity() const { return arity_; }
+
+  // Reads the next element into `values`. Returns false at the end of the
+  // file.
+  llvm::Expected<bool> ReadElement(
+      HostContext* host, SmallVectorImpl<RCReference<AsyncValue>>* values);
+
+ private:
+  CacheFileReader(std::unique_ptr<MappedFileInputStream> stream,
+                  size_t arity)
+      : stream_(std::move(stream)), arity_(arity) {}
+
+  llvm::Expected<RCReference<AsyncValue>> ReadValue(HostContext* host);
+
+  // Returns the next `count` bytes, or an error if the file is truncated.
+  llvm::Expected<ArrayRef<char>> ReadBytes(size_t count);
+  // Skips the padding to the next multiple of `alignment`.
+  llvm::Error SkipPadding(size_t alignment);
+
+  std::unique_ptr<MappedFileInputStream> stream_;
+  const size_t arity_;
+};
+
+}  // namespace data
+}  // namespace tfrt
+
+#endif  // TFRT_LIB_DATA_CACHE_FILE_H_
@@ -18,18 +18,27 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
+#include <random>
+
 #include "batch_dataset.h"
+#include "cache_dataset.h"
 #include "filter_dataset.h"
 #include "interleave_dataset.h"
+#include "map_and_batch_dataset.h"
 #include "map_dataset.h"
 #include "memory_dataset.h"
+#include "padded_batch_dataset.h"
 #include "prefetch_dataset.h"
 #include "range_dataset.h"
 #include "repeat_dataset.h"
+#include "sharded_tf_record_dataset.h"
+#include "shuffle_dataset.h"
 #include "slice_dataset.h"
 #include "tf_record_dataset.h"
 #include "tfrt/host_context/function.h"
 #include "tfrt/host_context/kernel_utils.h"
+#include "tfrt/host_context/resource_context.h"
 #include "tfrt/support/error_util.h"
 #include "tfrt/support/rc_array.h"
 #include "tfrt/support/ref_count.h"
@@ -103,6 +112,46 @@ RCReference<MapDataset> MakeMapDataset(RCReference<Dataset>* dataset,
       FormRef(&fn.get()), exec_ctx.host()));
 }
 
+// Like MakeMapDataset, with at most `num_parallel_calls` calls in flight. If
+// `num_parallel_calls` is -1, it defaults to the number of worker threads.
+llvm::Expected<RCReference<MapDataset>> MakeParallelMapDataset(
+    RCReference<Dataset>* dataset, int64_t num_parallel_calls,
+    RemainingArguments args, Attribute<bool> deterministic,
+    Attribute<Function> fn, const ExecutionContext& exec_ctx) {
+  HostContext* host = exec_ctx.host();
+  if (num_parallel_calls == -1)
+    num_parallel_calls = host->GetNumWorkerThreads();
+  if (num_parallel_calls <= 0)
+    return MakeStringError("num_parallel_calls must be positive or -1");
+  return TakeRef(host->Construct<MapDataset>(
+      dataset->CopyRef(), RCArray<AsyncValue>(args.values()),
+      FormRef(&fn.get()), host, num_parallel_calls, deterministic.get()));
+}
+
+//===----------------------------------------------------------------------===//
+// MapAndBatchDataset
+//===----------------------------------------------------------------------===//
+
+// Create a dataset that writes the results of `fn` directly into the rows of
+// batches of `batch_size` tensors with the `element_type` and `element_shape`.
+llvm::Expected<RCReference<MapAndBatchDataset>> MakeMapAndBatchDataset(
+    RCReference<Dataset>* dataset, int64_t batch_size, RemainingArguments args,
+    ArrayAttribute<int64_t> element_shape, Attribute<uint8_t> element_type,
+    Attribute<Function> fn, const ExecutionContext& exec_ctx) {
+  if (batch_size <= 0) return MakeStringError("batch_size must be positive");
+  if (fn->result_types().size() != 1)
+    return MakeStringError("function must return a single chain, but has ",
+                           fn->result_types().size(), " results");
+  auto dtype = ConvertBEFDataTypeToTensorDType(
+      static_cast<BEFDataType>(element_type.get()));
+  SmallVector<ssize_t, 4> dims(element_shape.data().begin(),
+                               element_shape.data().end());
+  return TakeRef(exec_ctx.host()->Construct<MapAndBatchDataset>(
+      dataset->CopyRef(), batch_size, TensorMetadata(dtype, dims),
+      RCArray<AsyncValue>(args.values()), FormRef(&fn.get()),
+      exec_ctx.host()));
+}
+
 //===----------------------------------------------------------------------===//
 // FilterDataset
 //===----------------------------------------------------------------------===//
@@ -146,6 +195,35 @@ RCReference<TFRecordDataset> MakeTFRecordDataset(
       std::move(path), buffer_size, num_worker_threads, exec_ctx.host()));
 }
 
+RCReference<TFRecordDataset> MakeMappedTFRecordDataset(
+    std::string path, const ExecutionContext& exec_ctx) {
+  auto num_worker_threads = exec_ctx.host()->GetNumWorkerThreads();
+  return TakeRef(exec_ctx.host()->Construct<TFRecordDataset>(
+      std::move(path), /*buffer_size=*/0, num_worker_threads, exec_ctx.host(),
+      /*memory_mapped=*/true));
+}
+
+//===----------------------------------------------------------------------===//
+// ShardedTFRecordDataset
+//===----------------------------------------------------------------------===//
+
+llvm::Expected<RCReference<ShardedTFRecordDataset>> MakeShardedTFRecordDataset(
+    std::string patterns, int64_t num_shards, int64_t shard_index,
+    int64_t num_parallel_reads, Attribute<bool> deterministic,
+    const ExecutionContext& exec_ctx) {
+  if (num_parallel_reads <= 0)
+    return MakeStringError("num_parallel_reads must be positive");
+  auto paths = GetShardFiles(patterns, num_shards, shard_index);
+  if (!paths) return paths.takeError();
+
+  auto num_worker_threads = exec_ctx.host()->GetNumWorkerThreads();
+  // Default buffer size to 256 KB.
+  int64_t buffer_size = 256 * 1024;
+  return TakeRef(exec_ctx.host()->Construct<ShardedTFRecordDataset>(
+      std::move(*paths), num_parallel_reads, deterministic.get(), buffer_size,
+      num_worker_threads, exec_ctx.host()));
+}
+
 //===----------------------------------------------------------------------===//
 // RepeatDataset
 //===----------------------------------------------------------------------===//
@@ -158,6 +236,42 @@ RCReference<RepeatDataset> MakeRepeatDataset(RCReference<Dataset>* dataset,
       host->Construct<RepeatDataset>(dataset->CopyRef(), count, host));
 }
 
+//===----------------------------------------------------------------------===//
+// ShuffleDataset
+//===----------------------------------------------------------------------===//
+
+llvm::Expected<RCReference<ShuffleDataset>> MakeShuffleDataset(
+    RCReference<Dataset>* dataset, int64_t buffer_size, int64_t seed,
+    Attribute<bool> reshuffle_each_iteration,
+    const ExecutionContext& exec_ctx) {
+  if (buffer_size <= 0) return MakeStringError("buffer_size must be positive");
+  // A seed of -1 makes the order different for each run.
+  uint64_t shuffle_seed = seed;
+  if (seed == -1) {
+    std::random_device random_device;
+    shuffle_seed =
+        (static_cast<uint64_t>(random_device()) << 32) | random_device();
+  }
+  HostContext* host = exec_ctx.host();
+  return TakeRef(host->Construct<ShuffleDataset>(
+      dataset->CopyRef(), buffer_size, shuffle_seed,
+      reshuffle_each_iteration.get(), host));
+}
+
+//===----------------------------------------------------------------------===//
+// CacheDataset
+//===----------------------------------------------------------------------===//
+
+// An empty filename caches the elements in memory.
+RCReference<CacheDataset> MakeCacheDataset(RCReference<Dataset>* dataset,
+                                           std::string filename,
+                                           const ExecutionContext& exec_ctx) {
+  HostContext* host = exec_ctx.host();
+  return TakeRef(host->Construct<CacheDataset>(
+      dataset->CopyRef(), std::move(filename), host->GetNumWorkerThreads(),
+      host));
+}
+
 //===----------------------------------------------------------------------===//
 // MemoryDataset
 //===----------------------------------------------------------------------===//
@@ -183,6 +297,38 @@ RCReference<BatchDataset<T...>> MakeBatchDataset(
       dataset->CopyRef(), batch_size, same_input_metadata.get(), host));
 }
 
+//===----------------------------------------------------------------------===//
+// PaddedBatchDataset
+//===----------------------------------------------------------------------===//
+
+llvm::Expected<RCReference<PaddedBatchDataset>> MakePaddedBatchDataset(
+    RCReference<Dataset>* dataset, int64_t batch_size,
+    const ExecutionContext& exec_ctx) {
+  HostContext* host = exec_ctx.host();
+  if (batch_size <= 0) return MakeStringError("batch_size must be positive");
+  return TakeRef(host->Construct<PaddedBatchDataset>(
+      dataset->CopyRef(), batch_size, std::vector<int64_t>(), host));
+}
+
+// Like MakePaddedBatchDataset, with the elements grouped into buckets by their
+// length before they are batched.
+llvm::Expected<RCReference<PaddedBatchDataset>> MakeBucketedPaddedBatchDataset(
+    RCReference<Dataset>* dataset, int64_t batch_size,
+    ArrayAttribute<int64_t> bucket_boundaries,
+    const ExecutionContext& exec_ctx) {
+  HostContext* host = exec_ctx.host();
+  if (batch_size <= 0) return MakeStringError("batch_size must be positive");
+  if (!std::is_sorted(bucket_boundaries.data().begin(),
+                      bucket_boundaries.data().end())) {
+    return MakeStringError("bucket_boundaries must be sorted");
+  }
+  return TakeRef(host->Construct<PaddedBatchDataset>(
+      dataset->CopyRef(), batch_size,
+      std::vector<int64_t>(bucket_boundaries.data().begin(),
+                           bucket_boundaries.data().end()),
+      host));
+}
+
 //===----------------------------------------------------------------------===//
 // PrefetchDataset
 //===----------------------------------------------------------------------===//
@@ -191,13 +337,40 @@ RCReference<PrefetchDataset> MakePrefetchDataset(
     RCReference<Dataset>* dataset, int64_t prefetch_num,
     const ExecutionContext& exec_ctx) {
   HostContext* host = exec_ctx.host();
-  if (prefetch_num == -1) {
-    prefetch_num = host->GetNumWorkerThreads();
-  }
+  // A prefetch_num of -1 (kAutoPrefetchNum) lets PrefetchDataset adapt the
+  // number of prefetched elements.
   return TakeRef(
       host->Construct<PrefetchDataset>(dataset->CopyRef(), prefetch_num, host));
 }
 
+// Prefetches an adaptive number of elements, whose bytes are bounded by
+// `max_bytes`. If `shared_budget` is not empty, the budget is shared by all the
+// budgeted prefetch datasets of the request with the same `shared_budget`.
+llvm::Expected<RCReference<PrefetchDataset>> MakeBudgetedPrefetchDataset(
+    RCReference<Dataset>* dataset, int64_t max_bytes,
+    StringAttribute shared_budget, const ExecutionContext& exec_ctx) {
+  if (max_bytes <= 0) return MakeStringError("max_bytes must be positive");
+  HostContext* host = exec_ctx.host();
+  if (shared_budget.get().empty()) {
+    return TakeRef(host->Construct<PrefetchDataset>(
+        dataset->CopyRef(), PrefetchDataset::kAutoPrefetchNum, host,
+        max_bytes));
+  }
+
+  auto* budget =
+      exec_ctx.resource_context()
+          ->GetOrCreateResource<RCReference<PrefetchBudget>>(
+              StrCat("tfrt.data.prefetch_budget.", shared_budget.get()),
+              TakeRef(new PrefetchBudget(max_bytes)));
+  if ((*budget)->max_bytes() != max_bytes) {
+    return MakeStringError("prefetch budget ", shared_budget.get(), " has ",
+                           (*budget)->max_bytes(), " bytes, not ", max_bytes);
+  }
+  return TakeRef(host->Construct<PrefetchDataset>(
+      dataset->CopyRef(), PrefetchDataset::kAutoPrefetchNum, host,
+      /*max_bytes=*/0, budget->CopyRef()));
+}
+
 //===----------------------------------------------------------------------===//
 // Generic input pipeline kernels
 //===----------------------------------------------------------------------===//
@@ -457,6 +630,11 @@ void RegisterDataKernels(KernelRegistry* registry) {
   registry->AddKernel("data.batch_dataset.i64_and_i64",
                       TFRT_KERNEL(MakeBatchDataset<int64_t, int64_t>));
 
+  registry->AddKernel("data.padded_batch_dataset",
+                      TFRT_KERNEL(MakePaddedBatchDataset));
+  registry->AddKernel("data.padded_batch_dataset.bucketed",
+                      TFRT_KERNEL(MakeBucketedPaddedBatchDataset));
+
   registry->AddKernel("data.memory_dataset.i64",
                       TFRT_KERNEL(MakeMemoryDataset<int64_t>));
   registry->AddKernel("data.memory_dataset.str",
@@ -466,11 +644,23 @@ void RegisterDataKernels(KernelRegistry* registry) {
   registry->AddKernel("data.interleave_dataset",
                       TFRT_KERNEL(MakeInterleaveDataset));
   registry->AddKernel("data.map_dataset", TFRT_KERNEL(MakeMapDataset));
+  registry->AddKernel("data.map_dataset.parallel",
+                      TFRT_KERNEL(MakeParallelMapDataset));
+  registry->AddKernel("data.map_and_batch_dataset",
+                      TFRT_KERNEL(MakeMapAndBatchDataset));
   registry->AddKernel("data.prefetch_dataset",
                       TFRT_KERNEL(MakePrefetchDataset));
+  registry->AddKernel("data.prefetch_dataset.budgeted",
+                      TFRT_KERNEL(MakeBudgetedPrefetchDataset));
   registry->AddKernel("data.repeat_dataset", TFRT_KERNEL(MakeRepeatDataset));
+  registry->AddKernel("data.shuffle_dataset", TFRT_KERNEL(MakeShuffleDataset));
+  registry->AddKernel("data.cache_dataset", TFRT_KERNEL(MakeCacheDataset));
   registry->AddKernel("data.tf_record_dataset",
                       TFRT_KERNEL(MakeTFRecordDataset));
+  registry->AddKernel("data.tf_record_dataset.host_buffer",
+                      TFRT_KERNEL(MakeMappedTFRecordDataset));
+  registry->AddKernel("data.sharded_tf_record_dataset",
+                      TFRT_KERNEL(MakeShardedTFRecordDataset));
 }
 
 }  // namespace data
@@ -23,23 +23,27 @@
 
 #include "io.h"
 
+#include <chrono>
+
 namespace tfrt {
 namespace data {
 namespace io {
 
 IterationResult PrefetchingIterator::GetNext(const ExecutionContext& exec_ctx) {
   auto* host = exec_ctx.host();
-  llvm::SmallVector<RCReference<AsyncValue>, 1> result_values;
-  result_values.resize(1);
-  // The IndirectAsyncValue might be filled later by the background blocking
+  llvm::SmallVector<RCReference<AsyncValue>, 4> result_values;
+  result_values.resize(arity_);
+  // The IndirectAsyncValues might be filled later by the background blocking
   // thread.
-  result_values[0] = host->MakeIndirectAsyncValue();
+  for (auto& value : result_values) value = host->MakeIndirectAsyncValue();
   auto result_eof = host->MakeUnconstructedAsyncValueRef<bool>();
   auto result =
       IterationResult::Pending(std::move(result_values), std::move(result_eof));
   {
     mutex_lock lock(mu_);
     output_buffer_.push(result.CopyRef());
+    // The caller waits unless a prefetched value is left for this output.
+    policy_.RecordConsumed(num_prefetched_ < output_buffer_.size());
 
     // Return since another thread is already actively reading data and updating
     // the output_buffer_.
@@ -50,7 +54,7 @@ IterationResult PrefetchingIterator::GetNext(const ExecutionContext& exec_ctx) {
     // The caller is a non-blocking thread, there is no token owner and there
     // are more values to prefetch. Schedule a blocking task to fetch values.
     if (!reached_eof_ &&
-        prefetch_buffer_.size() < prefetch_threshold_ + output_buffer_.size()) {
+        prefetch_buffer_.size() < PrefetchThreshold() + output_buffer_.size()) {
       auto task = [iterator = FormRef(this), exec_ctx]() {
         iterator->ReadIOSource(exec_ctx);
       };
@@ -65,6 +69,7 @@ IterationResult PrefetchingIterator::GetNext(const ExecutionContext& exec_ctx) {
       assert(output_buffer_.size() == 1);
       auto input = GetNextElement(exec_ctx);
       prefetch_buffer_.push(std::move(input));
+      ++num_prefetched_;
     }
   }
 
@@ -79,7 +84,7 @@ void PrefetchingIterator::ReadIOSource(const ExecutionContext& exec_ctx) {
     // The caller is the token owner, there are enough prefetched values and
     // there is no output value to update. Release the token and return.
     if (output_buffer_.empty() &&
-        (prefetch_buffer_.size() >= prefetch_threshold_ || reached_eof_)) {
+        (prefetch_buffer_.size() >= PrefetchThreshold() || reached_eof_)) {
       token_owned_ = false;
       return;
     }
@@ -88,24 +93,24 @@ void PrefetchingIterator::ReadIOSource(const ExecutionContext& exec_ctx) {
 
   // There is no other thread that owns the token. So we are free to access the
   // prefetch_buffer_ and the underlying IO source without having a lock.
-  auto prefetch_num =
-      max_prefetch_num_ + OutputBufferSize() - prefetch_buffer_.size();
-  for (int32_t i = 0; i < prefetch_num; ++i) {
+  // The policy learns from the prefetched values, so the number of values to
+  // prefetch is checked for every value.
+  while (prefetch_buffer_.size() <
+         policy_.MaxPrefetched() + OutputBufferSize()) {
     if (exec_ctx.IsCancelled()) return;
+    auto start_time = std::chrono::steady_clock::now();
     auto input = GetNextElement(exec_ctx);
     if (input.eof.IsConcrete() && input.eof.get()) {
       reached_eof_ = true;
       break;
     }
-    auto output = DequeueOutputBuffer();
-    if (!output) {
-      prefetch_buffer_.push(std::move(input));
-    } else {
-      // It is guaranteed that no other thread will attempt to dequeue value
-      // from the output buffer.
-      ForwardInputToOutput(std::move(input), std::move(output.getValue()),
-                           exec_ctx);
-    }
+    policy_.RecordProduced(EstimateElementBytes(input.values),
+                           std::chrono::steady_clock::now() - start_time);
+    // Values requested while the loop runs must be filled from the older
+    // prefetched values first, so the new value always goes through the
+    // prefetch_buffer_ to keep the order of the values.
+    PushPrefetched(std::move(input));
+    MaterializeOutputs(exec_ctx);
   }
   ReadIOSource(exec_ctx);
 }
@@ -141,7 +146,7 @@ void PrefetchingIterator::MaterializeOutputs(const ExecutionContext& exec_ctx) {
   // It is guaranteed that no other thread will attempt to dequeue value from
   // the output buffer concurrently.
   while (!prefetch_buffer_.empty()) {
-    auto output = DequeueOutputBuffer();
+    auto output = DequeueOutputBuffer(/*consumes_prefetched=*/true);
     if (!output) break;
     auto input = std::move(prefetch_buffer_.front());
     prefetch_buffer_.pop();
@@ -149,7 +154,7 @@ void PrefetchingIterator::MaterializeOutputs(const ExecutionContext& exec_ctx) {
                          exec_ctx);
   }
   if (reached_eof_) {
-    IterationResult eof_result = IterationResult::Eof(exec_ctx.host(), 1);
+    IterationResult eof_result = IterationResult::Eof(exec_ctx.host(), arity_);
     while (auto output = DequeueOutputBuffer()) {
       ForwardInputToOutput(eof_result.CopyRef(), std::move(output.getValue()),
                            exec_ctx);
@@ -23,11 +23,13 @@
 #ifndef TFRT_LIB_DATA_IO_H_
 #define TFRT_LIB_DATA_IO_H_
 
+#include <algorithm>
 #include <atomic>
 #include <memory>
 #include <queue>
 
 #include "dataset.h"
+#include "prefetch_policy.h"
 #include "tfrt/host_context/execution_context.h"
 #include "tfrt/support/forward_decls.h"
 #include "tfrt/support/mutex.h"
@@ -54,20 +56,38 @@ namespace io {
 // In the common case asynchronous prefetch tasks should run ahead of GetNext(),
 // and all calls to get the next element should produce results instantaneously.
 //
+// The number of prefetched elements is decided by a PrefetchPolicy, which
+// adapts it to the rate of the consumer and bounds the bytes of the prefetched
+// elements. A new prefetch task is launched when the number of prefetched
+// elements drops below a quarter of the policy's maximum.
+//
 // This is an internal implementation detail, and it is not exposed to the end
 // user as a dataset type.
-//
-// TODO(ezhulenev): Add flexible prefetching policy based not only on the number
-// of prefetched records, but also on the memory consumption.
 class PrefetchingIterator : public Iterator {
  public:
-  explicit PrefetchingIterator(int32_t num_worker_threads)
+  // `arity` is the number of values of each element.
+  explicit PrefetchingIterator(int32_t num_worker_threads, size_t arity = 1)
+      : PrefetchingIterator(DefaultPolicyOptions(num_worker_threads), arity) {}
+
+  explicit PrefetchingIterator(PrefetchPolicy::Options policy_options,
+                               size_t arity = 1)
       : Iterator(),
-        max_prefetch_num_(num_worker_threads * 8),
-        prefetch_threshold_(num_worker_threads * 2),
+        arity_(arity),
+        policy_(std::move(policy_options)),
         token_owned_(false),
-        reached_eof_(false) {
+        reached_eof_(false) {}
+
+  // The default policy starts with 8 prefetched elements per worker thread,
+  // and bounds the prefetched elements of the iterator to 64MB.
+  static PrefetchPolicy::Options DefaultPolicyOptions(
+      int32_t num_worker_threads) {
     assert(num_worker_threads > 0);
+    PrefetchPolicy::Options options;
+    options.min_depth = num_worker_threads;
+    options.initial_depth = num_worker_threads * 8;
+    options.max_depth = std::max(options.initial_depth, int64_t{1024});
+    options.max_bytes = 64 << 20;
+    return options;
   }
 
   // Gets the next element from a prefetch buffer, and maybe launches an
@@ -98,19 +118,35 @@ class PrefetchingIterator : public Iterator {
   // output_buffer_.
   void MaterializeOutputs(const ExecutionContext& exec_ctx);
 
+  // Prefetch tasks are launched when fewer elements than this are prefetched.
+  size_t PrefetchThreshold() const {
+    return std::max<int64_t>(policy_.MaxPrefetched() / 4, 1);
+  }
+
   int OutputBufferSize() TFRT_EXCLUDES(mu_) {
     mutex_lock lock(mu_);
     return output_buffer_.size();
   }
 
-  llvm::Optional<IterationResult> DequeueOutputBuffer() TFRT_EXCLUDES(mu_) {
+  // If `consumes_prefetched` is true, the output is filled from the front of
+  // the prefetch_buffer_, which is accounted for in num_prefetched_.
+  llvm::Optional<IterationResult> DequeueOutputBuffer(
+      bool consumes_prefetched = false) TFRT_EXCLUDES(mu_) {
     mutex_lock lock(mu_);
     if (output_buffer_.empty()) return llvm::None;
     auto value = std::move(output_buffer_.front());
     output_buffer_.pop();
+    if (consumes_prefetched) --num_prefetched_;
     return value;
   }
 
+  // Pushes `input` to the prefetch_buffer_. Only called by the token owner.
+  void PushPrefetched(IterationResult input) TFRT_EXCLUDES(mu_) {
+    prefetch_buffer_.push(std::move(input));
+    mutex_lock lock(mu_);
+    ++num_prefetched_;
+  }
+
   mutex mu_;
   // A queue of IterationResult returned by GetNextElement(...). This queue
   // does not need to be explicitly protected by lock because the implementation
@@ -119,15 +155,16 @@ class PrefetchingIterator : public Iterator {
   // A queue of IterationResult that have already been returned to the
   // GetNext(...) caller.
   std::queue<IterationResult> output_buffer_ TFRT_GUARDED_BY(mu_);
+  // The size of the prefetch_buffer_, which other threads than the token owner
+  // can read with mu_ held.
+  size_t num_prefetched_ TFRT_GUARDED_BY(mu_) = 0;
+
+  const size_t arity_;
 
-  // Maximum number of values to prefetch from the underlying IO source
-  // in addition to meeting the number of output values already requested in the
-  // output_buffer_. The total number of values in the queues of the open
-  // iterators is upper bounded by max_prefetch_num_ + output_buffer_size.
-  const size_t max_prefetch_num_;
-  // Schedule background blocking thread to prefetch from the underlying IO
-  // source if the number of prefetched values dropped below this threadhold.
-  const size_t prefetch_threshold_;
+  // Decides the maximum number of values to prefetch from the underlying IO
+  // source in addition to meeting the number of output values already
+  // requested in the output_buffer_.
+  PrefetchPolicy policy_;
 
   // This is a unique logical token for this iterator instance. It effectively
   // acts as a lock to ensure in-order delivery of results by guaranteeing that
@@ -0,0 +1,136 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//===- map_and_batch_dataset.cc ---------------------------------*- C++ -*-===//
+//
+// This file implements MapAndBatchDataset class which maps a function over the
+// elements of another Dataset instance and writes the results directly into
+// the rows of a batch.
+//
+//===----------------------------------------------------------------------===//
+
+#include "map_and_batch_dataset.h"
+
+#include "batch_dataset.h"
+#include "map_dataset.h"
+#include "tfrt/host_context/host_buffer.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+
+namespace tfrt {
+namespace data {
+
+//===----------------------------------------------------------------------===//
+// MapAndBatchDataset methods
+//===----------------------------------------------------------------------===//
+RCReference<Iterator> MapAndBatchDataset::MakeIterator() {
+  return TakeRef(host_->Construct<MapAndBatchDatasetIterator>(FormRef(this)));
+}
+
+//===----------------------------------------------------------------------===//
+// MapAndBatchDatasetIterator methods
+//===----------------------------------------------------------------------===//
+IterationResult MapAndBatchDatasetIterator::GetNext(
+    const ExecutionContext& exec_ctx) {
+  HostContext* host = exec_ctx.host();
+  const int64_t batch_size = parent_dataset_->batch_size_;
+  const TensorMetadata& element_metadata = parent_dataset_->element_metadata_;
+
+  SmallVector<IterationResult, 4> inputs;
+  inputs.reserve(batch_size);
+  for (int64_t i = 0; i < batch_size; ++i) {
+    inputs.push_back(input_iterator_->GetNext(exec_ctx));
+  }
+
+  auto result_value = host->MakeUnconstructedAsyncValueRef<DenseHostTensor>();
+  SmallVector<RCReference<AsyncValue>, 4> result_values;
+  result_values.push_back(result_value.CopyRCRef());
+  // result's eof should be exactly the same as the eof of the first input.
+  auto result = IterationResult::Pending(std::move(result_values),
+                                         inputs[0].eof.CopyRef());
+
+  SmallVector<ssize_t, 4> batch_dims;
+  batch_dims.push_back(batch_size);
+  for (int i = 0, e = element_metadata.shape.GetRank(); i < e; ++i) {
+    batch_dims.push_back(element_metadata.shape.GetDimensionSize(i));
+  }
+  auto dht = DenseHostTensor::CreateUninitialized(
+      TensorMetadata(element_metadata.dtype, batch_dims), host);
+  if (!dht) {
+    result_value.SetError(
+        EmitError(exec_ctx, "failed to create uninitialized tensor"));
+    return result;
+  }
+  auto batch = host->MakeAvailableAsyncValueRef<DenseHostTensor>(
+      std::move(*dht));
+
+  // Each call writes its row through a DenseHostTensor over a slice of the
+  // buffer of the batch. The batch is complete when all the calls are done.
+  const size_t row_size = element_metadata.GetHostSizeInBytes();
+  auto* counter_and_error = new CounterAndError(batch_size);
+  for (int64_t i = 0; i < batch_size; ++i) {
+    auto row_buffer = HostBuffer::CreateFromExternal(batch->buffer().CopyRef(),
+                                                     i * row_size, row_size);
+    auto row = host->MakeAvailableAsyncValueRef<DenseHostTensor>(
+        element_metadata, std::move(row_buffer));
+    RunCall(std::move(inputs[i]), std::move(row), batch.CopyRef(),
+            result_value.CopyRCRef(), counter_and_error, exec_ctx);
+  }
+  return result;
+}
+
+void MapAndBatchDatasetIterator::RunCall(IterationResult input,
+                                         AsyncValueRef<DenseHostTensor> row,
+                                         AsyncValueRef<DenseHostTensor> batch,
+                                         RCReference<AsyncValue> result,
+                                         CounterAndError* counter_and_error,
+                                         const ExecutionContext& exec_ctx) {
+  auto eof = input.eof.CopyRef();
+  eof.AndThen([exec_ctx, input = std::move(input), row = std::move(row),
+               batch = std::move(batch), result = std::move(result),
+               counter_and_error, iterator = FormRef(this)]() mutable {
+    if (input.eof.IsError()) {
+      SetSliceError(input.eof.release(), counter_and_error);
+      FinishSlices(1, batch, result, counter_and_error, exec_ctx);
+      return;
+    }
+    if (input.eof.get()) {
+      counter_and_error->eof_num.fetch_add(1);
+      FinishSlices(1, batch, result, counter_and_error, exec_ctx);
+      return;
+    }
+
+    // The row is passed after the values of the input.
+    auto args = std::move(input.values);
+    args.push_back(row.ReleaseRCRef());
+    auto* parent_dataset = iterator->parent_dataset_.get();
+    auto done = std::move(
+        EnqueueFunction(parent_dataset->map_fn_.get(),
+                        parent_dataset->additional_fn_args_.CopyRef(),
+                        RCArray<AsyncValue>(args), exec_ctx)[0]);
+    // map_fn returns its chain when it has written the row.
+    auto* done_ptr = done.get();
+    done_ptr->AndThen([exec_ctx, done = std::move(done),
+                       batch = std::move(batch), result = std::move(result),
+                       counter_and_error,
+                       iterator = std::move(iterator)]() mutable {
+      if (done->IsError()) SetSliceError(done.release(), counter_and_error);
+      FinishSlices(1, batch, result, counter_and_error, exec_ctx);
+    });
+  });
+}
+
+}  // namespace data
+}  // namespace tfrt
@@ -0,0 +1,125 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//===- map_and_batch_dataset.h ----------------------------------*- C++ -*-===//
+//
+// This file declares MapAndBatchDataset class which maps a function over the
+// elements of another Dataset instance and writes the results directly into
+// the rows of a batch.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef TFRT_LIB_DATA_MAP_AND_BATCH_DATASET_H_
+#define TFRT_LIB_DATA_MAP_AND_BATCH_DATASET_H_
+
+#include "dataset.h"
+#include "tfrt/host_context/function.h"
+#include "tfrt/support/forward_decls.h"
+#include "tfrt/support/rc_array.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+#include "tfrt/tensor/tensor_metadata.h"
+
+namespace tfrt {
+namespace data {
+
+class MapAndBatchDatasetIterator;
+struct CounterAndError;
+
+// MapAndBatchDataset is the fusion of MapDataset and BatchDataset. The batch is
+// allocated before map_fn is called, and each call gets a DenseHostTensor that
+// views its row of the batch as its last argument. map_fn writes its result
+// into the row and returns a chain, so that no tensor is allocated and no copy
+// is made per element.
+//
+// The rows have the `element_metadata`, and the batch has one more outermost
+// dimension of size `batch_size`.
+class MapAndBatchDataset : public Dataset {
+ public:
+  explicit MapAndBatchDataset(RCReference<Dataset> input_dataset,
+                              int64_t batch_size,
+                              TensorMetadata element_metadata,
+                              RCArray<AsyncValue> additional_fn_args,
+                              RCReference<const Function> map_fn,
+                              HostContext* host)
+      : input_dataset_(std::move(input_dataset)),
+        batch_size_(batch_size),
+        element_metadata_(std::move(element_metadata)),
+        additional_fn_args_(std::move(additional_fn_args)),
+        map_fn_(std::move(map_fn)),
+        host_(host),
+        allocator_(host->allocator()) {}
+
+  // This class is not copyable or movable.
+  MapAndBatchDataset(const MapAndBatchDataset&) = delete;
+  MapAndBatchDataset& operator=(const MapAndBatchDataset&) = delete;
+
+  RCReference<Iterator> MakeIterator() override;
+
+ private:
+  // Allow iterator to rely on private data members of this dataset.
+  friend class MapAndBatchDatasetIterator;
+
+  void Destroy() override {
+    internal::DestroyImpl<MapAndBatchDataset>(this, allocator_);
+  }
+
+  RCReference<Dataset> input_dataset_;
+  const int64_t batch_size_;
+  const TensorMetadata element_metadata_;
+  RCArray<AsyncValue> additional_fn_args_;
+  RCReference<const Function> map_fn_;
+  HostContext* host_;
+  HostAllocator* allocator_;
+};
+
+class MapAndBatchDatasetIterator : public Iterator {
+ public:
+  explicit MapAndBatchDatasetIterator(
+      RCReference<MapAndBatchDataset> parent_dataset)
+      : Iterator(),
+        parent_dataset_(std::move(parent_dataset)),
+        input_iterator_(parent_dataset_->input_dataset_->MakeIterator()) {}
+
+  // This class is not copyable or movable.
+  MapAndBatchDatasetIterator(const MapAndBatchDatasetIterator&) = delete;
+  MapAndBatchDatasetIterator& operator=(const MapAndBatchDatasetIterator&) =
+      delete;
+
+  IterationResult GetNext(const ExecutionContext& exec_ctx) override;
+
+ private:
+  void Destroy() override {
+    internal::DestroyImpl<MapAndBatchDatasetIterator>(
+        this, parent_dataset_->allocator_);
+  }
+
+  // Calls map_fn on `input` and `row` when the eof of `input` is available,
+  // and counts the row as done in `counter_and_error` when the call returns
+  // its chain. `result` is filled with `batch` when all the rows are done.
+  void RunCall(IterationResult input, AsyncValueRef<DenseHostTensor> row,
+               AsyncValueRef<DenseHostTensor> batch,
+               RCReference<AsyncValue> result,
+               CounterAndError* counter_and_error,
+               const ExecutionContext& exec_ctx);
+
+  RCReference<MapAndBatchDataset> parent_dataset_;
+  RCReference<Iterator> input_iterator_;
+};
+
+}  // namespace data
+}  // namespace tfrt
+
+#endif  // TFRT_LIB_DATA_MAP_AND_BATCH_DATASET_H_
@@ -23,6 +23,8 @@
 
 #include "map_dataset.h"
 
+#include "llvm/ADT/Optional.h"
+
 namespace tfrt {
 namespace data {
 
@@ -36,20 +38,170 @@ RCReference<Iterator> MapDataset::MakeIterator() {
 //===----------------------------------------------------------------------===//
 // MapDatasetIterator methods
 //===----------------------------------------------------------------------===//
+// Resolves the eof and forwards the values of `output`, which are indirect
+// async values, to those of `result`.
+static void FillOutput(IterationResult output, const IterationResult& result) {
+  if (result.eof.IsError()) {
+    output.eof.SetError(result.eof.GetError());
+  } else {
+    output.eof.emplace(result.eof.get());
+  }
+  for (size_t i = 0, e = output.values.size(); i < e; ++i) {
+    auto* output_value = cast<IndirectAsyncValue>(output.values[i].get());
+    output_value->ForwardTo(result.values[i].CopyRef());
+  }
+}
+
 IterationResult MapDatasetIterator::GetNext(const ExecutionContext& exec_ctx) {
-  auto input = input_iterator_->GetNext(exec_ctx);
   const Function* map_fn = parent_dataset_->map_fn_.get();
+  if (!IsScheduled()) {
+    auto input = input_iterator_->GetNext(exec_ctx);
+
+    auto values = std::move(input.values);
+    auto eof = std::move(input.eof);
+
+    // IDEA(donglin): consider extending RCArray to support CopyRef() without
+    // doing shallow copy.
+    auto additional_fn_args = parent_dataset_->additional_fn_args_.CopyRef();
+    auto result = EnqueueFunction(map_fn, std::move(additional_fn_args),
+                                  RCArray<AsyncValue>(std::move(values)),
+                                  exec_ctx);
+    return IterationResult::Pending(std::move(result), std::move(eof));
+  }
+
+  auto* host = exec_ctx.host();
+  llvm::SmallVector<RCReference<AsyncValue>, 4> result_values;
+  for (size_t i = 0, e = map_fn->result_types().size(); i < e; ++i)
+    result_values.push_back(host->MakeIndirectAsyncValue());
+  auto result = IterationResult::Pending(
+      std::move(result_values), host->MakeUnconstructedAsyncValueRef<bool>());
+
+  bool reached_end = false;
+  {
+    mutex_lock lock(mu_);
+    // In the non-deterministic order, the output can be filled right away if
+    // all the calls are done and the input reached end.
+    reached_end = !parent_dataset_->deterministic_ && reached_eof_ &&
+                  num_calls_in_flight_ == 0;
+    if (!reached_end) {
+      output_buffer_.push(result.CopyRef());
+      num_unstarted_calls_++;
+    }
+  }
+  if (reached_end) {
+    auto end = IterationResult::Eof(host, map_fn->result_types().size());
+    FillOutput(result.CopyRef(), end);
+    return result;
+  }
+
+  StartCalls(exec_ctx);
+  return result;
+}
+
+void MapDatasetIterator::StartCalls(const ExecutionContext& exec_ctx) {
+  {
+    mutex_lock lock(mu_);
+    if (starting_calls_) return;
+    starting_calls_ = true;
+  }
+  while (true) {
+    llvm::Optional<IterationResult> input;
+    llvm::Optional<IterationResult> output;
+    {
+      mutex_lock lock(mu_);
+      // Calls that complete while a call is started wake up this loop instead
+      // of starting calls themselves, so the loop must check for more calls in
+      // the same critical section that releases starting_calls_.
+      const auto num_parallel_calls = parent_dataset_->num_parallel_calls_;
+      if (num_unstarted_calls_ == 0 ||
+          (num_parallel_calls != MapDataset::kUnboundedParallelCalls &&
+           num_calls_in_flight_ >= num_parallel_calls) ||
+          (!parent_dataset_->deterministic_ && reached_eof_)) {
+        starting_calls_ = false;
+        return;
+      }
+      num_unstarted_calls_--;
+      num_calls_in_flight_++;
+      if (parent_dataset_->deterministic_) {
+        output = std::move(output_buffer_.front());
+        output_buffer_.pop();
+      }
+      input = input_iterator_->GetNext(exec_ctx);
+    }
+    RunCall(std::move(*input), std::move(output), exec_ctx);
+  }
+}
+
+void MapDatasetIterator::RunCall(IterationResult input,
+                                 llvm::Optional<IterationResult> output,
+                                 const ExecutionContext& exec_ctx) {
+  auto eof = input.eof.CopyRef();
+  eof.AndThen([exec_ctx, input = std::move(input), output = std::move(output),
+               iterator = FormRef(this)]() mutable {
+    auto* host = exec_ctx.host();
+    auto* parent_dataset = iterator->parent_dataset_.get();
+    if (input.eof.IsError() || input.eof.get()) {
+      // The result has the arity of map_fn's outputs, not of its inputs.
+      const size_t num_results = parent_dataset->map_fn_->result_types().size();
+      auto result = input.eof.IsError()
+                        ? IterationResult::Error(input.eof.CopyRCRef(),
+                                                 num_results)
+                        : IterationResult::Eof(host, num_results);
+      iterator->CompleteCall(std::move(output), std::move(result), exec_ctx);
+      return;
+    }
+
+    auto values = EnqueueFunction(
+        parent_dataset->map_fn_.get(),
+        parent_dataset->additional_fn_args_.CopyRef(),
+        RCArray<AsyncValue>(input.values), exec_ctx,
+        iterator->parent_dataset_.CopyRef());
+    SmallVector<AsyncValue*, 4> values_ptrs;
+    for (auto& value : values) values_ptrs.push_back(value.get());
+    // The call is in flight until its results are available, so that an
+    // asynchronous map_fn is bounded as well.
+    host->RunWhenReady(values_ptrs, [exec_ctx, host, output = std::move(output),
+                                     values = std::move(values),
+                                     iterator = std::move(iterator)]() mutable {
+      iterator->CompleteCall(std::move(output),
+                             IterationResult::Values(std::move(values), host),
+                             exec_ctx);
+    });
+  });
+}
 
-  auto values = std::move(input.values);
-  auto eof = std::move(input.eof);
+void MapDatasetIterator::CompleteCall(llvm::Optional<IterationResult> output,
+                                      IterationResult result,
+                                      const ExecutionContext& exec_ctx) {
+  llvm::SmallVector<IterationResult, 4> end_outputs;
+  {
+    mutex_lock lock(mu_);
+    num_calls_in_flight_--;
+    if (!parent_dataset_->deterministic_) {
+      if (!result.eof.IsError() && result.eof.get()) {
+        reached_eof_ = true;
+      } else {
+        // Take the first output not filled yet.
+        output = std::move(output_buffer_.front());
+        output_buffer_.pop();
+      }
+      // All the calls are done after the end of the input. The remaining
+      // outputs have no values to wait for.
+      if (reached_eof_ && num_calls_in_flight_ == 0) {
+        for (; !output_buffer_.empty(); output_buffer_.pop())
+          end_outputs.push_back(std::move(output_buffer_.front()));
+        num_unstarted_calls_ = 0;
+      }
+    }
+  }
 
-  // IDEA(donglin): consider extending RCArray to support CopyRef() without
-  // doing shallow copy.
-  auto additional_fn_args = parent_dataset_->additional_fn_args_.CopyRef();
-  auto result =
-      EnqueueFunction(map_fn, std::move(additional_fn_args),
-                      RCArray<AsyncValue>(std::move(values)), exec_ctx);
-  return IterationResult::Pending(std::move(result), std::move(eof));
+  if (output) FillOutput(std::move(*output), result);
+  if (!end_outputs.empty()) {
+    auto end = IterationResult::Eof(
+        exec_ctx.host(), parent_dataset_->map_fn_->result_types().size());
+    for (auto& end_output : end_outputs) FillOutput(std::move(end_output), end);
+  }
+  StartCalls(exec_ctx);
 }
 
 }  // namespace data
@@ -24,27 +24,89 @@
 #ifndef TFRT_LIB_DATA_MAP_DATASET_H_
 #define TFRT_LIB_DATA_MAP_DATASET_H_
 
+#include <atomic>
+#include <chrono>
+#include <queue>
+
 #include "dataset.h"
+#include "llvm/ADT/Optional.h"
 #include "tfrt/host_context/function.h"
 #include "tfrt/support/forward_decls.h"
+#include "tfrt/support/mutex.h"
+#include "tfrt/support/thread_annotations.h"
 
 namespace tfrt {
 namespace data {
 
 class MapDatasetIterator;
 
+// FunctionCost keeps a moving average of the time a function takes to run, so
+// that functions which are cheaper than a trip through the work queue can be
+// run inline. The average is updated without a lock, concurrent updates may
+// lose a sample.
+class FunctionCost {
+ public:
+  // Returns true if the function took less than kInlineThreshold on average
+  // over the last calls.
+  bool IsCheap() const {
+    return num_samples_.load(std::memory_order_relaxed) >= kMinSamples &&
+           average_ns_.load(std::memory_order_relaxed) <
+               kInlineThreshold.count();
+  }
+
+  void Record(std::chrono::nanoseconds run_time) {
+    auto average = average_ns_.load(std::memory_order_relaxed);
+    if (num_samples_.fetch_add(1, std::memory_order_relaxed) == 0) {
+      average = run_time.count();
+    } else {
+      average += (run_time.count() - average) / 8;
+    }
+    average_ns_.store(average, std::memory_order_relaxed);
+  }
+
+ private:
+  // Enqueuing a task costs a few microseconds, and a function that is not much
+  // more expensive is better run on the thread that makes its args available.
+  static constexpr std::chrono::nanoseconds kInlineThreshold{
+      std::chrono::microseconds(10)};
+  // The number of calls that are always enqueued to learn the run time.
+  static constexpr int64_t kMinSamples = 16;
+
+  std::atomic<int64_t> average_ns_{0};
+  std::atomic<int64_t> num_samples_{0};
+};
+
 // MapDataset maps a user-defined function over the elements in its input
 // dataset.
+//
+// By default map_fn is called for every element as soon as its args are
+// available, and the results are returned in the order of the input. If
+// `num_parallel_calls` is positive, at most that many calls (including the
+// elements requested from the input dataset for them) are in flight at a time,
+// and further elements are only requested from the input dataset when a call
+// completes. If `deterministic` is false, the results are returned in the
+// order the calls complete, so that a slow element does not hold back the
+// elements after it.
 class MapDataset : public Dataset {
  public:
+  // The number of parallel calls is not bounded.
+  static constexpr int64_t kUnboundedParallelCalls = -1;
+
   explicit MapDataset(RCReference<Dataset> input_dataset,
                       RCArray<AsyncValue> additional_fn_args,
-                      RCReference<const Function> map_fn, HostContext* host)
+                      RCReference<const Function> map_fn, HostContext* host,
+                      int64_t num_parallel_calls = kUnboundedParallelCalls,
+                      bool deterministic = true)
       : input_dataset_(std::move(input_dataset)),
         host_(host),
         allocator_(host->allocator()),
         additional_fn_args_(std::move(additional_fn_args)),
-        map_fn_(std::move(map_fn)) {}
+        map_fn_(std::move(map_fn)),
+        num_parallel_calls_(num_parallel_calls),
+        deterministic_(deterministic) {
+    assert(num_parallel_calls_ > 0 ||
+           num_parallel_calls_ == kUnboundedParallelCalls);
+  }
 
   // This class is not copyable or movable.
   MapDataset(const MapDataset&) = delete;
@@ -52,6 +114,10 @@ class MapDataset : public Dataset {
 
   RCReference<Iterator> MakeIterator() override;
 
+  // The run time of map_fn, shared by all the iterators. Only recorded for the
+  // parallel calls, see EnqueueFunction().
+  FunctionCost& map_fn_cost() { return map_fn_cost_; }
+
  private:
   // Allow iterator to rely on private data members of this dataset.
   friend class MapDatasetIterator;
@@ -65,13 +131,21 @@ class MapDataset : public Dataset {
   HostAllocator* allocator_;
   RCArray<AsyncValue> additional_fn_args_;
   RCReference<const Function> map_fn_;
+  const int64_t num_parallel_calls_;
+  const bool deterministic_;
+  FunctionCost map_fn_cost_;
 };
 
 // Enqueues map_fn(additional_fn_args, args) on the work queue and returns
-// the result AsyncValues.
+// the result AsyncValues. If `cost_dataset` is not null, the time until the
+// results of map_fn are available is recorded in its map_fn_cost(), and map_fn
+// is run inline instead when it is cheap and its args become available on a
+// non-blocking worker thread. Only the parallel map passes its dataset, which
+// is kept alive until the cost is recorded.
 static llvm::SmallVector<RCReference<AsyncValue>, 4> EnqueueFunction(
     const Function* map_fn, RCArray<AsyncValue> additional_fn_args,
-    RCArray<AsyncValue> args, const ExecutionContext& exec_ctx) {
+    RCArray<AsyncValue> args, const ExecutionContext& exec_ctx,
+    RCReference<MapDataset> cost_dataset = RCReference<MapDataset>()) {
   HostContext* host = exec_ctx.host();
   auto num_results = map_fn->result_types().size();
 
@@ -90,11 +164,55 @@ static llvm::SmallVector<RCReference<AsyncValue>, 4> EnqueueFunction(
       args.values(),
       [exec_ctx, num_results, map_fn = std::move(map_fn),
        additional_fn_args = std::move(additional_fn_args),
-       args = args.CopyRef(), results = std::move(results)]() mutable {
-        // IDEA(donglin): We can optimize performance for small tasks by not
-        // enqueuing small tasks to the threadpool. We need a way to identify
-        // small tasks.
-        //
+       args = args.CopyRef(), results = std::move(results),
+       cost_dataset = std::move(cost_dataset)]() mutable {
+        auto run_function = [exec_ctx, num_results, map_fn = std::move(map_fn),
+                             additional_fn_args = std::move(additional_fn_args),
+                             args = std::move(args),
+                             results = std::move(results),
+                             cost_dataset = cost_dataset.CopyRef()]() mutable {
+          // Construct arguments for function execution. The arguments
+          // consist of the 'additional_fn_args' from the MapDataset
+          // constructor, followed by the values from the underlying
+          // iterator.
+          SmallVector<AsyncValue*, 4> arguments;
+          for (auto* additional_arg : additional_fn_args.values()) {
+            arguments.push_back(additional_arg);
+          }
+          for (const auto& arg : args.values()) {
+            arguments.push_back(arg);
+          }
+          SmallVector<RCReference<AsyncValue>, 4> fn_results;
+          fn_results.resize(num_results);
+          auto start_time = std::chrono::steady_clock::now();
+          map_fn->Execute(exec_ctx, arguments, fn_results);
+          if (cost_dataset) {
+            // Record the time until the results are available, so that an
+            // asynchronous map_fn is not mistaken for a cheap one.
+            SmallVector<AsyncValue*, 4> fn_results_ptrs;
+            for (const auto& fn_result : fn_results)
+              fn_results_ptrs.push_back(fn_result.get());
+            exec_ctx.host()->RunWhenReady(
+                fn_results_ptrs, [cost_dataset = std::move(cost_dataset),
+                                  start_time] {
+                  cost_dataset->map_fn_cost().Record(
+                      std::chrono::steady_clock::now() - start_time);
+                });
+          }
+          for (size_t i = 0; i < num_results; ++i) {
+            results[i]->ForwardTo(std::move(fn_results[i]));
+          }
+        };
+
+        // Run the map function inline if it is known to be cheaper than
+        // enqueuing it. The blocking threads, e.g. of IO kernels, are left
+        // out, see the NOTE below.
+        if (cost_dataset && cost_dataset->map_fn_cost().IsCheap() &&
+            exec_ctx.host()->IsInWorkerThread()) {
+          run_function();
+          return;
+        }
+
         // Enqueue the map function to the threadpool to improve performance by
         // running the map function in parallel. An alternative approach to
         // increase parallelism is to compose map function with async kernels.
@@ -106,28 +224,7 @@ static llvm::SmallVector<RCReference<AsyncValue>, 4> EnqueueFunction(
         // enqueue work before the args are available, a thread from the
         // blocking threadpool might run the map function if the args is
         // computed by a thread in the blocking threadpool.
-        exec_ctx.host()->EnqueueWork(
-            [exec_ctx, num_results, map_fn = std::move(map_fn),
-             additional_fn_args = std::move(additional_fn_args),
-             args = std::move(args), results = std::move(results)]() mutable {
-              // Construct arguments for function execution. The arguments
-              // consist of the 'additional_fn_args' from the MapDataset
-              // constructor, followed by the values from the underlying
-              // iterator.
-              SmallVector<AsyncValue*, 4> arguments;
-              for (auto* additional_arg : additional_fn_args.values()) {
-                arguments.push_back(additional_arg);
-              }
-              for (const auto& arg : args.values()) {
-                arguments.push_back(arg);
-              }
-              SmallVector<RCReference<AsyncValue>, 4> fn_results;
-              fn_results.resize(num_results);
-              map_fn->Execute(exec_ctx, arguments, fn_results);
-              for (size_t i = 0; i < num_results; ++i) {
-                results[i]->ForwardTo(std::move(fn_results[i]));
-              }
-            });
+        exec_ctx.host()->EnqueueWork(std::move(run_function));
       });
 
   return results_ref;
@@ -152,8 +249,50 @@ class MapDatasetIterator : public Iterator {
                                               parent_dataset_->allocator_);
   }
 
+  // Returns true if the number of parallel calls is bounded, or if the results
+  // are returned in the order the calls complete.
+  bool IsScheduled() const {
+    return parent_dataset_->num_parallel_calls_ !=
+               MapDataset::kUnboundedParallelCalls ||
+           !parent_dataset_->deterministic_;
+  }
+
+  // Starts calls for the requested outputs while fewer than
+  // num_parallel_calls_ calls are in flight. Only one thread starts calls at a
+  // time, and calls that complete inline do not recurse into this method.
+  void StartCalls(const ExecutionContext& exec_ctx) TFRT_EXCLUDES(mu_);
+
+  // Calls map_fn on `input` when its eof is available, then completes the
+  // call. `output` is the output of the call in the deterministic order.
+  void RunCall(IterationResult input, llvm::Optional<IterationResult> output,
+               const ExecutionContext& exec_ctx);
+
+  // Fills the output of a call with `result`, which is the result of map_fn,
+  // or the end or error of the input, and starts the next calls. In the
+  // non-deterministic order `output` is empty, and the first output not filled
+  // yet is taken instead.
+  void CompleteCall(llvm::Optional<IterationResult> output,
+                    IterationResult result, const ExecutionContext& exec_ctx)
+      TFRT_EXCLUDES(mu_);
+
   RCReference<MapDataset> parent_dataset_;
   RCReference<Iterator> input_iterator_;
+
+  // The state of the iterator if IsScheduled(). input_iterator_ is only
+  // accessed with mu_ held in this case.
+  mutex mu_;
+  // The outputs returned by GetNext(...) without a call started for them in
+  // the deterministic order, or the outputs not filled yet otherwise.
+  std::queue<IterationResult> output_buffer_ TFRT_GUARDED_BY(mu_);
+  // The number of outputs returned by GetNext(...) without a call started for
+  // them.
+  int64_t num_unstarted_calls_ TFRT_GUARDED_BY(mu_) = 0;
+  int64_t num_calls_in_flight_ TFRT_GUARDED_BY(mu_) = 0;
+  // True if a thread is in StartCalls().
+  bool starting_calls_ TFRT_GUARDED_BY(mu_) = false;
+  // True if a call reached the end of the input, in which case no more calls
+  // are started in the non-deterministic order.
+  bool reached_eof_ TFRT_GUARDED_BY(mu_) = false;
 };
 
 }  // namespace data
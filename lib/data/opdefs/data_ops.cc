@@ -178,6 +178,16 @@ static LogicalResult verify(EnumerateIteratorOp op) {
   return success();
 }
 
+//===----------------------------------------------------------------------===//
+// MapAndBatchDatasetOp
+//===----------------------------------------------------------------------===//
+
+static LogicalResult verify(MapAndBatchDatasetOp op) {
+  // Only integer or float types are supported.
+  if (!op.element_type().isIntOrFloat()) return failure();
+  return success();
+}
+
 //===----------------------------------------------------------------------===//
 // RangeDatasetOp
 //===----------------------------------------------------------------------===//
@@ -0,0 +1,339 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+//===- padded_batch_dataset.cc --------------------------------------------===//
+//
+// This file implements PaddedBatchDataset class which wraps around another
+// Dataset instance and batches its variable-length tensors, padded to the
+// largest shape of each batch.
+//
+//===----------------------------------------------------------------------===//
+
+#include "padded_batch_dataset.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "tfrt/host_context/diagnostic.h"
+#include "tfrt/support/error_util.h"
+#include "tfrt/support/string_util.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+
+namespace tfrt {
+namespace data {
+
+//===----------------------------------------------------------------------===//
+// PaddedBatchDataset methods
+//===----------------------------------------------------------------------===//
+RCReference<Iterator> PaddedBatchDataset::MakeIterator() {
+  return TakeRef(host_->Construct<PaddedBatchDatasetIterator>(FormRef(this)));
+}
+
+//===----------------------------------------------------------------------===//
+// PaddedBatchDatasetIterator methods
+//===----------------------------------------------------------------------===//
+
+// Copies `src` with `src_dims` into `dst` with `dst_dims`, which are at least
+// as large, and zeroes the rest of `dst`.
+static void CopyPadded(const char* src, ArrayRef<ssize_t> src_dims, char* dst,
+                       ArrayRef<ssize_t> dst_dims, size_t dtype_size) {
+  if (src_dims.empty()) {
+    std::memcpy(dst, src, dtype_size);
+    return;
+  }
+  size_t src_row_bytes = dtype_size;
+  size_t dst_row_bytes = dtype_size;
+  for (size_t i = 1; i < src_dims.size(); ++i) {
+    src_row_bytes *= src_dims[i];
+    dst_row_bytes *= dst_dims[i];
+  }
+  if (src_row_bytes == dst_row_bytes) {
+    // The rows are not padded, so they are contiguous in both tensors.
+    std::memcpy(dst, src, src_dims[0] * src_row_bytes);
+  } else {
+    for (ssize_t i = 0; i < src_dims[0]; ++i) {
+      CopyPadded(src + i * src_row_bytes, src_dims.drop_front(),
+                 dst + i * dst_row_bytes, dst_dims.drop_front(), dtype_size);
+    }
+  }
+  std::memset(dst + src_dims[0] * dst_row_bytes, 0,
+              (dst_dims[0] - src_dims[0]) * dst_row_bytes);
+}
+
+// Pads and batches the `index`-th component of the elements of `batch`, whose
+// values are available DenseHostTensors.
+static llvm::Expected<DenseHostTensor> PadAndBatchComponent(
+    ArrayRef<IterationResult> batch, size_t index, HostContext* host) {
+  for (const IterationResult& element : batch) {
+    if (!element.values[index]->IsType<DenseHostTensor>()) {
+      return MakeStringError("padded_batch_dataset expects tensors, component ",
+                             index, " is not a DenseHostTensor");
+    }
+  }
+
+  const TensorMetadata& first =
+      batch[0].values[index]->get<DenseHostTensor>().metadata();
+  const int rank = first.shape.GetRank();
+  SmallVector<ssize_t, 4> dims;
+  dims.resize(rank + 1);
+  dims[0] = batch.size();
+  for (const IterationResult& element : batch) {
+    const TensorMetadata& metadata =
+        element.values[index]->get<DenseHostTensor>().metadata();
+    if (metadata.dtype != first.dtype || metadata.shape.GetRank() != rank) {
+      return MakeStringError("component ", index, " of the batch has ",
+                             metadata, " which is incompatible with ", first);
+    }
+    for (int i = 0; i < rank; ++i) {
+      dims[i + 1] = std::max(dims[i + 1], metadata.shape.GetDimensionSize(i));
+    }
+  }
+
+  auto result = DenseHostTensor::CreateUninitialized(
+      TensorMetadata(first.dtype, dims), host);
+  if (!result) return MakeStringError("failed to create uninitialized tensor");
+
+  ArrayRef<ssize_t> row_dims = llvm::makeArrayRef(dims).drop_front();
+  const size_t dtype_size = first.dtype.GetHostSize();
+  const size_t row_bytes = result->DataSizeInBytes() / batch.size();
+  auto* data = static_cast<char*>(result->data());
+  for (size_t i = 0; i < batch.size(); ++i) {
+    const auto& tensor = batch[i].values[index]->get<DenseHostTensor>();
+    SmallVector<ssize_t, 4> tensor_dims;
+    tensor.shape().GetDimensions(&tensor_dims);
+    CopyPadded(static_cast<const char*>(tensor.data()), tensor_dims,
+               data + i * row_bytes, row_dims, dtype_size);
+  }
+  return std::move(*result);
+}
+
+// Fills `output` with the padded batch of the elements of `batch`, whose eofs
+// and values are available.
+static void PadAndBatch(ArrayRef<IterationResult> batch,
+                        const IterationResult& output,
+                        const ExecutionContext& exec_ctx) {
+  auto set_error = [&](const DecodedDiagnostic& error) {
+    for (auto& value : output.values) value->SetError(error);
+  };
+  for (const IterationResult& element : batch) {
+    if (element.eof.IsError()) {
+      output.eof.SetError(element.eof.GetError());
+      set_error(element.eof.GetError());
+      return;
+    }
+    for (auto& value : element.values) {
+      if (value->IsError()) {
+        output.eof.emplace(false);
+        set_error(value->GetError());
+        return;
+      }
+    }
+  }
+
+  output.eof.emplace(false);
+  for (size_t i = 0, e = output.values.size(); i < e; ++i) {
+    auto tensor = PadAndBatchComponent(batch, i, exec_ctx.host());
+    if (!tensor) {
+      set_error(EmitError(exec_ctx, StrCat(tensor.takeError())));
+      return;
+    }
+    output.values[i]->emplace<DenseHostTensor>(std::move(*tensor));
+  }
+}
+
+PaddedBatchDatasetIterator::PaddedBatchDatasetIterator(
+    RCReference<PaddedBatchDataset> parent_dataset)
+    : Iterator(),
+      parent_dataset_(std::move(parent_dataset)),
+      input_iterator_(parent_dataset_->input_dataset_->MakeIterator()) {
+  buckets_.resize(parent_dataset_->bucket_boundaries_.size() + 1);
+}
+
+IterationResult PaddedBatchDatasetIterator::GetNext(
+    const ExecutionContext& exec_ctx) {
+  auto* host = exec_ctx.host();
+  // Initialize arity_ using the first value from the input_iterator_.
+  if (arity_ < 0) {
+    mutex_lock lock(mu_);
+    assert(!token_owned_);
+    auto input = input_iterator_->GetNext(exec_ctx);
+    arity_ = input.values.size();
+    input_buffer_.push(std::move(input));
+  }
+
+  llvm::SmallVector<RCReference<AsyncValue>, 4> result_values;
+  result_values.resize(arity_);
+  for (size_t i = 0; i < arity_; ++i) {
+    result_values[i] = host->MakeUnconstructedAsyncValueRef<DenseHostTensor>();
+  }
+  auto result_eof = host->MakeUnconstructedAsyncValueRef<bool>();
+  auto result =
+      IterationResult::Pending(std::move(result_values), std::move(result_eof));
+  {
+    mutex_lock lock(mu_);
+    output_buffer_.push(result.CopyRef());
+  }
+
+  MaybeScheduleBackgroundTask(exec_ctx, false, 0);
+  return result;
+}
+
+size_t PaddedBatchDatasetIterator::GetBucketIndex(
+    const IterationResult& element) const {
+  const auto& boundaries = parent_dataset_->bucket_boundaries_;
+  if (boundaries.empty()) return 0;
+  // Errors are batched on their own, the bucket does not matter.
+  const AsyncValue* value = element.values[0].get();
+  if (!value->IsType<DenseHostTensor>()) return 0;
+  const TensorShape& shape = value->get<DenseHostTensor>().shape();
+  const int64_t length = shape.GetRank() > 0 ? shape.GetDimensionSize(0) : 1;
+  return std::upper_bound(boundaries.begin(), boundaries.end(), length) -
+         boundaries.begin();
+}
+
+SmallVector<AsyncValue*, 4>
+PaddedBatchDatasetIterator::HandleAvailableInputs() {
+  const size_t batch_size = parent_dataset_->batch_size_;
+  while (!input_buffer_.empty()) {
+    auto& input = input_buffer_.front();
+    if (!input.eof.IsAvailable()) return {input.eof.GetAsyncValue()};
+    if (!input.eof.IsError() && input.eof.get()) {
+      reached_eof_ = true;
+      // All the remaining elements in the buffer must be EOF because they come
+      // from the exhausted iterator. Therefore we can clear the buffer.
+      input_buffer_ = {};
+      // Return the remaining elements of the buckets in smaller batches.
+      for (Batch& bucket : buckets_) {
+        if (!bucket.empty()) ready_batches_.push(std::move(bucket));
+      }
+      buckets_.clear();
+      break;
+    }
+
+    SmallVector<AsyncValue*, 4> unavailable;
+    if (!input.eof.IsError()) {
+      for (auto& value : input.values) {
+        if (!value->IsAvailable()) unavailable.push_back(value.get());
+      }
+    }
+    if (!unavailable.empty()) return unavailable;
+
+    auto element = std::move(input);
+    input_buffer_.pop();
+    bool is_error = element.eof.IsError() ||
+                    llvm::any_of(element.values, [](const auto& value) {
+                      return value->IsError();
+                    });
+    if (is_error) {
+      Batch error;
+      error.push_back(std::move(element));
+      ready_batches_.push(std::move(error));
+      continue;
+    }
+    Batch& bucket = buckets_[GetBucketIndex(element)];
+    bucket.push_back(std::move(element));
+    if (bucket.size() == batch_size) {
+      ready_batches_.push(std::move(bucket));
+      bucket = Batch();
+      bucket.reserve(batch_size);
+    }
+  }
+  return {};
+}
+
+void PaddedBatchDatasetIterator::MaybeScheduleBackgroundTask(
+    const ExecutionContext& exec_ctx, bool is_token_owner, int callback_count) {
+  {
+    mutex_lock lock(mu_);
+    // There is no more output value to update. Release the token if the caller
+    // owns the token and then return.
+    if (output_buffer_.empty()) {
+      if (is_token_owner) {
+        token_owned_ = false;
+      }
+      return;
+    }
+    // Return since the token is already owned by another thread.
+    if (!is_token_owner && token_owned_) return;
+    // Take the token if the thread does not already own the token.
+    token_owned_ = true;
+  }
+  // Only the thread that owns the token can execute the code below.
+
+  auto host = exec_ctx.host();
+  // Keep enough input elements requested to fill the requested outputs, if
+  // they all land in the same bucket.
+  if (!reached_eof_) {
+    int64_t input_fetch_num =
+        OutputBufferSize() * parent_dataset_->batch_size_ -
+        static_cast<int64_t>(input_buffer_.size());
+    for (int64_t i = 0; i < input_fetch_num; i++) {
+      auto input = input_iterator_->GetNext(exec_ctx);
+      assert(arity_ == input.values.size());
+      input_buffer_.push(std::move(input));
+    }
+  }
+  auto unavailable = HandleAvailableInputs();
+
+  // Fill the outputs with the ready batches. The batches are padded and copied
+  // on the work queue, so that the token owner can go on with the next inputs.
+  auto output_buffer_size = OutputBufferSize();
+  for (; output_buffer_size > 0 && !ready_batches_.empty();
+       --output_buffer_size) {
+    auto output = DequeueOutputBuffer();
+    host->EnqueueWork([exec_ctx, batch = std::move(ready_batches_.front()),
+                       output = std::move(output)] {
+      PadAndBatch(batch, output, exec_ctx);
+    });
+    ready_batches_.pop();
+  }
+
+  // The input_iterator_ has been exhausted and all the batches are returned.
+  if (reached_eof_ && ready_batches_.empty()) {
+    auto error = host->MakeErrorAsyncValueRef("iterator reached end");
+    for (; output_buffer_size > 0; --output_buffer_size) {
+      auto output = DequeueOutputBuffer();
+      for (auto& value : output.values) {
+        value->SetError(error->GetError());
+      }
+      output.eof.emplace(true);
+    }
+  }
+
+  if (unavailable.empty()) {
+    // Call the function again because the output_buffer_ might have more
+    // values now, or more inputs can be requested for it. No state is kept in
+    // the stack due to tail recursion. Thus we don't need to increment the
+    // callback_count.
+    MaybeScheduleBackgroundTask(exec_ctx, true, callback_count);
+    return;
+  }
+
+  // After the first element in the `input_buffer_` becomes available, the
+  // token owner should handle it, then call MaybeScheduleBackgroundTask()
+  // again to fill more outputs.
+  host->RunWhenReady(unavailable, [exec_ctx, host, callback_count,
+                                   iterator = FormRef(this)]() mutable {
+    if (callback_count >= MAX_RECURSIVE_CALLS) {
+      host->EnqueueWork([exec_ctx, iterator = std::move(iterator)] {
+        iterator->MaybeScheduleBackgroundTask(exec_ctx, true, 0);
+      });
+    } else {
+      iterator->MaybeScheduleBackgroundTask(exec_ctx, true, callback_count + 1);
+    }
+  });
+}
+
+}  // namespace data
+}  // namespace tfrt
@@ -0,0 +1,177 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//===- padded_batch_dataset.h -----------------------------------*- C++ -*-===//
+//
+// This file declares PaddedBatchDataset class which wraps around another
+// Dataset instance and batches its variable-length tensors, padded to the
+// largest shape of each batch.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef TFRT_LIB_DATA_PADDED_BATCH_DATASET_H_
+#define TFRT_LIB_DATA_PADDED_BATCH_DATASET_H_
+
+#include <algorithm>
+#include <queue>
+#include <vector>
+
+#include "dataset.h"
+#include "tfrt/support/forward_decls.h"
+#include "tfrt/support/mutex.h"
+#include "tfrt/support/thread_annotations.h"
+
+namespace tfrt {
+namespace data {
+
+class PaddedBatchDatasetIterator;
+
+// PaddedBatchDataset batches elements of DenseHostTensors whose shapes differ
+// in their dimension sizes. Each component of a batch has the shape of the
+// largest size of each dimension in the batch, with a leading batch dimension,
+// and the tensors are padded with zeros to that shape. The batch is allocated
+// once the metadata of all its elements is known, and every byte of it is
+// written once: the tensors are copied into their rows and only the padding
+// is zeroed.
+//
+// If `bucket_boundaries` is not empty, the elements are first grouped by the
+// size of the first dimension of their first component, so that each batch
+// holds elements of similar length and needs little padding. Bucket `i` holds
+// the lengths in [bucket_boundaries[i - 1], bucket_boundaries[i]), the first
+// and last buckets are unbounded below and above. A batch is returned when its
+// bucket has `batch_size` elements, so the batches are not in the order of the
+// input, and the remaining elements of the buckets are returned in smaller
+// batches at the end of the input.
+class PaddedBatchDataset : public Dataset {
+ public:
+  explicit PaddedBatchDataset(RCReference<Dataset> input_dataset,
+                              int64_t batch_size,
+                              std::vector<int64_t> bucket_boundaries,
+                              HostContext* host)
+      : input_dataset_(std::move(input_dataset)),
+        batch_size_(batch_size),
+        bucket_boundaries_(std::move(bucket_boundaries)),
+        host_(host),
+        allocator_(host->allocator()) {
+    assert(batch_size_ > 0);
+    assert(std::is_sorted(bucket_boundaries_.begin(),
+                          bucket_boundaries_.end()));
+  }
+
+  // This class is not copyable or movable.
+  PaddedBatchDataset(const PaddedBatchDataset&) = delete;
+  PaddedBatchDataset& operator=(const PaddedBatchDataset&) = delete;
+
+  RCReference<Iterator> MakeIterator() override;
+
+ private:
+  // Allow iterator to rely on private data members of this dataset.
+  friend class PaddedBatchDatasetIterator;
+
+  void Destroy() override {
+    internal::DestroyImpl<PaddedBatchDataset>(this, allocator_);
+  }
+
+  RCReference<Dataset> input_dataset_;
+  const int64_t batch_size_;
+  const std::vector<int64_t> bucket_boundaries_;
+  HostContext* host_;
+  HostAllocator* allocator_;
+};
+
+class PaddedBatchDatasetIterator : public Iterator {
+ public:
+  explicit PaddedBatchDatasetIterator(
+      RCReference<PaddedBatchDataset> parent_dataset);
+
+  // This class is not copyable or movable.
+  PaddedBatchDatasetIterator(const PaddedBatchDatasetIterator&) = delete;
+  PaddedBatchDatasetIterator& operator=(const PaddedBatchDatasetIterator&) =
+      delete;
+
+  IterationResult GetNext(const ExecutionContext& exec_ctx) override;
+
+ private:
+  // The elements of a batch, whose values are all available.
+  using Batch = std::vector<IterationResult>;
+
+  void Destroy() override {
+    internal::DestroyImpl<PaddedBatchDatasetIterator>(
+        this, parent_dataset_->allocator_);
+  }
+
+  // Like RepeatDatasetIterator::MaybeScheduleBackgroundTask(), ensures that
+  // only the token owner accesses the input_iterator_ and the buckets.
+  //
+  // The token owner requests input elements, moves the input elements whose
+  // values are available into their buckets, and fills the outputs with the
+  // full buckets, or with all the non-empty buckets after the end of the
+  // input. The batches are padded and copied by tasks on the work queue. When
+  // it has to wait for an input element, it calls itself again when the
+  // element is available.
+  void MaybeScheduleBackgroundTask(const ExecutionContext& exec_ctx,
+                                   bool is_token_owner, int callback_count)
+      TFRT_EXCLUDES(mu_);
+
+  // Moves the input elements whose eof and values are available from the
+  // input_buffer_ to their buckets, and the full buckets to the
+  // ready_batches_. Returns the unavailable values of the first input element
+  // that is not handled, or an empty vector if the input_buffer_ is empty.
+  SmallVector<AsyncValue*, 4> HandleAvailableInputs();
+
+  // Returns the index in buckets_ of an element with available values.
+  size_t GetBucketIndex(const IterationResult& element) const;
+
+  int OutputBufferSize() TFRT_EXCLUDES(mu_) {
+    mutex_lock lock(mu_);
+    return output_buffer_.size();
+  }
+
+  IterationResult DequeueOutputBuffer() TFRT_EXCLUDES(mu_) {
+    mutex_lock lock(mu_);
+    assert(!output_buffer_.empty());
+    auto value = std::move(output_buffer_.front());
+    output_buffer_.pop();
+    return value;
+  }
+
+  RCReference<PaddedBatchDataset> parent_dataset_;
+  RCReference<Iterator> input_iterator_;
+
+  // The state below is only accessed by the token owner.
+  int arity_ = -1;
+  // The elements requested from the input_iterator_ which are not handled
+  // yet, in order.
+  std::queue<IterationResult> input_buffer_;
+  // The elements of the batches that are not full yet, by bucket.
+  std::vector<Batch> buckets_;
+  // The batches to return, and the input errors, in order.
+  std::queue<Batch> ready_batches_;
+  bool reached_eof_ = false;
+
+  mutex mu_;
+  // A queue of IterationResult that have already been returned to the
+  // GetNext(...) caller.
+  std::queue<IterationResult> output_buffer_ TFRT_GUARDED_BY(mu_);
+  // This is a unique logical token for this iterator instance, see
+  // RepeatDatasetIterator::token_owned_.
+  bool token_owned_ TFRT_GUARDED_BY(mu_) = false;
+};
+
+}  // namespace data
+}  // namespace tfrt
+
+#endif  // TFRT_LIB_DATA_PADDED_BATCH_DATASET_H_
@@ -23,6 +23,8 @@
 //===----------------------------------------------------------------------===//
 #include "prefetch_dataset.h"
 
+#include <chrono>
+
 namespace tfrt {
 namespace data {
 
@@ -36,15 +38,56 @@ RCReference<Iterator> PrefetchDataset::MakeIterator() {
 //===----------------------------------------------------------------------===//
 // PrefetchDatasetIterator methods
 //===----------------------------------------------------------------------===//
+PrefetchDatasetIterator::PrefetchDatasetIterator(
+    RCReference<PrefetchDataset> parent_dataset)
+    : Iterator(),
+      parent_dataset_(std::move(parent_dataset)),
+      input_iterator_(parent_dataset_->input_dataset_->MakeIterator()) {
+  if (parent_dataset_->prefetch_num_ == PrefetchDataset::kAutoPrefetchNum) {
+    PrefetchPolicy::Options options;
+    options.initial_depth = parent_dataset_->host_->GetNumWorkerThreads();
+    options.max_bytes = parent_dataset_->max_bytes_;
+    options.shared_budget = parent_dataset_->shared_budget_.CopyRef();
+    policy_ = std::make_unique<PrefetchPolicy>(std::move(options));
+  }
+}
+
 IterationResult PrefetchDatasetIterator::GetNext(
     const ExecutionContext& exec_ctx) {
-  while (buffer_.size() < parent_dataset_->prefetch_num_) {
-    buffer_.push(input_iterator_->GetNext(exec_ctx));
+  if (!policy_) {
+    while (buffer_.size() < parent_dataset_->prefetch_num_) {
+      buffer_.push(input_iterator_->GetNext(exec_ctx));
+    }
+    auto result = std::move(buffer_.front());
+    buffer_.pop();
+    return result;
   }
+
+  if (buffer_.empty()) PrefetchWithPolicy(exec_ctx);
   auto result = std::move(buffer_.front());
   buffer_.pop();
+  policy_->RecordConsumed(!result.eof.IsAvailable());
+  // Refill the buffer after taking the element, so that the element does not
+  // count against the budget of the prefetched elements.
+  while (buffer_.size() < policy_->MaxPrefetched()) {
+    PrefetchWithPolicy(exec_ctx);
+  }
   return result;
 }
 
+void PrefetchDatasetIterator::PrefetchWithPolicy(
+    const ExecutionContext& exec_ctx) {
+  auto start_time = std::chrono::steady_clock::now();
+  buffer_.push(input_iterator_->GetNext(exec_ctx));
+  const IterationResult& element = buffer_.back();
+  element.eof.AndThen([element = element.CopyRef(), start_time,
+                       iterator = FormRef(this)] {
+    if (element.eof.IsError() || element.eof.get()) return;
+    iterator->policy_->RecordProduced(
+        EstimateElementBytes(element.values),
+        std::chrono::steady_clock::now() - start_time);
+  });
+}
+
 }  // namespace data
 }  // namespace tfrt
@@ -25,9 +25,11 @@
 #ifndef TFRT_LIB_DATA_PREFETCH_DATASET_H_
 #define TFRT_LIB_DATA_PREFETCH_DATASET_H_
 
+#include <memory>
 #include <queue>
 
 #include "dataset.h"
+#include "prefetch_policy.h"
 #include "tfrt/support/forward_decls.h"
 
 namespace tfrt {
@@ -37,13 +39,27 @@ class PrefetchDatasetIterator;
 
 // PrefetchDataset class which wraps around another dataset instance and
 // prefetches elements from the underlying dataset in an internal buffer.
+//
+// If `prefetch_num` is kAutoPrefetchNum, the number of prefetched elements is
+// decided by a PrefetchPolicy instead, which starts from the number of worker
+// threads and adapts to the rate of the consumer. The policy bounds the bytes
+// of the prefetched elements by `max_bytes` (if positive) and by the
+// `shared_budget` of the pipeline (if any).
 class PrefetchDataset : public Dataset {
  public:
+  static constexpr int64_t kAutoPrefetchNum = -1;
+
   explicit PrefetchDataset(RCReference<Dataset> input_dataset,
-                           int64_t prefetch_num, HostContext* host)
+                           int64_t prefetch_num, HostContext* host,
+                           int64_t max_bytes = 0,
+                           RCReference<PrefetchBudget> shared_budget = {})
       : input_dataset_(std::move(input_dataset)),
         prefetch_num_(prefetch_num),
-        host_(host) {}
+        max_bytes_(max_bytes),
+        shared_budget_(std::move(shared_budget)),
+        host_(host) {
+    assert(prefetch_num_ >= 0 || prefetch_num_ == kAutoPrefetchNum);
+  }
 
   // This class is not copyable or movable.
   PrefetchDataset(const PrefetchDataset&) = delete;
@@ -61,15 +77,14 @@ class PrefetchDataset : public Dataset {
 
   RCReference<Dataset> input_dataset_;
   int64_t prefetch_num_;
+  int64_t max_bytes_;
+  RCReference<PrefetchBudget> shared_budget_;
   HostContext* host_;
 };
 
 class PrefetchDatasetIterator : public Iterator {
  public:
-  explicit PrefetchDatasetIterator(RCReference<PrefetchDataset> parent_dataset)
-      : Iterator(),
-        parent_dataset_(std::move(parent_dataset)),
-        input_iterator_(parent_dataset_->input_dataset_->MakeIterator()) {}
+  explicit PrefetchDatasetIterator(RCReference<PrefetchDataset> parent_dataset);
 
   // This class is not copyable or movable.
   PrefetchDatasetIterator(const PrefetchDatasetIterator&) = delete;
@@ -83,9 +98,15 @@ class PrefetchDatasetIterator : public Iterator {
         this, parent_dataset_->host_->allocator());
   }
 
+  // Requests the next element from the input iterator, and reports its size
+  // and latency to the policy_ when it is available.
+  void PrefetchWithPolicy(const ExecutionContext& exec_ctx);
+
   RCReference<PrefetchDataset> parent_dataset_;
   RCReference<Iterator> input_iterator_;
   std::queue<IterationResult> buffer_;
+  // The policy if the parent dataset has kAutoPrefetchNum, otherwise nullptr.
+  std::unique_ptr<PrefetchPolicy> policy_;
 };
 
 }  // namespace data
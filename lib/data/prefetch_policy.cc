@@ -0,0 +1,158 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+//===- prefetch_policy.cc -------------------------------------------------===//
+//
+// This file implements PrefetchPolicy and PrefetchBudget.
+//
+//===----------------------------------------------------------------------===//
+
+#include "prefetch_policy.h"
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+#include "tfrt/host_context/host_buffer.h"
+#include "tfrt/tensor/dense_host_tensor.h"
+
+namespace tfrt {
+namespace data {
+
+int64_t EstimateElementBytes(ArrayRef<RCReference<AsyncValue>> values) {
+  int64_t bytes = 0;
+  for (const RCReference<AsyncValue>& value : values) {
+    if (!value->IsConcrete()) continue;
+    if (value->IsType<std::string>()) {
+      bytes += value->get<std::string>().size();
+    } else if (value->IsType<RCReference<HostBuffer>>()) {
+      bytes += value->get<RCReference<HostBuffer>>()->size();
+    } else if (value->IsType<DenseHostTensor>()) {
+      bytes += value->get<DenseHostTensor>().DataSizeInBytes();
+    }
+  }
+  return bytes;
+}
+
+//===----------------------------------------------------------------------===//
+// PrefetchBudget methods
+//===----------------------------------------------------------------------===//
+
+int64_t PrefetchBudget::UpdateReservation(int64_t old_bytes,
+                                          int64_t new_bytes) {
+  mutex_lock lock(mu_);
+  reserved_bytes_ -= old_bytes;
+  new_bytes = std::min(new_bytes, max_bytes_ - reserved_bytes_);
+  new_bytes = std::max<int64_t>(new_bytes, 0);
+  reserved_bytes_ += new_bytes;
+  return new_bytes;
+}
+
+//===----------------------------------------------------------------------===//
+// PrefetchPolicy methods
+//===----------------------------------------------------------------------===//
+
+PrefetchPolicy::PrefetchPolicy(Options options)
+    : options_(std::move(options)),
+      depth_(std::min(std::max(options_.initial_depth, options_.min_depth),
+                      options_.max_depth)),
+      max_prefetched_(depth_),
+      window_start_(Clock::now()) {
+  assert(options_.min_depth > 0);
+  assert(options_.min_depth <= options_.max_depth);
+}
+
+PrefetchPolicy::~PrefetchPolicy() {
+  if (options_.shared_budget)
+    options_.shared_budget->UpdateReservation(reserved_bytes_, 0);
+}
+
+int64_t PrefetchPolicy::MaxPrefetched() const {
+  mutex_lock lock(mu_);
+  return max_prefetched_;
+}
+
+int64_t PrefetchPolicy::depth() const {
+  mutex_lock lock(mu_);
+  return depth_;
+}
+
+void PrefetchPolicy::RecordProduced(int64_t bytes, Duration latency) {
+  // Weight of a new sample in the moving averages.
+  constexpr double kAlpha = 0.125;
+
+  mutex_lock lock(mu_);
+  if (average_latency_ns_ == 0) {
+    average_bytes_ = bytes;
+    average_latency_ns_ = latency.count();
+  } else {
+    average_bytes_ += kAlpha * (bytes - average_bytes_);
+    average_latency_ns_ += kAlpha * (latency.count() - average_latency_ns_);
+  }
+  UpdateMaxPrefetched();
+}
+
+void PrefetchPolicy::RecordConsumed(bool waited) {
+  mutex_lock lock(mu_);
+  ++window_consumed_;
+  if (waited) ++window_waits_;
+  if (window_consumed_ == kWindowSize) AdjustDepth(Clock::now());
+}
+
+void PrefetchPolicy::AdjustDepth(Clock::time_point now) {
+  if (window_waits_ > 0) {
+    depth_ = std::min(depth_ * 2, options_.max_depth);
+  } else if (average_latency_ns_ > 0) {
+    // The number of elements the consumer takes while one is produced.
+    const double consumer_interval_ns =
+        std::chrono::duration<double, std::nano>(now - window_start_).count() /
+        window_consumed_;
+    const int64_t needed = static_cast<int64_t>(
+        std::ceil(average_latency_ns_ / std::max(consumer_interval_ns, 1.0)));
+    // Shrink gradually, so that a short burst of fast consumption does not
+    // throw away the depth that was needed before.
+    if (depth_ > 2 * needed)
+      depth_ = std::max({depth_ - std::max<int64_t>(depth_ / 4, 1),
+                         2 * needed, options_.min_depth});
+  }
+
+  window_start_ = now;
+  window_consumed_ = 0;
+  window_waits_ = 0;
+  UpdateMaxPrefetched();
+}
+
+void PrefetchPolicy::UpdateMaxPrefetched() {
+  int64_t max_prefetched = depth_;
+  // Elements of unknown size are not limited by the budgets.
+  if (average_bytes_ >= 1) {
+    auto max_elements = [this](int64_t bytes) {
+      return static_cast<int64_t>(bytes / average_bytes_);
+    };
+    if (options_.max_bytes > 0) {
+      max_prefetched =
+          std::min(max_prefetched, max_elements(options_.max_bytes));
+    }
+    if (options_.shared_budget) {
+      reserved_bytes_ = options_.shared_budget->UpdateReservation(
+          reserved_bytes_,
+          static_cast<int64_t>(std::ceil(max_prefetched * average_bytes_)));
+      max_prefetched = std::min(max_prefetched, max_elements(reserved_bytes_));
+    }
+  }
+  max_prefetched_ = std::max<int64_t>(max_prefetched, 1);
+}
+
+}  // namespace data
+}  // namespace tfrt
@@ -0,0 +1,153 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//===- prefetch_policy.h ----------------------------------------*- C++ -*-===//
+//
+// This file declares PrefetchPolicy, which decides how many elements an
+// iterator prefetches ahead of its consumer, and PrefetchBudget, which bounds
+// the memory of the prefetched elements of a pipeline.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef TFRT_LIB_DATA_PREFETCH_POLICY_H_
+#define TFRT_LIB_DATA_PREFETCH_POLICY_H_
+
+#include <chrono>
+#include <cstdint>
+
+#include "tfrt/host_context/async_value.h"
+#include "tfrt/support/forward_decls.h"
+#include "tfrt/support/mutex.h"
+#include "tfrt/support/ref_count.h"
+#include "tfrt/support/thread_annotations.h"
+
+namespace tfrt {
+namespace data {
+
+// Returns the number of bytes held by the available `values` of an element.
+// Only strings, HostBuffers and DenseHostTensors are counted, other values
+// (including IndirectAsyncValues) count as zero bytes.
+int64_t EstimateElementBytes(ArrayRef<RCReference<AsyncValue>> values);
+
+// PrefetchBudget is a number of bytes shared by the prefetch policies of a
+// pipeline. Policies reserve their share of the budget as they learn the size
+// of their elements, so a pipeline with large elements in some stages can't
+// prefetch more than the budget in total.
+class PrefetchBudget : public ReferenceCounted<PrefetchBudget> {
+ public:
+  explicit PrefetchBudget(int64_t max_bytes) : max_bytes_(max_bytes) {
+    assert(max_bytes_ > 0);
+  }
+
+  int64_t max_bytes() const { return max_bytes_; }
+
+  int64_t reserved_bytes() const TFRT_EXCLUDES(mu_) {
+    mutex_lock lock(mu_);
+    return reserved_bytes_;
+  }
+
+  // Changes a reservation of `old_bytes` to `new_bytes`, or to what is left
+  // of the budget if it is smaller. Returns the new reservation.
+  int64_t UpdateReservation(int64_t old_bytes, int64_t new_bytes)
+      TFRT_EXCLUDES(mu_);
+
+ private:
+  const int64_t max_bytes_;
+  mutable mutex mu_;
+  int64_t reserved_bytes_ TFRT_GUARDED_BY(mu_) = 0;
+};
+
+// PrefetchPolicy adapts the number of prefetched elements of an iterator to
+// its producer and consumer:
+//
+// - The depth doubles when the consumer had to wait for elements during the
+//   last window of consumed elements.
+// - The depth shrinks when the consumer never waited, and the depth is more
+//   than twice the number of elements the consumer takes while an element is
+//   produced (the producer latency divided by the consumer interval).
+// - The number of prefetched elements is further limited by the byte budget
+//   of the iterator and by the shared budget of the pipeline, using the
+//   average size of the produced elements. At least one element can always be
+//   prefetched.
+//
+// All the methods are thread-safe.
+class PrefetchPolicy {
+ public:
+  using Duration = std::chrono::nanoseconds;
+
+  struct Options {
+    // The range of the depth.
+    int64_t min_depth = 1;
+    int64_t max_depth = 1024;
+    // The depth before any element is consumed.
+    int64_t initial_depth = 8;
+    // The bytes the prefetched elements of the iterator may use, or 0 for no
+    // limit.
+    int64_t max_bytes = 0;
+    // The budget shared with the other iterators of the pipeline, or nullptr.
+    RCReference<PrefetchBudget> shared_budget;
+  };
+
+  explicit PrefetchPolicy(Options options);
+  ~PrefetchPolicy();
+
+  // This class is not copyable or movable.
+  PrefetchPolicy(const PrefetchPolicy&) = delete;
+  PrefetchPolicy& operator=(const PrefetchPolicy&) = delete;
+
+  // The maximum number of elements to keep prefetched.
+  int64_t MaxPrefetched() const TFRT_EXCLUDES(mu_);
+
+  // The depth, before the byte budgets are applied.
+  int64_t depth() const TFRT_EXCLUDES(mu_);
+
+  // Records that the producer took `latency` to produce an element of `bytes`
+  // bytes.
+  void RecordProduced(int64_t bytes, Duration latency) TFRT_EXCLUDES(mu_);
+
+  // Records that the consumer took an element, and whether it had to wait
+  // for it because no element was prefetched.
+  void RecordConsumed(bool waited) TFRT_EXCLUDES(mu_);
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  // The number of consumed elements after which the depth is adjusted.
+  static constexpr int64_t kWindowSize = 16;
+
+  void AdjustDepth(Clock::time_point now) TFRT_REQUIRES(mu_);
+  void UpdateMaxPrefetched() TFRT_REQUIRES(mu_);
+
+  const Options options_;
+
+  mutable mutex mu_;
+  int64_t depth_ TFRT_GUARDED_BY(mu_);
+  int64_t max_prefetched_ TFRT_GUARDED_BY(mu_);
+  // Moving averages of the produced elements, zero until the first element.
+  double average_bytes_ TFRT_GUARDED_BY(mu_) = 0;
+  double average_latency_ns_ TFRT_GUARDED_BY(mu_) = 0;
+  // The current window of consumed elements.
+  Clock::time_point window_start_ TFRT_GUARDED_BY(mu_);
+  int64_t window_consumed_ TFRT_GUARDED_BY(mu_) = 0;
+  int64_t window_waits_ TFRT_GUARDED_BY(mu_) = 0;
+  // The bytes reserved in options_.shared_budget.
+  int64_t reserved_bytes_ TFRT_GUARDED_BY(mu_) = 0;
+};
+
+}  // namespace data
+}  // namespace tfrt
+
+#endif  // TFRT_LIB_DATA_PREFETCH_POLICY_H_
@@ -0,0 +1,286 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+//===- sharded_tf_record_dataset.cc ---------------------------------------===//
+//
+// This file implements ShardedTFRecordDataset class which reads the records of
+// multiple TFRecord files concurrently.
+//
+//===----------------------------------------------------------------------===//
+
+#include "sharded_tf_record_dataset.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/GlobPattern.h"
+#include "llvm/Support/Path.h"
+#include "tf_record_dataset.h"
+#include "tfrt/support/error_util.h"
+
+namespace tfrt {
+namespace data {
+
+static bool HasGlobCharacters(string_view path) {
+  return path.find_first_of("*?[") != string_view::npos;
+}
+
+llvm::Expected<std::vector<std::string>> GetShardFiles(string_view patterns,
+                                                       int64_t num_shards,
+                                                       int64_t shard_index) {
+  if (num_shards <= 0 || shard_index < 0 || shard_index >= num_shards) {
+    return MakeStringError("invalid shard index ", shard_index, " of ",
+                           num_shards, " shards");
+  }
+
+  llvm::SmallVector<string_view, 4> entries;
+  patterns.split(entries, ',', /*MaxSplit=*/-1, /*KeepEmpty=*/false);
+
+  std::vector<std::string> files;
+  for (string_view entry : entries) {
+    entry = entry.trim();
+    if (entry.empty()) continue;
+    if (!HasGlobCharacters(entry)) {
+      files.push_back(entry.str());
+      continue;
+    }
+
+    string_view dir = llvm::sys::path::parent_path(entry);
+    if (HasGlobCharacters(dir)) {
+      return MakeStringError(
+          "glob patterns are only supported in file names: ", entry);
+    }
+    auto glob = llvm::GlobPattern::create(llvm::sys::path::filename(entry));
+    if (!glob) {
+      return MakeStringError("invalid glob pattern ", entry, ": ",
+                             glob.takeError());
+    }
+
+    std::vector<std::string> matches;
+    std::error_code ec;
+    for (llvm::sys::fs::directory_iterator it(dir.empty() ? "." : dir, ec), end;
+         it != end && !ec; it.increment(ec)) {
+      if (it->type() == llvm::sys::fs::file_type::directory_file) continue;
+      if (glob->match(llvm::sys::path::filename(it->path())))
+        matches.push_back(it->path());
+    }
+    if (ec) {
+      return MakeStringError("failed to list directory ", dir, ": ",
+                             ec.message());
+    }
+    // Directory listings are not ordered, but all the workers need to agree
+    // on the order of the files.
+    std::sort(matches.begin(), matches.end());
+    files.insert(files.end(), std::make_move_iterator(matches.begin()),
+                 std::make_move_iterator(matches.end()));
+  }
+  if (files.empty()) return MakeStringError("no files match ", patterns);
+
+  std::vector<std::string> shard_files;
+  for (size_t i = shard_index; i < files.size(); i += num_shards)
+    shard_files.push_back(std::move(files[i]));
+  return shard_files;
+}
+
+//===----------------------------------------------------------------------===//
+// ShardedTFRecordDataset methods
+//===----------------------------------------------------------------------===//
+RCReference<Iterator> ShardedTFRecordDataset::MakeIterator() {
+  return TakeRef(
+      host_->Construct<ShardedTFRecordDatasetIterator>(FormRef(this)));
+}
+
+//===----------------------------------------------------------------------===//
+// ShardedTFRecordDatasetIterator methods
+//===----------------------------------------------------------------------===//
+ShardedTFRecordDatasetIterator::ShardedTFRecordDatasetIterator(
+    RCReference<ShardedTFRecordDataset> parent_dataset)
+    : Iterator(), parent_dataset_(std::move(parent_dataset)) {
+  readers_.resize(std::min<size_t>(parent_dataset_->num_parallel_reads_,
+                                   parent_dataset_->paths_.size()));
+  for (FileReader& reader : readers_) OpenNextFile(&reader);
+}
+
+IterationResult ShardedTFRecordDatasetIterator::GetNext(
+    const ExecutionContext& exec_ctx) {
+  auto* host = exec_ctx.host();
+
+  llvm::SmallVector<RCReference<AsyncValue>, 4> result_values;
+  result_values.push_back(host->MakeIndirectAsyncValue());
+  auto result_eof = host->MakeUnconstructedAsyncValueRef<bool>();
+  auto result =
+      IterationResult::Pending(std::move(result_values), std::move(result_eof));
+  {
+    mutex_lock lock(mu_);
+    output_buffer_.push(result.CopyRef());
+  }
+
+  MaybeScheduleBackgroundTask(exec_ctx, false, 0);
+  return result;
+}
+
+void ShardedTFRecordDatasetIterator::OpenNextFile(FileReader* reader) {
+  reader->queue = {};
+  const std::vector<std::string>& paths = parent_dataset_->paths_;
+  if (next_path_index_ == paths.size()) {
+    if (reader->iterator) {
+      reader->iterator.reset();
+      num_open_readers_--;
+    }
+    return;
+  }
+
+  HostContext* host = parent_dataset_->host_;
+  auto dataset = TakeRef(host->Construct<TFRecordDataset>(
+      paths[next_path_index_++], parent_dataset_->buffer_size_,
+      parent_dataset_->num_worker_threads_, host));
+  if (!reader->iterator) num_open_readers_++;
+  reader->iterator = dataset->MakeIterator();
+}
+
+void ShardedTFRecordDatasetIterator::FetchRecords(
+    const ExecutionContext& exec_ctx) {
+  auto output_buffer_size = OutputBufferSize();
+  if (num_open_readers_ == 0 || output_buffer_size == 0) return;
+
+  // Spread the requests over all the open readers, so that all the open files
+  // are read concurrently. In the deterministic order this is exactly the
+  // share of each reader, up to rounding.
+  auto fetch_num =
+      (output_buffer_size + num_open_readers_ - 1) / num_open_readers_;
+  for (FileReader& reader : readers_) {
+    if (!reader.iterator) continue;
+    while (reader.queue.size() < fetch_num)
+      reader.queue.push(reader.iterator->GetNext(exec_ctx));
+  }
+}
+
+SmallVector<RCReference<AsyncValue>, 4>
+ShardedTFRecordDatasetIterator::FillOutputValues(
+    const ExecutionContext& exec_ctx) {
+  auto output_buffer_size = OutputBufferSize();
+  while (output_buffer_size > 0) {
+    // All the files have reached end. Mark all values in the output_buffer_
+    // to be eof=true.
+    if (num_open_readers_ == 0) {
+      auto error =
+          exec_ctx.host()->MakeErrorAsyncValueRef("iterator reached end");
+      for (; output_buffer_size > 0; --output_buffer_size) {
+        auto output = DequeueOutputBuffer();
+        output.values[0]->SetError(error->GetError());
+        output.eof.emplace(true);
+      }
+      break;
+    }
+
+    // Find the reader to take the next record from. The eof of its record
+    // must be available to know whether the record is a value.
+    SmallVector<RCReference<AsyncValue>, 4> unavailable;
+    size_t index = reader_index_for_output_;
+    FileReader* reader = nullptr;
+    for (size_t i = 0; i < readers_.size();
+         ++i, index = (index + 1) % readers_.size()) {
+      FileReader& candidate = readers_[index];
+      if (!candidate.iterator) continue;
+      if (candidate.queue.empty())
+        candidate.queue.push(candidate.iterator->GetNext(exec_ctx));
+      auto& eof = candidate.queue.front().eof;
+      if (eof.IsAvailable()) {
+        reader = &candidate;
+        break;
+      }
+      unavailable.push_back(eof.CopyRCRef());
+      // In the deterministic order, only the first open reader can be taken
+      // from.
+      if (parent_dataset_->deterministic_) break;
+    }
+    if (reader == nullptr) return unavailable;
+    reader_index_for_output_ = index;
+
+    auto& next_result = reader->queue.front();
+    // The file has reached end. Open the next file at the same position, so
+    // that the order of the records does not depend on the timing of reads.
+    if (!next_result.eof.IsError() && next_result.eof.get()) {
+      OpenNextFile(reader);
+      continue;
+    }
+
+    auto output = DequeueOutputBuffer();
+    output_buffer_size--;
+    if (next_result.eof.IsError()) {
+      output.eof.SetError(next_result.eof.GetError());
+      output.values[0]->SetError(next_result.eof.GetError());
+    } else {
+      output.eof.emplace(false);
+      auto* output_value = cast<IndirectAsyncValue>(output.values[0].get());
+      output_value->ForwardTo(std::move(next_result.values[0]));
+    }
+    reader->queue.pop();
+    reader_index_for_output_ = (index + 1) % readers_.size();
+  }
+  return {};
+}
+
+void ShardedTFRecordDatasetIterator::MaybeScheduleBackgroundTask(
+    const ExecutionContext& exec_ctx, bool is_token_owner, int callback_count) {
+  {
+    mutex_lock lock(mu_);
+    // There is no more output value to update. Release the token if the caller
+    // owns the token and then return.
+    if (output_buffer_.empty()) {
+      if (is_token_owner) {
+        token_owned_ = false;
+      }
+      return;
+    }
+    // Return since the token is already owned by another thread.
+    if (!is_token_owner && token_owned_) return;
+    // Take the token if the thread does not already own the token.
+    token_owned_ = true;
+  }
+  // Only the thread that owns the token can execute the code below.
+
+  FetchRecords(exec_ctx);
+  auto unavailable = FillOutputValues(exec_ctx);
+  if (unavailable.empty()) {
+    // No state is kept in the stack due to tail recursion. Thus we don't need
+    // to increment the callback_count.
+    MaybeScheduleBackgroundTask(exec_ctx, true, callback_count);
+    return;
+  }
+
+  // Call MaybeScheduleBackgroundTask() again when the first of the values is
+  // available. The token is passed on to that callback only.
+  auto host = exec_ctx.host();
+  auto resumed = std::make_shared<std::atomic<bool>>(false);
+  for (auto& value : unavailable) {
+    value->AndThen([exec_ctx, host, callback_count, resumed,
+                    iterator = FormRef(this)]() mutable {
+      if (resumed->exchange(true)) return;
+      if (callback_count >= MAX_RECURSIVE_CALLS) {
+        host->EnqueueWork([exec_ctx, iterator = std::move(iterator)] {
+          iterator->MaybeScheduleBackgroundTask(exec_ctx, true, 0);
+        });
+      } else {
+        iterator->MaybeScheduleBackgroundTask(exec_ctx, true,
+                                              callback_count + 1);
+      }
+    });
+  }
+}
+
+}  // namespace data
+}  // namespace tfrt
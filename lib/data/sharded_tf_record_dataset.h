@@ -0,0 +1,187 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//===- sharded_tf_record_dataset.h ------------------------------*- C++ -*-===//
+//
+// This file declares ShardedTFRecordDataset class which reads the records of
+// multiple TFRecord files concurrently.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef TFRT_LIB_DATA_SHARDED_TF_RECORD_DATASET_H_
+#define TFRT_LIB_DATA_SHARDED_TF_RECORD_DATASET_H_
+
+#include <queue>
+#include <string>
+#include <vector>
+
+#include "dataset.h"
+#include "tfrt/support/forward_decls.h"
+#include "tfrt/support/mutex.h"
+#include "tfrt/support/thread_annotations.h"
+
+namespace tfrt {
+namespace data {
+
+class ShardedTFRecordDatasetIterator;
+
+// Expands `patterns`, a comma separated list of file paths and glob patterns,
+// into a list of files. The files matching a glob pattern are sorted, and
+// globs are only supported in the file name component of a path. Returns the
+// files whose index in the list is `shard_index` modulo `num_shards`, so that
+// data-parallel workers read disjoint sets of files.
+llvm::Expected<std::vector<std::string>> GetShardFiles(string_view patterns,
+                                                       int64_t num_shards,
+                                                       int64_t shard_index);
+
+// ShardedTFRecordDataset reads the records of a list of TFRecord files, with
+// `num_parallel_reads` files open at a time. Each open file is read by its own
+// TFRecordDatasetIterator, which prefetches its records on a blocking thread,
+// and the files are opened in the order of the list as the open files reach
+// their end.
+//
+// If `deterministic` is true, the records are taken from the open files in a
+// round robin order, so the order only depends on the files. Otherwise the
+// next record is taken from the first open file that has a record ready, so
+// that a slow file does not stall the pipeline.
+class ShardedTFRecordDataset : public Dataset {
+ public:
+  explicit ShardedTFRecordDataset(std::vector<std::string> paths,
+                                  int64_t num_parallel_reads,
+                                  bool deterministic, int64_t buffer_size,
+                                  int32_t num_worker_threads, HostContext* host)
+      : paths_(std::move(paths)),
+        num_parallel_reads_(num_parallel_reads),
+        deterministic_(deterministic),
+        buffer_size_(buffer_size),
+        num_worker_threads_(num_worker_threads),
+        host_(host),
+        allocator_(host->allocator()) {
+    assert(num_parallel_reads_ > 0);
+    assert(buffer_size_ >= 0);
+  }
+
+  // This class is not copyable or movable.
+  ShardedTFRecordDataset(const ShardedTFRecordDataset&) = delete;
+  ShardedTFRecordDataset& operator=(const ShardedTFRecordDataset&) = delete;
+
+  RCReference<Iterator> MakeIterator() override;
+
+ private:
+  // Allow iterator to rely on private data members of this dataset.
+  friend class ShardedTFRecordDatasetIterator;
+
+  void Destroy() override {
+    internal::DestroyImpl<ShardedTFRecordDataset>(this, allocator_);
+  }
+
+  const std::vector<std::string> paths_;
+  const int64_t num_parallel_reads_;
+  const bool deterministic_;
+  const int64_t buffer_size_;
+  const int32_t num_worker_threads_;
+  HostContext* host_;
+  HostAllocator* allocator_;
+};
+
+class ShardedTFRecordDatasetIterator : public Iterator {
+ public:
+  explicit ShardedTFRecordDatasetIterator(
+      RCReference<ShardedTFRecordDataset> parent_dataset);
+
+  // This class is not copyable or movable.
+  ShardedTFRecordDatasetIterator(const ShardedTFRecordDatasetIterator&) =
+      delete;
+  ShardedTFRecordDatasetIterator& operator=(
+      const ShardedTFRecordDatasetIterator&) = delete;
+
+  IterationResult GetNext(const ExecutionContext& exec_ctx) override;
+
+ private:
+  // An open file, and the records requested from it.
+  struct FileReader {
+    // The iterator of the file, or nullptr if the reader is closed.
+    RCReference<Iterator> iterator;
+    // The results of the GetNext() calls on the iterator, in order.
+    std::queue<IterationResult> queue;
+  };
+
+  void Destroy() override {
+    internal::DestroyImpl<ShardedTFRecordDatasetIterator>(
+        this, parent_dataset_->allocator_);
+  }
+
+  // Opens the next file of the list in `reader`, or closes the reader if all
+  // the files are opened.
+  void OpenNextFile(FileReader* reader);
+
+  // Requests records from the open readers, so that each reader has its share
+  // of the values in the output_buffer_ in flight.
+  void FetchRecords(const ExecutionContext& exec_ctx);
+
+  // Forwards the requested records to the values in the output_buffer_ in the
+  // order of the dataset, until the output_buffer_ is empty. Returns the
+  // unavailable eofs of the records that stop this method from forwarding
+  // more records, any of which can unblock it: the record of the next reader
+  // in the deterministic order, or the records at the front of all the open
+  // readers otherwise. Returns an empty vector if the output_buffer_ is empty.
+  SmallVector<RCReference<AsyncValue>, 4> FillOutputValues(
+      const ExecutionContext& exec_ctx) TFRT_EXCLUDES(mu_);
+
+  // Like InterleaveDatasetIterator::MaybeScheduleBackgroundTask(), ensures
+  // that only the token owner runs FetchRecords() and FillOutputValues().
+  void MaybeScheduleBackgroundTask(const ExecutionContext& exec_ctx,
+                                   bool is_token_owner, int callback_count)
+      TFRT_EXCLUDES(mu_);
+
+  int OutputBufferSize() TFRT_EXCLUDES(mu_) {
+    mutex_lock lock(mu_);
+    return output_buffer_.size();
+  }
+
+  IterationResult DequeueOutputBuffer() TFRT_EXCLUDES(mu_) {
+    mutex_lock lock(mu_);
+    assert(!output_buffer_.empty());
+    auto value = std::move(output_buffer_.front());
+    output_buffer_.pop();
+    return value;
+  }
+
+  RCReference<ShardedTFRecordDataset> parent_dataset_;
+
+  // The readers of the open files. Only the token owner accesses them.
+  std::vector<FileReader> readers_;
+  // The number of readers that are not closed.
+  size_t num_open_readers_ = 0;
+  // The index in parent_dataset_->paths_ of the next file to open.
+  size_t next_path_index_ = 0;
+  // readers_[reader_index_for_output_] is the first reader to take the next
+  // record from.
+  size_t reader_index_for_output_ = 0;
+
+  mutex mu_;
+  // A queue of IterationResult that have already been returned to the
+  // GetNext(...) caller.
+  std::queue<IterationResult> output_buffer_ TFRT_GUARDED_BY(mu_);
+  // This is a unique logical token for this iterator instance, see
+  // InterleaveDatasetIterator::token_owned_.
+  bool token_owned_ TFRT_GUARDED_BY(mu_) = false;
+};
+
+}  // namespace data
+}  // namespace tfrt
+
+#endif  // TFRT_LIB_DATA_SHARDED_TF_RECORD_DATASET_H_
@@ -0,0 +1,208 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//===- shuffle_dataset.cc ---------------------------------------*- C++ -*-===//
+//
+// This file implements ShuffleDataset class which wraps around another Dataset
+// instance and shuffles its elements with a bounded buffer.
+//
+//===----------------------------------------------------------------------===//
+
+#include "shuffle_dataset.h"
+
+namespace tfrt {
+namespace data {
+
+//===----------------------------------------------------------------------===//
+// ShuffleDataset methods
+//===----------------------------------------------------------------------===//
+RCReference<Iterator> ShuffleDataset::MakeIterator() {
+  uint64_t iteration = reshuffle_each_iteration_ ? num_iterations_++ : 0;
+  return TakeRef(
+      host_->Construct<ShuffleDatasetIterator>(FormRef(this), iteration));
+}
+
+//===----------------------------------------------------------------------===//
+// ShuffleDatasetIterator methods
+//===----------------------------------------------------------------------===//
+ShuffleDatasetIterator::ShuffleDatasetIterator(
+    RCReference<ShuffleDataset> parent_dataset, uint64_t iteration)
+    : Iterator(),
+      parent_dataset_(std::move(parent_dataset)),
+      input_iterator_(parent_dataset_->input_dataset_->MakeIterator()) {
+  const uint64_t seed = parent_dataset_->seed_;
+  std::seed_seq seed_seq{static_cast<uint32_t>(seed),
+                         static_cast<uint32_t>(seed >> 32),
+                         static_cast<uint32_t>(iteration),
+                         static_cast<uint32_t>(iteration >> 32)};
+  random_.seed(seed_seq);
+  shuffle_buffer_.reserve(parent_dataset_->buffer_size_);
+}
+
+IterationResult ShuffleDatasetIterator::GetNext(
+    const ExecutionContext& exec_ctx) {
+  auto* host = exec_ctx.host();
+  // Initialize arity_ using the first value from the input_iterator_.
+  if (arity_ < 0) {
+    mutex_lock lock(mu_);
+    assert(!token_owned_);
+    auto input = input_iterator_->GetNext(exec_ctx);
+    arity_ = input.values.size();
+    input_buffer_.push(std::move(input));
+  }
+
+  llvm::SmallVector<RCReference<AsyncValue>, 4> result_values;
+  result_values.resize(arity_);
+  for (size_t i = 0; i < arity_; ++i) {
+    result_values[i] = host->MakeIndirectAsyncValue();
+  }
+  auto result_eof = host->MakeUnconstructedAsyncValueRef<bool>();
+  auto result =
+      IterationResult::Pending(std::move(result_values), std::move(result_eof));
+  {
+    mutex_lock lock(mu_);
+    output_buffer_.push(result.CopyRef());
+  }
+
+  MaybeScheduleBackgroundTask(exec_ctx, false, 0);
+  return result;
+}
+
+void ShuffleDatasetIterator::MaybeScheduleBackgroundTask(
+    const ExecutionContext& exec_ctx, bool is_token_owner, int callback_count) {
+  {
+    mutex_lock lock(mu_);
+    // There is no more output value to update. Release the token if the caller
+    // owns the token and then return.
+    if (output_buffer_.empty()) {
+      if (is_token_owner) {
+        token_owned_ = false;
+      }
+      return;
+    }
+    // Return since the token is already owned by another thread.
+    if (!is_token_owner && token_owned_) return;
+    // Take the token if the thread does not already own the token.
+    token_owned_ = true;
+  }
+  // Only the thread that owns the token can execute the code below.
+
+  auto host = exec_ctx.host();
+  const size_t buffer_size = parent_dataset_->buffer_size_;
+  while (true) {
+    // Keep enough input elements requested to fill the shuffle buffer and to
+    // replace the elements taken by the outputs. The input elements are
+    // requested without waiting for them, so the buffer fills asynchronously.
+    if (!reached_eof_) {
+      int64_t input_fetch_num =
+          static_cast<int64_t>(buffer_size + OutputBufferSize()) -
+          shuffle_buffer_.size() - input_buffer_.size();
+      for (int64_t i = 0; i < input_fetch_num; i++) {
+        auto input = input_iterator_->GetNext(exec_ctx);
+        assert(arity_ == input.values.size());
+        input_buffer_.push(std::move(input));
+      }
+    }
+    HandleAvailableInputs();
+
+    // Fill the outputs with random elements of the shuffle buffer, refilling
+    // the buffer after each element taken. Only the eofs of the elements are
+    // known, their values are forwarded as they are.
+    auto output_buffer_size = OutputBufferSize();
+    while (output_buffer_size > 0 &&
+           (shuffle_buffer_.size() == buffer_size ||
+            (reached_eof_ && !shuffle_buffer_.empty()))) {
+      std::uniform_int_distribution<size_t> distribution(
+          0, shuffle_buffer_.size() - 1);
+      std::swap(shuffle_buffer_[distribution(random_)], shuffle_buffer_.back());
+      auto element = std::move(shuffle_buffer_.back());
+      shuffle_buffer_.pop_back();
+
+      auto output = DequeueOutputBuffer();
+      output_buffer_size--;
+      for (int i = 0; i < arity_; ++i) {
+        auto* output_value = cast<IndirectAsyncValue>(output.values[i].get());
+        output_value->ForwardTo(std::move(element.values[i]));
+      }
+      if (element.eof.IsError()) {
+        output.eof.SetError(element.eof.GetError());
+      } else {
+        output.eof.emplace(false);
+      }
+      HandleAvailableInputs();
+    }
+
+    // The input_iterator_ has been exhausted and all the elements are taken.
+    if (reached_eof_ && shuffle_buffer_.empty()) {
+      auto error = host->MakeErrorAsyncValueRef("iterator reached end");
+      for (; output_buffer_size > 0; --output_buffer_size) {
+        auto output = DequeueOutputBuffer();
+        for (auto& value : output.values) {
+          value->SetError(error->GetError());
+        }
+        output.eof.emplace(true);
+      }
+    }
+
+    if (output_buffer_size == 0 || reached_eof_) {
+      // Call the function again because the output_buffer_ might have more
+      // values now. No state is kept in the stack due to tail recursion. Thus
+      // we don't need to increment the callback_count.
+      MaybeScheduleBackgroundTask(exec_ctx, true, callback_count);
+      return;
+    }
+    // The outputs wait for the next input element. Otherwise all the input
+    // elements were available, and more can be requested right away.
+    if (!input_buffer_.empty()) break;
+  }
+
+  // After the first value in the `input_buffer_` becomes available, the token
+  // owner should handle it, then call MaybeScheduleBackgroundTask() again to
+  // fill more outputs.
+  auto* input_eof_ptr = input_buffer_.front().eof.GetAsyncValue();
+  input_eof_ptr->AndThen([exec_ctx, host, callback_count,
+                          iterator = FormRef(this)]() mutable {
+    if (callback_count >= MAX_RECURSIVE_CALLS) {
+      host->EnqueueWork([exec_ctx, iterator = std::move(iterator)] {
+        iterator->MaybeScheduleBackgroundTask(exec_ctx, true, 0);
+      });
+    } else {
+      iterator->MaybeScheduleBackgroundTask(exec_ctx, true, callback_count + 1);
+    }
+  });
+}
+
+void ShuffleDatasetIterator::HandleAvailableInputs() {
+  while (!input_buffer_.empty() &&
+         shuffle_buffer_.size() <
+             static_cast<size_t>(parent_dataset_->buffer_size_) &&
+         input_buffer_.front().eof.IsAvailable()) {
+    auto input = std::move(input_buffer_.front());
+    input_buffer_.pop();
+    if (!input.eof.IsError() && input.eof.get()) {
+      reached_eof_ = true;
+      // All the remaining elements in the buffer must be EOF because they come
+      // from the exhausted iterator. Therefore we can clear the buffer.
+      input_buffer_ = {};
+      return;
+    }
+    // Errors are shuffled like values, and returned to a random output.
+    shuffle_buffer_.push_back(std::move(input));
+  }
+}
+
+}  // namespace data
+}  // namespace tfrt
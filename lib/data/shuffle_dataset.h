@@ -0,0 +1,163 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//===- shuffle_dataset.h ----------------------------------------*- C++ -*-===//
+//
+// This file declares ShuffleDataset class which wraps around another Dataset
+// instance and shuffles its elements with a bounded buffer.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef TFRT_LIB_DATA_SHUFFLE_DATASET_H_
+#define TFRT_LIB_DATA_SHUFFLE_DATASET_H_
+
+#include <atomic>
+#include <queue>
+#include <random>
+#include <vector>
+
+#include "dataset.h"
+#include "tfrt/support/forward_decls.h"
+#include "tfrt/support/mutex.h"
+#include "tfrt/support/thread_annotations.h"
+
+namespace tfrt {
+namespace data {
+
+class ShuffleDatasetIterator;
+
+// ShuffleDataset keeps a buffer of `buffer_size` elements of its input
+// dataset, and returns a random element of the buffer for each GetNext(...),
+// which is replaced by the next input element. The elements are moved around
+// as references to their values, so the values are not copied and don't need
+// to be available to be shuffled.
+//
+// The order is decided by `seed`. If `reshuffle_each_iteration` is true, each
+// iterator of the dataset (e.g. each epoch of a RepeatDataset over it) uses a
+// different order derived from the seed, otherwise all the iterators use the
+// same order.
+class ShuffleDataset : public Dataset {
+ public:
+  explicit ShuffleDataset(RCReference<Dataset> input_dataset,
+                          int64_t buffer_size, uint64_t seed,
+                          bool reshuffle_each_iteration, HostContext* host)
+      : input_dataset_(std::move(input_dataset)),
+        buffer_size_(buffer_size),
+        seed_(seed),
+        reshuffle_each_iteration_(reshuffle_each_iteration),
+        host_(host),
+        allocator_(host->allocator()) {
+    assert(buffer_size_ > 0);
+  }
+
+  // This class is not copyable or movable.
+  ShuffleDataset(const ShuffleDataset&) = delete;
+  ShuffleDataset& operator=(const ShuffleDataset&) = delete;
+
+  RCReference<Iterator> MakeIterator() override;
+
+ private:
+  // Allow iterator to rely on private data members of this dataset.
+  friend class ShuffleDatasetIterator;
+
+  void Destroy() override {
+    internal::DestroyImpl<ShuffleDataset>(this, allocator_);
+  }
+
+  RCReference<Dataset> input_dataset_;
+  const int64_t buffer_size_;
+  const uint64_t seed_;
+  const bool reshuffle_each_iteration_;
+  // The number of iterators made, which seeds the order of the next iterator
+  // if reshuffle_each_iteration_ is true.
+  std::atomic<uint64_t> num_iterations_{0};
+  HostContext* host_;
+  HostAllocator* allocator_;
+};
+
+class ShuffleDatasetIterator : public Iterator {
+ public:
+  explicit ShuffleDatasetIterator(RCReference<ShuffleDataset> parent_dataset,
+                                  uint64_t iteration);
+
+  // This class is not copyable or movable.
+  ShuffleDatasetIterator(const ShuffleDatasetIterator&) = delete;
+  ShuffleDatasetIterator& operator=(const ShuffleDatasetIterator&) = delete;
+
+  IterationResult GetNext(const ExecutionContext& exec_ctx) override;
+
+ private:
+  void Destroy() override {
+    internal::DestroyImpl<ShuffleDatasetIterator>(this,
+                                                  parent_dataset_->allocator_);
+  }
+
+  // Like RepeatDatasetIterator::MaybeScheduleBackgroundTask(), ensures that
+  // only the token owner accesses the input_iterator_ and the shuffle buffer.
+  //
+  // The token owner requests input elements to fill the shuffle buffer, moves
+  // the input elements whose eof is available into the buffer, and fills the
+  // outputs with random elements of the buffer while the buffer is full, or
+  // while it is not empty after the end of the input. When it has to wait for
+  // an input element, it calls itself again when the element is available.
+  void MaybeScheduleBackgroundTask(const ExecutionContext& exec_ctx,
+                                   bool is_token_owner, int callback_count)
+      TFRT_EXCLUDES(mu_);
+
+  // Moves the input elements whose eof is available from the input_buffer_ to
+  // the shuffle_buffer_, until the shuffle_buffer_ is full.
+  void HandleAvailableInputs() TFRT_EXCLUDES(mu_);
+
+  int OutputBufferSize() TFRT_EXCLUDES(mu_) {
+    mutex_lock lock(mu_);
+    return output_buffer_.size();
+  }
+
+  IterationResult DequeueOutputBuffer() TFRT_EXCLUDES(mu_) {
+    mutex_lock lock(mu_);
+    assert(!output_buffer_.empty());
+    auto value = std::move(output_buffer_.front());
+    output_buffer_.pop();
+    return value;
+  }
+
+  RCReference<ShuffleDataset> parent_dataset_;
+  RCReference<Iterator> input_iterator_;
+
+  // The state below is only accessed by the token owner.
+  int arity_ = -1;
+  // The elements requested from the input_iterator_ whose eof is not handled
+  // yet, in order.
+  std::queue<IterationResult> input_buffer_;
+  // The input elements to pick the outputs from. Their eof is false or an
+  // error.
+  std::vector<IterationResult> shuffle_buffer_;
+  bool reached_eof_ = false;
+  std::mt19937_64 random_;
+
+  mutex mu_;
+  // A queue of IterationResult that have already been returned to the
+  // GetNext(...) caller.
+  std::queue<IterationResult> output_buffer_ TFRT_GUARDED_BY(mu_);
+  // This is a unique logical token for this iterator instance, see
+  // RepeatDatasetIterator::token_owned_.
+  bool token_owned_ TFRT_GUARDED_BY(mu_) = false;
+};
+
+}  // namespace data
+}  // namespace tfrt
+
+#endif  // TFRT_LIB_DATA_SHUFFLE_DATASET_H_
@@ -15,12 +15,14 @@
 //===- tf_record_dataset.cc -----------------------------------------------===//
 //
 // This file implements TFRecordDataset class which reads records from TFRecord
-// files into strings.
+// files into strings, or into slices of the memory-mapped file.
 //
 //===----------------------------------------------------------------------===//
 
 #include "tf_record_dataset.h"
 
+#include <limits>
+
 #include "tfrt/support/crc32c.h"
 #include "tfrt/support/error_util.h"
 #include "tfrt/support/raw_coding.h"
@@ -28,6 +30,9 @@
 namespace tfrt {
 namespace data {
 
+// The number of buffer_size chunks that are read ahead of the parsed records.
+static constexpr int kNumReadaheadChunks = 4;
+
 //===----------------------------------------------------------------------===//
 // Implementation for TFRecordDataset member functions
 //===----------------------------------------------------------------------===//
@@ -39,25 +44,70 @@ RCReference<Iterator> TFRecordDataset::MakeIterator() {
 //===----------------------------------------------------------------------===//
 // Implementation for TFRecordDatasetIterator member functions
 //===----------------------------------------------------------------------===//
+TFRecordDatasetIterator::TFRecordDatasetIterator(
+    RCReference<TFRecordDataset> parent_dataset)
+    : io::PrefetchingIterator(parent_dataset->num_worker_threads_),
+      parent_dataset_(std::move(parent_dataset)) {
+  if (parent_dataset_->memory_mapped_) {
+    auto stream = MappedFileInputStream::Open(parent_dataset_->path_);
+    if (!stream) {
+      open_error_ = StrCat(stream.takeError());
+      return;
+    }
+    mapped_stream_ = stream->get();
+    stream_ = std::move(*stream);
+    return;
+  }
+
+  if (parent_dataset_->buffer_size_ == 0) {
+    stream_ = std::make_unique<FileInputStream>(parent_dataset_->path_);
+    return;
+  }
+
+  // Read the file in buffer_size chunks, a few of them ahead of the records
+  // being parsed.
+  auto stream = AsyncFileInputStream::Open(
+      parent_dataset_->path_, parent_dataset_->buffer_size_,
+      kNumReadaheadChunks, AsyncFileReader::GetDefault(),
+      parent_dataset_->host_);
+  if (!stream) {
+    open_error_ = StrCat(stream.takeError());
+    return;
+  }
+  stream_ = std::move(*stream);
+}
+
 IterationResult TFRecordDatasetIterator::GetNextElement(
     const ExecutionContext& exec_ctx) {
   HostContext* host = exec_ctx.host();
-  bool eof = false;
-  auto result = ReadRecord(&eof);
-
-  if (eof) {
-    return IterationResult::Eof(host, 1);
-  }
-  if (!result) {
-    // Do not decode location or emit error because the local handler might have
-    // been freed.
-    auto error = host->MakeErrorAsyncValueRef(StrCat(result.takeError()));
-    return IterationResult::Error(std::move(error), 1);
+  // Do not decode location or emit errors because the local handler might have
+  // been freed.
+  if (open_error_.hasValue()) {
+    return IterationResult::Error(host->MakeErrorAsyncValueRef(*open_error_),
+                                  1);
   }
 
+  bool eof = false;
   llvm::SmallVector<RCReference<AsyncValue>, 4> values;
-  values.push_back(
-      host->MakeAvailableAsyncValueRef<std::string>(std::move(*result)));
+  if (mapped_stream_) {
+    auto result = ReadRecordInPlace(&eof);
+    if (eof) return IterationResult::Eof(host, 1);
+    if (!result) {
+      auto error = host->MakeErrorAsyncValueRef(StrCat(result.takeError()));
+      return IterationResult::Error(std::move(error), 1);
+    }
+    values.push_back(host->MakeAvailableAsyncValueRef<RCReference<HostBuffer>>(
+        std::move(*result)));
+  } else {
+    auto result = ReadRecord(&eof);
+    if (eof) return IterationResult::Eof(host, 1);
+    if (!result) {
+      auto error = host->MakeErrorAsyncValueRef(StrCat(result.takeError()));
+      return IterationResult::Error(std::move(error), 1);
+    }
+    values.push_back(
+        host->MakeAvailableAsyncValueRef<std::string>(std::move(*result)));
+  }
   return IterationResult::Values(std::move(values), host);
 }
 
@@ -66,9 +116,14 @@ IterationResult TFRecordDatasetIterator::GetNextElement(
 // ifstream reading sequentially.
 llvm::Expected<std::string> TFRecordDatasetIterator::ReadChecksummed(
     size_t pos, size_t n, bool* eof) {
-  // The crc has size uint32.
-  const size_t count = n + sizeof(uint32_t);
   *eof = false;
+  // The crc has size uint32. `n` is read from the file, and a length which
+  // would overflow is reported like any record longer than the file.
+  if (n > std::numeric_limits<size_t>::max() - sizeof(uint32_t)) {
+    *eof = true;
+    return MakeStringError("end of file");
+  }
+  const size_t count = n + sizeof(uint32_t);
 
   std::string result;
   result.clear();
@@ -91,6 +146,30 @@ llvm::Expected<std::string> TFRecordDatasetIterator::ReadChecksummed(
   return result;
 }
 
+llvm::Expected<ArrayRef<char>> TFRecordDatasetIterator::ReadChecksummedInPlace(
+    size_t pos, size_t n, bool* eof) {
+  *eof = false;
+  auto stream_pos = mapped_stream_->Tell();
+  if (!stream_pos) return stream_pos.takeError();
+
+  // The crc has size uint32. `n` is read from the file, so it is checked
+  // against the remaining bytes before the size of the crc is added to it.
+  const size_t remaining = mapped_stream_->buffer()->size() - *stream_pos;
+  if (remaining < sizeof(uint32_t) || n > remaining - sizeof(uint32_t)) {
+    mapped_stream_->ReadInPlace(remaining);
+    *eof = true;
+    return MakeStringError("end of file");
+  }
+
+  ArrayRef<char> bytes = mapped_stream_->ReadInPlace(n + sizeof(uint32_t));
+  const uint32_t masked_crc = DecodeFixed32(bytes.data() + n);
+  if (crc32c::Unmask(masked_crc) != crc32c::Value(bytes.data(), n)) {
+    return MakeStringError("data corruption at position ", pos);
+  }
+
+  return bytes.take_front(n);
+}
+
 llvm::Expected<std::string> TFRecordDatasetIterator::ReadRecord(bool* eof) {
   *eof = false;
   auto pos = stream_->Tell();
@@ -110,5 +189,30 @@ llvm::Expected<std::string> TFRecordDatasetIterator::ReadRecord(bool* eof) {
   return body;
 }
 
+llvm::Expected<RCReference<HostBuffer>>
+TFRecordDatasetIterator::ReadRecordInPlace(bool* eof) {
+  *eof = false;
+  auto pos = mapped_stream_->Tell();
+  if (!pos) return pos.takeError();
+
+  // Read header.
+  auto header = ReadChecksummedInPlace(*pos, sizeof(uint64_t), eof);
+  if (!header) return header.takeError();
+  const uint64_t length = DecodeFixed64(header->data());
+
+  // Read body.
+  auto body = ReadChecksummedInPlace(*pos, length, eof);
+  if (*eof) {
+    *eof = false;
+    return MakeStringError("truncated record at position ", *pos);
+  }
+  if (!body) return body.takeError();
+
+  const RCReference<HostBuffer>& buffer = mapped_stream_->buffer();
+  const size_t offset =
+      body->data() - static_cast<const char*>(buffer->data());
+  return HostBuffer::CreateFromExternal(buffer.CopyRef(), offset, body->size());
+}
+
 }  // namespace data
 }  // namespace tfrt
@@ -17,7 +17,7 @@
 //===- tf_record_dataset.h --------------------------------------*- C++ -*-===//
 //
 // This file declares TFRecordDataset class which reads records from TFRecord
-// files into strings.
+// files into strings, or into slices of the memory-mapped file.
 //
 //===----------------------------------------------------------------------===//
 
@@ -26,30 +26,41 @@
 
 #include "dataset.h"
 #include "io.h"
-#include "tfrt/io/buffered_input_stream.h"
+#include "tfrt/io/async_file_input_stream.h"
+#include "tfrt/io/async_file_reader.h"
 #include "tfrt/io/file_input_stream.h"
+#include "tfrt/io/mapped_file_input_stream.h"
 #include "tfrt/support/forward_decls.h"
 
 namespace tfrt {
 namespace data {
 
-using ::tfrt::io::BufferedInputStream;
+using ::tfrt::io::AsyncFileInputStream;
+using ::tfrt::io::AsyncFileReader;
 using ::tfrt::io::FileInputStream;
 using ::tfrt::io::InputStream;
+using ::tfrt::io::MappedFileInputStream;
 
 // TFRecordDataset reads TFRecord bytes from a file.
 //
-// TODO(rachelim): Consider using a custom data type to represent the
-// bytes read from a TFRecord file. This will make the code more type safe
-// and allow for future optimizations to use mmap instead of copying bytes
-// from the file onto the heap.
+// By default the records are copied into std::string elements. The file is
+// read in `buffer_size` chunks by an AsyncFileInputStream, which keeps a few
+// chunk reads in flight ahead of the records being parsed, so the blocking
+// threads of the PrefetchingIterator rarely wait for the disk. If
+// `memory_mapped` is true, the file is memory-mapped instead and each record is
+// an RCReference<HostBuffer> slice of the mapping: the record bytes are not
+// copied, and their checksums are verified in place. Large files are better
+// read this way, because the pages of the mapping are backed by the page cache
+// rather than by the process heap.
 class TFRecordDataset : public Dataset {
  public:
   explicit TFRecordDataset(std::string path, int64_t buffer_size,
-                           int32_t num_worker_threads, HostContext* host)
+                           int32_t num_worker_threads, HostContext* host,
+                           bool memory_mapped = false)
       : path_(std::move(path)),
         buffer_size_(buffer_size),
         num_worker_threads_(num_worker_threads),
+        memory_mapped_(memory_mapped),
         host_(host),
         allocator_(host->allocator()) {
     assert(buffer_size_ >= 0);
@@ -71,22 +82,15 @@ class TFRecordDataset : public Dataset {
   const std::string path_;
   const int64_t buffer_size_;
   const int32_t num_worker_threads_;
+  const bool memory_mapped_;
   HostContext* host_;
   HostAllocator* allocator_;
 };
 
 class TFRecordDatasetIterator : public io::PrefetchingIterator {
  public:
-  explicit TFRecordDatasetIterator(RCReference<TFRecordDataset> parent_dataset)
-      : io::PrefetchingIterator(parent_dataset->num_worker_threads_),
-        parent_dataset_(std::move(parent_dataset)),
-        stream_(new FileInputStream(parent_dataset_->path_.c_str())) {
-    if (parent_dataset_->buffer_size_ > 0) {
-      stream_ = std::make_unique<BufferedInputStream>(
-          std::move(stream_), parent_dataset_->buffer_size_,
-          parent_dataset_->allocator_);
-    }
-  }
+  explicit TFRecordDatasetIterator(
+      RCReference<TFRecordDataset> parent_dataset);
 
   // This class is not copyable or movable.
   TFRecordDatasetIterator(const TFRecordDatasetIterator&) = delete;
@@ -113,6 +117,11 @@ class TFRecordDatasetIterator : public io::PrefetchingIterator {
   // If eof is set to true, caller should not process the return value.
   llvm::Expected<std::string> ReadChecksummed(size_t pos, size_t n, bool* eof);
 
+  // Same as ReadChecksummed(), but returns the bytes in place in the mapped
+  // file.
+  llvm::Expected<ArrayRef<char>> ReadChecksummedInPlace(size_t pos, size_t n,
+                                                        bool* eof);
+
   // Reads a record from the input stream and advances the input stream to point
   // to the start of the next record. Updates *eof to true iff stream_ is
   // already at the end of file and there is no error. Otherwise, returns the
@@ -120,8 +129,15 @@ class TFRecordDatasetIterator : public io::PrefetchingIterator {
   // return value.
   llvm::Expected<std::string> ReadRecord(bool* eof);
 
+  // Same as ReadRecord(), but returns the record as a slice of the mapped file.
+  llvm::Expected<RCReference<HostBuffer>> ReadRecordInPlace(bool* eof);
+
   RCReference<TFRecordDataset> parent_dataset_;
   std::unique_ptr<InputStream> stream_;
+  // Points to `stream_` if the file is memory-mapped.
+  MappedFileInputStream* mapped_stream_ = nullptr;
+  // The error of opening the file, reported by the first GetNextElement().
+  llvm::Optional<std::string> open_error_;
 };
 
 }  // namespace data
@@ -0,0 +1,119 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+//===- arena_allocator.cc - Request-scoped Arena Allocator ----------------===//
+//
+// This file implements ArenaAllocator.
+//
+//===----------------------------------------------------------------------===//
+
+#include "tfrt/host_context/arena_allocator.h"
+
+#include <cassert>
+#include <new>
+
+#include "llvm/Support/MathExtras.h"
+
+namespace tfrt {
+
+namespace {
+// All allocations are carved at offsets that are multiples of this, so that
+// only larger alignments need padding.
+constexpr size_t kMinAlignment = 16;
+}  // namespace
+
+thread_local ArenaAllocator* ArenaAllocator::current_ = nullptr;
+
+ArenaAllocator::ArenaAllocator(HostAllocator* fallback) : fallback_(fallback) {
+  static_assert(llvm::isPowerOf2_64(kBlockSize),
+                "FromPointer requires a power of two block size");
+  AddBlock(nullptr);
+}
+
+ArenaAllocator::~ArenaAllocator() {
+  mutex_lock lock(mu_);
+  while (blocks_) {
+    Block* next = blocks_->next;
+    blocks_->~Block();
+    fallback_->DeallocateBytes(blocks_, kBlockSize);
+    blocks_ = next;
+  }
+}
+
+bool ArenaAllocator::AddBlock(Block* full_block) {
+  mutex_lock lock(mu_);
+  // Another thread has replaced the full block while we were waiting.
+  if (current_block_.load(std::memory_order_relaxed) != full_block) return true;
+
+  void* buffer = fallback_->AllocateBytes(kBlockSize, kBlockSize);
+  if (buffer == nullptr) return false;
+
+  auto* block = new (buffer) Block;
+  block->arena = this;
+  block->next = blocks_;
+  block->offset.store(llvm::alignTo(sizeof(Block), kMinAlignment),
+                      std::memory_order_relaxed);
+  blocks_ = block;
+  current_block_.store(block, std::memory_order_release);
+  return true;
+}
+
+void* ArenaAllocator::TryAllocateBytes(size_t size, size_t alignment) {
+  if (size > kMaxAllocationSize) return nullptr;
+  assert(alignment <= kMaxAllocationSize && "unsupported alignment");
+
+  // Reserve enough space to align the allocation within the reserved range.
+  size_t reserved_size = llvm::alignTo(size, kMinAlignment);
+  if (alignment > kMinAlignment) reserved_size += alignment - kMinAlignment;
+
+  while (true) {
+    Block* block = current_block_.load(std::memory_order_acquire);
+    if (block == nullptr) {
+      if (!AddBlock(nullptr)) return nullptr;
+      continue;
+    }
+
+    size_t offset =
+        block->offset.fetch_add(reserved_size, std::memory_order_relaxed);
+    if (offset + reserved_size <= kBlockSize) {
+      // Released by DeallocateBytes.
+      AddRef();
+      auto address = reinterpret_cast<uintptr_t>(block) + offset;
+      return reinterpret_cast<void*>(llvm::alignTo(address, alignment));
+    }
+
+    // The block is full. Further allocations from it will also fail, so we
+    // don't need to undo the fetch_add.
+    if (!AddBlock(block)) return nullptr;
+  }
+}
+
+void* ArenaAllocator::AllocateBytes(size_t size, size_t alignment) {
+  if (size > kMaxAllocationSize)
+    return fallback_->AllocateBytes(size, alignment);
+  return TryAllocateBytes(size, alignment);
+}
+
+void ArenaAllocator::DeallocateBytes(void* ptr, size_t size) {
+  if (size > kMaxAllocationSize) {
+    fallback_->DeallocateBytes(ptr, size);
+    return;
+  }
+  assert(FromPointer(ptr) == this && "pointer is not owned by this arena");
+  // This might destroy the arena if the owner has already dropped its
+  // reference.
+  DropRef();
+}
+
+}  // namespace tfrt
@@ -21,10 +21,12 @@
 #include "tfrt/host_context/async_value.h"
 
 #include "llvm/ADT/FunctionExtras.h"
+#include "tfrt/host_context/arena_allocator.h"
 #include "tfrt/host_context/function.h"
 #include "tfrt/host_context/host_context.h"
 #include "tfrt/support/concurrent_vector.h"
 #include "tfrt/support/string_util.h"
+#include "tfrt/tracing/tracing.h"
 
 namespace tfrt {
 
@@ -41,6 +43,9 @@ class NotifierListNode {
   // This is the next thing waiting on the AsyncValue.
   NotifierListNode* next_;
   llvm::unique_function<void()> notification_;
+  // True if the node is allocated from the arena of its AsyncValue, otherwise
+  // it is allocated from the HostContext.
+  bool is_arena_allocated_ = false;
 };
 
 /*static*/ uint16_t AsyncValue::CreateTypeInfoAndReturnTypeIdImpl(
@@ -71,17 +76,25 @@ const AsyncValue::TypeInfo& AsyncValue::GetTypeInfo() const {
 }
 
 void AsyncValue::Destroy() {
+  // Read the allocation source before the destructor runs.
+  ArenaAllocator* arena =
+      is_arena_allocated_ ? ArenaAllocator::FromPointer(this) : nullptr;
+
+  size_t size;
   if (kind() == Kind::kIndirect) {
     // Depending on what the benchmarks say, it might make sense to remove this
     // explicit check and instead make ~IndirectAsyncValue go through the
     // GetTypeInfo().destructor case below.
     static_cast<IndirectAsyncValue*>(this)->~IndirectAsyncValue();
-    GetHostContext()->DeallocateBytes(this, sizeof(IndirectAsyncValue));
-    return;
+    size = sizeof(IndirectAsyncValue);
+  } else {
+    size = GetTypeInfo().destructor(this, /*destroys_object=*/true);
   }
 
-  auto size = GetTypeInfo().destructor(this, /*destroys_object=*/true);
-  GetHostContext()->DeallocateBytes(this, size);
+  if (arena)
+    arena->DeallocateBytes(this, size);
+  else
+    GetHostContext()->DeallocateBytes(this, size);
 }
 
 // This is called when the value is set into the ConcreteAsyncValue buffer, or
@@ -113,7 +126,15 @@ void AsyncValue::RunWaiters(NotifierListNode* list) {
     // check atomic state again.
     node->notification_();
     list = node->next_;
-    host->Destruct(node);
+    // Waiter nodes of an arena allocated value usually come from the same
+    // arena. See EnqueueWaiter().
+    if (node->is_arena_allocated_) {
+      ArenaAllocator* arena = ArenaAllocator::FromPointer(node);
+      node->~NotifierListNode();
+      arena->Deallocate(node);
+    } else {
+      host->Destruct(node);
+    }
   }
 }
 
@@ -122,8 +143,29 @@ void AsyncValue::RunWaiters(NotifierListNode* list) {
 // called when the value becomes available.
 void AsyncValue::EnqueueWaiter(llvm::unique_function<void()>&& waiter,
                                WaitersAndState old_value) {
-  // Create the node for our waiter.
-  auto* node = GetHostContext()->Construct<NotifierListNode>(std::move(waiter));
+  // The waiter of a sampled request is traced on the thread that runs it.
+  if (uint64_t tracing_request_id = tracing::GetTracingRequestId()) {
+    waiter = [tracing_request_id, waiter = std::move(waiter)]() mutable {
+      tracing::ScopedTracingRequest tracing_request(tracing_request_id);
+      waiter();
+    };
+  }
+
+  // Create the node for our waiter, from the arena of this value if it has
+  // one and it is not exhausted. The node holds a reference to the arena
+  // through its allocation, so the arena outlives the node even if this value
+  // is destroyed by the waiter.
+  NotifierListNode* node = nullptr;
+  if (is_arena_allocated_) {
+    if (void* buf = ArenaAllocator::FromPointer(this)->TryAllocateBytes(
+            sizeof(NotifierListNode), alignof(NotifierListNode))) {
+      node = new (buf) NotifierListNode(std::move(waiter));
+      node->is_arena_allocated_ = true;
+    }
+  }
+  if (!node) {
+    node = GetHostContext()->Construct<NotifierListNode>(std::move(waiter));
+  }
   auto old_state = old_value.getInt();
 
   // Swap the next link in. old_value.getInt() must be unavailable when
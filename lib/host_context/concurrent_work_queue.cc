@@ -40,6 +40,8 @@ WorkQueueFactoryMap* GetWorkQueueFactories() {
 
 }  // namespace
 
+thread_local TaskPriority ScopedTaskPriority::current_ = TaskPriority::kDefault;
+
 ConcurrentWorkQueue::~ConcurrentWorkQueue() = default;
 
 void RegisterWorkQueueFactory(string_view name, WorkQueueFactory factory) {
@@ -26,6 +26,14 @@
 
 namespace tfrt {
 
+RequestContext::RequestContext(HostContext* host,
+                               ResourceContext* resource_context,
+                               bool use_arena_allocator)
+    : host_{host}, resource_context_{resource_context} {
+  if (use_arena_allocator)
+    arena_allocator_ = TakeRef(new ArenaAllocator(host->allocator()));
+}
+
 RequestContext::~RequestContext() {
   if (auto cancel_value = GetCancelAsyncValue()) {
     cancel_value->DropRef();
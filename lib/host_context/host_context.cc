@@ -29,6 +29,7 @@
 #include "tfrt/host_context/shared_context.h"
 #include "tfrt/support/mutex.h"
 #include "tfrt/support/string_util.h"
+#include "tfrt/tracing/tracing.h"
 
 namespace tfrt {
 
@@ -71,7 +72,7 @@ void Function::VtableAnchor() {}
 
 // Construct an empty IndirectAsyncValue, not forwarding to anything.
 RCReference<IndirectAsyncValue> HostContext::MakeIndirectAsyncValue() {
-  return TakeRef(Construct<IndirectAsyncValue>(instance_ptr_));
+  return TakeRef(ConstructAsyncValue<IndirectAsyncValue>(instance_ptr_));
 }
 
 //===----------------------------------------------------------------------===//
@@ -91,8 +92,8 @@ void HostContext::EmitError(const DecodedDiagnostic& diagnostic) {
 RCReference<ErrorAsyncValue> HostContext::MakeErrorAsyncValueRef(
     DecodedDiagnostic&& diagnostic) {
   // Create an AsyncValue for this error condition.
-  auto* error_value =
-      Construct<ErrorAsyncValue>(instance_ptr_, std::move(diagnostic));
+  auto* error_value = ConstructAsyncValue<ErrorAsyncValue>(
+      instance_ptr_, std::move(diagnostic));
 
   return TakeRef(error_value);
 }
@@ -127,22 +128,69 @@ void HostContext::Await(ArrayRef<RCReference<AsyncValue>> values) {
   work_queue_->Await(values);
 }
 
+// Returns a task which runs `work` with `priority` and the sampled tracing
+// request of the calling thread, see tracing::ScopedTracingRequest.
+static TaskFunction MakeTask(TaskPriority priority,
+                             llvm::unique_function<void()> work) {
+  // Threads run with the default priority and no sampled request outside of
+  // ScopedTaskPriority and ScopedTracingRequest, so only work of other
+  // priorities or of sampled requests has to set them, which saves a wrapper
+  // around the common work.
+  const uint64_t tracing_request_id = tracing::GetTracingRequestId();
+  if (priority == TaskPriority::kDefault && tracing_request_id == 0)
+    return TaskFunction(std::move(work));
+  return TaskFunction(
+      [priority, tracing_request_id, work = std::move(work)]() mutable {
+        ScopedTaskPriority task_priority(priority);
+        tracing::ScopedTracingRequest tracing_request(tracing_request_id);
+        work();
+      });
+}
+
 // Add some work to the workqueue managed by this CPU device.
 void HostContext::EnqueueWork(llvm::unique_function<void()> work) {
-  work_queue_->AddTask(TaskFunction(std::move(work)));
+  EnqueueWork(ScopedTaskPriority::GetCurrent(), std::move(work));
+}
+
+// Add some work with the given priority to the workqueue managed by this CPU
+// device.
+void HostContext::EnqueueWork(TaskPriority priority,
+                              llvm::unique_function<void()> work) {
+  work_queue_->AddTaskWithPriority(priority,
+                                   MakeTask(priority, std::move(work)));
+}
+
+// Add a batch of work to the workqueue managed by this CPU device.
+void HostContext::EnqueueWork(
+    MutableArrayRef<llvm::unique_function<void()>> work) {
+  EnqueueWork(ScopedTaskPriority::GetCurrent(), work);
+}
+
+// Add a batch of work with the given priority to the workqueue managed by this
+// CPU device.
+void HostContext::EnqueueWork(
+    TaskPriority priority,
+    MutableArrayRef<llvm::unique_function<void()>> work) {
+  SmallVector<TaskFunction, 16> tasks;
+  tasks.reserve(work.size());
+  for (llvm::unique_function<void()>& item : work)
+    tasks.push_back(MakeTask(priority, std::move(item)));
+  work_queue_->AddTasks(priority, tasks);
 }
 
 // Add some work to the workqueue managed by this CPU device.
 bool HostContext::EnqueueBlockingWork(llvm::unique_function<void()> work) {
   Optional<TaskFunction> task = work_queue_->AddBlockingTask(
-      TaskFunction(std::move(work)), /*allow_queuing=*/true);
+      MakeTask(TaskPriority::kDefault, std::move(work)),
+      /*allow_queuing=*/true);
   return !task.hasValue();
 }
 
 // Runs blocking work on a work_queue managed by this CPU device.
 bool HostContext::RunBlockingWork(llvm::unique_function<void()> work) {
   Optional<TaskFunction> task = work_queue_->AddBlockingTask(
-      TaskFunction(std::move(work)), /*allow_queuing=*/false);
+      MakeTask(TaskPriority::kDefault, std::move(work)),
+      /*allow_queuing=*/false);
   return !task.hasValue();
 }
 
@@ -154,6 +202,10 @@ bool HostContext::IsInWorkerThread() const {
   return work_queue_->IsInWorkerThread();
 }
 
+WorkQueueStats HostContext::GetWorkQueueStats() const {
+  return work_queue_->GetStats();
+}
+
 // Run the specified function when the specified set of AsyncValue's are all
 // resolved.  This is a set-version of "AndThen".
 void HostContext::RunWhenReady(ArrayRef<AsyncValue*> values,
@@ -0,0 +1,212 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+//===- kernel_profiler.cc - Kernel Execution Profiler ---------------------===//
+//
+// This file implements KernelProfiler.
+//
+//===----------------------------------------------------------------------===//
+
+#include "tfrt/host_context/kernel_profiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cinttypes>
+#include <limits>
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/raw_ostream.h"
+
+namespace tfrt {
+
+namespace {
+
+// The wall times of the calls are counted in log-linear buckets: the times
+// below 8ns have their own buckets, and every power of two above is split into
+// 8 buckets of equal width.
+constexpr int kSubBucketBits = 3;
+constexpr int kNumSubBuckets = 1 << kSubBucketBits;
+constexpr int kNumBuckets = (63 - kSubBucketBits + 1) * kNumSubBuckets;
+
+int GetBucketIndex(int64_t value) {
+  if (value < kNumSubBuckets) return value;
+  const int exponent = llvm::Log2_64(value);
+  const int sub_bucket =
+      (value >> (exponent - kSubBucketBits)) & (kNumSubBuckets - 1);
+  return (exponent - kSubBucketBits + 1) * kNumSubBuckets + sub_bucket;
+}
+
+int64_t GetLowerBound(int index) {
+  if (index < kNumSubBuckets) return index;
+  const int exponent = index / kNumSubBuckets + kSubBucketBits - 1;
+  const int sub_bucket = index % kNumSubBuckets;
+  return static_cast<int64_t>(kNumSubBuckets + sub_bucket)
+         << (exponent - kSubBucketBits);
+}
+
+int64_t GetUpperBound(int index) {
+  return index + 1 < kNumBuckets ? GetLowerBound(index + 1) - 1
+                                 : std::numeric_limits<int64_t>::max();
+}
+
+// The calls of a kernel recorded by a thread, or merged by GetProfile().
+struct KernelCalls {
+  KernelProfiler::KernelProfile profile;
+  uint64_t buckets[kNumBuckets] = {};
+};
+
+// The table of the calling thread, for the profiler with id `profiler_id`.
+struct ThreadTableCache {
+  uint64_t profiler_id = 0;
+  void* table = nullptr;
+};
+thread_local ThreadTableCache thread_table_cache;
+
+std::atomic<uint64_t> next_profiler_id{1};
+
+}  // namespace
+
+struct KernelProfiler::ThreadTable {
+  // Only contended while the profile is merged.
+  mutex mu;
+  llvm::DenseMap<const char*, std::unique_ptr<KernelCalls>> calls
+      TFRT_GUARDED_BY(mu);
+};
+
+KernelProfiler::KernelProfiler()
+    : id_(next_profiler_id.fetch_add(1, std::memory_order_relaxed)) {}
+
+KernelProfiler::~KernelProfiler() = default;
+
+KernelProfiler::ThreadTable* KernelProfiler::GetThreadTable() {
+  ThreadTableCache& cache = thread_table_cache;
+  if (cache.profiler_id == id_) return static_cast<ThreadTable*>(cache.table);
+
+  // The cache holds the table of another profiler if the thread records into
+  // several profilers, in which case the table of this profiler may already
+  // exist.
+  mutex_lock lock(mu_);
+  ThreadTable*& table = thread_tables_[std::this_thread::get_id()];
+  if (!table) {
+    tables_.push_back(std::make_unique<ThreadTable>());
+    table = tables_.back().get();
+  }
+  cache.profiler_id = id_;
+  cache.table = table;
+  return table;
+}
+
+size_t KernelProfiler::GetNumThreads() const {
+  mutex_lock lock(mu_);
+  return tables_.size();
+}
+
+void KernelProfiler::RecordKernelCall(const char* kernel_name,
+                                      Location location, int64_t duration_ns,
+                                      bool is_error) {
+  duration_ns = std::max<int64_t>(duration_ns, 0);
+  ThreadTable* table = GetThreadTable();
+  mutex_lock lock(table->mu);
+  auto& calls = table->calls[kernel_name];
+  if (!calls) {
+    calls = std::make_unique<KernelCalls>();
+    calls->profile.kernel_name = kernel_name;
+    calls->profile.max_ns = -1;
+  }
+  KernelProfile& profile = calls->profile;
+  ++profile.num_calls;
+  if (is_error) ++profile.num_errors;
+  profile.total_ns += duration_ns;
+  ++calls->buckets[GetBucketIndex(duration_ns)];
+  if (duration_ns > profile.max_ns) {
+    profile.max_ns = duration_ns;
+    profile.max_location = location.Decode();
+  }
+}
+
+std::vector<KernelProfiler::KernelProfile> KernelProfiler::GetProfile() const {
+  llvm::StringMap<KernelCalls> merged;
+  {
+    mutex_lock lock(mu_);
+    for (const auto& table : tables_) {
+      mutex_lock table_lock(table->mu);
+      for (const auto& entry : table->calls) {
+        const KernelCalls& calls = *entry.second;
+        KernelCalls& merged_calls = merged[calls.profile.kernel_name];
+        KernelProfile& profile = merged_calls.profile;
+        if (profile.num_calls == 0 || calls.profile.max_ns > profile.max_ns) {
+          profile.max_ns = calls.profile.max_ns;
+          profile.max_location = calls.profile.max_location;
+        }
+        profile.num_calls += calls.profile.num_calls;
+        profile.num_errors += calls.profile.num_errors;
+        profile.total_ns += calls.profile.total_ns;
+        for (int i = 0; i < kNumBuckets; ++i)
+          merged_calls.buckets[i] += calls.buckets[i];
+      }
+    }
+  }
+
+  std::vector<KernelProfile> profiles;
+  profiles.reserve(merged.size());
+  for (auto& entry : merged) {
+    KernelCalls& calls = entry.getValue();
+    KernelProfile& profile = calls.profile;
+    profile.kernel_name = entry.getKey().str();
+    // The p99 is the upper bound of the bucket of the 99th percentile call,
+    // which is at most the slowest call.
+    const uint64_t rank = (profile.num_calls * 99 + 99) / 100;
+    uint64_t count = 0;
+    for (int i = 0; i < kNumBuckets; ++i) {
+      count += calls.buckets[i];
+      if (count >= rank) {
+        profile.p99_ns = std::min(GetUpperBound(i), profile.max_ns);
+        break;
+      }
+    }
+    profiles.push_back(std::move(profile));
+  }
+  std::sort(profiles.begin(), profiles.end(),
+            [](const KernelProfile& a, const KernelProfile& b) {
+              if (a.total_ns != b.total_ns) return a.total_ns > b.total_ns;
+              return a.kernel_name < b.kernel_name;
+            });
+  return profiles;
+}
+
+void KernelProfiler::PrintProfile(raw_ostream& os) const {
+  os << "     calls   errors     total_ms       avg_us       p99_us       "
+        "max_us  kernel (slowest call)\n";
+  for (const KernelProfile& profile : GetProfile()) {
+    os << llvm::format("%10" PRId64 " %8" PRId64 " %12.3f %12.3f %12.3f %12.3f",
+                       profile.num_calls, profile.num_errors,
+                       profile.total_ns / 1e6,
+                       profile.total_ns / 1e3 / profile.num_calls,
+                       profile.p99_ns / 1e3, profile.max_ns / 1e3);
+    os << "  " << profile.kernel_name;
+    const DecodedLocation& location = profile.max_location;
+    if (!location.filename.empty() || location.line >= 0) {
+      os << " (" << location.filename << ':' << location.line << ':'
+         << location.column << ')';
+    }
+    os << '\n';
+  }
+  os.flush();
+}
+
+}  // namespace tfrt
@@ -35,6 +35,8 @@ using llvm::StringSet;
 
 struct KernelRegistry::Impl {
   StringMap<KernelImplementation> implementations;
+  // Only kernels that are not cheap are recorded.
+  StringMap<KernelCost> kernel_costs;
   StringSet<> type_names;
 };
 
@@ -43,12 +45,14 @@ KernelRegistry::KernelRegistry() : impl_(std::make_unique<Impl>()) {}
 KernelRegistry::~KernelRegistry() {}
 
 void KernelRegistry::AddKernel(string_view kernel_name,
-                               AsyncKernelImplementation fn) {
+                               AsyncKernelImplementation fn, KernelCost cost) {
   bool added =
       impl_->implementations.try_emplace(kernel_name, KernelImplementation{fn})
           .second;
   (void)added;
   assert(added && "Re-registered existing kernel_name for async kernel");
+
+  if (cost != KernelCost::kCheap) impl_->kernel_costs[kernel_name] = cost;
 }
 
 void KernelRegistry::AddSyncKernel(string_view kernel_name,
@@ -66,6 +70,11 @@ KernelImplementation KernelRegistry::GetKernel(string_view kernel_name) const {
                                             : it->second;
 }
 
+KernelCost KernelRegistry::GetKernelCost(string_view kernel_name) const {
+  auto it = impl_->kernel_costs.find(kernel_name);
+  return it == impl_->kernel_costs.end() ? KernelCost::kCheap : it->second;
+}
+
 TypeName KernelRegistry::GetType(string_view type_name) const {
   auto it = impl_->type_names.insert(type_name).first;
   return TypeName(it->getKeyData());
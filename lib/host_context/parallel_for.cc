@@ -77,35 +77,36 @@ class ParallelForExecutionContext {
         host, n, block_size, std::move(compute), std::move(on_done));
   }
 
-  // EvalBlocks() recursively splits the assigned block range and enqueues work
-  // to the HostContext. This improves latency, by removing a sequential step
-  // from the caller thread. After enqueueing work to the host context, it
-  // evaluates a single block in the caller thread. Blocks to evaluate are
-  // specified by the half-open interval [start_block, end_block).
+  // EvalBlocks() enqueues all but the first block of the assigned block range
+  // to the HostContext in a single batch, which wakes up all the worker threads
+  // needed to evaluate them at once, and then evaluates the first block in the
+  // caller thread. Blocks to evaluate are specified by the half-open interval
+  // [start_block, end_block).
   void EvalBlocks(size_t start_block, size_t end_block) {
-    while (end_block - start_block > 1) {
-      const size_t mid_block = start_block + (end_block - start_block) / 2;
-
-      // Evaluate [mid_block, end_block) blocks.
-      host_->EnqueueWork(
-          [this, mid_block, end_block]() { EvalBlocks(mid_block, end_block); });
-
-      // Current range becomes [start_block, mid_block).
-      end_block = mid_block;
+    assert(end_block - start_block >= 1);
+
+    if (end_block - start_block > 1) {
+      SmallVector<llvm::unique_function<void()>, 32> work;
+      work.reserve(end_block - start_block - 1);
+      for (size_t block = start_block + 1; block < end_block; ++block)
+        work.emplace_back([this, block]() { EvalBlock(block); });
+      host_->EnqueueWork(work);
     }
 
-    assert(end_block - start_block == 1);
+    EvalBlock(start_block);
+  }
 
-    // Call `compute` for a single block.
-    compute_(start_block * block_size_, std::min(n_, end_block * block_size_));
+  int PendingBlocks() { return pending_blocks_; }
+
+ private:
+  // Calls `compute` for a single block.
+  void EvalBlock(size_t block) {
+    compute_(block * block_size_, std::min(n_, (block + 1) * block_size_));
 
     // Delete this context if it was the last block.
     if (pending_blocks_.fetch_sub(1) == 1) delete this;
   }
 
-  int PendingBlocks() { return pending_blocks_; }
-
- private:
   ParallelForExecutionContext(
       HostContext* host, size_t n, size_t block_size,
       llvm::unique_function<void(size_t, size_t)> compute,
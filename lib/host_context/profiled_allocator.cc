@@ -26,6 +26,7 @@
 #include <cstdint>
 
 #include "tfrt/host_context/host_allocator.h"
+#include "tfrt/metrics/metrics_api.h"
 
 namespace tfrt {
 
@@ -45,7 +46,11 @@ void AtomicUpdateMax(T const& value, std::atomic<T>* max_value) noexcept {
 class ProfiledAllocator : public HostAllocator {
  public:
   explicit ProfiledAllocator(std::unique_ptr<HostAllocator> allocator)
-      : allocator_(std::move(allocator)) {}
+      : allocator_(std::move(allocator)),
+        allocated_bytes_(
+            metrics::NewCounter("/tfrt/host_allocator/allocated_bytes")),
+        deallocated_bytes_(
+            metrics::NewCounter("/tfrt/host_allocator/deallocated_bytes")) {}
 
   ~ProfiledAllocator() override {
     if (print_profile_) {
@@ -60,6 +65,7 @@ class ProfiledAllocator : public HostAllocator {
     AtomicUpdateMax<int64_t>(curr_num_allocations_, &max_num_allocations_);
     AtomicUpdateMax<int64_t>(curr_num_bytes_allocated_,
                              &max_num_bytes_allocated_);
+    allocated_bytes_->IncrementBy(size);
 
     return allocator_->AllocateBytes(size, alignment);
   }
@@ -67,6 +73,7 @@ class ProfiledAllocator : public HostAllocator {
   void DeallocateBytes(void* ptr, size_t size) override {
     --curr_num_allocations_;
     curr_num_bytes_allocated_.fetch_sub(size);
+    deallocated_bytes_->IncrementBy(size);
 
     allocator_->DeallocateBytes(ptr, size);
   }
@@ -96,6 +103,10 @@ class ProfiledAllocator : public HostAllocator {
 
  private:
   std::unique_ptr<HostAllocator> allocator_;
+  // The bytes allocated and deallocated by all the profiled allocators, so
+  // that their difference is the bytes in use.
+  metrics::Counter* const allocated_bytes_;
+  metrics::Counter* const deallocated_bytes_;
 };
 
 class LeakCheckAllocator : public ProfiledAllocator {
@@ -0,0 +1,280 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+//===- size_class_allocator.cc - Size Class Memory Allocator --------------===//
+//
+// This file implements a HostAllocator that serves small allocations from
+// per-thread free lists of fixed size classes.
+//
+//===----------------------------------------------------------------------===//
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <new>
+#include <thread>
+#include <vector>
+
+#include "tfrt/host_context/host_allocator.h"
+#include "tfrt/support/mutex.h"
+#include "tfrt/support/thread_annotations.h"
+#include "tfrt/support/thread_local.h"
+
+namespace tfrt {
+
+namespace {
+
+// The size classes. The runtime allocates many small objects of few distinct
+// sizes, e.g. AsyncValues, waiter nodes and BEFExecutors, so a handful of
+// classes with at most 50% internal fragmentation is enough.
+constexpr std::array<size_t, 10> kSizeClasses = {16,  32,  48,  64,  96,
+                                                 128, 192, 256, 384, 512};
+constexpr size_t kNumSizeClasses = kSizeClasses.size();
+constexpr size_t kMaxSmallSize = kSizeClasses.back();
+
+// Objects are carved from slabs that are aligned to their size, so that the
+// size class of an object can be found from the header of its slab.
+constexpr size_t kSlabSize = 64 * 1024;
+
+// The number of objects moved between a thread cache and the depot at a time.
+constexpr size_t kMagazineSize = 32;
+
+// The largest power of two that divides `size_class`. Objects of a size class
+// are aligned to this.
+constexpr size_t SizeClassAlignment(size_t size_class) {
+  return size_class & ~(size_class - 1);
+}
+
+// The largest alignment of the objects of a size class.
+constexpr size_t kMaxSmallAlignment = SizeClassAlignment(kMaxSmallSize);
+
+struct SlabHeader {
+  size_t size_class_index;
+};
+
+// A free object, linked into a free list through its first word.
+struct FreeObject {
+  FreeObject* next;
+};
+
+// A singly linked list of free objects of one size class.
+struct FreeList {
+  FreeObject* head = nullptr;
+  size_t size = 0;
+
+  void Push(FreeObject* object) {
+    object->next = head;
+    head = object;
+    ++size;
+  }
+
+  FreeObject* Pop() {
+    FreeObject* object = head;
+    head = object->next;
+    --size;
+    return object;
+  }
+
+  // Move `num_objects` objects from the front of this list to a new list.
+  FreeList Split(size_t num_objects) {
+    assert(num_objects <= size);
+    FreeList result;
+    for (size_t i = 0; i < num_objects; ++i) result.Push(Pop());
+    return result;
+  }
+};
+
+}  // namespace
+
+// SizeClassAllocator rounds small allocations up to a size class and keeps
+// freed objects of each class in a free list of the calling thread, so that
+// the common allocate/deallocate pairs on worker threads touch no shared state.
+// Threads exchange objects with a global depot a magazine of kMagazineSize
+// objects at a time, which bounds the memory cached by each thread and lets
+// objects freed on one thread be reused by another.
+//
+// Memory for small objects is allocated from the underlying allocator in slabs
+// that are only returned when the SizeClassAllocator is destroyed. Allocations
+// larger than kMaxSmallSize, or aligned to more than kMaxSmallAlignment, are
+// forwarded to the underlying allocator.
+class SizeClassAllocator : public HostAllocator {
+ public:
+  explicit SizeClassAllocator(std::unique_ptr<HostAllocator> allocator)
+      : id_(next_id_.fetch_add(1, std::memory_order_relaxed)),
+        allocator_(std::move(allocator)),
+        thread_caches_(ThreadLocal<ThreadCache>::Capacity(
+            2 * std::max(std::thread::hardware_concurrency(), 1u))) {
+    for (size_t i = 0, size = 0; i < kNumSizeClasses; ++i) {
+      for (; size <= kSizeClasses[i]; size += kMinAlignment)
+        size_class_index_[size / kMinAlignment] = i;
+    }
+  }
+
+  ~SizeClassAllocator() override {
+    mutex_lock lock(slabs_mu_);
+    for (void* slab : slabs_) allocator_->DeallocateBytes(slab, kSlabSize);
+  }
+
+  void* AllocateBytes(size_t size, size_t alignment) override {
+    if (size > kMaxSmallSize) return allocator_->AllocateBytes(size, alignment);
+    // Over-aligned small objects are rare. They are aligned to a slab, so that
+    // DeallocateBytes() can tell them from the objects carved from slabs,
+    // which are never at the start of their slab.
+    if (alignment > kMaxSmallAlignment)
+      return allocator_->AllocateBytes(size, std::max(alignment, kSlabSize));
+
+    size_t index = GetSizeClassIndex(size, alignment);
+    FreeList& free_list = GetThreadCache().free_lists[index];
+    if (free_list.size == 0) {
+      free_list = RefillFromDepot(index);
+      if (free_list.size == 0) return nullptr;
+    }
+    return free_list.Pop();
+  }
+
+  void DeallocateBytes(void* ptr, size_t size) override {
+    auto slab_address = reinterpret_cast<uintptr_t>(ptr) & ~(kSlabSize - 1);
+    if (size > kMaxSmallSize ||
+        slab_address == reinterpret_cast<uintptr_t>(ptr)) {
+      allocator_->DeallocateBytes(ptr, size);
+      return;
+    }
+
+    // The slab records the size class, as `size` does not tell us about the
+    // alignment the object was allocated with.
+    size_t index =
+        reinterpret_cast<const SlabHeader*>(slab_address)->size_class_index;
+
+    FreeList& free_list = GetThreadCache().free_lists[index];
+    free_list.Push(static_cast<FreeObject*>(ptr));
+    // Keep one magazine to serve future allocations, and return the rest.
+    if (free_list.size >= 2 * kMagazineSize)
+      ReturnToDepot(index, free_list.Split(kMagazineSize));
+  }
+
+ private:
+  static constexpr size_t kMinAlignment = 16;
+
+  struct ThreadCache {
+    std::array<FreeList, kNumSizeClasses> free_lists;
+  };
+
+  // The global pool of free objects of one size class.
+  struct Depot {
+    mutex mu;
+    std::vector<FreeList> magazines TFRT_GUARDED_BY(mu);
+    // The unused range of the slab that objects are carved from.
+    uintptr_t slab_cursor TFRT_GUARDED_BY(mu) = 0;
+    uintptr_t slab_end TFRT_GUARDED_BY(mu) = 0;
+  };
+
+  ThreadCache& GetThreadCache() {
+    // Remember the cache of the last allocator used on this thread, so that
+    // the common case of a single allocator per process skips the ThreadLocal
+    // lookup. Allocator ids are never reused, so a stale entry never matches.
+    thread_local uint64_t last_allocator_id = 0;
+    thread_local ThreadCache* last_thread_cache = nullptr;
+    if (last_allocator_id != id_) {
+      last_thread_cache = &thread_caches_.Local();
+      last_allocator_id = id_;
+    }
+    return *last_thread_cache;
+  }
+
+  size_t GetSizeClassIndex(size_t size, size_t alignment) const {
+    size_t index =
+        size_class_index_[(size + kMinAlignment - 1) / kMinAlignment];
+    if (alignment <= kMinAlignment) return index;
+
+    // Large alignments are rare. Find the smallest size class whose objects
+    // are aligned enough.
+    assert(alignment <= kMaxSmallAlignment && "unsupported alignment");
+    while (SizeClassAlignment(kSizeClasses[index]) < alignment) ++index;
+    return index;
+  }
+
+  // Return a magazine from the depot, carving new objects from a slab if the
+  // depot is empty. Return an empty list if a new slab can't be allocated.
+  FreeList RefillFromDepot(size_t index) {
+    Depot& depot = depots_[index];
+    mutex_lock lock(depot.mu);
+    if (!depot.magazines.empty()) {
+      FreeList magazine = depot.magazines.back();
+      depot.magazines.pop_back();
+      return magazine;
+    }
+
+    size_t size_class = kSizeClasses[index];
+    FreeList magazine;
+    while (magazine.size < kMagazineSize) {
+      if (depot.slab_cursor + size_class > depot.slab_end) {
+        void* slab = AllocateSlab(index);
+        if (slab == nullptr) break;
+        auto slab_address = reinterpret_cast<uintptr_t>(slab);
+        // Skip the header, keeping the objects aligned to the size class.
+        depot.slab_cursor =
+            slab_address +
+            std::max(SizeClassAlignment(size_class), sizeof(SlabHeader));
+        depot.slab_end = slab_address + kSlabSize;
+      }
+      magazine.Push(reinterpret_cast<FreeObject*>(depot.slab_cursor));
+      depot.slab_cursor += size_class;
+    }
+    return magazine;
+  }
+
+  void ReturnToDepot(size_t index, FreeList magazine) {
+    Depot& depot = depots_[index];
+    mutex_lock lock(depot.mu);
+    depot.magazines.push_back(magazine);
+  }
+
+  void* AllocateSlab(size_t index) {
+    void* slab = allocator_->AllocateBytes(kSlabSize, kSlabSize);
+    if (slab == nullptr) return nullptr;
+    new (slab) SlabHeader{index};
+
+    mutex_lock lock(slabs_mu_);
+    slabs_.push_back(slab);
+    return slab;
+  }
+
+  static std::atomic<uint64_t> next_id_;
+
+  // A unique id of this allocator. See GetThreadCache().
+  const uint64_t id_;
+
+  std::unique_ptr<HostAllocator> allocator_;
+
+  // Maps a size rounded up to kMinAlignment to the smallest size class that
+  // can hold it.
+  std::array<uint8_t, kMaxSmallSize / kMinAlignment + 1> size_class_index_;
+
+  ThreadLocal<ThreadCache> thread_caches_;
+  std::array<Depot, kNumSizeClasses> depots_;
+
+  mutex slabs_mu_;
+  std::vector<void*> slabs_ TFRT_GUARDED_BY(slabs_mu_);
+};
+
+std::atomic<uint64_t> SizeClassAllocator::next_id_{1};
+
+std::unique_ptr<HostAllocator> CreateSizeClassAllocator(
+    std::unique_ptr<HostAllocator> allocator) {
+  return std::make_unique<SizeClassAllocator>(std::move(allocator));
+}
+
+}  // namespace tfrt
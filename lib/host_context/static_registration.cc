@@ -17,9 +17,11 @@
 // This file implements the work queue factories and registers them.
 //
 //===----------------------------------------------------------------------===//
+#include <algorithm>
 #include <cstddef>
 #include <string>
 #include <thread>
+#include <tuple>
 
 #include "tfrt/host_context/concurrent_work_queue.h"
 #include "tfrt/support/logging.h"
@@ -43,14 +45,13 @@ std::unique_ptr<ConcurrentWorkQueue> SingleThreadedWorkQueueFactory(
   return CreateSingleThreadedWorkQueue();
 }
 
-struct MakeMultiThreadedWorkQueue {
-  static std::unique_ptr<ConcurrentWorkQueue> make(int num_threads,
-                                                   int num_blocking_threads) {
-    return CreateMultiThreadedWorkQueue(
-        std::min(kMaxNumThreads, num_threads),
-        std::min(kMaxNumThreads, num_blocking_threads));
-  }
-};
+std::unique_ptr<ConcurrentWorkQueue> MakeMultiThreadedWorkQueue(
+    int num_threads, int num_blocking_threads,
+    MultiThreadedWorkQueueOptions options) {
+  options.num_threads = std::min(kMaxNumThreads, num_threads);
+  options.num_blocking_threads = std::min(kMaxNumThreads, num_blocking_threads);
+  return CreateMultiThreadedWorkQueue(options);
+}
 
 // Factory function for a multi-threaded thread pool.  Parses the given argument
 // to determine the construction parameters.  The argument must be either "X" or
@@ -58,10 +59,10 @@ struct MakeMultiThreadedWorkQueue {
 // use for blocking work, and Y will determine the number of threads for
 // nonblocking work. If X is not specified, the pool will use a number of
 // threads based on the number of CPUs in the system. Y is not specified, a
-// `kDefaultNumThreads` number of threads will be used for blocking work.
-template <typename MakeWorkQueue>
+// `kDefaultNumThreads` number of threads will be used for blocking work. The
+// other `options` are passed through.
 std::unique_ptr<ConcurrentWorkQueue> MultiThreadedWorkQueueFactory(
-    string_view arg) {
+    string_view arg, const MultiThreadedWorkQueueOptions& options) {
   if (arg.empty()) {
     // Reserve one or more CPUs (currently 1 out of 8) for blocking tasks, to
     // avoid oversubscribing CPUs.
@@ -70,7 +71,7 @@ std::unique_ptr<ConcurrentWorkQueue> MultiThreadedWorkQueueFactory(
     int num_blocking =
         std::max(static_cast<int>(num_cpus * kBlockingCpuFraction), 1);
     int num_nonblocking = std::max(num_cpus - num_blocking, 1);
-    return MakeWorkQueue::make(num_nonblocking, num_blocking);
+    return MakeMultiThreadedWorkQueue(num_nonblocking, num_blocking, options);
   } else {
     size_t comma = arg.find(',');
     int num_threads;
@@ -100,14 +101,61 @@ std::unique_ptr<ConcurrentWorkQueue> MultiThreadedWorkQueueFactory(
         return nullptr;
       }
     }
-    return MakeWorkQueue::make(num_threads, num_blocking);
+    return MakeMultiThreadedWorkQueue(num_threads, num_blocking, options);
+  }
+}
+
+// Parses a trailing option of the "mstd" work queue argument into `options`.
+// Returns false if `option` is not an option.
+bool ParseMultiThreadedWorkQueueOption(
+    string_view option, MultiThreadedWorkQueueOptions* options) {
+  if (option == "numa") {
+    options->numa_aware = true;
+    return true;
+  }
+
+  string_view key, value;
+  std::tie(key, value) = option.split('=');
+  int int_value;
+  if (value.empty() || value.getAsInteger(10, int_value) || int_value < 0)
+    return false;
+
+  if (key == "spinning_threads") {
+    options->spinning.max_spinning_threads = int_value;
+  } else if (key == "spin_count") {
+    options->spinning.spin_count = int_value;
+  } else if (key == "adaptive_spin") {
+    options->spinning.adaptive = int_value != 0;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+// Factory function for the "mstd" work queue. The thread counts parsed by
+// MultiThreadedWorkQueueFactory can be followed by options:
+//
+//   numa                 - the NUMA-aware multi-threaded work queue.
+//   spinning_threads=N   - WorkerSpinningOptions::max_spinning_threads.
+//   spin_count=N         - WorkerSpinningOptions::spin_count.
+//   adaptive_spin=0|1    - WorkerSpinningOptions::adaptive.
+//
+// E.g. "mstd:numa" or "mstd:8,2,numa,spinning_threads=4".
+std::unique_ptr<ConcurrentWorkQueue> MstdWorkQueueFactory(string_view arg) {
+  MultiThreadedWorkQueueOptions options;
+  while (!arg.empty()) {
+    size_t comma = arg.rfind(',');
+    string_view option =
+        comma == string_view::npos ? arg : arg.substr(comma + 1);
+    if (!ParseMultiThreadedWorkQueueOption(option, &options)) break;
+    arg = comma == string_view::npos ? "" : arg.substr(0, comma);
   }
+  return MultiThreadedWorkQueueFactory(arg, options);
 }
 
 }  // namespace
 
 TFRT_WORK_QUEUE_FACTORY("s", SingleThreadedWorkQueueFactory);
-TFRT_WORK_QUEUE_FACTORY(
-    "mstd", MultiThreadedWorkQueueFactory<MakeMultiThreadedWorkQueue>);
+TFRT_WORK_QUEUE_FACTORY("mstd", MstdWorkQueueFactory);
 
 }  // namespace tfrt
@@ -0,0 +1,117 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+//===- async_file_input_stream.cc -----------------------------------------===//
+//
+// This file implements AsyncFileInputStream.
+//
+//===----------------------------------------------------------------------===//
+
+#include "tfrt/io/async_file_input_stream.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "tfrt/host_context/host_context.h"
+#include "tfrt/support/latch.h"
+
+namespace tfrt {
+namespace io {
+namespace {
+
+// Blocks until `value` is available.
+void BlockUntilAvailable(const AsyncValueRef<size_t>& value) {
+  if (value.IsAvailable()) return;
+  latch available(1);
+  value.AndThen([&available] { available.count_down(); });
+  available.wait();
+}
+
+}  // namespace
+
+llvm::Expected<std::unique_ptr<AsyncFileInputStream>>
+AsyncFileInputStream::Open(string_view path, size_t chunk_size,
+                           int num_chunks, AsyncFileReader* reader,
+                           HostContext* host) {
+  auto file = llvm::sys::fs::openNativeFileForRead(path);
+  if (!file) {
+    return MakeStringError("failed to open file ", path, ": ",
+                           file.takeError());
+  }
+  return std::unique_ptr<AsyncFileInputStream>(new AsyncFileInputStream(
+      *file, chunk_size, num_chunks, reader, host));
+}
+
+AsyncFileInputStream::AsyncFileInputStream(llvm::sys::fs::file_t file,
+                                           size_t chunk_size, int num_chunks,
+                                           AsyncFileReader* reader,
+                                           HostContext* host)
+    : file_(file),
+      chunk_size_(chunk_size),
+      reader_(reader),
+      host_(host),
+      chunks_(num_chunks) {
+  assert(chunk_size_ > 0);
+  assert(num_chunks > 0);
+  for (Chunk& chunk : chunks_) {
+    chunk.data = host_->allocator()->Allocate<char>(chunk_size_);
+    StartRead(&chunk);
+  }
+}
+
+AsyncFileInputStream::~AsyncFileInputStream() {
+  for (Chunk& chunk : chunks_) {
+    BlockUntilAvailable(chunk.size);
+    host_->allocator()->Deallocate(chunk.data, chunk_size_);
+  }
+  llvm::sys::fs::closeFile(file_);
+}
+
+void AsyncFileInputStream::StartRead(Chunk* chunk) {
+  chunk->size =
+      reader_->ReadAt(file_, next_offset_, chunk->data, chunk_size_, host_);
+  next_offset_ += chunk_size_;
+}
+
+llvm::Expected<size_t> AsyncFileInputStream::Read(char* buf, size_t count) {
+  size_t num_read = 0;
+  while (num_read < count) {
+    Chunk& chunk = chunks_[current_];
+    BlockUntilAvailable(chunk.size);
+    if (chunk.size.IsError())
+      return MakeStringError(chunk.size.GetError().message);
+
+    const size_t size = chunk.size.get();
+    if (chunk_pos_ == size) {
+      // Only the last chunk of the file is not full.
+      if (size < chunk_size_) break;
+      // The chunk is consumed, reuse it for the chunk after the ones in
+      // flight.
+      StartRead(&chunk);
+      current_ = (current_ + 1) % chunks_.size();
+      chunk_pos_ = 0;
+      continue;
+    }
+
+    const size_t read_count = std::min(size - chunk_pos_, count - num_read);
+    std::memcpy(buf + num_read, chunk.data + chunk_pos_, read_count);
+    chunk_pos_ += read_count;
+    num_read += read_count;
+  }
+  pos_ += num_read;
+  return num_read;
+}
+
+}  // namespace io
+}  // namespace tfrt
@@ -0,0 +1,376 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+//===- async_file_reader.cc -----------------------------------------------===//
+//
+// This file implements AsyncFileReader on top of io_uring, and the pread
+// fallback.
+//
+//===----------------------------------------------------------------------===//
+
+#include "tfrt/io/async_file_reader.h"
+
+#include "tfrt/host_context/host_context.h"
+#include "tfrt/support/error_util.h"
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define TFRT_IO_URING 1
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <thread>
+
+#include "tfrt/support/logging.h"
+#include "tfrt/support/mutex.h"
+#include "tfrt/support/thread_annotations.h"
+#endif
+
+namespace tfrt {
+namespace io {
+namespace {
+
+using ::llvm::sys::fs::file_t;
+
+// Reads until `count` bytes are read or the end of the file is reached.
+llvm::Expected<size_t> ReadFully(file_t file, uint64_t offset, char* buf,
+                                 size_t count) {
+  size_t num_read = 0;
+  while (num_read < count) {
+    auto result = llvm::sys::fs::readNativeFileSlice(
+        file, llvm::makeMutableArrayRef(buf + num_read, count - num_read),
+        offset + num_read);
+    if (!result) return result.takeError();
+    if (*result == 0) break;
+    num_read += *result;
+  }
+  return num_read;
+}
+
+AsyncValueRef<size_t> ReadFullyAt(file_t file, uint64_t offset, char* buf,
+                                  size_t count, HostContext* host) {
+  auto num_read = ReadFully(file, offset, buf, count);
+  if (!num_read) {
+    return host->MakeErrorAsyncValueRef(
+        StrCat("failed to read file: ", num_read.takeError()));
+  }
+  return host->MakeAvailableAsyncValueRef<size_t>(*num_read);
+}
+
+class PreadFileReader : public AsyncFileReader {
+ public:
+  bool IsAsync() const override { return false; }
+
+  AsyncValueRef<size_t> ReadAt(file_t file, uint64_t offset, char* buf,
+                               size_t count, HostContext* host) override {
+    return ReadFullyAt(file, offset, buf, count, host);
+  }
+};
+
+#if defined(TFRT_IO_URING)
+
+// Submits reads to an io_uring with the raw syscalls, to not depend on
+// liburing. Entries are queued under a mutex, and a dedicated thread waits for
+// the completions.
+class IoUringFileReader : public AsyncFileReader {
+ public:
+  // Returns nullptr if the io_uring can't be set up.
+  static std::unique_ptr<IoUringFileReader> Create(unsigned queue_depth);
+
+  ~IoUringFileReader() override;
+
+  bool IsAsync() const override { return true; }
+
+  AsyncValueRef<size_t> ReadAt(file_t file, uint64_t offset, char* buf,
+                               size_t count, HostContext* host) override;
+
+ private:
+  // A read in flight, owned by the ring from submission to completion.
+  struct PendingRead {
+    AsyncValueRef<size_t> result;
+    int fd;
+    uint64_t offset;
+    char* buf;
+    size_t count;
+    size_t num_read = 0;
+    iovec iov;
+  };
+
+  // The user data of the completion that stops the completion thread.
+  static constexpr uint64_t kStopUserData = 0;
+
+  IoUringFileReader() = default;
+
+  bool SetUp(unsigned queue_depth);
+
+  // Submits a read of the remaining bytes of `read`, or a no-op that stops the
+  // completion thread if `read` is nullptr. mu_ is only held to queue the
+  // entry and not while entering the ring, so that a submission that waits
+  // for the completion thread does not block it.
+  void Submit(PendingRead* read) TFRT_EXCLUDES(mu_);
+
+  // Waits for completions until the stop no-op and all the reads complete.
+  void ProcessCompletions();
+
+  // Handles the completion of `read` with `result` bytes or -errno. Returns
+  // true if the read is done.
+  bool Complete(PendingRead* read, int result);
+
+  int ring_fd_ = -1;
+
+  void* sq_ring_ = nullptr;
+  size_t sq_ring_size_ = 0;
+  void* cq_ring_ = nullptr;
+  size_t cq_ring_size_ = 0;
+  io_uring_sqe* sqes_ = nullptr;
+  size_t sqes_size_ = 0;
+
+  // Submission queue fields in the mapped ring.
+  unsigned* sq_head_ = nullptr;
+  unsigned* sq_tail_ = nullptr;
+  unsigned* sq_mask_ = nullptr;
+  unsigned* sq_array_ = nullptr;
+  // Completion queue fields in the mapped ring.
+  unsigned* cq_head_ = nullptr;
+  unsigned* cq_tail_ = nullptr;
+  unsigned* cq_mask_ = nullptr;
+  io_uring_cqe* cqes_ = nullptr;
+
+  // The submission queue has room for an entry of each read in flight and the
+  // stop no-op, and the completion queue is twice as large, so that it can't
+  // overflow if at most this many reads are in flight.
+  unsigned max_in_flight_ = 0;
+
+  mutex mu_;
+  unsigned num_in_flight_ TFRT_GUARDED_BY(mu_) = 0;
+
+  std::thread completion_thread_;
+};
+
+std::unique_ptr<IoUringFileReader> IoUringFileReader::Create(
+    unsigned queue_depth) {
+  std::unique_ptr<IoUringFileReader> reader(new IoUringFileReader());
+  if (!reader->SetUp(queue_depth)) return nullptr;
+  reader->completion_thread_ =
+      std::thread([reader = reader.get()] { reader->ProcessCompletions(); });
+  return reader;
+}
+
+bool IoUringFileReader::SetUp(unsigned queue_depth) {
+  io_uring_params params;
+  std::memset(&params, 0, sizeof(params));
+  // One more entry for the stop no-op.
+  ring_fd_ = syscall(__NR_io_uring_setup, queue_depth + 1, &params);
+  if (ring_fd_ < 0) return false;
+
+  sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  cq_ring_size_ =
+      params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+  const bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+  if (single_mmap) {
+    sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+  }
+
+  auto map = [this](size_t size, off_t offset) -> void* {
+    void* ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_POPULATE, ring_fd_, offset);
+    return ptr == MAP_FAILED ? nullptr : ptr;
+  };
+  sq_ring_ = map(sq_ring_size_, IORING_OFF_SQ_RING);
+  cq_ring_ = single_mmap ? sq_ring_ : map(cq_ring_size_, IORING_OFF_CQ_RING);
+  sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+  sqes_ = static_cast<io_uring_sqe*>(map(sqes_size_, IORING_OFF_SQES));
+  if (!sq_ring_ || !cq_ring_ || !sqes_) return false;
+
+  auto sq_field = [this](uint32_t offset) {
+    return reinterpret_cast<unsigned*>(static_cast<char*>(sq_ring_) + offset);
+  };
+  auto cq_field = [this](uint32_t offset) {
+    return reinterpret_cast<unsigned*>(static_cast<char*>(cq_ring_) + offset);
+  };
+  sq_head_ = sq_field(params.sq_off.head);
+  sq_tail_ = sq_field(params.sq_off.tail);
+  sq_mask_ = sq_field(params.sq_off.ring_mask);
+  sq_array_ = sq_field(params.sq_off.array);
+  cq_head_ = cq_field(params.cq_off.head);
+  cq_tail_ = cq_field(params.cq_off.tail);
+  cq_mask_ = cq_field(params.cq_off.ring_mask);
+  cqes_ = reinterpret_cast<io_uring_cqe*>(cq_field(params.cq_off.cqes));
+
+  max_in_flight_ =
+      std::min({queue_depth, params.sq_entries - 1, params.cq_entries / 2});
+  return true;
+}
+
+IoUringFileReader::~IoUringFileReader() {
+  if (completion_thread_.joinable()) {
+    Submit(nullptr);
+    completion_thread_.join();
+  }
+
+  if (sqes_) munmap(sqes_, sqes_size_);
+  if (cq_ring_ && cq_ring_ != sq_ring_) munmap(cq_ring_, cq_ring_size_);
+  if (sq_ring_) munmap(sq_ring_, sq_ring_size_);
+  if (ring_fd_ >= 0) close(ring_fd_);
+}
+
+AsyncValueRef<size_t> IoUringFileReader::ReadAt(file_t file, uint64_t offset,
+                                                char* buf, size_t count,
+                                                HostContext* host) {
+  if (count == 0) return host->MakeAvailableAsyncValueRef<size_t>(0);
+
+  bool submit;
+  {
+    mutex_lock lock(mu_);
+    submit = num_in_flight_ < max_in_flight_;
+    if (submit) ++num_in_flight_;
+  }
+  if (submit) {
+    auto result = host->MakeUnconstructedAsyncValueRef<size_t>();
+    Submit(new PendingRead{result.CopyRef(), file, offset, buf, count});
+    return result;
+  }
+
+  // Reading synchronously when the ring is full is the natural backpressure
+  // for the caller.
+  return ReadFullyAt(file, offset, buf, count, host);
+}
+
+void IoUringFileReader::Submit(PendingRead* read) {
+  unsigned tail;
+  {
+    mutex_lock lock(mu_);
+    // Only submitters, serialized by mu_, write the tail. Each read has at
+    // most one entry in the queue, so the queue is never full, see SetUp().
+    tail = *sq_tail_;
+    const unsigned index = tail & *sq_mask_;
+    io_uring_sqe* sqe = &sqes_[index];
+    std::memset(sqe, 0, sizeof(*sqe));
+    if (read) {
+      read->iov.iov_base = read->buf + read->num_read;
+      read->iov.iov_len = read->count - read->num_read;
+      // IORING_OP_READV is supported by all kernels with io_uring (>= 5.1).
+      sqe->opcode = IORING_OP_READV;
+      sqe->fd = read->fd;
+      sqe->off = read->offset + read->num_read;
+      sqe->addr = reinterpret_cast<uint64_t>(&read->iov);
+      sqe->len = 1;
+      sqe->user_data = reinterpret_cast<uint64_t>(read);
+    } else {
+      sqe->opcode = IORING_OP_NOP;
+      sqe->user_data = kStopUserData;
+    }
+    sq_array_[index] = index;
+    __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+  }
+
+  // Enter the ring until the kernel consumed the entry, along with the entries
+  // queued before it by other threads. EBUSY means that the completion queue
+  // overflowed. The entry is then left in the queue, and the completion thread
+  // submits it after it reaps the completions, see ProcessCompletions().
+  for (;;) {
+    const unsigned to_submit =
+        tail + 1 - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+    if (static_cast<int>(to_submit) <= 0) return;
+    if (syscall(__NR_io_uring_enter, ring_fd_, to_submit, 0, 0, nullptr, 0) >=
+        0)
+      continue;
+    if (errno == EBUSY) return;
+    if (errno != EINTR && errno != EAGAIN) {
+      TFRT_LOG(FATAL) << "io_uring_enter failed: " << std::strerror(errno);
+    }
+  }
+}
+
+bool IoUringFileReader::Complete(PendingRead* read, int result) {
+  if (result == -EINTR || result == -EAGAIN) {
+    Submit(read);
+    return false;
+  }
+
+  if (result < 0) {
+    read->result.SetError(
+        StrCat("failed to read file: ", std::strerror(-result)));
+  } else {
+    read->num_read += result;
+    // Regular files can return short reads, e.g. if the read is interrupted.
+    // Read the rest, unless the end of the file is reached.
+    if (result > 0 && read->num_read < read->count) {
+      Submit(read);
+      return false;
+    }
+    read->result.emplace(read->num_read);
+  }
+  delete read;
+  return true;
+}
+
+void IoUringFileReader::ProcessCompletions() {
+  bool stopping = false;
+  for (;;) {
+    // Submit the entries that Submit() left in the queue on EBUSY.
+    const unsigned to_submit = __atomic_load_n(sq_tail_, __ATOMIC_ACQUIRE) -
+                               __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+    if (syscall(__NR_io_uring_enter, ring_fd_, to_submit, 1,
+                IORING_ENTER_GETEVENTS, nullptr, 0) < 0 &&
+        errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+      TFRT_LOG(FATAL) << "io_uring_enter failed: " << std::strerror(errno);
+    }
+
+    unsigned head = *cq_head_;
+    const unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+    unsigned num_completed = 0;
+    for (; head != tail; ++head) {
+      const io_uring_cqe& cqe = cqes_[head & *cq_mask_];
+      if (cqe.user_data == kStopUserData) {
+        stopping = true;
+      } else if (Complete(reinterpret_cast<PendingRead*>(cqe.user_data),
+                          cqe.res)) {
+        ++num_completed;
+      }
+    }
+    __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+
+    mutex_lock lock(mu_);
+    num_in_flight_ -= num_completed;
+    if (stopping && num_in_flight_ == 0) return;
+  }
+}
+
+#endif  // TFRT_IO_URING
+
+}  // namespace
+
+AsyncFileReader* AsyncFileReader::GetDefault() {
+  static AsyncFileReader* reader = Create(/*queue_depth=*/256).release();
+  return reader;
+}
+
+std::unique_ptr<AsyncFileReader> AsyncFileReader::Create(unsigned queue_depth,
+                                                         bool use_io_uring) {
+#if defined(TFRT_IO_URING)
+  if (use_io_uring) {
+    if (auto reader = IoUringFileReader::Create(queue_depth)) return reader;
+  }
+#endif
+  return std::make_unique<PreadFileReader>();
+}
+
+}  // namespace io
+}  // namespace tfrt
@@ -0,0 +1,86 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+//===- mapped_file_input_stream.cc ----------------------------------------===//
+//
+// This file implements MappedFileInputStream.
+//
+//===----------------------------------------------------------------------===//
+
+#include "tfrt/io/mapped_file_input_stream.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "llvm/Support/FileSystem.h"
+
+namespace tfrt {
+namespace io {
+
+llvm::Expected<std::unique_ptr<MappedFileInputStream>>
+MappedFileInputStream::Open(string_view path) {
+  namespace fs = ::llvm::sys::fs;
+
+  llvm::Expected<fs::file_t> file = fs::openNativeFileForRead(path);
+  if (!file) {
+    return MakeStringError("failed to open file: ", path, ": ",
+                           file.takeError());
+  }
+
+  fs::file_status status;
+  std::error_code ec = fs::status(*file, status);
+  if (ec) {
+    fs::closeFile(*file);
+    return MakeStringError("failed to stat file: ", path, ": ", ec.message());
+  }
+
+  // Empty files can't be mapped.
+  const uint64_t size = status.getSize();
+  if (size == 0) {
+    fs::closeFile(*file);
+    return std::unique_ptr<MappedFileInputStream>(new MappedFileInputStream(
+        HostBuffer::CreateFromExternal(nullptr, 0, [](void*, size_t) {})));
+  }
+
+  // The mapping stays valid after the file is closed.
+  auto region = std::make_unique<fs::mapped_file_region>(
+      *file, fs::mapped_file_region::readonly, size, /*offset=*/0, ec);
+  fs::closeFile(*file);
+  if (ec) {
+    return MakeStringError("failed to map file: ", path, ": ", ec.message());
+  }
+
+  void* data = const_cast<char*>(region->const_data());
+  auto buffer = HostBuffer::CreateFromExternal(
+      data, size,
+      [region = std::move(region)](void*, size_t) mutable { region.reset(); });
+  return std::unique_ptr<MappedFileInputStream>(
+      new MappedFileInputStream(std::move(buffer)));
+}
+
+llvm::Expected<size_t> MappedFileInputStream::Read(char* buf, size_t count) {
+  ArrayRef<char> bytes = ReadInPlace(count);
+  if (!bytes.empty()) std::memcpy(buf, bytes.data(), bytes.size());
+  return bytes.size();
+}
+
+ArrayRef<char> MappedFileInputStream::ReadInPlace(size_t count) {
+  count = std::min(count, buffer_->size() - pos_);
+  ArrayRef<char> bytes(static_cast<const char*>(buffer_->data()) + pos_, count);
+  pos_ += count;
+  return bytes;
+}
+
+}  // namespace io
+}  // namespace tfrt
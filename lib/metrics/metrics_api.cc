@@ -0,0 +1,308 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+//===- metrics_api.cc -----------------------------------------------------===//
+//
+// This file provides the built-in implementation of all metrics APIs if
+// ENABLE_TFRT_METRICS is not defined.
+//
+//===----------------------------------------------------------------------===//
+
+#include "tfrt/metrics/metrics_api.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <map>
+#include <memory>
+#include <tuple>
+
+#include "llvm/Support/MathExtras.h"
+#include "tfrt/metrics/metrics_registry.h"
+#include "tfrt/support/mutex.h"
+#include "tfrt/support/thread_annotations.h"
+
+namespace tfrt {
+namespace metrics {
+
+// If ENABLE_TFRT_METRICS is not defined, provide the built-in implementation of
+// the metrics APIs defined in metrics_api.h, which keeps the metrics in this
+// process and exports them with GetMetricsSnapshot(). Otherwise, we assume
+// users will provide their own implementation of all metrics APIs as a library
+// during TFRT compilation.
+
+#if !defined(ENABLE_TFRT_METRICS)
+namespace {
+
+// Counters and histograms are sharded, so that threads updating the same
+// metric mostly write to different cache lines. Each thread updates the shard
+// of its index, which is assigned round robin when the thread first updates a
+// metric.
+constexpr int kNumShards = 16;
+
+int GetShardIndex() {
+  static std::atomic<int> next_shard_index{0};
+  thread_local int shard_index =
+      next_shard_index.fetch_add(1, std::memory_order_relaxed) % kNumShards;
+  return shard_index;
+}
+
+class MetricBase {
+ public:
+  virtual ~MetricBase() {}
+
+  // Sets the value of `snapshot` to the current value of this metric.
+  virtual void Snapshot(MetricSnapshot* snapshot) const = 0;
+};
+
+template <typename T>
+class GaugeImpl;
+
+template <>
+class GaugeImpl<int64_t> : public Gauge<int64_t>, public MetricBase {
+ public:
+  void SetValue(int64_t value) override {
+    value_.store(value, std::memory_order_relaxed);
+  }
+
+  void Snapshot(MetricSnapshot* snapshot) const override {
+    snapshot->value = value_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  std::atomic<int64_t> value_{0};
+};
+
+template <>
+class GaugeImpl<std::string> : public Gauge<std::string>, public MetricBase {
+ public:
+  void SetValue(std::string value) override {
+    mutex_lock lock(mu_);
+    value_ = std::move(value);
+  }
+
+  void Snapshot(MetricSnapshot* snapshot) const override {
+    mutex_lock lock(mu_);
+    snapshot->is_string = true;
+    snapshot->string_value = value_;
+  }
+
+ private:
+  mutable mutex mu_;
+  std::string value_ TFRT_GUARDED_BY(mu_);
+};
+
+class CounterImpl : public Counter, public MetricBase {
+ public:
+  void IncrementBy(int64_t value) override {
+    shards_[GetShardIndex()].value.fetch_add(value, std::memory_order_relaxed);
+  }
+
+  void Snapshot(MetricSnapshot* snapshot) const override {
+    int64_t value = 0;
+    for (const Shard& shard : shards_)
+      value += shard.value.load(std::memory_order_relaxed);
+    snapshot->value = value;
+  }
+
+ private:
+  struct alignas(64) Shard {
+    std::atomic<int64_t> value{0};
+  };
+
+  Shard shards_[kNumShards];
+};
+
+// A histogram with log-linear buckets: the values below 4 have their own
+// buckets, and every power of two above is split into 4 buckets of equal
+// width, so that a bucket is at most 25% wider than its lower bound.
+class HistogramImpl : public Histogram, public MetricBase {
+ public:
+  void Record(int64_t value) override {
+    value = std::max<int64_t>(value, 0);
+    Shard& shard = shards_[GetShardIndex()];
+    shard.buckets[GetBucketIndex(value)].fetch_add(1,
+                                                   std::memory_order_relaxed);
+    shard.sum.fetch_add(value, std::memory_order_relaxed);
+  }
+
+  void Snapshot(MetricSnapshot* snapshot) const override {
+    uint64_t counts[kNumBuckets] = {};
+    int num_buckets = 0;
+    for (int i = 0; i < kNumBuckets; ++i) {
+      for (const Shard& shard : shards_)
+        counts[i] += shard.buckets[i].load(std::memory_order_relaxed);
+      if (counts[i] != 0) num_buckets = i + 1;
+      snapshot->count += counts[i];
+    }
+    // The empty buckets below the last non-empty one are kept, so that the
+    // bucket bounds only change when larger values are recorded.
+    for (int i = 0; i < num_buckets; ++i) {
+      int64_t upper_bound = i + 1 < kNumBuckets
+                                ? GetLowerBound(i + 1) - 1
+                                : std::numeric_limits<int64_t>::max();
+      snapshot->buckets.push_back({GetLowerBound(i), upper_bound, counts[i]});
+    }
+    for (const Shard& shard : shards_)
+      snapshot->sum += shard.sum.load(std::memory_order_relaxed);
+  }
+
+ private:
+  static constexpr int kSubBucketBits = 2;
+  static constexpr int kNumSubBuckets = 1 << kSubBucketBits;
+  // The buckets of [0, 4), and 4 buckets for each power of two up to 2^62.
+  static constexpr int kNumBuckets = (63 - kSubBucketBits + 1) * kNumSubBuckets;
+
+  static int GetBucketIndex(int64_t value) {
+    if (value < kNumSubBuckets) return value;
+    const int exponent = llvm::Log2_64(value);
+    const int sub_bucket =
+        (value >> (exponent - kSubBucketBits)) & (kNumSubBuckets - 1);
+    return (exponent - kSubBucketBits + 1) * kNumSubBuckets + sub_bucket;
+  }
+
+  static int64_t GetLowerBound(int index) {
+    if (index < kNumSubBuckets) return index;
+    const int exponent = index / kNumSubBuckets + kSubBucketBits - 1;
+    const int sub_bucket = index % kNumSubBuckets;
+    return static_cast<int64_t>(kNumSubBuckets + sub_bucket)
+           << (exponent - kSubBucketBits);
+  }
+
+  struct alignas(64) Shard {
+    std::atomic<uint64_t> buckets[kNumBuckets] = {};
+    std::atomic<int64_t> sum{0};
+  };
+
+  Shard shards_[kNumShards];
+};
+
+// All the metrics, by name, labels and type.
+class MetricsRegistry {
+ public:
+  static MetricsRegistry& Get() {
+    static auto* registry = new MetricsRegistry();
+    return *registry;
+  }
+
+  // Returns the metric of type T with the given name and labels, which is
+  // created if it doesn't exist yet.
+  template <typename T>
+  T* GetOrCreate(MetricSnapshot::Kind kind, std::string name,
+                 MetricLabels labels) {
+    static const char type_id = 0;
+    mutex_lock lock(mu_);
+    Entry& entry =
+        metrics_[Key(std::move(name), std::move(labels), &type_id)];
+    if (!entry.metric) {
+      entry.kind = kind;
+      entry.metric = std::make_unique<T>();
+    }
+    return static_cast<T*>(entry.metric.get());
+  }
+
+  int64_t AddCollector(std::function<void()> collector) {
+    mutex_lock lock(collectors_mu_);
+    const int64_t id = next_collector_id_++;
+    collectors_.emplace(id, std::move(collector));
+    return id;
+  }
+
+  void RemoveCollector(int64_t id) {
+    mutex_lock lock(collectors_mu_);
+    collectors_.erase(id);
+  }
+
+  // Runs the collectors. They are run under collectors_mu_, so that a
+  // collector is not running anymore once it is removed, and without mu_,
+  // since they update metrics.
+  void Collect() {
+    mutex_lock lock(collectors_mu_);
+    for (const auto& collector : collectors_) collector.second();
+  }
+
+  // Returns the snapshots sorted by name and labels, since the keys are.
+  std::vector<MetricSnapshot> Snapshot() const {
+    mutex_lock lock(mu_);
+    std::vector<MetricSnapshot> snapshots;
+    snapshots.reserve(metrics_.size());
+    for (const auto& metric : metrics_) {
+      snapshots.emplace_back();
+      MetricSnapshot& snapshot = snapshots.back();
+      snapshot.name = std::get<0>(metric.first);
+      snapshot.labels = std::get<1>(metric.first);
+      snapshot.kind = metric.second.kind;
+      metric.second.metric->Snapshot(&snapshot);
+    }
+    return snapshots;
+  }
+
+ private:
+  // The name, labels and a unique address for the type of a metric.
+  using Key = std::tuple<std::string, MetricLabels, const void*>;
+
+  struct Entry {
+    MetricSnapshot::Kind kind;
+    std::unique_ptr<MetricBase> metric;
+  };
+
+  mutable mutex mu_;
+  std::map<Key, Entry> metrics_ TFRT_GUARDED_BY(mu_);
+
+  mutex collectors_mu_;
+  int64_t next_collector_id_ TFRT_GUARDED_BY(collectors_mu_) = 0;
+  std::map<int64_t, std::function<void()>> collectors_
+      TFRT_GUARDED_BY(collectors_mu_);
+};
+
+}  // namespace
+
+template <typename T>
+Gauge<T>* NewGauge(std::string name) {
+  return MetricsRegistry::Get().GetOrCreate<GaugeImpl<T>>(
+      MetricSnapshot::Kind::kGauge, std::move(name), {});
+}
+
+template Gauge<int64_t>* NewGauge<int64_t>(std::string name);
+template Gauge<std::string>* NewGauge<std::string>(std::string name);
+
+Counter* NewCounter(std::string name, MetricLabels labels) {
+  return MetricsRegistry::Get().GetOrCreate<CounterImpl>(
+      MetricSnapshot::Kind::kCounter, std::move(name), std::move(labels));
+}
+
+Histogram* NewHistogram(std::string name, MetricLabels labels) {
+  return MetricsRegistry::Get().GetOrCreate<HistogramImpl>(
+      MetricSnapshot::Kind::kHistogram, std::move(name), std::move(labels));
+}
+
+std::vector<MetricSnapshot> GetMetricsSnapshot() {
+  MetricsRegistry& registry = MetricsRegistry::Get();
+  registry.Collect();
+  return registry.Snapshot();
+}
+
+int64_t AddMetricsCollector(std::function<void()> collector) {
+  return MetricsRegistry::Get().AddCollector(std::move(collector));
+}
+
+void RemoveMetricsCollector(int64_t id) {
+  MetricsRegistry::Get().RemoveCollector(id);
+}
+#endif
+
+}  // namespace metrics
+}  // namespace tfrt
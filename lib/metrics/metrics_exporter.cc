@@ -0,0 +1,224 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+//===- metrics_exporter.cc ------------------------------------------------===//
+//
+// This file implements the exporters of the built-in metrics implementation.
+//
+//===----------------------------------------------------------------------===//
+
+#include "tfrt/metrics/metrics_exporter.h"
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+
+#include "llvm/Support/Error.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/raw_ostream.h"
+#include "tfrt/support/error_util.h"
+
+namespace tfrt {
+namespace metrics {
+namespace {
+
+// Writes `name` as a Prometheus metric or label name.
+void WriteName(string_view name, raw_ostream& os) {
+  name = name.ltrim('/');
+  for (size_t i = 0; i < name.size(); ++i) {
+    char c = name[i];
+    bool valid = std::isalpha(static_cast<unsigned char>(c)) || c == '_' ||
+                 (i > 0 && std::isdigit(static_cast<unsigned char>(c)));
+    os << (valid ? c : '_');
+  }
+}
+
+// Writes the labels of `metric` and an optional extra label, e.g. `le` of a
+// histogram bucket.
+void WriteLabels(const MetricSnapshot& metric, string_view extra_key,
+                 string_view extra_value, raw_ostream& os) {
+  bool first = true;
+  auto write_label = [&](string_view key, string_view value) {
+    os << (first ? "{" : ",");
+    first = false;
+    WriteName(key, os);
+    os << "=\"";
+    for (char c : value) {
+      if (c == '\\' || c == '"') {
+        os << '\\' << c;
+      } else if (c == '\n') {
+        os << "\\n";
+      } else {
+        os << c;
+      }
+    }
+    os << '"';
+  };
+  for (const auto& label : metric.labels)
+    write_label(label.first, label.second);
+  if (!extra_key.empty()) write_label(extra_key, extra_value);
+  if (!first) os << '}';
+}
+
+void WriteHistogram(const MetricSnapshot& metric, raw_ostream& os) {
+  uint64_t cumulative_count = 0;
+  for (const MetricSnapshot::Bucket& bucket : metric.buckets) {
+    cumulative_count += bucket.count;
+    WriteName(metric.name, os);
+    os << "_bucket";
+    WriteLabels(metric, "le", std::to_string(bucket.upper_bound), os);
+    os << ' ' << cumulative_count << '\n';
+  }
+  WriteName(metric.name, os);
+  os << "_bucket";
+  WriteLabels(metric, "le", "+Inf", os);
+  os << ' ' << metric.count << '\n';
+  WriteName(metric.name, os);
+  os << "_sum";
+  WriteLabels(metric, "", "", os);
+  os << ' ' << metric.sum << '\n';
+  WriteName(metric.name, os);
+  os << "_count";
+  WriteLabels(metric, "", "", os);
+  os << ' ' << metric.count << '\n';
+}
+
+}  // namespace
+
+void WritePrometheusText(ArrayRef<MetricSnapshot> metrics, raw_ostream& os) {
+  const MetricSnapshot* previous = nullptr;
+  for (const MetricSnapshot& metric : metrics) {
+    // The metrics with the same name share their type line.
+    if (!previous || previous->name != metric.name) {
+      os << "# TYPE ";
+      WriteName(metric.name, os);
+      switch (metric.kind) {
+        case MetricSnapshot::Kind::kCounter:
+          os << " counter\n";
+          break;
+        case MetricSnapshot::Kind::kGauge:
+          os << " gauge\n";
+          break;
+        case MetricSnapshot::Kind::kHistogram:
+          os << " histogram\n";
+          break;
+      }
+    }
+    previous = &metric;
+
+    if (metric.kind == MetricSnapshot::Kind::kHistogram) {
+      WriteHistogram(metric, os);
+      continue;
+    }
+    WriteName(metric.name, os);
+    if (metric.is_string) {
+      WriteLabels(metric, "value", metric.string_value, os);
+      os << " 1\n";
+    } else {
+      WriteLabels(metric, "", "", os);
+      os << ' ' << metric.value << '\n';
+    }
+  }
+}
+
+Error WriteMetricsFile(string_view path) {
+  std::string temp_path = (path + ".tmp").str();
+  {
+    std::error_code error_code;
+    llvm::raw_fd_ostream os(temp_path, error_code);
+    if (error_code) {
+      return MakeStringError("failed to open ", temp_path, ": ",
+                             error_code.message());
+    }
+    WritePrometheusText(GetMetricsSnapshot(), os);
+    os.close();
+    if (os.has_error()) return MakeStringError("failed to write ", temp_path);
+  }
+  if (std::error_code error_code = llvm::sys::fs::rename(temp_path, path)) {
+    return MakeStringError("failed to rename ", temp_path, " to ", path, ": ",
+                           error_code.message());
+  }
+  return Error::success();
+}
+
+Expected<std::unique_ptr<MetricsSocketServer>> MetricsSocketServer::Create(
+    string_view path) {
+  sockaddr_un address = {};
+  address.sun_family = AF_UNIX;
+  if (path.size() >= sizeof(address.sun_path))
+    return MakeStringError("socket path is too long: ", path);
+  std::memcpy(address.sun_path, path.data(), path.size());
+
+  int socket_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (socket_fd < 0)
+    return MakeStringError("failed to create socket: ", std::strerror(errno));
+  if (bind(socket_fd, reinterpret_cast<const sockaddr*>(&address),
+           sizeof(address)) != 0 ||
+      listen(socket_fd, /*backlog=*/16) != 0) {
+    auto error = MakeStringError("failed to listen on ", path, ": ",
+                                 std::strerror(errno));
+    close(socket_fd);
+    return std::move(error);
+  }
+  return std::unique_ptr<MetricsSocketServer>(
+      new MetricsSocketServer(path.str(), socket_fd));
+}
+
+MetricsSocketServer::MetricsSocketServer(std::string path, int socket_fd)
+    : path_(std::move(path)), socket_fd_(socket_fd), thread_([this] {
+        Serve();
+      }) {}
+
+MetricsSocketServer::~MetricsSocketServer() {
+  // Shutting down the socket makes the pending accept() fail.
+  shutdown(socket_fd_, SHUT_RDWR);
+  thread_.join();
+  close(socket_fd_);
+  unlink(path_.c_str());
+}
+
+void MetricsSocketServer::Serve() {
+  while (true) {
+    int client_fd = accept(socket_fd_, nullptr, nullptr);
+    if (client_fd < 0) {
+      if (errno == EINTR) continue;
+      return;
+    }
+    std::string text;
+    llvm::raw_string_ostream os(text);
+    WritePrometheusText(GetMetricsSnapshot(), os);
+    os.flush();
+    for (size_t offset = 0; offset < text.size();) {
+#ifdef MSG_NOSIGNAL
+      // Don't raise SIGPIPE if the client disconnects early.
+      ssize_t size = send(client_fd, text.data() + offset,
+                          text.size() - offset, MSG_NOSIGNAL);
+#else
+      ssize_t size =
+          send(client_fd, text.data() + offset, text.size() - offset, 0);
+#endif
+      if (size < 0 && errno == EINTR) continue;
+      if (size <= 0) break;
+      offset += size;
+    }
+    close(client_fd);
+  }
+}
+
+}  // namespace metrics
+}  // namespace tfrt
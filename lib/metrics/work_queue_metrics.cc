@@ -0,0 +1,123 @@
+/*
+ * Copyright 2020 The TensorFlow Runtime Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//===- work_queue_metrics.cc ----------------------------------------------===//
+//
+// This file implements the export of work queue statistics to metrics.
+//
+//===----------------------------------------------------------------------===//
+
+#include "tfrt/metrics/work_queue_metrics.h"
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#include "tfrt/host_context/concurrent_work_queue.h"
+#include "tfrt/host_context/host_context.h"
+#include "tfrt/metrics/metrics_api.h"
+#include "tfrt/metrics/metrics_registry.h"
+
+namespace tfrt {
+namespace metrics {
+namespace {
+
+// Gauges of a group of worker threads, e.g. non-blocking or blocking threads.
+struct WorkerThreadGauges {
+  explicit WorkerThreadGauges(const std::string& prefix)
+      : num_threads(NewGauge<int64_t>(prefix + "/num_threads")),
+        num_tasks_executed(NewGauge<int64_t>(prefix + "/tasks_executed")),
+        num_steal_attempts(NewGauge<int64_t>(prefix + "/steal_attempts")),
+        num_successful_steals(
+            NewGauge<int64_t>(prefix + "/successful_steals")),
+        num_parks(NewGauge<int64_t>(prefix + "/parks")),
+        parked_time(NewGauge<int64_t>(prefix + "/parked_time_us")),
+        active_time(NewGauge<int64_t>(prefix + "/active_time_us")),
+        queue_depth(NewGauge<int64_t>(prefix + "/queue_depth")) {}
+
+  void Set(ArrayRef<WorkerThreadStats> threads) {
+    WorkerThreadStats total;
+    for (const WorkerThreadStats& thread : threads) {
+      total.num_tasks_executed += thread.num_tasks_executed;
+      total.num_steal_attempts += thread.num_steal_attempts;
+      total.num_successful_steals += thread.num_successful_steals;
+      total.num_parks += thread.num_parks;
+      total.parked_time += thread.parked_time;
+      total.active_time += thread.active_time;
+      total.queue_depth += thread.queue_depth;
+    }
+
+    num_threads->SetValue(threads.size());
+    num_tasks_executed->SetValue(total.num_tasks_executed);
+    num_steal_attempts->SetValue(total.num_steal_attempts);
+    num_successful_steals->SetValue(total.num_successful_steals);
+    num_parks->SetValue(total.num_parks);
+    parked_time->SetValue(
+        std::chrono::duration_cast<std::chrono::microseconds>(total.parked_time)
+            .count());
+    active_time->SetValue(
+        std::chrono::duration_cast<std::chrono::microseconds>(total.active_time)
+            .count());
+    queue_depth->SetValue(total.queue_depth);
+  }
+
+  Gauge<int64_t>* num_threads;
+  Gauge<int64_t>* num_tasks_executed;
+  Gauge<int64_t>* num_steal_attempts;
+  Gauge<int64_t>* num_successful_steals;
+  Gauge<int64_t>* num_parks;
+  Gauge<int64_t>* parked_time;
+  Gauge<int64_t>* active_time;
+  Gauge<int64_t>* queue_depth;
+};
+
+struct WorkQueueGauges {
+  WorkQueueGauges()
+      : worker_threads("/tfrt/work_queue/worker_threads"),
+        blocking_threads("/tfrt/work_queue/blocking_threads"),
+        num_dynamic_threads(
+            NewGauge<int64_t>("/tfrt/work_queue/dynamic_threads")),
+        num_idle_dynamic_threads(
+            NewGauge<int64_t>("/tfrt/work_queue/idle_dynamic_threads")) {}
+
+  WorkerThreadGauges worker_threads;
+  WorkerThreadGauges blocking_threads;
+  Gauge<int64_t>* num_dynamic_threads;
+  Gauge<int64_t>* num_idle_dynamic_threads;
+};
+
+}  // namespace
+
+void ExportWorkQueueMetrics(const HostContext& host) {
+  static auto* gauges = new WorkQueueGauges();
+
+  WorkQueueStats stats = host.GetWorkQueueStats();
+  gauges->worker_threads.Set(stats.worker_threads);
+  gauges->blocking_threads.Set(stats.blocking_threads);
+  gauges->num_dynamic_threads->SetValue(stats.num_dynamic_threads);
+  gauges->num_idle_dynamic_threads->SetValue(stats.num_idle_dynamic_threads);
+}
+
+WorkQueueMetricsCollector::WorkQueueMetricsCollector(const HostContext& host)
+    : collector_id_(
+          AddMetricsCollector([&host] { ExportWorkQueueMetrics(host); })) {}
+
+WorkQueueMetricsCollector::~WorkQueueMetricsCollector() {
+  RemoveMetricsCollector(collector_id_);
+}
+
+}  // namespace metrics
+}  // namespace tfrt
@@ -187,6 +187,17 @@ static AsyncValueRef<T> TestCopyWithDelay(Argument<T> in,
   return exec_ctx.host()->MakeAvailableAsyncValueRef<T>(in.get());
 }
 
+// Add two integers after busy looping for `num_iterations` iterations in the
+// caller thread. It is registered as an expensive kernel, and is intended for
+// benchmarking the scheduling of mixed cheap and expensive kernels.
+static int32_t TestExpensiveAddI32(Argument<int32_t> a, Argument<int32_t> b,
+                                   Attribute<int32_t> num_iterations) {
+  // Use a volatile counter to keep the compiler from removing the loop.
+  volatile int32_t counter = 0;
+  for (int32_t i = 0; i < *num_iterations; ++i) counter = counter + 1;
+  return *a + *b;
+}
+
 //===----------------------------------------------------------------------===//
 // tfrt_test count3 kernels. For input x, returns x+1, x+2, x+3
 // For demonstrating using std::tuple to return multiple outputs
@@ -209,6 +220,8 @@ void RegisterSimpleKernels(KernelRegistry* registry) {
                       TFRT_KERNEL(TestCopyWithDelay<int32_t>));
   registry->AddKernel("tfrt_test.copy.with_delay.i64",
                       TFRT_KERNEL(TestCopyWithDelay<int64_t>));
+  registry->AddKernel("tfrt_test.expensive_add.i32",
+                      TFRT_KERNEL(TestExpensiveAddI32), KernelCost::kExpensive);
 
   SetupStringRegistry(registry);
   SetupValueTrackingRegistry(registry);
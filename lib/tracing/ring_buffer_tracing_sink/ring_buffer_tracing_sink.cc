@@ -0,0 +1,350 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+//===- ring_buffer_tracing_sink.cc - Ring Buffer Tracing Sink -------------===//
+//
+// This file implements a tracing sink which records activities into per-thread
+// ring buffers and exports them in the Chrome trace event format.
+//
+//===----------------------------------------------------------------------===//
+
+#include "tfrt/tracing/ring_buffer_tracing_sink/ring_buffer_tracing_sink.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+
+#include "llvm/Support/Error.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/raw_ostream.h"
+#include "tfrt/support/error_util.h"
+
+namespace tfrt {
+namespace tracing {
+
+namespace {
+
+const auto kProcessStart = std::chrono::steady_clock::now();
+
+int64_t NowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now() - kProcessStart)
+      .count();
+}
+
+// The end of a scope which is not popped yet.
+constexpr int64_t kOpenScope = -1;
+
+enum class ActivityKind : uint8_t { kEvent, kScope };
+
+// An activity in a ring buffer. The activity with index `i` (counting all the
+// activities recorded by the thread) is written to slot `i % capacity`. Like a
+// seqlock, `version` is 2 * i + 1 while the owning thread writes the slot, and
+// 2 * i + 2 after, so that a concurrent reader can tell whether it read a
+// complete activity.
+struct alignas(64) Activity {
+  std::atomic<uint64_t> version{0};
+  const char* category;
+  int64_t start_ns;
+  int64_t end_ns;
+  // See GetTracingRequestId().
+  uint64_t request_id;
+  // The id of the name if it is interned, otherwise the name is stored below.
+  uint32_t name_id;
+  ActivityKind kind;
+  bool interned;
+  uint8_t name_size;
+  char name[RingBufferTracingSink::kMaxNameSize];
+};
+static_assert(sizeof(Activity) == 128, "Activity should fill 2 cache lines");
+
+void SetName(Activity& activity, string_view name) {
+  activity.interned = false;
+  activity.name_size =
+      std::min(name.size(), RingBufferTracingSink::kMaxNameSize);
+  std::memcpy(activity.name, name.data(), activity.name_size);
+}
+
+void SetName(Activity& activity, InternedTracingName name) {
+  activity.interned = true;
+  activity.name_id = name.id;
+}
+
+// A copy of an activity read by Flush().
+struct ActivityCopy {
+  const char* category;
+  int64_t start_ns;
+  int64_t end_ns;
+  uint64_t request_id;
+  ActivityKind kind;
+  string_view name;
+  char name_buffer[RingBufferTracingSink::kMaxNameSize];
+};
+
+// The buffer of the calling thread, for the sink with id `sink_id`.
+struct ThreadBufferCache {
+  uint64_t sink_id = 0;
+  void* buffer = nullptr;
+};
+thread_local ThreadBufferCache thread_buffer_cache;
+
+std::atomic<uint64_t> next_sink_id{1};
+
+// Writes `value` as a JSON string.
+void WriteJsonString(raw_ostream& os, string_view value) {
+  os << '"';
+  for (char c : value) {
+    switch (c) {
+      case '"':
+        os << "\\\"";
+        break;
+      case '\\':
+        os << "\\\\";
+        break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20) {
+          os << llvm::format("\\u%04x", c);
+        } else {
+          os << c;
+        }
+    }
+  }
+  os << '"';
+}
+
+// Writes a time in nanoseconds as the microseconds of the trace event format.
+void WriteMicroseconds(raw_ostream& os, int64_t ns) {
+  os << llvm::format("%.3f", ns / 1000.0);
+}
+
+}  // namespace
+
+struct RingBufferTracingSink::ThreadBuffer {
+  // The maximum depth of the recorded scopes. Deeper scopes are not recorded.
+  static constexpr int kMaxScopeDepth = 128;
+
+  ThreadBuffer(size_t capacity, int tid)
+      : activities(new Activity[capacity]), capacity(capacity), tid(tid) {}
+
+  Activity& GetActivity(uint64_t index) {
+    return activities[index & (capacity - 1)];
+  }
+
+  // Records an activity and returns its index.
+  template <typename Name>
+  uint64_t Write(ActivityKind kind, const char* category, Name name,
+                 int64_t start_ns, int64_t end_ns) {
+    const uint64_t index = head.load(std::memory_order_relaxed);
+    Activity& activity = GetActivity(index);
+    activity.version.store(2 * index + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    activity.category = category;
+    activity.start_ns = start_ns;
+    activity.end_ns = end_ns;
+    activity.request_id = GetTracingRequestId();
+    activity.kind = kind;
+    SetName(activity, name);
+    activity.version.store(2 * index + 2, std::memory_order_release);
+    head.store(index + 1, std::memory_order_release);
+    return index;
+  }
+
+  // Sets the end of the scope with activity `index`, unless the activity has
+  // been overwritten by newer activities.
+  void EndScope(uint64_t index, int64_t end_ns) {
+    if (head.load(std::memory_order_relaxed) - index > capacity) return;
+    Activity& activity = GetActivity(index);
+    activity.version.store(2 * index + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    activity.end_ns = end_ns;
+    activity.version.store(2 * index + 2, std::memory_order_release);
+  }
+
+  const std::unique_ptr<Activity[]> activities;
+  const size_t capacity;
+  const int tid;
+  // The number of activities recorded by the thread. Only the owning thread
+  // writes it.
+  std::atomic<uint64_t> head{0};
+
+  // The state below is only accessed by the owning thread.
+  // The indices of the activities of the open scopes.
+  uint64_t scopes[kMaxScopeDepth];
+  int depth = 0;
+
+  // The index of the first activity that is not flushed yet. Only accessed
+  // with the mu_ of the sink held.
+  uint64_t flushed = 0;
+};
+
+RingBufferTracingSink::RingBufferTracingSink(Options options)
+    : options_(std::move(options)),
+      id_(next_sink_id.fetch_add(1, std::memory_order_relaxed)),
+      capacity_(llvm::PowerOf2Ceil(std::max<size_t>(
+          options_.capacity_per_thread, 1))) {}
+
+RingBufferTracingSink::~RingBufferTracingSink() = default;
+
+RingBufferTracingSink::ThreadBuffer* RingBufferTracingSink::GetThreadBuffer() {
+  ThreadBufferCache& cache = thread_buffer_cache;
+  if (cache.sink_id == id_) return static_cast<ThreadBuffer*>(cache.buffer);
+
+  // The cache holds the buffer of another sink if the thread records into
+  // several sinks, in which case the buffer of this sink may already exist.
+  mutex_lock lock(mu_);
+  ThreadBuffer*& buffer = thread_buffers_[std::this_thread::get_id()];
+  if (!buffer) {
+    buffers_.push_back(
+        std::make_unique<ThreadBuffer>(capacity_, buffers_.size() + 1));
+    buffer = buffers_.back().get();
+  }
+  cache.sink_id = id_;
+  cache.buffer = buffer;
+  return buffer;
+}
+
+Error RingBufferTracingSink::RequestTracing(bool enable) {
+  if (!enable && !options_.output_path.empty())
+    return Flush(options_.output_path);
+  return Error::success();
+}
+
+template <typename Name>
+void RingBufferTracingSink::RecordEvent(const char* category, Name name) {
+  const int64_t now = NowNs();
+  GetThreadBuffer()->Write(ActivityKind::kEvent, category, name, now, now);
+}
+
+template <typename Name>
+void RingBufferTracingSink::PushScope(const char* category, Name name) {
+  ThreadBuffer* buffer = GetThreadBuffer();
+  if (buffer->depth < ThreadBuffer::kMaxScopeDepth) {
+    buffer->scopes[buffer->depth] = buffer->Write(
+        ActivityKind::kScope, category, name, NowNs(), kOpenScope);
+  }
+  ++buffer->depth;
+}
+
+void RingBufferTracingSink::RecordTracingEvent(const char* category,
+                                               string_view name) {
+  RecordEvent(category, name);
+}
+
+void RingBufferTracingSink::RecordTracingEvent(const char* category,
+                                               InternedTracingName name) {
+  RecordEvent(category, name);
+}
+
+void RingBufferTracingSink::PushTracingScope(const char* category,
+                                             string_view name) {
+  PushScope(category, name);
+}
+
+void RingBufferTracingSink::PushTracingScope(const char* category,
+                                             InternedTracingName name) {
+  PushScope(category, name);
+}
+
+void RingBufferTracingSink::PopTracingScope() {
+  ThreadBuffer* buffer = GetThreadBuffer();
+  if (buffer->depth == 0) return;
+  if (--buffer->depth >= ThreadBuffer::kMaxScopeDepth) return;
+
+  buffer->EndScope(buffer->scopes[buffer->depth], NowNs());
+}
+
+// Copies the activity with `index` from `activity` into `copy`. Returns false
+// if the activity is being written or has been overwritten.
+static bool ReadActivity(const Activity& activity, uint64_t index,
+                         ActivityCopy* copy) {
+  const uint64_t version = activity.version.load(std::memory_order_acquire);
+  if (version != 2 * index + 2) return false;
+  copy->category = activity.category;
+  copy->start_ns = activity.start_ns;
+  copy->end_ns = activity.end_ns;
+  copy->request_id = activity.request_id;
+  copy->kind = activity.kind;
+  const bool interned = activity.interned;
+  const uint32_t name_id = activity.name_id;
+  const size_t name_size =
+      std::min<size_t>(activity.name_size, RingBufferTracingSink::kMaxNameSize);
+  std::memcpy(copy->name_buffer, activity.name, name_size);
+  std::atomic_thread_fence(std::memory_order_acquire);
+  if (activity.version.load(std::memory_order_relaxed) != version)
+    return false;
+  copy->name = interned ? GetInternedTracingName({name_id})
+                        : string_view(copy->name_buffer, name_size);
+  return true;
+}
+
+void RingBufferTracingSink::Flush(raw_ostream& os) {
+  mutex_lock lock(mu_);
+  uint64_t num_dropped = 0;
+  bool first = true;
+  os << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+  for (const auto& buffer : buffers_) {
+    const uint64_t head = buffer->head.load(std::memory_order_acquire);
+    uint64_t begin = buffer->flushed;
+    if (head - begin > capacity_) begin = head - capacity_;
+    num_dropped += begin - buffer->flushed;
+
+    for (uint64_t index = begin; index < head; ++index) {
+      ActivityCopy activity;
+      if (!ReadActivity(buffer->GetActivity(index), index, &activity)) {
+        ++num_dropped;
+        continue;
+      }
+      os << (first ? "\n" : ",\n") << "{\"name\":";
+      first = false;
+      WriteJsonString(os, activity.name);
+      if (activity.category) {
+        os << ",\"cat\":";
+        WriteJsonString(os, activity.category);
+      }
+      os << ",\"pid\":0,\"tid\":" << buffer->tid << ",\"ts\":";
+      WriteMicroseconds(os, activity.start_ns);
+      if (activity.request_id != 0)
+        os << ",\"args\":{\"request_id\":" << activity.request_id << "}";
+      if (activity.kind == ActivityKind::kEvent) {
+        os << ",\"ph\":\"i\",\"s\":\"t\"}";
+      } else if (activity.end_ns == kOpenScope) {
+        os << ",\"ph\":\"B\"}";
+      } else {
+        os << ",\"ph\":\"X\",\"dur\":";
+        WriteMicroseconds(os, activity.end_ns - activity.start_ns);
+        os << "}";
+      }
+    }
+    buffer->flushed = head;
+  }
+  os << "\n],\"otherData\":{\"dropped_activities\":" << num_dropped << "}}\n";
+  os.flush();
+}
+
+Error RingBufferTracingSink::Flush(string_view path) {
+  std::error_code error_code;
+  llvm::raw_fd_ostream os(path, error_code);
+  if (error_code) {
+    return MakeStringError("failed to open ", path, ": ",
+                           error_code.message());
+  }
+  Flush(os);
+  if (os.has_error()) return MakeStringError("failed to write ", path);
+  return Error::success();
+}
+
+}  // namespace tracing
+}  // namespace tfrt
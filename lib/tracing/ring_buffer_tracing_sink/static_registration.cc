@@ -0,0 +1,38 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+//===- static_registration.cc ---------------------------------------------===//
+//
+// This file uses a static constructor to automatically register the ring
+// buffer tracing sink. The trace is written to the file named by the
+// TFRT_TRACE_FILE environment variable whenever tracing is disabled.
+//
+//===----------------------------------------------------------------------===//
+
+#include <cstdlib>
+
+#include "tfrt/tracing/ring_buffer_tracing_sink/ring_buffer_tracing_sink.h"
+#include "tfrt/tracing/tracing.h"
+
+namespace tfrt {
+namespace tracing {
+static const bool kRegisterTracingSink = [] {
+  RingBufferTracingSink::Options options;
+  if (const char* path = std::getenv("TFRT_TRACE_FILE"))
+    options.output_path = path;
+  RegisterTracingSink(new RingBufferTracingSink(std::move(options)));
+  return true;
+}();
+}  // namespace tracing
+}  // namespace tfrt
@@ -22,6 +22,7 @@
 #include <cassert>
 #include <mutex>
 
+#include "llvm/ADT/StringMap.h"
 #include "llvm/Support/Error.h"
 
 namespace tfrt {
@@ -44,8 +45,77 @@ void TracingSink::PushTracingScope(const char* category, std::string&& name) {
   PushTracingScope(category, string_view(name));
 }
 
+void TracingSink::RecordTracingEvent(const char* category,
+                                     InternedTracingName name) {
+  RecordTracingEvent(category, GetInternedTracingName(name));
+}
+
+void TracingSink::PushTracingScope(const char* category,
+                                   InternedTracingName name) {
+  PushTracingScope(category, GetInternedTracingName(name));
+}
+
+namespace {
+// The interned tracing names. The names are stored in chunks which are never
+// moved or freed, so that they can be looked up without taking the lock.
+class InternedNameTable {
+ public:
+  InternedNameTable() {
+    // Id 0 is returned when the table is full.
+    Intern("(too many interned tracing names)");
+  }
+
+  InternedTracingName Intern(string_view name) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    uint32_t id = ids_.size();
+    auto result = ids_.try_emplace(name, id);
+    if (!result.second) return {result.first->second};
+    if (id >= kNumChunks * kChunkSize) {
+      ids_.erase(result.first);
+      return {0};
+    }
+    auto& chunk = chunks_[id / kChunkSize];
+    if (id % kChunkSize == 0)
+      chunk.store(new string_view[kChunkSize], std::memory_order_release);
+    chunk.load(std::memory_order_relaxed)[id % kChunkSize] =
+        result.first->first();
+    return {id};
+  }
+
+  string_view Lookup(InternedTracingName name) const {
+    assert(name.id < kNumChunks * kChunkSize);
+    auto* chunk = chunks_[name.id / kChunkSize].load(std::memory_order_acquire);
+    assert(chunk && "Invalid interned tracing name");
+    return chunk[name.id % kChunkSize];
+  }
+
+ private:
+  static constexpr uint32_t kChunkSize = 1024;
+  static constexpr uint32_t kNumChunks = 1024;
+
+  std::mutex mutex_;
+  llvm::StringMap<uint32_t> ids_;
+  std::atomic<string_view*> chunks_[kNumChunks] = {};
+};
+
+InternedNameTable& GetInternedNameTable() {
+  static auto table = new InternedNameTable;
+  return *table;
+}
+}  // namespace
+
+InternedTracingName InternTracingName(string_view name) {
+  return GetInternedNameTable().Intern(name);
+}
+
+string_view GetInternedTracingName(InternedTracingName name) {
+  return GetInternedNameTable().Lookup(name);
+}
+
 TracingSink* internal::kTracingSink = nullptr;
 std::atomic<int> internal::kIsTracingEnabled(0);
+thread_local uint64_t internal::kTracingRequestId = 0;
+std::atomic<bool> internal::kHasSampledRequests(false);
 
 static std::mutex& GetTracingMutex() {
   static auto mutex = new std::mutex;
@@ -73,5 +143,19 @@ void RequestTracing(bool enable) {
   consumeError(internal::kTracingSink->RequestTracing(enable));
 }
 
+uint64_t TracingSampler::Sample(bool force) {
+#ifdef TFRT_DISABLE_TRACING
+  return 0;
+#else
+  if (internal::kTracingSink == nullptr) return 0;
+  if (!force) {
+    uint64_t index = num_requests_.fetch_add(1, std::memory_order_relaxed);
+    if (sampling_period_ == 0 || index % sampling_period_ != 0) return 0;
+  }
+  static std::atomic<uint64_t> next_request_id{1};
+  return next_request_id.fetch_add(1, std::memory_order_relaxed);
+#endif
+}
+
 }  // namespace tracing
 }  // namespace tfrt
@@ -13,6 +13,7 @@
 // limitations under the License.
 
 // RUN: bef_executor -work_queue_type=s $(bef_name %s) | FileCheck %s --dump-input=fail
+// RUN: bef_executor -work_queue_type=s -request_arena $(bef_name %s) | FileCheck %s --dump-input=fail
 
 // NOTE: This test is intentionally not using chains to sequence side effecting
 // kernels according to common sense.  This is to make sure the executor is
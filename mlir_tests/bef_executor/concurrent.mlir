@@ -16,6 +16,11 @@
 
 // RUN: bef_executor $(bef_name %s) | FileCheck %s --dump-input=fail
 // RUN: bef_executor -work_queue_type=mstd $(bef_name %s) | FileCheck %s --dump-input=fail
+// RUN: bef_executor -work_queue_type=mstd -parallel_dispatch_threshold=1 $(bef_name %s) | FileCheck %s --dump-input=fail
+// RUN: bef_executor -work_queue_type=mstd -request_arena $(bef_name %s) | FileCheck %s --dump-input=fail
+// RUN: bef_executor -work_queue_type=mstd -host_allocator_type=size_class_allocator $(bef_name %s) | FileCheck %s --dump-input=fail
+// RUN: bef_executor -work_queue_type=mstd:numa $(bef_name %s) | FileCheck %s --dump-input=fail
+// RUN: bef_executor -work_queue_type=mstd:4,2,spinning_threads=0 $(bef_name %s) | FileCheck %s --dump-input=fail
 
 // Asynchronously increment %counter once.
 func @async_incs(%counter : !test.atomic.i32, %ch : !tfrt.chain) -> !tfrt.chain {
@@ -185,3 +190,23 @@ func @repeated_blocking_sleep2() -> i32 {
   // CHECK: Slept for 1299 microseconds
   tfrt.return %a1 : i32
 }
+
+// This tests that expensive kernels dispatched to the work queue still produce
+// the results their users wait for.
+// CHECK-LABEL: --- Running 'mixed_cost_kernels'
+func @mixed_cost_kernels() -> i32 {
+  %a = tfrt.constant.i32 1
+  %c0 = tfrt.constant.i32 0
+
+  %e1 = "tfrt_test.expensive_add.i32"(%c0, %a) {num_iterations = 1000 : i32} : (i32, i32) -> i32
+  %c1 = tfrt.add.i32 %c0, %a
+  %e2 = "tfrt_test.expensive_add.i32"(%c1, %a) {num_iterations = 1000 : i32} : (i32, i32) -> i32
+  %c2 = tfrt.add.i32 %c1, %a
+  %e3 = "tfrt_test.expensive_add.i32"(%c2, %a) {num_iterations = 1000 : i32} : (i32, i32) -> i32
+  %c3 = tfrt.add.i32 %c2, %a
+
+  %s = "tfrt_test.sum"(%c3, %e1, %e2, %e3) : (i32, i32, i32, i32) -> i32
+
+  // CHECK: 'mixed_cost_kernels' returned 9
+  tfrt.return %s : i32
+}
@@ -13,6 +13,7 @@
 // limitations under the License.
 
 // RUN: bef_executor $(bef_name %s) | FileCheck %s --dump-input=fail
+// RUN: bef_executor -request_arena $(bef_name %s) | FileCheck %s --dump-input=fail
 
 // CHECK-LABEL: --- Running 'test_linear'
 func @test_linear() {
@@ -0,0 +1,42 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// RUN: bef_executor -profile_kernels $(bef_name %s) 2>&1 | FileCheck %s --dump-input=fail
+
+// CHECK-LABEL: --- Running 'repeat_add'
+func @repeat_add() -> i32 {
+  %count = tfrt.constant.i32 5
+  %v0 = tfrt.constant.i32 0
+
+  // The kernels of the body are profiled too.
+  %sum = tfrt.repeat.i32 %count, %v0 : i32 {
+    %one = tfrt.constant.i32 1
+    %v1 = tfrt.add.i32 %v0, %one
+    tfrt.return %v1 : i32
+  }
+
+  tfrt.return %sum : i32
+}
+// CHECK: 'repeat_add' returned 5
+
+// CHECK-LABEL: --- Running 'fail'
+func @fail() -> i32 {
+  %x = "tfrt_test.fail"() : () -> i32 // expected-error {{something bad happened}}
+  tfrt.return %x : i32
+}
+
+// CHECK-LABEL: --- Kernel profile:
+// CHECK-NEXT: calls errors total_ms avg_us p99_us max_us kernel (slowest call)
+// CHECK-DAG: {{ +}}5 {{ +}}0 {{.*}} tfrt.add.i32 ({{.*}}:{{[0-9]+}}:{{[0-9]+}})
+// CHECK-DAG: {{ +}}1 {{ +}}1 {{.*}} tfrt_test.fail ({{.*}}:{{[0-9]+}}:{{[0-9]+}})
@@ -0,0 +1,33 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+// RUN: bef_executor -profile_kernels $(bef_name %s) 2>&1 | FileCheck %s --dump-input=fail
+
+// The kernels below come from different source files, so their locations
+// refer to different entries of the LocationFilenames section.
+
+// CHECK-LABEL: --- Running 'multiple_files'
+func @multiple_files() -> i32 {
+  %one = tfrt.constant.i32 1 loc("first.mlir":3:7)
+  %two = tfrt.add.i32 %one, %one loc("second.mlir":5:9)
+  %quot, %rem = tfrt.div.i32 %two, %one loc("third.mlir":11:2)
+  tfrt.return %quot : i32
+}
+// CHECK: 'multiple_files' returned 2
+
+// CHECK-LABEL: --- Kernel profile:
+// CHECK-DAG: tfrt.constant.i32 (first.mlir:3:7)
+// CHECK-DAG: tfrt.add.i32 (second.mlir:5:9)
+// CHECK-DAG: tfrt.div.i32 (third.mlir:11:2)
@@ -135,6 +135,97 @@ def generate_star_mlir(num_kernels):
   return generate_benchmark_mlir('BM_star_{}'.format(num_kernels), body)
 
 
+def generate_function_call_mlir(num_kernels):
+  """Benchmark the per-call overhead of BEFExecutor.
+
+  Generate a serial chain of calls to a small BEF function, so that the
+  benchmark is dominated by the cost of setting up each function execution.
+  """
+
+  body = """
+  // The pseudo-code for this mlir function is as follows:
+  //
+  // c0 = 1
+  // c1 = callee(c0)
+  // c2 = callee(c1)
+  // c3 = callee(c2)
+  // ...
+  // Each call to callee runs a new BEFExecutor.
+
+  %c0 = tfrt.constant.i32 1
+"""
+
+  def gen_line(c):
+    return '  %c{} = tfrt.call @function_call_callee(%c{}) : (i32) -> i32'.format(
+        c + 1, c)
+
+  body += '\n'.join([gen_line(c) for c in range(num_kernels)])
+  # Add return statement.
+  body += '\n  tfrt.return %c{} : i32'.format(num_kernels)
+
+  callee = """
+func @function_call_callee(%x: i32) -> i32 {
+  %a = tfrt.constant.i32 1
+  %y0 = tfrt.add.i32 %x, %a
+  %y1 = tfrt.add.i32 %y0, %a
+  %y2 = tfrt.add.i32 %y1, %a
+  %y3 = tfrt.add.i32 %y2, %a
+  tfrt.return %y3 : i32
+}
+"""
+
+  return generate_benchmark_mlir('BM_function_call_{}'.format(num_kernels),
+                                 body) + callee
+
+
+def generate_mixed_cost_mlir(num_kernels):
+  """Generate a DAG that mixes cheap and expensive kernels.
+
+  The cheap kernels form a serial critical path, and each of them feeds an
+  expensive kernel that is off the critical path.
+  """
+
+  body = """
+  // The pseudo-code for this mlir function is as follows:
+  //
+  // a = 1
+  // c0 = 1
+  // e1 = expensive_add(c0, a)
+  // c1 = c0 + a
+  // e2 = expensive_add(c1, a)
+  // c2 = c1 + a
+  // ...
+  // s = sum(c_n, e1, e2, ...)
+  //
+  // The c_i's need to be computed in serial, while the expensive e_i's can be
+  // computed in parallel with them.
+
+  %a = tfrt.constant.i32 1
+  %c0 = tfrt.constant.i32 1
+"""
+
+  def gen_lines(c):
+    return ('  %e{e} = "tfrt_test.expensive_add.i32"(%c{c}, %a) '
+            '{{num_iterations = 10000 : i32}} : (i32, i32) -> i32\n'
+            '  %c{e} = "tfrt.add.i32"(%c{c}, %a) : (i32, i32) -> i32').format(
+                c=c, e=c + 1)
+
+  # Construct sum statement:
+  # %s = "tfrt_test.sum"(%cn, %e1, %e2, ...) : (i32, ..., i32) -> i32
+  sum_line = '  %s = "tfrt_test.sum"({args}) : ({arg_types}) -> i32'.format(
+      args=', '.join(['%c{}'.format(num_kernels)] +
+                     ['%e{}'.format(i + 1) for i in range(num_kernels)]),
+      arg_types=', '.join(['i32' for i in range(num_kernels + 1)]),
+  )
+
+  body += '\n'.join([gen_lines(c) for c in range(num_kernels)])
+  body += ('\n' + sum_line)
+  # Add return statement.
+  body += '\n  tfrt.return %s : i32'
+
+  return generate_benchmark_mlir('BM_mixed_cost_{}'.format(num_kernels), body)
+
+
 def generate_dense_host_tensor(num_kernels):
   """Benchmark DHTIndexableView overhead.
 
@@ -207,12 +298,72 @@ def generate_host_tensor(num_kernels):
   return generate_benchmark_mlir('BM_HostTensor_{}'.format(num_kernels), body)
 
 
+def generate_map_and_batch_mlir(num_kernels):
+  """Benchmark data.map_and_batch_dataset against map_dataset + batch_dataset.
+
+  Generate two benchmarks that each fill a 4KB tensor for num_kernels elements
+  and batch the results, one with the fused dataset that fills the rows of the
+  batch and one with data.map_dataset followed by data.batch_dataset.
+  """
+
+  def gen_body(datasets):
+    return """
+  // The pseudo-code for this mlir function is as follows:
+  //
+  // d = range(0, n)
+  // d = map_and_batch(d, fill_row, n)   or   batch(map(d, make_tensor), n)
+  // t = get_next(make_iterator(d))
+
+  %start = tfrt.constant.i64 0
+  %stop = tfrt.constant.i64 {num_kernels}
+  %step = tfrt.constant.i64 1
+  %batch_size = tfrt.constant.i64 {num_kernels}
+  %dataset0 = data.range_dataset %start, %stop, %step {{element_type = i64}}
+{datasets}
+  %iterator = data.make_iterator %dataset
+  %ch0 = tfrt.new.chain
+  %ch1, %t = data.iterator_get_next (%iterator, %ch0) : !t.tensor
+  tfrt.return %t : !t.tensor
+""".format(num_kernels=num_kernels, datasets=datasets)
+
+  fused = gen_body("""
+  %dataset = data.map_and_batch_dataset %dataset0, %batch_size {function = @map_and_batch_fill_row, element_type = f32, element_shape = [1024]}
+""")
+  unfused = gen_body("""
+  %dataset1 = data.map_dataset %dataset0 {function = @map_and_batch_make_tensor}
+  %dataset = data.batch_dataset.tensor %dataset1, %batch_size {same_input_metadata = 1 : i1}
+""")
+
+  map_fns = """
+func @map_and_batch_fill_row(%x: i64, %row: !t.tensor) -> !tfrt.chain {
+  %ch0 = tfrt.new.chain
+  %ch1 = tfrt_dht.fill_tensor_with_constant.f32 %row, %ch0 1.0 : f32
+  tfrt.return %ch1 : !tfrt.chain
+}
+
+func @map_and_batch_make_tensor(%x: i64) -> !t.tensor {
+  %ch0 = tfrt.new.chain
+  %t = tfrt_dht.create_uninitialized_tensor.f32.1 [1024 : i64]
+  %ch1 = tfrt_dht.fill_tensor_with_constant.f32 %t, %ch0 1.0 : f32
+  tfrt.return %t : !t.tensor
+}
+"""
+
+  return (generate_benchmark_mlir('BM_map_and_batch_{}'.format(num_kernels),
+                                  fused) +
+          generate_benchmark_mlir('BM_map_then_batch_{}'.format(num_kernels),
+                                  unfused) + map_fns)
+
+
 def main():
   generator_map = {
       'fully_serial': generate_fully_serial_mlir,
       'fully_parallel': generate_fully_parallel_mlir,
       'star': generate_star_mlir,
+      'function_call': generate_function_call_mlir,
+      'mixed_cost': generate_mixed_cost_mlir,
       'dense_host_tensor': generate_dense_host_tensor,
+      'map_and_batch': generate_map_and_batch_mlir,
   }
   gen_benchmark_mlir_main(generator_map)
 
@@ -0,0 +1,198 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+// RUN: rm -f cache_dataset_test.cache
+// RUN: bef_executor $(bef_name %s) 2>&1 | FileCheck %s --dump-input=fail
+// The second run reads the cache file written by the first run.
+// RUN: bef_executor $(bef_name %s) 2>&1 | FileCheck %s --dump-input=fail
+// RUN: rm -f cache_dataset_test.cache
+
+func @times_two(%x : i64) -> i64 {
+  %y = tfrt.add.i64 %x, %x
+  tfrt.return %y : i64
+}
+
+// An empty filename caches the elements in memory.
+// CHECK-LABEL: --- Running 'cache_dataset_in_memory'
+func @cache_dataset_in_memory() -> !tfrt.chain {
+  %start = tfrt.constant.i64 0
+  %stop = tfrt.constant.i64 3
+  %step = tfrt.constant.i64 1
+  %dataset0 = data.range_dataset %start, %stop, %step {element_type = i64}
+  %dataset1 = data.map_dataset %dataset0 {function = @times_two}
+  %filename = "tfrt_test.get_string"() { value = "" } : () -> !tfrt.string
+  %dataset2 = data.cache_dataset %dataset1, %filename
+  %count = tfrt.constant.i64 2
+  %dataset3 = data.repeat_dataset %dataset2, %count
+  %iterator = data.make_iterator %dataset3
+  %ch0 = tfrt.new.chain
+
+  %ch1, %v0 = data.iterator_get_next (%iterator, %ch0) : i64
+  // CHECK: int64 = 0
+  %ch2 = tfrt.print.i64 %v0, %ch1
+
+  %ch3, %v1 = data.iterator_get_next (%iterator, %ch2) : i64
+  // CHECK: int64 = 2
+  %ch4 = tfrt.print.i64 %v1, %ch3
+
+  %ch5, %v2 = data.iterator_get_next (%iterator, %ch4) : i64
+  // CHECK: int64 = 4
+  %ch6 = tfrt.print.i64 %v2, %ch5
+
+  // The second repetition reads the cached elements.
+  %ch7, %v3 = data.iterator_get_next (%iterator, %ch6) : i64
+  // CHECK: int64 = 0
+  %ch8 = tfrt.print.i64 %v3, %ch7
+
+  %ch9, %v4 = data.iterator_get_next (%iterator, %ch8) : i64
+  // CHECK: int64 = 2
+  %ch10 = tfrt.print.i64 %v4, %ch9
+
+  %ch11, %v5 = data.iterator_get_next (%iterator, %ch10) : i64
+  // CHECK: int64 = 4
+  %ch12 = tfrt.print.i64 %v5, %ch11
+
+  // expected-error @+1 {{iterator reached end}}
+  %ch13, %v6 = data.iterator_get_next (%iterator, %ch12) : i64
+  %ch14 = tfrt.print.i64 %v6, %ch13
+
+  tfrt.return %ch14 : !tfrt.chain
+}
+// CHECK: 'cache_dataset_in_memory' returned <<error: iterator reached end>>
+
+func @twelve_divided_by(%x : i64) -> i64 {
+  %twelve = tfrt.constant.i64 12
+  // The error is only emitted once, since the second repetition reads the
+  // cached error instead of calling the function again.
+  // expected-error @+1 {{Divide by zero}}
+  %quot, %rem = tfrt.div.i64 %twelve, %x
+  tfrt.return %quot : i64
+}
+
+// CHECK-LABEL: --- Running 'cache_dataset_in_memory_error'
+func @cache_dataset_in_memory_error() -> !tfrt.chain {
+  %start = tfrt.constant.i64 -1
+  %stop = tfrt.constant.i64 2
+  %step = tfrt.constant.i64 1
+  %dataset0 = data.range_dataset %start, %stop, %step {element_type = i64}
+  %dataset1 = data.map_dataset %dataset0 {function = @twelve_divided_by}
+  %filename = "tfrt_test.get_string"() { value = "" } : () -> !tfrt.string
+  %dataset2 = data.cache_dataset %dataset1, %filename
+  %count = tfrt.constant.i64 2
+  %dataset3 = data.repeat_dataset %dataset2, %count
+  %iterator = data.make_iterator %dataset3
+  %ch0 = tfrt.new.chain
+
+  %ch1, %v0 = data.iterator_get_next (%iterator, %ch0) : i64
+  // CHECK: int64 = -12
+  %ch2 = tfrt.print.i64 %v0, %ch1
+
+  // The value is the error of 12 / 0.
+  %ch3, %v1 = data.iterator_get_next (%iterator, %ch2) : i64
+
+  %ch4, %v2 = data.iterator_get_next (%iterator, %ch3) : i64
+  // CHECK: int64 = 12
+  %ch5 = tfrt.print.i64 %v2, %ch4
+
+  %ch6, %v3 = data.iterator_get_next (%iterator, %ch5) : i64
+  // CHECK: int64 = -12
+  %ch7 = tfrt.print.i64 %v3, %ch6
+
+  // The value is the cached error.
+  %ch8, %v4 = data.iterator_get_next (%iterator, %ch7) : i64
+
+  %ch9, %v5 = data.iterator_get_next (%iterator, %ch8) : i64
+  // CHECK: int64 = 12
+  %ch10 = tfrt.print.i64 %v5, %ch9
+
+  // expected-error @+1 {{iterator reached end}}
+  %ch11, %v6 = data.iterator_get_next (%iterator, %ch10) : i64
+  %ch12 = tfrt.print.i64 %v6, %ch11
+
+  tfrt.return %ch12 : !tfrt.chain
+}
+// CHECK: 'cache_dataset_in_memory_error' returned <<error: iterator reached end>>
+
+// The first repetition of the first run writes the cache file, which is read
+// by the later repetitions and runs.
+// CHECK-LABEL: --- Running 'cache_dataset_file'
+func @cache_dataset_file() -> !tfrt.chain {
+  %path = "tfrt_test.get_string"() {
+    value = "mlir_tests/data/test_data/records.tfrecord"
+  } : () -> !tfrt.string
+  %dataset0 = data.tf_record_dataset %path
+  %filename = "tfrt_test.get_string"() {
+    value = "cache_dataset_test.cache"
+  } : () -> !tfrt.string
+  %dataset1 = data.cache_dataset %dataset0, %filename
+  %count = tfrt.constant.i64 2
+  %dataset2 = data.repeat_dataset %dataset1, %count
+  %iterator = data.make_iterator %dataset2
+  %ch0 = tfrt.new.chain
+
+  %ch1, %r0 = data.iterator_get_next (%iterator, %ch0) : !tfrt.string
+  // CHECK: string = a
+  %ch2 = "tfrt_test.print_string"(%r0, %ch1) : (!tfrt.string, !tfrt.chain) -> (!tfrt.chain)
+
+  %ch3, %r1 = data.iterator_get_next (%iterator, %ch2) : !tfrt.string
+  // CHECK: string = bc
+  %ch4 = "tfrt_test.print_string"(%r1, %ch3) : (!tfrt.string, !tfrt.chain) -> (!tfrt.chain)
+
+  %ch5, %r2 = data.iterator_get_next (%iterator, %ch4) : !tfrt.string
+  // CHECK: string = def
+  %ch6 = "tfrt_test.print_string"(%r2, %ch5) : (!tfrt.string, !tfrt.chain) -> (!tfrt.chain)
+
+  %ch7, %r3 = data.iterator_get_next (%iterator, %ch6) : !tfrt.string
+  // CHECK: string = a
+  %ch8 = "tfrt_test.print_string"(%r3, %ch7) : (!tfrt.string, !tfrt.chain) -> (!tfrt.chain)
+
+  %ch9, %r4 = data.iterator_get_next (%iterator, %ch8) : !tfrt.string
+  // CHECK: string = bc
+  %ch10 = "tfrt_test.print_string"(%r4, %ch9) : (!tfrt.string, !tfrt.chain) -> (!tfrt.chain)
+
+  %ch11, %r5 = data.iterator_get_next (%iterator, %ch10) : !tfrt.string
+  // CHECK: string = def
+  %ch12 = "tfrt_test.print_string"(%r5, %ch11) : (!tfrt.string, !tfrt.chain) -> (!tfrt.chain)
+
+  // expected-error @+1 {{iterator reached end}}
+  %ch13, %r6 = data.iterator_get_next (%iterator, %ch12) : !tfrt.string
+  %ch14 = "tfrt_test.print_string"(%r6, %ch13) : (!tfrt.string, !tfrt.chain) -> (!tfrt.chain)
+
+  tfrt.return %ch14 : !tfrt.chain
+}
+// CHECK: 'cache_dataset_file' returned <<error: iterator reached end>>
+
+// An error of the input is returned in its place, and the cache file is not
+// written.
+// CHECK-LABEL: --- Running 'cache_dataset_file_error'
+func @cache_dataset_file_error() -> !tfrt.chain {
+  %path = "tfrt_test.get_string"() {
+    value = "mlir_tests/data/test_data/corrupted.tfrecord"
+  } : () -> !tfrt.string
+  %dataset0 = data.tf_record_dataset %path
+  %filename = "tfrt_test.get_string"() {
+    value = "cache_dataset_test_error.cache"
+  } : () -> !tfrt.string
+  %dataset1 = data.cache_dataset %dataset0, %filename
+  %iterator = data.make_iterator %dataset1
+  %ch0 = tfrt.new.chain
+
+  // expected-error @+1 {{data corruption at position 0}}
+  %ch1, %r0 = data.iterator_get_next (%iterator, %ch0) : !tfrt.string
+  %ch2 = "tfrt_test.print_string"(%r0, %ch1) : (!tfrt.string, !tfrt.chain) -> (!tfrt.chain)
+
+  tfrt.return %ch2 : !tfrt.chain
+}
+// CHECK: 'cache_dataset_file_error' returned <<error: data corruption at position 0>>
@@ -0,0 +1,126 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// RUN: bef_executor $(bef_name %s) 2>&1 | FileCheck %s --dump-input=fail
+// RUN: tfrt_opt %s | tfrt_opt
+
+// Writes 2 * x into the row.
+func @times_two(%x : i64, %row : !t.tensor) -> !tfrt.chain {
+  %ch0 = tfrt.new.chain
+  %y = tfrt.add.i64 %x, %x
+  %ch1 = "tfrt_dht.set_tensor_with_values.i64"(%row, %ch0, %y)
+    : (!t.tensor, !tfrt.chain, i64) -> !tfrt.chain
+  tfrt.return %ch1 : !tfrt.chain
+}
+
+// CHECK-LABEL: --- Running 'map_and_batch_dataset'
+func @map_and_batch_dataset() -> !tfrt.chain {
+  %start = tfrt.constant.i64 0
+  %stop = tfrt.constant.i64 10
+  %step = tfrt.constant.i64 1
+  %dataset0 = data.range_dataset %start, %stop, %step {element_type = i64}
+
+  %batch_size = tfrt.constant.i64 4
+  %dataset1 = data.map_and_batch_dataset %dataset0, %batch_size
+    { function = @times_two, element_type = i64, element_shape = [] }
+  %iterator = data.make_iterator %dataset1
+  %ch0 = tfrt.new.chain
+
+  %ch1, %t0 = data.iterator_get_next (%iterator, %ch0) : !t.tensor
+  // CHECK: shape = [4], values = [0, 2, 4, 6]
+  %ch2 = tfrt_dht.print_tensor %t0, %ch1
+
+  %ch3, %t1 = data.iterator_get_next (%iterator, %ch2) : !t.tensor
+  // CHECK: shape = [4], values = [8, 10, 12, 14]
+  %ch4 = tfrt_dht.print_tensor %t1, %ch3
+
+  // The last batch is smaller than the batch size.
+  %ch5, %t2 = data.iterator_get_next (%iterator, %ch4) : !t.tensor
+  // CHECK: shape = [2], values = [16, 18]
+  %ch6 = tfrt_dht.print_tensor %t2, %ch5
+
+  tfrt.return %ch6 : !tfrt.chain
+}
+
+// Writes [offset, offset + x] into the row.
+func @add(%offset : i64, %x : i64, %row : !t.tensor) -> !tfrt.chain {
+  %ch0 = tfrt.new.chain
+  %y = tfrt.add.i64 %offset, %x
+  %ch1 = "tfrt_dht.set_tensor_with_values.i64"(%row, %ch0, %offset, %y)
+    : (!t.tensor, !tfrt.chain, i64, i64) -> !tfrt.chain
+  tfrt.return %ch1 : !tfrt.chain
+}
+
+// CHECK-LABEL: --- Running 'map_and_batch_dataset_with_other_arguments'
+func @map_and_batch_dataset_with_other_arguments() -> !tfrt.chain {
+  %start = tfrt.constant.i64 0
+  %stop = tfrt.constant.i64 4
+  %step = tfrt.constant.i64 1
+  %dataset0 = data.range_dataset %start, %stop, %step {element_type = i64}
+
+  %batch_size = tfrt.constant.i64 2
+  %offset = tfrt.constant.i64 100
+  %dataset1 = data.map_and_batch_dataset %dataset0, %batch_size,
+    %offset : i64 { function = @add, element_type = i64, element_shape = [2] }
+  %iterator = data.make_iterator %dataset1
+  %ch0 = tfrt.new.chain
+
+  %ch1, %t0 = data.iterator_get_next (%iterator, %ch0) : !t.tensor
+  // CHECK: shape = [2, 2], values = [100, 100, 100, 101]
+  %ch2 = tfrt_dht.print_tensor %t0, %ch1
+
+  %ch3, %t1 = data.iterator_get_next (%iterator, %ch2) : !t.tensor
+  // CHECK: shape = [2, 2], values = [100, 102, 100, 103]
+  %ch4 = tfrt_dht.print_tensor %t1, %ch3
+
+  tfrt.return %ch4 : !tfrt.chain
+}
+
+// CHECK-LABEL: --- Running 'map_and_batch_dataset_zero_batch_size'
+func @map_and_batch_dataset_zero_batch_size() -> !tfrt.dataset {
+  %start = tfrt.constant.i64 0
+  %stop = tfrt.constant.i64 6
+  %step = tfrt.constant.i64 1
+  %dataset0 = data.range_dataset %start, %stop, %step {element_type = i64}
+
+  %batch_size = tfrt.constant.i64 0
+  // expected-error @+1 {{runtime error: batch_size must be positive}}
+  %dataset1 = data.map_and_batch_dataset %dataset0, %batch_size
+    { function = @times_two, element_type = i64, element_shape = [] }
+
+  tfrt.return %dataset1 : !tfrt.dataset
+}
+// CHECK: 'map_and_batch_dataset_zero_batch_size' returned <<error: batch_size must be positive>>
+
+func @return_two_chains(%x : i64, %row : !t.tensor)
+    -> (!tfrt.chain, !tfrt.chain) {
+  %ch0 = tfrt.new.chain
+  tfrt.return %ch0, %ch0 : !tfrt.chain, !tfrt.chain
+}
+
+// CHECK-LABEL: --- Running 'map_and_batch_dataset_wrong_arity'
+func @map_and_batch_dataset_wrong_arity() -> !tfrt.dataset {
+  %start = tfrt.constant.i64 0
+  %stop = tfrt.constant.i64 6
+  %step = tfrt.constant.i64 1
+  %dataset0 = data.range_dataset %start, %stop, %step {element_type = i64}
+
+  %batch_size = tfrt.constant.i64 2
+  // expected-error @+1 {{runtime error: function must return a single chain, but has 2 results}}
+  %dataset1 = data.map_and_batch_dataset %dataset0, %batch_size
+    { function = @return_two_chains, element_type = i64, element_shape = [] }
+
+  tfrt.return %dataset1 : !tfrt.dataset
+}
+// CHECK: 'map_and_batch_dataset_wrong_arity' returned <<error: function must return a single chain, but has 2 results>>
@@ -0,0 +1,165 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+// RUN: bef_executor $(bef_name %s) 2>&1 | FileCheck %s --dump-input=fail
+
+// The input tensors are batches of a range, so the last tensor of each
+// repetition is shorter than the others.
+// CHECK-LABEL: --- Running 'padded_batch_dataset'
+func @padded_batch_dataset() -> !tfrt.chain {
+  %start = tfrt.constant.i64 0
+  %stop = tfrt.constant.i64 5
+  %step = tfrt.constant.i64 1
+  %dataset0 = data.range_dataset %start, %stop, %step {element_type = i64}
+  %batch_size0 = tfrt.constant.i64 2
+  %dataset1 = data.batch_dataset.i64 %dataset0, %batch_size0
+    { same_input_metadata = 1 : i1 }
+  %count = tfrt.constant.i64 2
+  %dataset2 = data.repeat_dataset %dataset1, %count
+  %batch_size1 = tfrt.constant.i64 3
+  %dataset3 = data.padded_batch_dataset %dataset2, %batch_size1
+  %iterator = data.make_iterator %dataset3
+  %ch0 = tfrt.new.chain
+
+  %ch1, %t0 = data.iterator_get_next (%iterator, %ch0) : !t.tensor
+  // CHECK: shape = [3, 2], values = [0, 1, 2, 3, 4, 0]
+  %ch2 = tfrt_dht.print_tensor %t0, %ch1
+
+  %ch3, %t1 = data.iterator_get_next (%iterator, %ch2) : !t.tensor
+  // CHECK: shape = [3, 2], values = [0, 1, 2, 3, 4, 0]
+  %ch4 = tfrt_dht.print_tensor %t1, %ch3
+
+  // expected-error @+1 {{iterator reached end}}
+  %ch5, %t2 = data.iterator_get_next (%iterator, %ch4) : !t.tensor
+  %ch6 = tfrt_dht.print_tensor %t2, %ch5
+
+  tfrt.return %ch6 : !tfrt.chain
+}
+// CHECK: 'padded_batch_dataset' returned <<error: iterator reached end>>
+
+// The tensors of 2 elements go to the second bucket and the tensors of 1
+// element to the first one. The partial batch of the first bucket is returned
+// at the end of the input.
+// CHECK-LABEL: --- Running 'padded_batch_dataset_bucketed'
+func @padded_batch_dataset_bucketed() -> !tfrt.chain {
+  %start = tfrt.constant.i64 0
+  %stop = tfrt.constant.i64 5
+  %step = tfrt.constant.i64 1
+  %dataset0 = data.range_dataset %start, %stop, %step {element_type = i64}
+  %batch_size = tfrt.constant.i64 2
+  %dataset1 = data.batch_dataset.i64 %dataset0, %batch_size
+    { same_input_metadata = 1 : i1 }
+  %count = tfrt.constant.i64 3
+  %dataset2 = data.repeat_dataset %dataset1, %count
+  %dataset3 = data.padded_batch_dataset.bucketed %dataset2, %batch_size
+    { bucket_boundaries = [2] }
+  %iterator = data.make_iterator %dataset3
+  %ch0 = tfrt.new.chain
+
+  %ch1, %t0 = data.iterator_get_next (%iterator, %ch0) : !t.tensor
+  // CHECK: shape = [2, 2], values = [0, 1, 2, 3]
+  %ch2 = tfrt_dht.print_tensor %t0, %ch1
+
+  %ch3, %t1 = data.iterator_get_next (%iterator, %ch2) : !t.tensor
+  // CHECK: shape = [2, 2], values = [0, 1, 2, 3]
+  %ch4 = tfrt_dht.print_tensor %t1, %ch3
+
+  %ch5, %t2 = data.iterator_get_next (%iterator, %ch4) : !t.tensor
+  // CHECK: shape = [2, 1], values = [4, 4]
+  %ch6 = tfrt_dht.print_tensor %t2, %ch5
+
+  %ch7, %t3 = data.iterator_get_next (%iterator, %ch6) : !t.tensor
+  // CHECK: shape = [2, 2], values = [0, 1, 2, 3]
+  %ch8 = tfrt_dht.print_tensor %t3, %ch7
+
+  %ch9, %t4 = data.iterator_get_next (%iterator, %ch8) : !t.tensor
+  // CHECK: shape = [1, 1], values = [4]
+  %ch10 = tfrt_dht.print_tensor %t4, %ch9
+
+  // expected-error @+1 {{iterator reached end}}
+  %ch11, %t5 = data.iterator_get_next (%iterator, %ch10) : !t.tensor
+  %ch12 = tfrt_dht.print_tensor %t5, %ch11
+
+  tfrt.return %ch12 : !tfrt.chain
+}
+// CHECK: 'padded_batch_dataset_bucketed' returned <<error: iterator reached end>>
+
+// CHECK-LABEL: --- Running 'padded_batch_dataset_not_tensors'
+func @padded_batch_dataset_not_tensors() -> !tfrt.chain {
+  %start = tfrt.constant.i64 0
+  %stop = tfrt.constant.i64 2
+  %step = tfrt.constant.i64 1
+  %dataset0 = data.range_dataset %start, %stop, %step {element_type = i64}
+  %batch_size = tfrt.constant.i64 2
+  %dataset1 = data.padded_batch_dataset %dataset0, %batch_size
+  %iterator = data.make_iterator %dataset1
+  %ch0 = tfrt.new.chain
+
+  // expected-error @+1 {{padded_batch_dataset expects tensors, component 0 is not a DenseHostTensor}}
+  %ch1, %t0 = data.iterator_get_next (%iterator, %ch0) : !t.tensor
+  %ch2 = tfrt_dht.print_tensor %t0, %ch1
+
+  tfrt.return %ch2 : !tfrt.chain
+}
+// CHECK: 'padded_batch_dataset_not_tensors' returned <<error: padded_batch_dataset expects tensors, component 0 is not a DenseHostTensor>>
+
+// The error of the input is returned in place of the batch.
+// CHECK-LABEL: --- Running 'padded_batch_dataset_input_error'
+func @padded_batch_dataset_input_error() -> !tfrt.chain {
+  %path = "tfrt_test.get_string"() {
+    value = "mlir_tests/data/test_data/corrupted.tfrecord"
+  } : () -> !tfrt.string
+  %dataset0 = data.tf_record_dataset %path
+  %batch_size = tfrt.constant.i64 2
+  %dataset1 = data.padded_batch_dataset %dataset0, %batch_size
+  %iterator = data.make_iterator %dataset1
+  %ch0 = tfrt.new.chain
+
+  // expected-error @+1 {{data corruption at position 0}}
+  %ch1, %t0 = data.iterator_get_next (%iterator, %ch0) : !t.tensor
+  %ch2 = tfrt_dht.print_tensor %t0, %ch1
+
+  tfrt.return %ch2 : !tfrt.chain
+}
+// CHECK: 'padded_batch_dataset_input_error' returned <<error: data corruption at position 0>>
+
+// CHECK-LABEL: --- Running 'padded_batch_dataset_zero_batch_size'
+func @padded_batch_dataset_zero_batch_size() -> !tfrt.dataset {
+  %start = tfrt.constant.i64 0
+  %stop = tfrt.constant.i64 4
+  %step = tfrt.constant.i64 1
+  %dataset0 = data.range_dataset %start, %stop, %step {element_type = i64}
+  %batch_size = tfrt.constant.i64 0
+  // expected-error @+1 {{batch_size must be positive}}
+  %dataset1 = data.padded_batch_dataset %dataset0, %batch_size
+
+  tfrt.return %dataset1 : !tfrt.dataset
+}
+// CHECK: 'padded_batch_dataset_zero_batch_size' returned <<error: batch_size must be positive>>
+
+// CHECK-LABEL: --- Running 'padded_batch_dataset_unsorted_boundaries'
+func @padded_batch_dataset_unsorted_boundaries() -> !tfrt.dataset {
+  %start = tfrt.constant.i64 0
+  %stop = tfrt.constant.i64 4
+  %step = tfrt.constant.i64 1
+  %dataset0 = data.range_dataset %start, %stop, %step {element_type = i64}
+  %batch_size = tfrt.constant.i64 2
+  // expected-error @+1 {{bucket_boundaries must be sorted}}
+  %dataset1 = data.padded_batch_dataset.bucketed %dataset0, %batch_size
+    { bucket_boundaries = [8, 4] }
+
+  tfrt.return %dataset1 : !tfrt.dataset
+}
+// CHECK: 'padded_batch_dataset_unsorted_boundaries' returned <<error: bucket_boundaries must be sorted>>
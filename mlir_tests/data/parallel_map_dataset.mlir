@@ -0,0 +1,185 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+// RUN: bef_executor $(bef_name %s) 2>&1 | FileCheck %s --dump-input=fail
+
+func @times_two(%x : i64) -> i64 {
+  %y = tfrt.add.i64 %x, %x
+  tfrt.return %y : i64
+}
+
+// The results are returned in the order of the input.
+// CHECK-LABEL: --- Running 'parallel_map_dataset'
+func @parallel_map_dataset() -> !tfrt.chain {
+  %start = tfrt.constant.i64 0
+  %stop = tfrt.constant.i64 4
+  %step = tfrt.constant.i64 1
+  %dataset0 = data.range_dataset %start, %stop, %step {element_type = i64}
+  %num_parallel_calls = tfrt.constant.i64 2
+  %dataset1 = data.map_dataset.parallel %dataset0, %num_parallel_calls
+    { function = @times_two, deterministic = 1 : i1 }
+  %iterator = data.make_iterator %dataset1
+  %ch0 = tfrt.new.chain
+
+  %ch1, %v0 = data.iterator_get_next (%iterator, %ch0) : i64
+  // CHECK: int64 = 0
+  %ch2 = tfrt.print.i64 %v0, %ch1
+
+  %ch3, %v1 = data.iterator_get_next (%iterator, %ch2) : i64
+  // CHECK: int64 = 2
+  %ch4 = tfrt.print.i64 %v1, %ch3
+
+  %ch5, %v2 = data.iterator_get_next (%iterator, %ch4) : i64
+  // CHECK: int64 = 4
+  %ch6 = tfrt.print.i64 %v2, %ch5
+
+  %ch7, %v3 = data.iterator_get_next (%iterator, %ch6) : i64
+  // CHECK: int64 = 6
+  %ch8 = tfrt.print.i64 %v3, %ch7
+
+  // expected-error @+1 {{iterator reached end}}
+  %ch9, %v4 = data.iterator_get_next (%iterator, %ch8) : i64
+  %ch10 = tfrt.print.i64 %v4, %ch9
+
+  tfrt.return %ch10 : !tfrt.chain
+}
+// CHECK: 'parallel_map_dataset' returned <<error: iterator reached end>>
+
+func @add(%x : i64, %y : i64) -> i64 {
+  %z = tfrt.add.i64 %x, %y
+  tfrt.return %z : i64
+}
+
+// A num_parallel_calls of -1 is the number of worker threads.
+// CHECK-LABEL: --- Running 'parallel_map_dataset_with_other_arguments'
+func @parallel_map_dataset_with_other_arguments() -> !tfrt.chain {
+  %start = tfrt.constant.i64 0
+  %stop = tfrt.constant.i64 3
+  %step = tfrt.constant.i64 1
+  %dataset0 = data.range_dataset %start, %stop, %step {element_type = i64}
+  %num_parallel_calls = tfrt.constant.i64 -1
+  %offset = tfrt.constant.i64 100
+  %dataset1 = data.map_dataset.parallel %dataset0, %num_parallel_calls,
+    %offset : i64 { function = @add, deterministic = 1 : i1 }
+  %iterator = data.make_iterator %dataset1
+  %ch0 = tfrt.new.chain
+
+  %ch1, %v0 = data.iterator_get_next (%iterator, %ch0) : i64
+  // CHECK: int64 = 100
+  %ch2 = tfrt.print.i64 %v0, %ch1
+
+  %ch3, %v1 = data.iterator_get_next (%iterator, %ch2) : i64
+  // CHECK: int64 = 101
+  %ch4 = tfrt.print.i64 %v1, %ch3
+
+  %ch5, %v2 = data.iterator_get_next (%iterator, %ch4) : i64
+  // CHECK: int64 = 102
+  %ch6 = tfrt.print.i64 %v2, %ch5
+
+  tfrt.return %ch6 : !tfrt.chain
+}
+
+// The results are returned in the order the calls complete, so only the set
+// of results is checked.
+// CHECK-LABEL: --- Running 'parallel_map_dataset_unordered'
+func @parallel_map_dataset_unordered() -> !tfrt.chain {
+  %start = tfrt.constant.i64 0
+  %stop = tfrt.constant.i64 4
+  %step = tfrt.constant.i64 1
+  %dataset0 = data.range_dataset %start, %stop, %step {element_type = i64}
+  %num_parallel_calls = tfrt.constant.i64 3
+  %dataset1 = data.map_dataset.parallel %dataset0, %num_parallel_calls
+    { function = @times_two, deterministic = 0 : i1 }
+  %iterator = data.make_iterator %dataset1
+  %ch0 = tfrt.new.chain
+
+  // CHECK-DAG: int64 = 0
+  // CHECK-DAG: int64 = 2
+  // CHECK-DAG: int64 = 4
+  // CHECK-DAG: int64 = 6
+  %ch1, %v0 = data.iterator_get_next (%iterator, %ch0) : i64
+  %ch2 = tfrt.print.i64 %v0, %ch1
+
+  %ch3, %v1 = data.iterator_get_next (%iterator, %ch2) : i64
+  %ch4 = tfrt.print.i64 %v1, %ch3
+
+  %ch5, %v2 = data.iterator_get_next (%iterator, %ch4) : i64
+  %ch6 = tfrt.print.i64 %v2, %ch5
+
+  %ch7, %v3 = data.iterator_get_next (%iterator, %ch6) : i64
+  %ch8 = tfrt.print.i64 %v3, %ch7
+
+  // The end of the input is returned after all the results.
+  // expected-error @+1 {{iterator reached end}}
+  %ch9, %v4 = data.iterator_get_next (%iterator, %ch8) : i64
+  %ch10 = tfrt.print.i64 %v4, %ch9
+
+  tfrt.return %ch10 : !tfrt.chain
+}
+// CHECK: 'parallel_map_dataset_unordered' returned <<error: iterator reached end>>
+
+func @twelve_divided_by(%x : i64) -> i64 {
+  %twelve = tfrt.constant.i64 12
+  // expected-error @+1 {{Divide by zero}}
+  %quot, %rem = tfrt.div.i64 %twelve, %x
+  tfrt.return %quot : i64
+}
+
+// The error of a call is returned in place of its result, and the calls
+// after it still run.
+// CHECK-LABEL: --- Running 'parallel_map_dataset_error'
+func @parallel_map_dataset_error() -> !tfrt.chain {
+  %start = tfrt.constant.i64 -1
+  %stop = tfrt.constant.i64 3
+  %step = tfrt.constant.i64 1
+  %dataset0 = data.range_dataset %start, %stop, %step {element_type = i64}
+  %num_parallel_calls = tfrt.constant.i64 2
+  %dataset1 = data.map_dataset.parallel %dataset0, %num_parallel_calls
+    { function = @twelve_divided_by, deterministic = 1 : i1 }
+  %iterator = data.make_iterator %dataset1
+  %ch0 = tfrt.new.chain
+
+  %ch1, %v0 = data.iterator_get_next (%iterator, %ch0) : i64
+  // CHECK: int64 = -12
+  %ch2 = tfrt.print.i64 %v0, %ch1
+
+  // The value is the error of 12 / 0.
+  %ch3, %v1 = data.iterator_get_next (%iterator, %ch2) : i64
+
+  %ch4, %v2 = data.iterator_get_next (%iterator, %ch3) : i64
+  // CHECK: int64 = 12
+  %ch5 = tfrt.print.i64 %v2, %ch4
+
+  %ch6, %v3 = data.iterator_get_next (%iterator, %ch5) : i64
+  // CHECK: int64 = 6
+  %ch7 = tfrt.print.i64 %v3, %ch6
+
+  tfrt.return %ch7 : !tfrt.chain
+}
+
+// CHECK-LABEL: --- Running 'parallel_map_dataset_no_parallel_calls'
+func @parallel_map_dataset_no_parallel_calls() -> !tfrt.dataset {
+  %start = tfrt.constant.i64 0
+  %stop = tfrt.constant.i64 4
+  %step = tfrt.constant.i64 1
+  %dataset0 = data.range_dataset %start, %stop, %step {element_type = i64}
+  %num_parallel_calls = tfrt.constant.i64 0
+  // expected-error @+1 {{num_parallel_calls must be positive or -1}}
+  %dataset1 = data.map_dataset.parallel %dataset0, %num_parallel_calls
+    { function = @times_two, deterministic = 1 : i1 }
+
+  tfrt.return %dataset1 : !tfrt.dataset
+}
+// CHECK: 'parallel_map_dataset_no_parallel_calls' returned <<error: num_parallel_calls must be positive or -1>>
@@ -0,0 +1,214 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+// RUN: bef_executor $(bef_name %s) 2>&1 | FileCheck %s --dump-input=fail
+
+func @times_two(%x : i64) -> i64 {
+  %y = tfrt.add.i64 %x, %x
+  tfrt.return %y : i64
+}
+
+// A prefetch_num of -1 adapts the number of prefetched elements.
+// CHECK-LABEL: --- Running 'prefetch_dataset_auto'
+func @prefetch_dataset_auto() -> !tfrt.chain {
+  %start = tfrt.constant.i64 0
+  %stop = tfrt.constant.i64 4
+  %step = tfrt.constant.i64 1
+  %dataset0 = data.range_dataset %start, %stop, %step {element_type = i64}
+  %dataset1 = data.map_dataset %dataset0 {function = @times_two}
+  %prefetch_num = tfrt.constant.i64 -1
+  %dataset2 = data.prefetch_dataset %dataset1, %prefetch_num
+  %iterator = data.make_iterator %dataset2
+  %ch0 = tfrt.new.chain
+
+  %ch1, %v0 = data.iterator_get_next (%iterator, %ch0) : i64
+  // CHECK: int64 = 0
+  %ch2 = tfrt.print.i64 %v0, %ch1
+
+  %ch3, %v1 = data.iterator_get_next (%iterator, %ch2) : i64
+  // CHECK: int64 = 2
+  %ch4 = tfrt.print.i64 %v1, %ch3
+
+  %ch5, %v2 = data.iterator_get_next (%iterator, %ch4) : i64
+  // CHECK: int64 = 4
+  %ch6 = tfrt.print.i64 %v2, %ch5
+
+  %ch7, %v3 = data.iterator_get_next (%iterator, %ch6) : i64
+  // CHECK: int64 = 6
+  %ch8 = tfrt.print.i64 %v3, %ch7
+
+  // expected-error @+1 {{iterator reached end}}
+  %ch9, %v4 = data.iterator_get_next (%iterator, %ch8) : i64
+  %ch10 = tfrt.print.i64 %v4, %ch9
+
+  tfrt.return %ch10 : !tfrt.chain
+}
+// CHECK: 'prefetch_dataset_auto' returned <<error: iterator reached end>>
+
+func @twelve_divided_by(%x : i64) -> i64 {
+  %twelve = tfrt.constant.i64 12
+  // expected-error @+1 {{Divide by zero}}
+  %quot, %rem = tfrt.div.i64 %twelve, %x
+  tfrt.return %quot : i64
+}
+
+// The error of an element is returned in its place, and the elements after
+// it are still prefetched.
+// CHECK-LABEL: --- Running 'prefetch_dataset_error'
+func @prefetch_dataset_error() -> !tfrt.chain {
+  %start = tfrt.constant.i64 -1
+  %stop = tfrt.constant.i64 3
+  %step = tfrt.constant.i64 1
+  %dataset0 = data.range_dataset %start, %stop, %step {element_type = i64}
+  %dataset1 = data.map_dataset %dataset0 {function = @twelve_divided_by}
+  %prefetch_num = tfrt.constant.i64 2
+  %dataset2 = data.prefetch_dataset %dataset1, %prefetch_num
+  %iterator = data.make_iterator %dataset2
+  %ch0 = tfrt.new.chain
+
+  %ch1, %v0 = data.iterator_get_next (%iterator, %ch0) : i64
+  // CHECK: int64 = -12
+  %ch2 = tfrt.print.i64 %v0, %ch1
+
+  // The value is the error of 12 / 0.
+  %ch3, %v1 = data.iterator_get_next (%iterator, %ch2) : i64
+
+  %ch4, %v2 = data.iterator_get_next (%iterator, %ch3) : i64
+  // CHECK: int64 = 12
+  %ch5 = tfrt.print.i64 %v2, %ch4
+
+  %ch6, %v3 = data.iterator_get_next (%iterator, %ch5) : i64
+  // CHECK: int64 = 6
+  %ch7 = tfrt.print.i64 %v3, %ch6
+
+  tfrt.return %ch7 : !tfrt.chain
+}
+
+// Each tensor of 2 int64 elements has 16 bytes, so at most one tensor is
+// prefetched at a time.
+// CHECK-LABEL: --- Running 'prefetch_dataset_budgeted'
+func @prefetch_dataset_budgeted() -> !tfrt.chain {
+  %start = tfrt.constant.i64 0
+  %stop = tfrt.constant.i64 5
+  %step = tfrt.constant.i64 1
+  %dataset0 = data.range_dataset %start, %stop, %step {element_type = i64}
+  %batch_size = tfrt.constant.i64 2
+  %dataset1 = data.batch_dataset.i64 %dataset0, %batch_size
+    { same_input_metadata = 1 : i1 }
+  %max_bytes = tfrt.constant.i64 16
+  %dataset2 = data.prefetch_dataset.budgeted %dataset1, %max_bytes
+    { shared_budget = "" }
+  %iterator = data.make_iterator %dataset2
+  %ch0 = tfrt.new.chain
+
+  %ch1, %t0 = data.iterator_get_next (%iterator, %ch0) : !t.tensor
+  // CHECK: shape = [2], values = [0, 1]
+  %ch2 = tfrt_dht.print_tensor %t0, %ch1
+
+  %ch3, %t1 = data.iterator_get_next (%iterator, %ch2) : !t.tensor
+  // CHECK: shape = [2], values = [2, 3]
+  %ch4 = tfrt_dht.print_tensor %t1, %ch3
+
+  %ch5, %t2 = data.iterator_get_next (%iterator, %ch4) : !t.tensor
+  // CHECK: shape = [1], values = [4]
+  %ch6 = tfrt_dht.print_tensor %t2, %ch5
+
+  // expected-error @+1 {{iterator reached end}}
+  %ch7, %t3 = data.iterator_get_next (%iterator, %ch6) : !t.tensor
+  %ch8 = tfrt_dht.print_tensor %t3, %ch7
+
+  tfrt.return %ch8 : !tfrt.chain
+}
+// CHECK: 'prefetch_dataset_budgeted' returned <<error: iterator reached end>>
+
+// Both datasets prefetch from the same budget of 16 bytes.
+// CHECK-LABEL: --- Running 'prefetch_dataset_shared_budget'
+func @prefetch_dataset_shared_budget() -> !tfrt.chain {
+  %step = tfrt.constant.i64 1
+  %batch_size = tfrt.constant.i64 2
+  %max_bytes = tfrt.constant.i64 16
+
+  %start0 = tfrt.constant.i64 0
+  %stop0 = tfrt.constant.i64 4
+  %dataset0 = data.range_dataset %start0, %stop0, %step {element_type = i64}
+  %dataset1 = data.batch_dataset.i64 %dataset0, %batch_size
+    { same_input_metadata = 1 : i1 }
+  %dataset2 = data.prefetch_dataset.budgeted %dataset1, %max_bytes
+    { shared_budget = "pipeline" }
+  %iterator0 = data.make_iterator %dataset2
+
+  %start1 = tfrt.constant.i64 10
+  %stop1 = tfrt.constant.i64 14
+  %dataset3 = data.range_dataset %start1, %stop1, %step {element_type = i64}
+  %dataset4 = data.batch_dataset.i64 %dataset3, %batch_size
+    { same_input_metadata = 1 : i1 }
+  %dataset5 = data.prefetch_dataset.budgeted %dataset4, %max_bytes
+    { shared_budget = "pipeline" }
+  %iterator1 = data.make_iterator %dataset5
+
+  %ch0 = tfrt.new.chain
+
+  %ch1, %t0 = data.iterator_get_next (%iterator0, %ch0) : !t.tensor
+  // CHECK: shape = [2], values = [0, 1]
+  %ch2 = tfrt_dht.print_tensor %t0, %ch1
+
+  %ch3, %t1 = data.iterator_get_next (%iterator1, %ch2) : !t.tensor
+  // CHECK: shape = [2], values = [10, 11]
+  %ch4 = tfrt_dht.print_tensor %t1, %ch3
+
+  %ch5, %t2 = data.iterator_get_next (%iterator0, %ch4) : !t.tensor
+  // CHECK: shape = [2], values = [2, 3]
+  %ch6 = tfrt_dht.print_tensor %t2, %ch5
+
+  %ch7, %t3 = data.iterator_get_next (%iterator1, %ch6) : !t.tensor
+  // CHECK: shape = [2], values = [12, 13]
+  %ch8 = tfrt_dht.print_tensor %t3, %ch7
+
+  tfrt.return %ch8 : !tfrt.chain
+}
+
+// CHECK-LABEL: --- Running 'prefetch_dataset_budgeted_zero_bytes'
+func @prefetch_dataset_budgeted_zero_bytes() -> !tfrt.dataset {
+  %start = tfrt.constant.i64 0
+  %stop = tfrt.constant.i64 4
+  %step = tfrt.constant.i64 1
+  %dataset0 = data.range_dataset %start, %stop, %step {element_type = i64}
+  %max_bytes = tfrt.constant.i64 0
+  // expected-error @+1 {{max_bytes must be positive}}
+  %dataset1 = data.prefetch_dataset.budgeted %dataset0, %max_bytes
+    { shared_budget = "" }
+
+  tfrt.return %dataset1 : !tfrt.dataset
+}
+// CHECK: 'prefetch_dataset_budgeted_zero_bytes' returned <<error: max_bytes must be positive>>
+
+// The datasets of a shared budget must agree on its size.
+// CHECK-LABEL: --- Running 'prefetch_dataset_shared_budget_mismatch'
+func @prefetch_dataset_shared_budget_mismatch() -> !tfrt.dataset {
+  %start = tfrt.constant.i64 0
+  %stop = tfrt.constant.i64 4
+  %step = tfrt.constant.i64 1
+  %dataset0 = data.range_dataset %start, %stop, %step {element_type = i64}
+  %max_bytes0 = tfrt.constant.i64 1024
+  %dataset1 = data.prefetch_dataset.budgeted %dataset0, %max_bytes0
+    { shared_budget = "pipeline" }
+  %max_bytes1 = tfrt.constant.i64 2048
+  // expected-error @+1 {{prefetch budget pipeline has 1024 bytes, not 2048}}
+  %dataset2 = data.prefetch_dataset.budgeted %dataset1, %max_bytes1
+    { shared_budget = "pipeline" }
+
+  tfrt.return %dataset2 : !tfrt.dataset
+}
+// CHECK: 'prefetch_dataset_shared_budget_mismatch' returned <<error: prefetch budget pipeline has 1024 bytes, not 2048>>
@@ -0,0 +1,215 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// RUN: bef_executor $(bef_name %s) 2>&1 | FileCheck %s --dump-input=fail
+
+// shard_<i>.tfrecord holds the records shard<i>_record0 and shard<i>_record1,
+// except for shard_2.tfrecord which only holds shard2_record0.
+
+// The records are taken from the two open files in turn. When a file
+// reaches end, the next file is opened in its place.
+// CHECK-LABEL: --- Running 'sharded_tf_record_dataset'
+func @sharded_tf_record_dataset() -> !tfrt.chain {
+  %patterns = "tfrt_test.get_string"() {
+    value = "mlir_tests/data/test_data/shard_*.tfrecord"
+  } : () -> !tfrt.string
+  %num_shards = tfrt.constant.i64 1
+  %shard_index = tfrt.constant.i64 0
+  %num_parallel_reads = tfrt.constant.i64 2
+  %dataset = data.sharded_tf_record_dataset %patterns, %num_shards,
+    %shard_index, %num_parallel_reads { deterministic = 1 : i1 }
+  %iterator = data.make_iterator %dataset
+  %ch0 = tfrt.new.chain
+
+  %ch1, %r0 = data.iterator_get_next (%iterator, %ch0) : !tfrt.string
+  // CHECK: string = shard0_record0
+  %ch2 = "tfrt_test.print_string"(%r0, %ch1) : (!tfrt.string, !tfrt.chain) -> (!tfrt.chain)
+
+  %ch3, %r1 = data.iterator_get_next (%iterator, %ch2) : !tfrt.string
+  // CHECK: string = shard1_record0
+  %ch4 = "tfrt_test.print_string"(%r1, %ch3) : (!tfrt.string, !tfrt.chain) -> (!tfrt.chain)
+
+  %ch5, %r2 = data.iterator_get_next (%iterator, %ch4) : !tfrt.string
+  // CHECK: string = shard0_record1
+  %ch6 = "tfrt_test.print_string"(%r2, %ch5) : (!tfrt.string, !tfrt.chain) -> (!tfrt.chain)
+
+  %ch7, %r3 = data.iterator_get_next (%iterator, %ch6) : !tfrt.string
+  // CHECK: string = shard1_record1
+  %ch8 = "tfrt_test.print_string"(%r3, %ch7) : (!tfrt.string, !tfrt.chain) -> (!tfrt.chain)
+
+  %ch9, %r4 = data.iterator_get_next (%iterator, %ch8) : !tfrt.string
+  // CHECK: string = shard2_record0
+  %ch10 = "tfrt_test.print_string"(%r4, %ch9) : (!tfrt.string, !tfrt.chain) -> (!tfrt.chain)
+
+  // expected-error @+1 {{iterator reached end}}
+  %ch11, %end = data.iterator_get_next (%iterator, %ch10) : !tfrt.string
+  %ch12 = "tfrt_test.print_string"(%end, %ch11) : (!tfrt.string, !tfrt.chain) -> (!tfrt.chain)
+
+  tfrt.return %ch12 : !tfrt.chain
+}
+// CHECK: 'sharded_tf_record_dataset' returned <<error: iterator reached end>>
+
+// The shard 1 of 2 only gets the second of the three files.
+// CHECK-LABEL: --- Running 'sharded_tf_record_dataset_shard'
+func @sharded_tf_record_dataset_shard() -> !tfrt.chain {
+  %patterns = "tfrt_test.get_string"() {
+    value = "mlir_tests/data/test_data/shard_*.tfrecord"
+  } : () -> !tfrt.string
+  %num_shards = tfrt.constant.i64 2
+  %shard_index = tfrt.constant.i64 1
+  %num_parallel_reads = tfrt.constant.i64 2
+  %dataset = data.sharded_tf_record_dataset %patterns, %num_shards,
+    %shard_index, %num_parallel_reads { deterministic = 1 : i1 }
+  %iterator = data.make_iterator %dataset
+  %ch0 = tfrt.new.chain
+
+  %ch1, %r0 = data.iterator_get_next (%iterator, %ch0) : !tfrt.string
+  // CHECK: string = shard1_record0
+  %ch2 = "tfrt_test.print_string"(%r0, %ch1) : (!tfrt.string, !tfrt.chain) -> (!tfrt.chain)
+
+  %ch3, %r1 = data.iterator_get_next (%iterator, %ch2) : !tfrt.string
+  // CHECK: string = shard1_record1
+  %ch4 = "tfrt_test.print_string"(%r1, %ch3) : (!tfrt.string, !tfrt.chain) -> (!tfrt.chain)
+
+  // expected-error @+1 {{iterator reached end}}
+  %ch5, %end = data.iterator_get_next (%iterator, %ch4) : !tfrt.string
+  %ch6 = "tfrt_test.print_string"(%end, %ch5) : (!tfrt.string, !tfrt.chain) -> (!tfrt.chain)
+
+  tfrt.return %ch6 : !tfrt.chain
+}
+// CHECK: 'sharded_tf_record_dataset_shard' returned <<error: iterator reached end>>
+
+// The files of a list are read in the order of the list.
+// CHECK-LABEL: --- Running 'sharded_tf_record_dataset_file_list'
+func @sharded_tf_record_dataset_file_list() -> !tfrt.chain {
+  %patterns = "tfrt_test.get_string"() {
+    value = "mlir_tests/data/test_data/shard_2.tfrecord, mlir_tests/data/test_data/shard_0.tfrecord"
+  } : () -> !tfrt.string
+  %num_shards = tfrt.constant.i64 1
+  %shard_index = tfrt.constant.i64 0
+  %num_parallel_reads = tfrt.constant.i64 1
+  %dataset = data.sharded_tf_record_dataset %patterns, %num_shards,
+    %shard_index, %num_parallel_reads { deterministic = 1 : i1 }
+  %iterator = data.make_iterator %dataset
+  %ch0 = tfrt.new.chain
+
+  %ch1, %r0 = data.iterator_get_next (%iterator, %ch0) : !tfrt.string
+  // CHECK: string = shard2_record0
+  %ch2 = "tfrt_test.print_string"(%r0, %ch1) : (!tfrt.string, !tfrt.chain) -> (!tfrt.chain)
+
+  %ch3, %r1 = data.iterator_get_next (%iterator, %ch2) : !tfrt.string
+  // CHECK: string = shard0_record0
+  %ch4 = "tfrt_test.print_string"(%r1, %ch3) : (!tfrt.string, !tfrt.chain) -> (!tfrt.chain)
+
+  %ch5, %r2 = data.iterator_get_next (%iterator, %ch4) : !tfrt.string
+  // CHECK: string = shard0_record1
+  %ch6 = "tfrt_test.print_string"(%r2, %ch5) : (!tfrt.string, !tfrt.chain) -> (!tfrt.chain)
+
+  // expected-error @+1 {{iterator reached end}}
+  %ch7, %end = data.iterator_get_next (%iterator, %ch6) : !tfrt.string
+  %ch8 = "tfrt_test.print_string"(%end, %ch7) : (!tfrt.string, !tfrt.chain) -> (!tfrt.chain)
+
+  tfrt.return %ch8 : !tfrt.chain
+}
+// CHECK: 'sharded_tf_record_dataset_file_list' returned <<error: iterator reached end>>
+
+// The records are returned in the order they are read.
+// CHECK-LABEL: --- Running 'sharded_tf_record_dataset_nondeterministic'
+func @sharded_tf_record_dataset_nondeterministic() -> !tfrt.chain {
+  %patterns = "tfrt_test.get_string"() {
+    value = "mlir_tests/data/test_data/shard_*.tfrecord"
+  } : () -> !tfrt.string
+  %num_shards = tfrt.constant.i64 1
+  %shard_index = tfrt.constant.i64 0
+  %num_parallel_reads = tfrt.constant.i64 3
+  %dataset = data.sharded_tf_record_dataset %patterns, %num_shards,
+    %shard_index, %num_parallel_reads { deterministic = 0 : i1 }
+  %iterator = data.make_iterator %dataset
+  %ch0 = tfrt.new.chain
+
+  %ch1, %r0 = data.iterator_get_next (%iterator, %ch0) : !tfrt.string
+  // CHECK-DAG: string = shard0_record0
+  %ch2 = "tfrt_test.print_string"(%r0, %ch1) : (!tfrt.string, !tfrt.chain) -> (!tfrt.chain)
+
+  %ch3, %r1 = data.iterator_get_next (%iterator, %ch2) : !tfrt.string
+  // CHECK-DAG: string = shard0_record1
+  %ch4 = "tfrt_test.print_string"(%r1, %ch3) : (!tfrt.string, !tfrt.chain) -> (!tfrt.chain)
+
+  %ch5, %r2 = data.iterator_get_next (%iterator, %ch4) : !tfrt.string
+  // CHECK-DAG: string = shard1_record0
+  %ch6 = "tfrt_test.print_string"(%r2, %ch5) : (!tfrt.string, !tfrt.chain) -> (!tfrt.chain)
+
+  %ch7, %r3 = data.iterator_get_next (%iterator, %ch6) : !tfrt.string
+  // CHECK-DAG: string = shard1_record1
+  %ch8 = "tfrt_test.print_string"(%r3, %ch7) : (!tfrt.string, !tfrt.chain) -> (!tfrt.chain)
+
+  %ch9, %r4 = data.iterator_get_next (%iterator, %ch8) : !tfrt.string
+  // CHECK-DAG: string = shard2_record0
+  %ch10 = "tfrt_test.print_string"(%r4, %ch9) : (!tfrt.string, !tfrt.chain) -> (!tfrt.chain)
+
+  // expected-error @+1 {{iterator reached end}}
+  %ch11, %end = data.iterator_get_next (%iterator, %ch10) : !tfrt.string
+  %ch12 = "tfrt_test.print_string"(%end, %ch11) : (!tfrt.string, !tfrt.chain) -> (!tfrt.chain)
+
+  tfrt.return %ch12 : !tfrt.chain
+}
+// CHECK: 'sharded_tf_record_dataset_nondeterministic' returned <<error: iterator reached end>>
+
+// CHECK-LABEL: --- Running 'sharded_tf_record_dataset_invalid_shard'
+func @sharded_tf_record_dataset_invalid_shard() -> !tfrt.dataset {
+  %patterns = "tfrt_test.get_string"() {
+    value = "mlir_tests/data/test_data/shard_*.tfrecord"
+  } : () -> !tfrt.string
+  %num_shards = tfrt.constant.i64 2
+  %shard_index = tfrt.constant.i64 2
+  %num_parallel_reads = tfrt.constant.i64 2
+  // expected-error @+1 {{invalid shard index 2 of 2 shards}}
+  %dataset = data.sharded_tf_record_dataset %patterns, %num_shards,
+    %shard_index, %num_parallel_reads { deterministic = 1 : i1 }
+
+  tfrt.return %dataset : !tfrt.dataset
+}
+// CHECK: 'sharded_tf_record_dataset_invalid_shard' returned <<error: invalid shard index 2 of 2 shards>>
+
+// CHECK-LABEL: --- Running 'sharded_tf_record_dataset_no_files'
+func @sharded_tf_record_dataset_no_files() -> !tfrt.dataset {
+  %patterns = "tfrt_test.get_string"() {
+    value = "mlir_tests/data/test_data/missing_*.tfrecord"
+  } : () -> !tfrt.string
+  %num_shards = tfrt.constant.i64 1
+  %shard_index = tfrt.constant.i64 0
+  %num_parallel_reads = tfrt.constant.i64 2
+  // expected-error @+1 {{no files match mlir_tests/data/test_data/missing_*.tfrecord}}
+  %dataset = data.sharded_tf_record_dataset %patterns, %num_shards,
+    %shard_index, %num_parallel_reads { deterministic = 1 : i1 }
+
+  tfrt.return %dataset : !tfrt.dataset
+}
+// CHECK: 'sharded_tf_record_dataset_no_files' returned <<error: no files match mlir_tests/data/test_data/missing_*.tfrecord>>
+
+// CHECK-LABEL: --- Running 'sharded_tf_record_dataset_no_parallel_reads'
+func @sharded_tf_record_dataset_no_parallel_reads() -> !tfrt.dataset {
+  %patterns = "tfrt_test.get_string"() {
+    value = "mlir_tests/data/test_data/shard_*.tfrecord"
+  } : () -> !tfrt.string
+  %num_shards = tfrt.constant.i64 1
+  %shard_index = tfrt.constant.i64 0
+  %num_parallel_reads = tfrt.constant.i64 0
+  // expected-error @+1 {{num_parallel_reads must be positive}}
+  %dataset = data.sharded_tf_record_dataset %patterns, %num_shards,
+    %shard_index, %num_parallel_reads { deterministic = 1 : i1 }
+
+  tfrt.return %dataset : !tfrt.dataset
+}
+// CHECK: 'sharded_tf_record_dataset_no_parallel_reads' returned <<error: num_parallel_reads must be positive>>
@@ -0,0 +1,167 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+// RUN: bef_executor $(bef_name %s) 2>&1 | FileCheck %s --dump-input=fail
+
+// The order of a seed depends on the standard library, so the tests only check
+// the elements, and that the order is the same for each iterator when
+// reshuffle_each_iteration is false.
+
+// CHECK-LABEL: --- Running 'shuffle_dataset'
+func @shuffle_dataset() -> !tfrt.chain {
+  %start = tfrt.constant.i64 0
+  %stop = tfrt.constant.i64 4
+  %step = tfrt.constant.i64 1
+  %dataset0 = data.range_dataset %start, %stop, %step {element_type = i64}
+  %buffer_size = tfrt.constant.i64 2
+  %seed = tfrt.constant.i64 -1
+  %dataset1 = data.shuffle_dataset %dataset0, %buffer_size, %seed
+    { reshuffle_each_iteration = 1 : i1 }
+  %iterator = data.make_iterator %dataset1
+  %ch0 = tfrt.new.chain
+
+  // CHECK-DAG: int64 = 0
+  // CHECK-DAG: int64 = 1
+  // CHECK-DAG: int64 = 2
+  // CHECK-DAG: int64 = 3
+  %ch1, %v0 = data.iterator_get_next (%iterator, %ch0) : i64
+  %ch2 = tfrt.print.i64 %v0, %ch1
+
+  %ch3, %v1 = data.iterator_get_next (%iterator, %ch2) : i64
+  %ch4 = tfrt.print.i64 %v1, %ch3
+
+  %ch5, %v2 = data.iterator_get_next (%iterator, %ch4) : i64
+  %ch6 = tfrt.print.i64 %v2, %ch5
+
+  %ch7, %v3 = data.iterator_get_next (%iterator, %ch6) : i64
+  %ch8 = tfrt.print.i64 %v3, %ch7
+
+  // expected-error @+1 {{iterator reached end}}
+  %ch9, %v4 = data.iterator_get_next (%iterator, %ch8) : i64
+  %ch10 = tfrt.print.i64 %v4, %ch9
+
+  tfrt.return %ch10 : !tfrt.chain
+}
+// CHECK: 'shuffle_dataset' returned <<error: iterator reached end>>
+
+// Both repetitions have the order of the seed.
+// CHECK-LABEL: --- Running 'shuffle_dataset_seeded'
+func @shuffle_dataset_seeded() -> !tfrt.chain {
+  %start = tfrt.constant.i64 0
+  %stop = tfrt.constant.i64 3
+  %step = tfrt.constant.i64 1
+  %dataset0 = data.range_dataset %start, %stop, %step {element_type = i64}
+  %buffer_size = tfrt.constant.i64 3
+  %seed = tfrt.constant.i64 42
+  %dataset1 = data.shuffle_dataset %dataset0, %buffer_size, %seed
+    { reshuffle_each_iteration = 0 : i1 }
+  %count = tfrt.constant.i64 2
+  %dataset2 = data.repeat_dataset %dataset1, %count
+  %iterator = data.make_iterator %dataset2
+  %ch0 = tfrt.new.chain
+
+  %ch1, %v0 = data.iterator_get_next (%iterator, %ch0) : i64
+  // CHECK: int64 = [[FIRST:[0-2]]]
+  %ch2 = tfrt.print.i64 %v0, %ch1
+
+  %ch3, %v1 = data.iterator_get_next (%iterator, %ch2) : i64
+  // CHECK: int64 = [[SECOND:[0-2]]]
+  %ch4 = tfrt.print.i64 %v1, %ch3
+
+  %ch5, %v2 = data.iterator_get_next (%iterator, %ch4) : i64
+  // CHECK: int64 = [[THIRD:[0-2]]]
+  %ch6 = tfrt.print.i64 %v2, %ch5
+
+  %ch7, %v3 = data.iterator_get_next (%iterator, %ch6) : i64
+  // CHECK: int64 = [[FIRST]]
+  %ch8 = tfrt.print.i64 %v3, %ch7
+
+  %ch9, %v4 = data.iterator_get_next (%iterator, %ch8) : i64
+  // CHECK: int64 = [[SECOND]]
+  %ch10 = tfrt.print.i64 %v4, %ch9
+
+  %ch11, %v5 = data.iterator_get_next (%iterator, %ch10) : i64
+  // CHECK: int64 = [[THIRD]]
+  %ch12 = tfrt.print.i64 %v5, %ch11
+
+  // expected-error @+1 {{iterator reached end}}
+  %ch13, %v6 = data.iterator_get_next (%iterator, %ch12) : i64
+  %ch14 = tfrt.print.i64 %v6, %ch13
+
+  tfrt.return %ch14 : !tfrt.chain
+}
+// CHECK: 'shuffle_dataset_seeded' returned <<error: iterator reached end>>
+
+func @twelve_divided_by(%x : i64) -> i64 {
+  %twelve = tfrt.constant.i64 12
+  // expected-error @+1 {{Divide by zero}}
+  %quot, %rem = tfrt.div.i64 %twelve, %x
+  tfrt.return %quot : i64
+}
+
+// A buffer of one element keeps the order of the input, so the error of the
+// input is returned in its place.
+// CHECK-LABEL: --- Running 'shuffle_dataset_error'
+func @shuffle_dataset_error() -> !tfrt.chain {
+  %start = tfrt.constant.i64 -1
+  %stop = tfrt.constant.i64 3
+  %step = tfrt.constant.i64 1
+  %dataset0 = data.range_dataset %start, %stop, %step {element_type = i64}
+  %dataset1 = data.map_dataset %dataset0 {function = @twelve_divided_by}
+  %buffer_size = tfrt.constant.i64 1
+  %seed = tfrt.constant.i64 42
+  %dataset2 = data.shuffle_dataset %dataset1, %buffer_size, %seed
+    { reshuffle_each_iteration = 0 : i1 }
+  %iterator = data.make_iterator %dataset2
+  %ch0 = tfrt.new.chain
+
+  %ch1, %v0 = data.iterator_get_next (%iterator, %ch0) : i64
+  // CHECK: int64 = -12
+  %ch2 = tfrt.print.i64 %v0, %ch1
+
+  // The value is the error of 12 / 0.
+  %ch3, %v1 = data.iterator_get_next (%iterator, %ch2) : i64
+
+  %ch4, %v2 = data.iterator_get_next (%iterator, %ch3) : i64
+  // CHECK: int64 = 12
+  %ch5 = tfrt.print.i64 %v2, %ch4
+
+  %ch6, %v3 = data.iterator_get_next (%iterator, %ch5) : i64
+  // CHECK: int64 = 6
+  %ch7 = tfrt.print.i64 %v3, %ch6
+
+  // expected-error @+1 {{iterator reached end}}
+  %ch8, %v4 = data.iterator_get_next (%iterator, %ch7) : i64
+  %ch9 = tfrt.print.i64 %v4, %ch8
+
+  tfrt.return %ch9 : !tfrt.chain
+}
+// CHECK: 'shuffle_dataset_error' returned <<error: iterator reached end>>
+
+// CHECK-LABEL: --- Running 'shuffle_dataset_zero_buffer_size'
+func @shuffle_dataset_zero_buffer_size() -> !tfrt.dataset {
+  %start = tfrt.constant.i64 0
+  %stop = tfrt.constant.i64 4
+  %step = tfrt.constant.i64 1
+  %dataset0 = data.range_dataset %start, %stop, %step {element_type = i64}
+  %buffer_size = tfrt.constant.i64 0
+  %seed = tfrt.constant.i64 42
+  // expected-error @+1 {{buffer_size must be positive}}
+  %dataset1 = data.shuffle_dataset %dataset0, %buffer_size, %seed
+    { reshuffle_each_iteration = 0 : i1 }
+
+  tfrt.return %dataset1 : !tfrt.dataset
+}
+// CHECK: 'shuffle_dataset_zero_buffer_size' returned <<error: buffer_size must be positive>>
@@ -0,0 +1,102 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+// RUN: bef_executor $(bef_name %s) 2>&1 | FileCheck %s --dump-input=fail
+
+// data.tf_record_dataset reads the files with AsyncFileInputStream.
+// records.tfrecord holds the records "a", "bc" and "def".
+
+// CHECK-LABEL: --- Running 'tf_record_dataset'
+func @tf_record_dataset() -> !tfrt.chain {
+  %path = "tfrt_test.get_string"() {
+    value = "mlir_tests/data/test_data/records.tfrecord"
+  } : () -> !tfrt.string
+  %dataset = data.tf_record_dataset %path
+  %iterator = data.make_iterator %dataset
+  %ch0 = tfrt.new.chain
+
+  %ch1, %r0 = data.iterator_get_next (%iterator, %ch0) : !tfrt.string
+  // CHECK: string = a
+  %ch2 = "tfrt_test.print_string"(%r0, %ch1) : (!tfrt.string, !tfrt.chain) -> (!tfrt.chain)
+
+  %ch3, %r1 = data.iterator_get_next (%iterator, %ch2) : !tfrt.string
+  // CHECK: string = bc
+  %ch4 = "tfrt_test.print_string"(%r1, %ch3) : (!tfrt.string, !tfrt.chain) -> (!tfrt.chain)
+
+  %ch5, %r2 = data.iterator_get_next (%iterator, %ch4) : !tfrt.string
+  // CHECK: string = def
+  %ch6 = "tfrt_test.print_string"(%r2, %ch5) : (!tfrt.string, !tfrt.chain) -> (!tfrt.chain)
+
+  // expected-error @+1 {{iterator reached end}}
+  %ch7, %r3 = data.iterator_get_next (%iterator, %ch6) : !tfrt.string
+  %ch8 = "tfrt_test.print_string"(%r3, %ch7) : (!tfrt.string, !tfrt.chain) -> (!tfrt.chain)
+
+  tfrt.return %ch8 : !tfrt.chain
+}
+// CHECK: 'tf_record_dataset' returned <<error: iterator reached end>>
+
+// The checksum of the first record of corrupted.tfrecord is wrong.
+// CHECK-LABEL: --- Running 'tf_record_dataset_corrupted'
+func @tf_record_dataset_corrupted() -> !tfrt.chain {
+  %path = "tfrt_test.get_string"() {
+    value = "mlir_tests/data/test_data/corrupted.tfrecord"
+  } : () -> !tfrt.string
+  %dataset = data.tf_record_dataset %path
+  %iterator = data.make_iterator %dataset
+  %ch0 = tfrt.new.chain
+
+  // expected-error @+1 {{data corruption at position 0}}
+  %ch1, %r0 = data.iterator_get_next (%iterator, %ch0) : !tfrt.string
+  %ch2 = "tfrt_test.print_string"(%r0, %ch1) : (!tfrt.string, !tfrt.chain) -> (!tfrt.chain)
+
+  tfrt.return %ch2 : !tfrt.chain
+}
+// CHECK: 'tf_record_dataset_corrupted' returned <<error: data corruption at position 0>>
+
+// The file ends in the middle of the first record. The reads of the stream
+// come back short, which must not be mistaken for the end of the input.
+// CHECK-LABEL: --- Running 'tf_record_dataset_truncated'
+func @tf_record_dataset_truncated() -> !tfrt.chain {
+  %path = "tfrt_test.get_string"() {
+    value = "mlir_tests/data/test_data/truncated.tfrecord"
+  } : () -> !tfrt.string
+  %dataset = data.tf_record_dataset %path
+  %iterator = data.make_iterator %dataset
+  %ch0 = tfrt.new.chain
+
+  // expected-error @+1 {{truncated record at position 0}}
+  %ch1, %r0 = data.iterator_get_next (%iterator, %ch0) : !tfrt.string
+  %ch2 = "tfrt_test.print_string"(%r0, %ch1) : (!tfrt.string, !tfrt.chain) -> (!tfrt.chain)
+
+  tfrt.return %ch2 : !tfrt.chain
+}
+// CHECK: 'tf_record_dataset_truncated' returned <<error: truncated record at position 0>>
+
+// CHECK-LABEL: --- Running 'tf_record_dataset_missing_file'
+func @tf_record_dataset_missing_file() -> !tfrt.chain {
+  %path = "tfrt_test.get_string"() {
+    value = "mlir_tests/data/test_data/missing.tfrecord"
+  } : () -> !tfrt.string
+  %dataset = data.tf_record_dataset %path
+  %iterator = data.make_iterator %dataset
+  %ch0 = tfrt.new.chain
+
+  // expected-error @+1 {{failed to open file}}
+  %ch1, %r0 = data.iterator_get_next (%iterator, %ch0) : !tfrt.string
+  %ch2 = "tfrt_test.print_string"(%r0, %ch1) : (!tfrt.string, !tfrt.chain) -> (!tfrt.chain)
+
+  tfrt.return %ch2 : !tfrt.chain
+}
+// CHECK: 'tf_record_dataset_missing_file' returned <<error: failed to open file
@@ -0,0 +1,83 @@
+// Copyright 2020 The TensorFlow Runtime Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+// RUN: bef_executor $(bef_name %s) 2>&1 | FileCheck %s --dump-input=fail
+
+// Each record is a HostBuffer that refers to the bytes of the record in the
+// mapped file. records.tfrecord holds the records "a", "bc" and "def".
+
+// CHECK-LABEL: --- Running 'tf_record_dataset_host_buffer'
+func @tf_record_dataset_host_buffer() -> !tfrt.chain {
+  %path = "tfrt_test.get_string"() {
+    value = "mlir_tests/data/test_data/records.tfrecord"
+  } : () -> !tfrt.string
+  %dataset = data.tf_record_dataset.host_buffer %path
+  %iterator = data.make_iterator %dataset
+  %ch0 = tfrt.new.chain
+
+  %ch1, %r0 = data.iterator_get_next (%iterator, %ch0) : !ht.host_buffer
+  // CHECK: HostBuffer<pointer={{0x[[:xdigit:]]*}}, size=1>
+  %ch2 = tfrt_dht.print_buffer %r0, %ch1
+
+  %ch3, %r1 = data.iterator_get_next (%iterator, %ch2) : !ht.host_buffer
+  // CHECK: HostBuffer<pointer={{0x[[:xdigit:]]*}}, size=2>
+  %ch4 = tfrt_dht.print_buffer %r1, %ch3
+
+  %ch5, %r2 = data.iterator_get_next (%iterator, %ch4) : !ht.host_buffer
+  // CHECK: HostBuffer<pointer={{0x[[:xdigit:]]*}}, size=3>
+  %ch6 = tfrt_dht.print_buffer %r2, %ch5
+
+  // expected-error @+1 {{iterator reached end}}
+  %ch7, %r3 = data.iterator_get_next (%iterator, %ch6) : !ht.host_buffer
+  %ch8 = tfrt_dht.print_buffer %r3, %ch7
+
+  tfrt.return %ch8 : !tfrt.chain
+}
+// CHECK: 'tf_record_dataset_host_buffer' returned <<error: iterator reached end>>
+
+// The checksum of the first record of corrupted.tfrecord is wrong.
+// CHECK-LABEL: --- Running 'tf_record_dataset_host_buffer_corrupted'
+func @tf_record_dataset_host_buffer_corrupted() -> !tfrt.chain {
+  %path = "tfrt_test.get_string"() {
+    value = "mlir_tests/data/test_data/corrupted.tfrecord"
+  } : () -> !tfrt.string
+  %dataset = data.tf_record_dataset.host_buffer %path
+  %iterator = data.make_iterator %dataset
+  %ch0 = tfrt.new.chain
+
+  // expected-error @+1 {{data corruption at position 0}}
+  %ch1, %r0 = data.iterator_get_next (%iterator, %ch0) : !ht.host_buffer
+  %ch2 = tfrt_dht.print_buffer %r0, %ch1
+
+  tfrt.return %ch2 : !tfrt.chain
+}
+// CHECK: 'tf_record_dataset_host_buffer_corrupted' returned <<error: data corruption at position 0>>
+
+// CHECK-LABEL: --- Running 'tf_record_dataset_host_buffer_missing_file'
+func @tf_record_dataset_host_buffer_missing_file() -> !tfrt.chain {
+  %path = "tfrt_test.get_string"() {
+    value = "mlir_tests/data/test_data/missing.tfrecord"
+  } : () -> !tfrt.string
+  %dataset = data.tf_record_dataset.host_buffer %path
+  %iterator = data.make_iterator %dataset
+  %ch0 = tfrt.new.chain
+
+  // expected-error @+1 {{failed to open file}}
+  %ch1, %r0 = data.iterator_get_next (%iterator, %ch0) : !ht.host_buffer
+  %ch2 = tfrt_dht.print_buffer %r0, %ch1
+
+  tfrt.return %ch2 : !tfrt.chain
+}
+// CHECK: 'tf_record_dataset_host_buffer_missing_file' returned <<error: failed to open file
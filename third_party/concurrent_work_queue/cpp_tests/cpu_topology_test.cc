@@ -0,0 +1,162 @@
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+//===- cpu_topology_test.cc -------------------------------------*- C++ -*-===//
+//
+// Unit tests for CpuTopology and NUMA-aware worker placement.
+//
+//===----------------------------------------------------------------------===//
+
+#include "cpu_topology.h"
+
+#include <atomic>
+#include <fstream>
+#include <string>
+#include <thread>
+
+#include "environment.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
+#include "non_blocking_work_queue.h"
+#include "tfrt/host_context/task_function.h"
+#include "tfrt/support/latch.h"
+
+namespace tfrt {
+namespace {
+
+using ::tfrt::internal::CpuTopology;
+using ::tfrt::internal::WorkerPlacement;
+using ::testing::ElementsAre;
+
+using ThreadingEnvironment = ::tfrt::internal::ThreadingEnvironment;
+using WorkQueue = ::tfrt::internal::NonBlockingWorkQueue<ThreadingEnvironment>;
+
+// A fake sysfs tree with a NUMA node directory for each cpulist.
+class FakeSysfs {
+ public:
+  FakeSysfs() {
+    EXPECT_FALSE(llvm::sys::fs::createUniqueDirectory("sysfs", root_));
+  }
+  ~FakeSysfs() { llvm::sys::fs::remove_directories(root_); }
+
+  void AddNode(string_view node_name, string_view cpulist) {
+    llvm::SmallString<128> dir(root_);
+    llvm::sys::path::append(dir, "devices", "system", "node", node_name);
+    ASSERT_FALSE(llvm::sys::fs::create_directories(dir));
+    llvm::sys::path::append(dir, "cpulist");
+    std::ofstream(std::string(dir.str())) << std::string(cpulist) << "\n";
+  }
+
+  string_view root() const { return root_; }
+
+ private:
+  llvm::SmallString<128> root_;
+};
+
+TEST(CpuTopologyTest, ParseCpuList) {
+  std::vector<int> cpus;
+  ASSERT_TRUE(internal::ParseCpuList("0-3,8,10-11\n", &cpus));
+  EXPECT_THAT(cpus, ElementsAre(0, 1, 2, 3, 8, 10, 11));
+
+  cpus.clear();
+  ASSERT_TRUE(internal::ParseCpuList("", &cpus));
+  EXPECT_TRUE(cpus.empty());
+
+  EXPECT_FALSE(internal::ParseCpuList("0-", &cpus));
+  EXPECT_FALSE(internal::ParseCpuList("3-1", &cpus));
+  EXPECT_FALSE(internal::ParseCpuList("a,b", &cpus));
+}
+
+TEST(CpuTopologyTest, ReadFakeTopology) {
+  FakeSysfs sysfs;
+  sysfs.AddNode("node2", "4-5");
+  sysfs.AddNode("node0", "0-3");
+  sysfs.AddNode("node1", "");  // memory-only node
+  sysfs.AddNode("possible", "0-2");
+
+  CpuTopology topology = internal::ReadCpuTopology(sysfs.root());
+  ASSERT_EQ(topology.nodes.size(), 2);
+  EXPECT_THAT(topology.nodes[0], ElementsAre(0, 1, 2, 3));
+  EXPECT_THAT(topology.nodes[1], ElementsAre(4, 5));
+  EXPECT_EQ(topology.NumCpus(), 6);
+}
+
+TEST(CpuTopologyTest, MissingTopology) {
+  FakeSysfs sysfs;
+  CpuTopology topology = internal::ReadCpuTopology(sysfs.root());
+  ASSERT_EQ(topology.nodes.size(), 1);
+  EXPECT_EQ(topology.NumCpus(),
+            std::max(std::thread::hardware_concurrency(), 1u));
+}
+
+TEST(CpuTopologyTest, WorkerPlacement) {
+  CpuTopology topology;
+  topology.nodes = {{0, 1, 2, 3}, {4, 5}};
+
+  // Workers alternate between nodes until the smaller node is full, and wrap
+  // around when there are more workers than CPUs.
+  WorkerPlacement placement(topology, 8);
+  ASSERT_EQ(placement.NumNodes(), 2);
+  EXPECT_EQ(placement.Cpu(0), 0);
+  EXPECT_EQ(placement.Cpu(1), 4);
+  EXPECT_EQ(placement.Cpu(2), 1);
+  EXPECT_EQ(placement.Cpu(3), 5);
+  EXPECT_EQ(placement.Cpu(4), 2);
+  EXPECT_EQ(placement.Cpu(5), 3);
+  EXPECT_EQ(placement.Cpu(6), 0);
+  EXPECT_EQ(placement.Cpu(7), 4);
+  EXPECT_THAT(placement.NodeThreads(0), ElementsAre(0, 2, 4, 5, 6));
+  EXPECT_THAT(placement.NodeThreads(1), ElementsAre(1, 3, 7));
+  EXPECT_EQ(placement.Node(7), 1);
+
+  EXPECT_EQ(placement.NodeOfCpu(3), 0);
+  EXPECT_EQ(placement.NodeOfCpu(5), 1);
+  EXPECT_EQ(placement.NodeOfCpu(6), -1);
+  EXPECT_EQ(placement.NodeOfCpu(-1), -1);
+}
+
+TEST(CpuTopologyTest, NodeWithoutWorkers) {
+  CpuTopology topology;
+  topology.nodes = {{0, 1}, {2, 3}};
+
+  WorkerPlacement placement(topology, 1);
+  EXPECT_THAT(placement.NodeThreads(0), ElementsAre(0));
+  EXPECT_TRUE(placement.NodeThreads(1).empty());
+  // Tasks from the CPUs of the second node can't stay on that node.
+  EXPECT_EQ(placement.NodeOfCpu(2), -1);
+}
+
+TEST(CpuTopologyTest, NonBlockingWorkQueueWithFakeTopology) {
+  CpuTopology topology;
+  topology.nodes = {{0, 1}, {2, 3}};
+
+  auto quiescing_state = std::make_unique<internal::QuiescingState>();
+  WorkQueue work_queue(quiescing_state.get(), 4, &topology);
+
+  // Each task submitted from the outside submits more tasks from a worker
+  // thread, which are stolen by the workers of both nodes.
+  const int kNumTasks = 100;
+  std::atomic<int> num_executed{0};
+  ::tfrt::latch latch(kNumTasks * kNumTasks);
+  for (int i = 0; i < kNumTasks; ++i) {
+    work_queue.AddTask(TaskFunction([&] {
+      for (int j = 0; j < kNumTasks; ++j) {
+        work_queue.AddTask(TaskFunction([&] {
+          ++num_executed;
+          latch.count_down();
+        }));
+      }
+    }));
+  }
+
+  latch.wait();
+  EXPECT_EQ(num_executed.load(), kNumTasks * kNumTasks);
+  work_queue.Quiesce();
+}
+
+}  // namespace
+}  // namespace tfrt
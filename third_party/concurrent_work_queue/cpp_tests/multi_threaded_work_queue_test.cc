@@ -15,6 +15,7 @@
 #include "tfrt/host_context/diagnostic.h"
 #include "tfrt/host_context/host_allocator.h"
 #include "tfrt/host_context/host_context.h"
+#include "tfrt/support/latch.h"
 
 namespace tfrt {
 namespace {
@@ -52,5 +53,60 @@ TEST(MultiThreadedWorkQueueTest, PingPong) {
   ASSERT_EQ(last_executed_task, num_tasks - 1);
 }
 
+TEST(MultiThreadedWorkQueueTest, NumaAware) {
+  auto host = std::make_unique<HostContext>(
+      [](const DecodedDiagnostic&) {}, CreateMallocAllocator(),
+      CreateNumaAwareMultiThreadedWorkQueue(4, 4));
+
+  std::atomic<int> num_executed{0};
+  const int num_tasks = 1000;
+  for (int i = 0; i < num_tasks; ++i) {
+    host->EnqueueWork([&]() {
+      host->EnqueueWork([&]() { ++num_executed; });
+      ++num_executed;
+    });
+  }
+
+  host->Quiesce();
+  ASSERT_EQ(num_executed, 2 * num_tasks);
+}
+
+TEST(MultiThreadedWorkQueueTest, Stats) {
+  auto host = CreateTestHostContext(4);
+
+  const int num_tasks = 1000;
+  const int num_blocking_tasks = 100;
+  ::tfrt::latch latch(num_tasks + num_blocking_tasks);
+  for (int i = 0; i < num_tasks; ++i) {
+    host->EnqueueWork([&]() { latch.count_down(); });
+  }
+  for (int i = 0; i < num_blocking_tasks; ++i) {
+    ASSERT_TRUE(host->EnqueueBlockingWork([&]() { latch.count_down(); }));
+  }
+
+  // Wait for the tasks before quiescing, so that they all run in the worker
+  // threads rather than in the caller thread.
+  latch.wait();
+  host->Quiesce();
+
+  WorkQueueStats stats = host->GetWorkQueueStats();
+  ASSERT_EQ(stats.worker_threads.size(), 4);
+  ASSERT_EQ(stats.blocking_threads.size(), 4);
+
+  auto sum_tasks_executed = [](ArrayRef<WorkerThreadStats> threads) {
+    uint64_t num_tasks_executed = 0;
+    for (const WorkerThreadStats& thread : threads) {
+      num_tasks_executed += thread.num_tasks_executed;
+      EXPECT_EQ(thread.queue_depth, 0);
+      EXPECT_LE(thread.num_successful_steals, thread.num_steal_attempts);
+      EXPECT_GT((thread.parked_time + thread.active_time).count(), 0);
+    }
+    return num_tasks_executed;
+  };
+  EXPECT_EQ(sum_tasks_executed(stats.worker_threads), num_tasks);
+  EXPECT_EQ(sum_tasks_executed(stats.blocking_threads), num_blocking_tasks);
+  EXPECT_LE(stats.num_idle_dynamic_threads, stats.num_dynamic_threads);
+}
+
 }  // namespace
 }  // namespace tfrt
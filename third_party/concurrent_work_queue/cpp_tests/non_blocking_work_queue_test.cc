@@ -10,8 +10,12 @@
 
 #include "non_blocking_work_queue.h"
 
+#include <vector>
+
 #include "benchmark/benchmark.h"
 #include "environment.h"
+#include "gtest/gtest.h"
+#include "tfrt/host_context/concurrent_work_queue.h"
 #include "tfrt/host_context/task_function.h"
 #include "tfrt/support/latch.h"
 
@@ -21,6 +25,141 @@ namespace {
 using ThreadingEnvironment = ::tfrt::internal::ThreadingEnvironment;
 using WorkQueue = ::tfrt::internal::NonBlockingWorkQueue<ThreadingEnvironment>;
 
+// Blocks the only worker thread of `work_queue` until the returned latch is
+// released, so that the tasks added in the meantime stay in its queue.
+std::unique_ptr<::tfrt::latch> BlockWorker(WorkQueue* work_queue) {
+  auto blocker = std::make_unique<::tfrt::latch>(1);
+  ::tfrt::latch started(1);
+  work_queue->AddTask(TaskFunction([&started, blocker = blocker.get()] {
+    started.count_down();
+    blocker->wait();
+  }));
+  started.wait();
+  return blocker;
+}
+
+TEST(NonBlockingWorkQueueTest, HighPriorityTasksRunFirst) {
+  auto quiescing_state = std::make_unique<internal::QuiescingState>();
+  WorkQueue work_queue(quiescing_state.get(), 1);
+  auto blocker = BlockWorker(&work_queue);
+
+  // Wait for the tasks with a latch, because Quiesce() would steal them.
+  ::tfrt::latch done(8);
+  std::vector<int> order;
+  auto task = [&](int i) {
+    return TaskFunction([&, i] {
+      order.push_back(i);
+      done.count_down();
+    });
+  };
+  for (int i = 0; i < 4; ++i) work_queue.AddTask(task(i));
+  for (int i = 4; i < 8; ++i) work_queue.AddTask(task(i), TaskPriority::kHigh);
+
+  blocker->count_down();
+  done.wait();
+  EXPECT_EQ(order, std::vector<int>({4, 5, 6, 7, 0, 1, 2, 3}));
+}
+
+TEST(NonBlockingWorkQueueTest, DefaultPriorityTasksAreNotStarved) {
+  auto quiescing_state = std::make_unique<internal::QuiescingState>();
+  WorkQueue work_queue(quiescing_state.get(), 1);
+  auto blocker = BlockWorker(&work_queue);
+
+  const int kNumHighPriorityTasks = 100;
+  ::tfrt::latch done(kNumHighPriorityTasks + 1);
+  int num_high_priority_executed = 0;
+  int high_priority_executed_before_default = -1;
+  work_queue.AddTask(TaskFunction([&] {
+    high_priority_executed_before_default = num_high_priority_executed;
+    done.count_down();
+  }));
+  for (int i = 0; i < kNumHighPriorityTasks; ++i) {
+    work_queue.AddTask(TaskFunction([&] {
+                         ++num_high_priority_executed;
+                         done.count_down();
+                       }),
+                       TaskPriority::kHigh);
+  }
+
+  blocker->count_down();
+  done.wait();
+  EXPECT_EQ(num_high_priority_executed, kNumHighPriorityTasks);
+  EXPECT_GE(high_priority_executed_before_default, 0);
+  EXPECT_LT(high_priority_executed_before_default, kNumHighPriorityTasks);
+}
+
+// Runs `num_tasks` no-op tasks and waits until the worker threads are parked.
+void RunTasksAndQuiesce(WorkQueue* work_queue, int num_tasks) {
+  ::tfrt::latch done(num_tasks);
+  for (int i = 0; i < num_tasks; ++i)
+    work_queue->AddTask(TaskFunction([&done] { done.count_down(); }));
+  done.wait();
+  work_queue->Quiesce();
+}
+
+TEST(NonBlockingWorkQueueTest, SpinningStats) {
+  auto quiescing_state = std::make_unique<internal::QuiescingState>();
+  WorkerSpinningOptions spinning;
+  spinning.max_spinning_threads = 2;
+  WorkQueue work_queue(quiescing_state.get(), 2, /*topology=*/nullptr,
+                       spinning);
+  RunTasksAndQuiesce(&work_queue, 1000);
+
+  // Threads that run out of work spin before they park.
+  internal::SpinningStats stats = work_queue.GetSpinningStats();
+  EXPECT_GT(stats.num_spins, 0);
+  EXPECT_LE(stats.num_successful_spins, stats.num_spins);
+  EXPECT_LE(stats.num_unparks, stats.num_parks);
+}
+
+TEST(NonBlockingWorkQueueTest, SpinningDisabled) {
+  auto quiescing_state = std::make_unique<internal::QuiescingState>();
+  WorkerSpinningOptions spinning;
+  spinning.max_spinning_threads = 0;
+  WorkQueue work_queue(quiescing_state.get(), 2, /*topology=*/nullptr,
+                       spinning);
+  RunTasksAndQuiesce(&work_queue, 1000);
+
+  internal::SpinningStats stats = work_queue.GetSpinningStats();
+  EXPECT_EQ(stats.num_spins, 0);
+  EXPECT_EQ(stats.num_successful_spins, 0);
+}
+
+TEST(NonBlockingWorkQueueTest, AddTasksWakesUpThreads) {
+  auto quiescing_state = std::make_unique<internal::QuiescingState>();
+  const int kNumThreads = 4;
+  WorkQueue work_queue(quiescing_state.get(), kNumThreads);
+
+  // The tasks wait for each other, so they complete only if all the threads
+  // run them in parallel.
+  auto add_tasks = [&](::tfrt::latch* started, ::tfrt::latch* done) {
+    std::vector<TaskFunction> tasks;
+    for (int i = 0; i < kNumThreads; ++i) {
+      tasks.emplace_back([started, done] {
+        started->count_down();
+        started->wait();
+        done->count_down();
+      });
+    }
+    work_queue.AddTasks(tasks);
+  };
+
+  // Add the tasks from a free-standing thread.
+  ::tfrt::latch started(kNumThreads);
+  ::tfrt::latch done(kNumThreads);
+  add_tasks(&started, &done);
+  done.wait();
+  work_queue.Quiesce();
+
+  // Add the tasks from a worker thread.
+  ::tfrt::latch worker_started(kNumThreads);
+  ::tfrt::latch worker_done(kNumThreads);
+  work_queue.AddTask(
+      TaskFunction([&] { add_tasks(&worker_started, &worker_done); }));
+  worker_done.wait();
+  work_queue.Quiesce();
+}
+
 // Benchmark work queue throughput.
 //
 // Submit `num_producers` tasks to `producer` work queue, each submitting
@@ -57,6 +196,40 @@ void NoOp(WorkQueue& producer, WorkQueue& worker, benchmark::State& state) {
   state.SetItemsProcessed(num_producers * num_tasks * state.iterations());
 }
 
+// Same as NoOp, but each producer task submits its `num_tasks` tasks in a
+// single batch.
+void NoOpBatched(WorkQueue& producer, WorkQueue& worker,
+                 benchmark::State& state) {
+  const int num_producers = state.range(0);
+  const int num_tasks = state.range(1);
+
+  for (auto _ : state) {
+    ::tfrt::latch latch(2 * num_producers);
+
+    std::atomic<int>* counters = new std::atomic<int>[num_producers];
+    for (int i = 0; i < num_producers; ++i) counters[i] = num_tasks;
+
+    for (int i = 0; i < num_producers; ++i) {
+      producer.AddTask(TaskFunction([&, i] {
+        std::vector<TaskFunction> tasks;
+        tasks.reserve(num_tasks);
+        for (int j = 0; j < num_tasks; ++j) {
+          tasks.emplace_back([&, i]() {
+            if (counters[i].fetch_sub(1) == 1) latch.count_down();
+          });
+        }
+        worker.AddTasks(tasks);
+        latch.count_down();
+      }));
+    }
+
+    latch.wait();
+    delete[] counters;
+  }
+
+  state.SetItemsProcessed(num_producers * num_tasks * state.iterations());
+}
+
 #define BM_Run(FN, producer_threads, worker_threads)                 \
   static void BM_##FN##_tpool_##producer_threads##x##worker_threads( \
       benchmark::State& state) {                                     \
@@ -78,10 +251,21 @@ void NoOp(WorkQueue& producer, WorkQueue& worker, benchmark::State& state) {
       ->ArgPair(100, 100)                         \
       ->ArgPair(100, 1000)
 
+#define BM_NoOpBatched(producer_threads, worker_threads) \
+  BM_Run(NoOpBatched, producer_threads, worker_threads)  \
+      ->ArgPair(10, 10)                                  \
+      ->ArgPair(10, 100)                                 \
+      ->ArgPair(10, 1000)                                \
+      ->ArgPair(100, 10)                                 \
+      ->ArgPair(100, 100)
+
 BM_NoOp(4, 4);
 BM_NoOp(8, 8);
 BM_NoOp(16, 16);
 BM_NoOp(32, 32);
 
+BM_NoOpBatched(4, 4);
+BM_NoOpBatched(16, 16);
+
 }  // namespace
 }  // namespace tfrt
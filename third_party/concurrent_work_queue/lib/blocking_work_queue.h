@@ -67,6 +67,11 @@ class BlockingWorkQueue
 
   void Quiesce();
 
+  // Returns the number of started dynamic threads, and how many of them are
+  // waiting for the next task.
+  void GetDynamicThreadStats(int* num_dynamic_threads,
+                             int* num_idle_dynamic_threads) const;
+
  private:
   static constexpr char const* kThreadNamePrefix = "tfrt-blocking-queue";
   static constexpr char const* kDynamicThreadNamePrefix = "tfrt-dynamic-queue";
@@ -88,6 +93,7 @@ class BlockingWorkQueue
   LLVM_NODISCARD Optional<TaskFunction> NextTask(Queue* queue);
   LLVM_NODISCARD Optional<TaskFunction> Steal(Queue* queue);
   LLVM_NODISCARD bool Empty(Queue* queue);
+  LLVM_NODISCARD unsigned Size(const Queue* queue);
 
   // If the blocking task does not allow queuing, it is executed in one of the
   // dynamically spawned threads. These threads have 1-to-1 task-to-thread
@@ -106,7 +112,7 @@ class BlockingWorkQueue
   const std::chrono::nanoseconds idle_wait_time_;
 
   // All operations with dynamic threads are done holding this mutex.
-  mutex mutex_;
+  mutable mutex mutex_;
   condition_variable wake_do_work_cv_;
   condition_variable thread_exited_cv_;
 
@@ -344,6 +350,20 @@ LLVM_NODISCARD bool BlockingWorkQueue<ThreadingEnvironment>::Empty(
   return queue->Empty();
 }
 
+template <typename ThreadingEnvironment>
+LLVM_NODISCARD unsigned BlockingWorkQueue<ThreadingEnvironment>::Size(
+    const Queue* queue) {
+  return queue->Size();
+}
+
+template <typename ThreadingEnvironment>
+void BlockingWorkQueue<ThreadingEnvironment>::GetDynamicThreadStats(
+    int* num_dynamic_threads, int* num_idle_dynamic_threads) const {
+  mutex_lock lock(mutex_);
+  *num_dynamic_threads = num_dynamic_threads_;
+  *num_idle_dynamic_threads = num_idle_dynamic_threads_;
+}
+
 }  // namespace internal
 }  // namespace tfrt
 
@@ -0,0 +1,156 @@
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+//===- cpu_topology.cc ------------------------------------------*- C++ -*-===//
+//
+// CPU topology discovery and worker thread placement.
+//
+//===----------------------------------------------------------------------===//
+
+#include "cpu_topology.h"
+
+#include <algorithm>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <utility>
+
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
+#include "work_queue_base.h"
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+namespace tfrt {
+namespace internal {
+
+int CpuTopology::NumCpus() const {
+  int num_cpus = 0;
+  for (const std::vector<int>& cpus : nodes) num_cpus += cpus.size();
+  return num_cpus;
+}
+
+bool ParseCpuList(string_view cpulist, std::vector<int>* cpus) {
+  cpulist = cpulist.trim();
+  if (cpulist.empty()) return true;
+
+  llvm::SmallVector<string_view, 8> ranges;
+  cpulist.split(ranges, ',');
+  for (string_view range : ranges) {
+    string_view first, last;
+    std::tie(first, last) = range.split('-');
+    int begin, end;
+    if (first.trim().getAsInteger(10, begin)) return false;
+    end = begin;
+    if (first.size() != range.size() && last.trim().getAsInteger(10, end))
+      return false;
+    if (begin < 0 || end < begin) return false;
+    for (int cpu = begin; cpu <= end; ++cpu) cpus->push_back(cpu);
+  }
+  return true;
+}
+
+static CpuTopology DefaultCpuTopology() {
+  CpuTopology topology;
+  topology.nodes.emplace_back();
+  int num_cpus = std::max(std::thread::hardware_concurrency(), 1u);
+  for (int cpu = 0; cpu < num_cpus; ++cpu) topology.nodes[0].push_back(cpu);
+  return topology;
+}
+
+CpuTopology ReadCpuTopology(string_view sysfs_root) {
+  llvm::SmallString<128> node_dir(sysfs_root);
+  llvm::sys::path::append(node_dir, "devices", "system", "node");
+
+  // Node ids might be sparse, so list the directory instead of probing ids.
+  std::vector<std::pair<int, std::vector<int>>> nodes;
+  std::error_code ec;
+  for (llvm::sys::fs::directory_iterator it(node_dir, ec), end;
+       it != end && !ec; it.increment(ec)) {
+    string_view name = llvm::sys::path::filename(it->path());
+    int node_id;
+    if (!name.consume_front("node") || name.getAsInteger(10, node_id))
+      continue;
+
+    llvm::SmallString<128> cpulist_path(it->path());
+    llvm::sys::path::append(cpulist_path, "cpulist");
+    std::ifstream file(std::string(cpulist_path.str()));
+    std::string cpulist;
+    if (!file || !std::getline(file, cpulist)) continue;
+
+    std::vector<int> cpus;
+    // Memory-only nodes have an empty cpulist.
+    if (!ParseCpuList(cpulist, &cpus) || cpus.empty()) continue;
+    nodes.emplace_back(node_id, std::move(cpus));
+  }
+
+  if (nodes.empty()) return DefaultCpuTopology();
+
+  std::sort(nodes.begin(), nodes.end());
+  CpuTopology topology;
+  for (auto& node : nodes) topology.nodes.push_back(std::move(node.second));
+  return topology;
+}
+
+CpuTopology GetSystemCpuTopology() {
+  CpuTopology topology = ReadCpuTopology("/sys");
+
+#if defined(__linux__)
+  // Drop the CPUs that we are not allowed to run on (e.g. because of taskset
+  // or cgroup cpusets), pinning worker threads to them would fail.
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) return topology;
+
+  CpuTopology restricted;
+  for (const std::vector<int>& node : topology.nodes) {
+    std::vector<int> cpus;
+    for (int cpu : node)
+      if (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed)) cpus.push_back(cpu);
+    if (!cpus.empty()) restricted.nodes.push_back(std::move(cpus));
+  }
+  if (!restricted.nodes.empty()) return restricted;
+#endif
+
+  return topology;
+}
+
+WorkerPlacement::WorkerPlacement(const CpuTopology& topology, int num_threads)
+    : thread_cpus_(num_threads),
+      thread_nodes_(num_threads),
+      node_threads_(topology.nodes.size()) {
+  assert(!topology.nodes.empty() && "topology must have at least one node");
+
+  // Order CPUs by taking one CPU from each node in turn, so that consecutive
+  // workers land on different nodes even if the nodes have different sizes.
+  std::vector<std::pair<int, int>> cpus;  // (cpu, node)
+  for (int i = 0; cpus.size() < topology.NumCpus(); ++i) {
+    for (int node = 0; node < topology.nodes.size(); ++node) {
+      if (i < topology.nodes[node].size())
+        cpus.emplace_back(topology.nodes[node][i], node);
+    }
+  }
+
+  for (int thread_id = 0; thread_id < num_threads; ++thread_id) {
+    std::pair<int, int> cpu = cpus[thread_id % cpus.size()];
+    thread_cpus_[thread_id] = cpu.first;
+    thread_nodes_[thread_id] = cpu.second;
+    node_threads_[cpu.second].push_back(thread_id);
+  }
+
+  for (const std::vector<int>& threads : node_threads_)
+    node_coprimes_.push_back(ComputeCoprimes(threads.size()));
+
+  for (const std::pair<int, int>& cpu : cpus) {
+    if (node_threads_[cpu.second].empty()) continue;
+    if (cpu.first >= cpu_nodes_.size()) cpu_nodes_.resize(cpu.first + 1, -1);
+    cpu_nodes_[cpu.first] = cpu.second;
+  }
+}
+
+}  // namespace internal
+}  // namespace tfrt
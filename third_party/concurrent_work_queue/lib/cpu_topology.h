@@ -0,0 +1,90 @@
+// This Source Code Form is subject to the terms of the Mozilla
+// Public License v. 2.0. If a copy of the MPL was not distributed
+// with this file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+//===- cpu_topology.h -------------------------------------------*- C++ -*-===//
+//
+// CPU topology of the machine (logical CPUs grouped by NUMA node), and the
+// placement of work queue worker threads on it.
+//
+// On Linux the topology is read from sysfs:
+//
+//   /sys/devices/system/node/node<N>/cpulist
+//
+// Reading from a different sysfs root allows to test the placement with a
+// fake topology.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef TFRT_THIRD_PARTY_CONCURRENT_WORK_QUEUE_CPU_TOPOLOGY_H_
+#define TFRT_THIRD_PARTY_CONCURRENT_WORK_QUEUE_CPU_TOPOLOGY_H_
+
+#include <vector>
+
+#include "llvm/ADT/ArrayRef.h"
+#include "tfrt/support/forward_decls.h"
+
+namespace tfrt {
+namespace internal {
+
+struct CpuTopology {
+  // Logical CPU ids of each NUMA node. Nodes without CPUs are not included.
+  std::vector<std::vector<int>> nodes;
+
+  int NumCpus() const;
+};
+
+// Parses a Linux cpulist string, e.g. "0-3,8,10-11". Returns false if the
+// string is malformed.
+bool ParseCpuList(string_view cpulist, std::vector<int>* cpus);
+
+// Reads the NUMA topology from `sysfs_root`. If the topology is not available
+// (e.g. not on Linux), returns a single node with
+// std::thread::hardware_concurrency() CPUs.
+CpuTopology ReadCpuTopology(string_view sysfs_root);
+
+// Reads the NUMA topology of the machine, restricted to the CPUs the process
+// is allowed to run on.
+CpuTopology GetSystemCpuTopology();
+
+// Assignment of the worker threads of a work queue to CPUs. Workers are spread
+// evenly over the NUMA nodes, and over the CPUs within each node. If there are
+// more workers than CPUs, CPUs are assigned to multiple workers.
+class WorkerPlacement {
+ public:
+  WorkerPlacement(const CpuTopology& topology, int num_threads);
+
+  int NumNodes() const { return node_threads_.size(); }
+
+  // CPU the worker thread should be pinned to.
+  int Cpu(int thread_id) const { return thread_cpus_[thread_id]; }
+
+  // NUMA node of the worker thread.
+  int Node(int thread_id) const { return thread_nodes_[thread_id]; }
+
+  // Worker threads placed on the NUMA node, and the coprimes of their number
+  // for random walks over them (see ComputeCoprimes).
+  ArrayRef<int> NodeThreads(int node) const { return node_threads_[node]; }
+  ArrayRef<unsigned> NodeCoprimes(int node) const {
+    return node_coprimes_[node];
+  }
+
+  // Returns the NUMA node of the CPU if any worker threads are placed on the
+  // node, or `-1` otherwise.
+  int NodeOfCpu(int cpu) const {
+    if (cpu < 0 || cpu >= cpu_nodes_.size()) return -1;
+    return cpu_nodes_[cpu];
+  }
+
+ private:
+  std::vector<int> thread_cpus_;
+  std::vector<int> thread_nodes_;
+  std::vector<std::vector<int>> node_threads_;
+  std::vector<std::vector<unsigned>> node_coprimes_;
+  std::vector<int> cpu_nodes_;  // indexed by CPU id
+};
+
+}  // namespace internal
+}  // namespace tfrt
+
+#endif  // TFRT_THIRD_PARTY_CONCURRENT_WORK_QUEUE_CPU_TOPOLOGY_H_
@@ -19,6 +19,11 @@
 #include "llvm/ADT/StringRef.h"
 #include "tfrt/support/forward_decls.h"
 
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
 namespace tfrt {
 namespace internal {
 
@@ -44,6 +49,27 @@ struct StdThreadingEnvironment {
   static uint64_t ThisThreadIdHash() {
     return std::hash<std::thread::id>()(std::this_thread::get_id());
   }
+
+  static bool SetThisThreadAffinity(int cpu) {
+#if defined(__linux__)
+    if (cpu < 0 || cpu >= CPU_SETSIZE) return false;
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    CPU_SET(cpu, &cpu_set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set) ==
+           0;
+#else
+    return false;
+#endif
+  }
+
+  static int ThisThreadCpu() {
+#if defined(__linux__)
+    return sched_getcpu();
+#else
+    return -1;
+#endif
+  }
 };
 
 using ThreadingEnvironment = StdThreadingEnvironment;
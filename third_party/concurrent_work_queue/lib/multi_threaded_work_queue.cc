@@ -13,6 +13,7 @@
 #include <thread>
 
 #include "blocking_work_queue.h"
+#include "cpu_topology.h"
 #include "environment.h"
 #include "llvm/ADT/ArrayRef.h"
 #include "non_blocking_work_queue.h"
@@ -29,17 +30,24 @@ class MultiThreadedWorkQueue : public ConcurrentWorkQueue {
   using ThreadingEnvironment = ::tfrt::internal::ThreadingEnvironment;
 
  public:
-  MultiThreadedWorkQueue(int num_threads, int num_blocking_threads);
+  // If `topology` is not null, non-blocking worker threads are placed on it.
+  MultiThreadedWorkQueue(int num_threads, int num_blocking_threads,
+                         const internal::CpuTopology* topology,
+                         const WorkerSpinningOptions& spinning);
   ~MultiThreadedWorkQueue() override;
 
   std::string name() const override {
     return StrCat("Multi-threaded C++ work queue (", num_threads_, " threads, ",
-                  num_blocking_threads_, " blocking threads)");
+                  num_blocking_threads_, " blocking threads",
+                  numa_aware_ ? ", NUMA aware" : "", ")");
   }
 
   int GetParallelismLevel() const final { return num_threads_; }
 
   void AddTask(TaskFunction task) final;
+  void AddTaskWithPriority(TaskPriority priority, TaskFunction task) final;
+  void AddTasks(TaskPriority priority,
+                MutableArrayRef<TaskFunction> tasks) final;
   Optional<TaskFunction> AddBlockingTask(TaskFunction task,
                                          bool allow_queuing) final;
   void Quiesce() final;
@@ -47,21 +55,28 @@ class MultiThreadedWorkQueue : public ConcurrentWorkQueue {
 
   bool IsInWorkerThread() const final;
 
+  WorkQueueStats GetStats() const final;
+
  private:
   const int num_threads_;
   const int num_blocking_threads_;
+  const bool numa_aware_;
 
   std::unique_ptr<internal::QuiescingState> quiescing_state_;
   internal::NonBlockingWorkQueue<ThreadingEnvironment> non_blocking_work_queue_;
   internal::BlockingWorkQueue<ThreadingEnvironment> blocking_work_queue_;
 };
 
-MultiThreadedWorkQueue::MultiThreadedWorkQueue(int num_threads,
-                                               int num_blocking_threads)
+MultiThreadedWorkQueue::MultiThreadedWorkQueue(
+    int num_threads, int num_blocking_threads,
+    const internal::CpuTopology* topology,
+    const WorkerSpinningOptions& spinning)
     : num_threads_(num_threads),
       num_blocking_threads_(num_blocking_threads),
+      numa_aware_(topology != nullptr),
       quiescing_state_(std::make_unique<internal::QuiescingState>()),
-      non_blocking_work_queue_(quiescing_state_.get(), num_threads),
+      non_blocking_work_queue_(quiescing_state_.get(), num_threads, topology,
+                               spinning),
       blocking_work_queue_(quiescing_state_.get(), num_blocking_threads) {}
 
 MultiThreadedWorkQueue::~MultiThreadedWorkQueue() {
@@ -74,6 +89,16 @@ void MultiThreadedWorkQueue::AddTask(TaskFunction task) {
   non_blocking_work_queue_.AddTask(std::move(task));
 }
 
+void MultiThreadedWorkQueue::AddTaskWithPriority(TaskPriority priority,
+                                                 TaskFunction task) {
+  non_blocking_work_queue_.AddTask(std::move(task), priority);
+}
+
+void MultiThreadedWorkQueue::AddTasks(TaskPriority priority,
+                                      MutableArrayRef<TaskFunction> tasks) {
+  non_blocking_work_queue_.AddTasks(tasks, priority);
+}
+
 Optional<TaskFunction> MultiThreadedWorkQueue::AddBlockingTask(
     TaskFunction task, bool allow_queuing) {
   if (allow_queuing) {
@@ -124,11 +149,46 @@ bool MultiThreadedWorkQueue::IsInWorkerThread() const {
   return non_blocking_work_queue_.IsInWorkerThread();
 }
 
+WorkQueueStats MultiThreadedWorkQueue::GetStats() const {
+  WorkQueueStats stats;
+  stats.worker_threads = non_blocking_work_queue_.GetWorkerThreadStats();
+  stats.blocking_threads = blocking_work_queue_.GetWorkerThreadStats();
+  blocking_work_queue_.GetDynamicThreadStats(&stats.num_dynamic_threads,
+                                             &stats.num_idle_dynamic_threads);
+  return stats;
+}
+
 std::unique_ptr<ConcurrentWorkQueue> CreateMultiThreadedWorkQueue(
+    const MultiThreadedWorkQueueOptions& options) {
+  assert(options.num_threads > 0 && options.num_blocking_threads > 0);
+  assert(options.spinning.max_spinning_threads >= 0 &&
+         options.spinning.spin_count >= 0);
+  if (!options.numa_aware) {
+    return std::make_unique<MultiThreadedWorkQueue>(
+        options.num_threads, options.num_blocking_threads,
+        /*topology=*/nullptr, options.spinning);
+  }
+  internal::CpuTopology topology = internal::GetSystemCpuTopology();
+  return std::make_unique<MultiThreadedWorkQueue>(
+      options.num_threads, options.num_blocking_threads, &topology,
+      options.spinning);
+}
+
+std::unique_ptr<ConcurrentWorkQueue> CreateMultiThreadedWorkQueue(
+    int num_threads, int num_blocking_threads) {
+  MultiThreadedWorkQueueOptions options;
+  options.num_threads = num_threads;
+  options.num_blocking_threads = num_blocking_threads;
+  return CreateMultiThreadedWorkQueue(options);
+}
+
+std::unique_ptr<ConcurrentWorkQueue> CreateNumaAwareMultiThreadedWorkQueue(
     int num_threads, int num_blocking_threads) {
-  assert(num_threads > 0 && num_blocking_threads > 0);
-  return std::make_unique<MultiThreadedWorkQueue>(num_threads,
-                                                  num_blocking_threads);
+  MultiThreadedWorkQueueOptions options;
+  options.num_threads = num_threads;
+  options.num_blocking_threads = num_blocking_threads;
+  options.numa_aware = true;
+  return CreateMultiThreadedWorkQueue(options);
 }
 
 }  // namespace tfrt
@@ -18,6 +18,12 @@
 // mostly LIFO task execution order, which is optimal for cache locality for
 // compute intensive tasks.
 //
+// Each thread has a separate TaskDeque for high priority tasks. Threads pop and
+// steal high priority tasks first, however after running
+// `kMaxHighPriorityTasksInARow` high priority tasks from its own queue a thread
+// runs one default priority task, so that a steady stream of high priority
+// tasks can't starve the default priority ones.
+//
 // Work stealing algorithm is based on:
 //
 //   "Thread Scheduling for Multiprogrammed Multiprocessors"
@@ -30,6 +36,7 @@
 
 #include "llvm/Support/Compiler.h"
 #include "task_deque.h"
+#include "tfrt/host_context/concurrent_work_queue.h"
 #include "tfrt/host_context/task_function.h"
 #include "work_queue_base.h"
 
@@ -39,11 +46,38 @@ namespace internal {
 template <typename ThreadingEnvironment>
 class NonBlockingWorkQueue;
 
+// Pending tasks of a worker thread, in a separate TaskDeque for each priority.
+struct PriorityTaskDeques {
+  TaskDeque& Get(TaskPriority priority) {
+    return priority == TaskPriority::kHigh ? high_priority : default_priority;
+  }
+
+  bool Empty() const {
+    return high_priority.Empty() && default_priority.Empty();
+  }
+
+  unsigned Size() const {
+    return high_priority.Size() + default_priority.Size();
+  }
+
+  void Flush() {
+    high_priority.Flush();
+    default_priority.Flush();
+  }
+
+  TaskDeque high_priority;
+  TaskDeque default_priority;
+
+  // The number of high priority tasks the owner thread popped since it last
+  // popped a default priority task. Accessed only by the owner thread.
+  unsigned num_high_priority_in_a_row = 0;
+};
+
 template <typename ThreadingEnvironmentTy>
 struct WorkQueueTraits<NonBlockingWorkQueue<ThreadingEnvironmentTy>> {
   using ThreadingEnvironment = ThreadingEnvironmentTy;
   using Thread = typename ThreadingEnvironment::Thread;
-  using Queue = ::tfrt::internal::TaskDeque;
+  using Queue = ::tfrt::internal::PriorityTaskDeques;
 };
 
 template <typename ThreadingEnvironment>
@@ -57,23 +91,40 @@ class NonBlockingWorkQueue
   using ThreadData = typename Base::ThreadData;
 
  public:
+  // If `topology` is not null, worker threads are placed on the NUMA topology
+  // (see WorkQueueBase).
   explicit NonBlockingWorkQueue(QuiescingState* quiescing_state,
-                                int num_threads);
+                                int num_threads,
+                                const CpuTopology* topology = nullptr,
+                                const WorkerSpinningOptions& spinning = {});
   ~NonBlockingWorkQueue() = default;
 
-  void AddTask(TaskFunction task);
+  void AddTask(TaskFunction task,
+               TaskPriority priority = TaskPriority::kDefault);
+
+  // Adds all `tasks` (moving them out of the array) spread over the queues of
+  // the worker threads, and wakes up as many parked threads as needed to run
+  // them in parallel.
+  void AddTasks(MutableArrayRef<TaskFunction> tasks,
+                TaskPriority priority = TaskPriority::kDefault);
 
   using Base::Steal;
 
  private:
   static constexpr char const* kThreadNamePrefix = "tfrt-non-blocking-queue";
 
+  // Starvation protection: the maximum number of high priority tasks a thread
+  // pops from its own queue before it pops a default priority task.
+  static constexpr unsigned kMaxHighPriorityTasksInARow = 16;
+
   template <typename WorkQueue>
   friend class WorkQueueBase;
 
   using Base::GetPerThread;
   using Base::IsNotifyParkedThreadRequired;
   using Base::IsQuiescing;
+  using Base::NotifyParkedThreads;
+  using Base::RandomQueueIndex;
   using Base::WithPendingTaskCounter;
 
   using Base::coprimes_;
@@ -84,16 +135,19 @@ class NonBlockingWorkQueue
   LLVM_NODISCARD Optional<TaskFunction> NextTask(Queue* queue);
   LLVM_NODISCARD Optional<TaskFunction> Steal(Queue* queue);
   LLVM_NODISCARD bool Empty(Queue* queue);
+  LLVM_NODISCARD unsigned Size(const Queue* queue);
 };
 
 template <typename ThreadingEnvironment>
 NonBlockingWorkQueue<ThreadingEnvironment>::NonBlockingWorkQueue(
-    QuiescingState* quiescing_state, int num_threads)
+    QuiescingState* quiescing_state, int num_threads,
+    const CpuTopology* topology, const WorkerSpinningOptions& spinning)
     : WorkQueueBase<NonBlockingWorkQueue>(quiescing_state, kThreadNamePrefix,
-                                          num_threads) {}
+                                          num_threads, topology, spinning) {}
 
 template <typename ThreadingEnvironment>
-void NonBlockingWorkQueue<ThreadingEnvironment>::AddTask(TaskFunction task) {
+void NonBlockingWorkQueue<ThreadingEnvironment>::AddTask(
+    TaskFunction task, TaskPriority priority) {
   // Keep track of the number of pending tasks.
   if (IsQuiescing()) task = WithPendingTaskCounter(std::move(task));
 
@@ -107,17 +161,18 @@ void NonBlockingWorkQueue<ThreadingEnvironment>::AddTask(TaskFunction task) {
   //
   // If a caller is a free-standing thread (or worker of another pool), we push
   // the new task into a random queue (FIFO execution order). Tasks still could
-  // be executed in LIFO order, if they would be stolen by other workers.
+  // be executed in LIFO order, if they would be stolen by other workers. With
+  // worker placement the random queue belongs to the caller NUMA node.
 
   PerThread* pt = GetPerThread();
   if (pt->parent == this) {
     // Worker thread of this pool, push onto the thread's queue.
-    Queue& q = thread_data_[pt->thread_id].queue;
+    TaskDeque& q = thread_data_[pt->thread_id].queue.Get(priority);
     inline_task = q.PushFront(std::move(task));
   } else {
     // A free-standing thread (or worker of another pool).
-    unsigned rnd = FastReduce(pt->rng(), num_threads_);
-    Queue& q = thread_data_[rnd].queue;
+    unsigned rnd = RandomQueueIndex(pt);
+    TaskDeque& q = thread_data_[rnd].queue.Get(priority);
     inline_task = q.PushBack(std::move(task));
   }
   // Note: below we touch `*this` after making `task` available to worker
@@ -136,16 +191,64 @@ void NonBlockingWorkQueue<ThreadingEnvironment>::AddTask(TaskFunction task) {
   }
 }
 
+template <typename ThreadingEnvironment>
+void NonBlockingWorkQueue<ThreadingEnvironment>::AddTasks(
+    MutableArrayRef<TaskFunction> tasks, TaskPriority priority) {
+  if (tasks.empty()) return;
+
+  // Keep track of the number of pending tasks.
+  if (IsQuiescing()) {
+    for (TaskFunction& task : tasks)
+      task = WithPendingTaskCounter(std::move(task));
+  }
+
+  // Tasks that did not fit into full worker queues. They are executed in the
+  // current thread after all the other tasks are made available to workers.
+  llvm::SmallVector<TaskFunction, 4> inline_tasks;
+
+  // Spread the tasks round robin over the queues, starting from the queue
+  // AddTask() would have picked. A worker thread of this pool pushes into the
+  // front of its own queue (as in AddTask), and into the back of the others.
+  PerThread* pt = GetPerThread();
+  const int own_queue = pt->parent == this ? pt->thread_id : -1;
+  unsigned index = own_queue >= 0 ? own_queue : RandomQueueIndex(pt);
+
+  for (TaskFunction& task : tasks) {
+    TaskDeque& q = thread_data_[index].queue.Get(priority);
+    llvm::Optional<TaskFunction> inline_task =
+        index == own_queue ? q.PushFront(std::move(task))
+                           : q.PushBack(std::move(task));
+    if (inline_task.hasValue()) inline_tasks.push_back(std::move(*inline_task));
+    if (++index == num_threads_) index = 0;
+  }
+
+  // See the note about the racy-use-after-free in AddTask().
+  NotifyParkedThreads(tasks.size() - inline_tasks.size());
+  for (TaskFunction& task : inline_tasks) task();
+}
+
 template <typename ThreadingEnvironment>
 LLVM_NODISCARD Optional<TaskFunction>
 NonBlockingWorkQueue<ThreadingEnvironment>::NextTask(Queue* queue) {
-  return queue->PopFront();
+  if (queue->num_high_priority_in_a_row < kMaxHighPriorityTasksInARow) {
+    Optional<TaskFunction> task = queue->high_priority.PopFront();
+    if (task.hasValue()) {
+      ++queue->num_high_priority_in_a_row;
+      return task;
+    }
+  }
+  queue->num_high_priority_in_a_row = 0;
+  Optional<TaskFunction> task = queue->default_priority.PopFront();
+  if (task.hasValue()) return task;
+  return queue->high_priority.PopFront();
 }
 
 template <typename ThreadingEnvironment>
 LLVM_NODISCARD Optional<TaskFunction>
 NonBlockingWorkQueue<ThreadingEnvironment>::Steal(Queue* queue) {
-  return queue->PopBack();
+  Optional<TaskFunction> task = queue->high_priority.PopBack();
+  if (task.hasValue()) return task;
+  return queue->default_priority.PopBack();
 }
 
 template <typename ThreadingEnvironment>
@@ -154,6 +257,12 @@ LLVM_NODISCARD bool NonBlockingWorkQueue<ThreadingEnvironment>::Empty(
   return queue->Empty();
 }
 
+template <typename ThreadingEnvironment>
+LLVM_NODISCARD unsigned NonBlockingWorkQueue<ThreadingEnvironment>::Size(
+    const Queue* queue) {
+  return queue->Size();
+}
+
 }  // namespace internal
 }  // namespace tfrt
 
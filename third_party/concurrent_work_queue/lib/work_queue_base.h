@@ -22,10 +22,18 @@
 // new task added to the queue.
 //
 // Before parking on a conditional variable, thread might go into a spin loop
-// (controlled by `kMaxSpinningThreads` constant), and execute steal loop for a
-// fixed number of iterations. This allows to skip expensive park/unpark
-// operations, and reduces latency. Increasing `kMaxSpinningThreads` improves
-// latency at the cost of burned CPU cycles.
+// (controlled by `WorkerSpinningOptions`), and execute steal loop for a number
+// of iterations. This allows to skip expensive park/unpark operations, and
+// reduces latency. Increasing `max_spinning_threads` improves latency at the
+// cost of burned CPU cycles. With adaptive spinning each thread shrinks its
+// spin count when spinning does not find tasks, and grows it back when it does.
+//
+// Optionally the work queue places its worker threads on the NUMA topology of
+// the machine (see WorkerPlacement): each worker is pinned to a CPU, steal loop
+// tries the queues of the workers on the same NUMA node before the others, and
+// tasks added by a free-standing thread are pushed to the queues of the node
+// the thread is running on. This keeps the tasks and the data they touch in
+// the memory of one node.
 //
 // See derived work queue implementation for more details about work stealing.
 //
@@ -46,6 +54,14 @@
 //    // good hash function and generate uniformly distributed values. Values
 //    // are used as an initial seed for per-thread random number generation.
 //    static uint64_t ThisThreadIdHash() {... }
+//
+//    // Pins the current thread to the logical CPU `cpu`. Returns false if
+//    // the thread can't be pinned (the thread keeps running unpinned).
+//    static bool SetThisThreadAffinity(int cpu) { ... }
+//
+//    // Returns the logical CPU the current thread is running on, or `-1` if
+//    // it is not known.
+//    static int ThisThreadCpu() { ... }
 //  }
 //
 //===----------------------------------------------------------------------===//
@@ -53,14 +69,18 @@
 #ifndef TFRT_THIRD_PARTY_CONCURRENT_WORK_QUEUE_WORK_QUEUE_BASE_H_
 #define TFRT_THIRD_PARTY_CONCURRENT_WORK_QUEUE_WORK_QUEUE_BASE_H_
 
+#include <algorithm>
 #include <atomic>
+#include <chrono>
 #include <memory>
 #include <string>
 #include <thread>
 
+#include "cpu_topology.h"
 #include "event_count.h"
 #include "llvm/Support/Compiler.h"
 #include "task_queue.h"
+#include "tfrt/host_context/concurrent_work_queue.h"
 #include "tfrt/host_context/task_function.h"
 #include "tfrt/support/forward_decls.h"
 #include "tfrt/support/logging.h"
@@ -94,6 +114,21 @@ inline uint32_t FastReduce(uint32_t x, uint32_t size) {
 template <typename Derived>
 struct WorkQueueTraits;
 
+// Counters of the park/unpark and spinning events of the worker threads, for
+// tuning WorkerSpinningOptions.
+struct SpinningStats {
+  uint64_t num_parks = 0;    // worker threads parked on the event count
+  uint64_t num_unparks = 0;  // parked worker threads woken up
+  uint64_t num_spins = 0;    // spin loops entered before parking
+  uint64_t num_successful_spins = 0;  // spin loops that found a task
+};
+
+// Increments a counter that is written by a single thread and read by others.
+inline void IncrementCounter(std::atomic<uint64_t>* counter) {
+  counter->store(counter->load(std::memory_order_relaxed) + 1,
+                 std::memory_order_relaxed);
+}
+
 //===----------------------------------------------------------------------===//
 // Quiescing enables pending tasks counter to implement strong work queue
 // emptiness check in the MultiThreadedWorkQueue::Quiesce() implementation.
@@ -212,6 +247,12 @@ class WorkQueueBase {
   //
   // bool Derived::Empty(Queue* queue);
 
+  // Size() returns the number of tasks in the queue. It's only used for
+  // statistics, so it might be an estimate if the queue is modified
+  // concurrently.
+  //
+  // unsigned Derived::Size(const Queue* queue);
+
   // ------------------------------------------------------------------------ //
 
   bool IsQuiescing() const {
@@ -245,6 +286,12 @@ class WorkQueueBase {
   // Stop all threads managed by this work queue.
   void Cancel();
 
+  // Returns the spinning counters summed over all worker threads.
+  SpinningStats GetSpinningStats() const;
+
+  // Returns the statistics of each worker thread.
+  std::vector<WorkerThreadStats> GetWorkerThreadStats() const;
+
  private:
   template <typename ThreadingEnvironment>
   friend class BlockingWorkQueue;
@@ -259,12 +306,46 @@ class WorkQueueBase {
     int thread_id;  // Worker thread index in the workers queue
   };
 
+  // Counters of a worker thread, written only by the thread itself. They are
+  // padded to keep them off the cache lines of the queue that is accessed by
+  // the stealing threads, and off the lines of the neighbouring ThreadData.
+  // Padding is used instead of alignas(128) because ThreadData lives in a
+  // std::vector, whose allocator ignores over-alignment before C++17.
+  struct ThreadCounters {
+    char padding_before[128];
+
+    std::atomic<uint64_t> num_tasks_executed{0};
+    std::atomic<uint64_t> num_steal_attempts{0};
+    std::atomic<uint64_t> num_successful_steals{0};
+    std::atomic<uint64_t> num_parks{0};
+    std::atomic<uint64_t> num_unparks{0};
+    std::atomic<uint64_t> num_spins{0};
+    std::atomic<uint64_t> num_successful_spins{0};
+
+    // Timestamps (see NowNanos) of the thread start and of the last park, and
+    // the time spent parked excluding the current park. `park_start_time` is
+    // zero if the thread is not parked.
+    std::atomic<int64_t> start_time{0};
+    std::atomic<int64_t> park_start_time{0};
+    std::atomic<int64_t> parked_time{0};
+
+    char padding_after[128];
+  };
+
   struct ThreadData {
     ThreadData() : thread(), queue() {}
     std::unique_ptr<Thread> thread;
     Queue queue;
+    ThreadCounters counters;
   };
 
+  // Monotonic clock for the thread statistics, in nanoseconds.
+  static int64_t NowNanos() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+  }
+
   // Returns a TaskFunction with an attached pending tasks counter, if the
   // quiescing mode is on.
   TaskFunction WithPendingTaskCounter(TaskFunction task) {
@@ -274,14 +355,15 @@ class WorkQueueBase {
         });
   }
 
-  // TODO(ezhulenev): Make this a runtime parameter? More spinning threads help
-  // to reduce latency at the cost of wasted CPU cycles.
-  static constexpr int kMaxSpinningThreads = 1;
-
-  // The number of steal loop spin iterations before parking (this number is
-  // divided by the number of threads, to get spin count for each thread).
+  // The default number of steal loop spin iterations before parking (this
+  // number is divided by the number of threads, to get spin count for each
+  // thread).
   static constexpr int kSpinCount = 5000;
 
+  // With adaptive spinning, the spin count of a thread stays within
+  // [spin_count / kAdaptiveSpinRange, spin_count].
+  static constexpr int kAdaptiveSpinRange = 16;
+
   // If there are enough active threads with an empty pending task queues, there
   // is no need for spinning before parking a thread that is out of work to do,
   // because these active threads will go into a steal loop after finishing with
@@ -292,8 +374,11 @@ class WorkQueueBase {
   // will be unparked, however this should be very rare in practice.
   static constexpr int kMinActiveThreadsToStartSpinning = 4;
 
+  // If `topology` is not null, worker threads are placed on it.
   explicit WorkQueueBase(QuiescingState* quiescing_state,
-                         string_view name_prefix, int num_threads);
+                         string_view name_prefix, int num_threads,
+                         const CpuTopology* topology = nullptr,
+                         const WorkerSpinningOptions& spinning = {});
   ~WorkQueueBase();
 
   // Main worker thread loop.
@@ -302,7 +387,7 @@ class WorkQueueBase {
   // WaitForWork() blocks until new work is available (returns true), or if it
   // is time to exit (returns false). Can optionally return a task to execute in
   // `task` (in such case `task.hasValue() == true` on return).
-  LLVM_NODISCARD bool WaitForWork(EventCount::Waiter* waiter,
+  LLVM_NODISCARD bool WaitForWork(int thread_id, EventCount::Waiter* waiter,
                                   llvm::Optional<TaskFunction>* task);
 
   // StartSpinning() checks if the number of threads in the spin loop is less
@@ -326,6 +411,12 @@ class WorkQueueBase {
 
   void Notify() { event_count_.Notify(false); }
 
+  // NotifyParkedThreads() is IsNotifyParkedThreadRequired() and Notify() for
+  // `num_tasks` tasks added to the queues at once: spinning threads pick up as
+  // many of them as they can, and a parked thread is woken up for each of the
+  // others (up to the number of threads).
+  void NotifyParkedThreads(unsigned num_tasks);
+
   // Returns current thread id if the caller thread is managed by `this`,
   // returns `-1` otherwise.
   int CurrentThreadId() const;
@@ -334,6 +425,20 @@ class WorkQueueBase {
   // if all queues are empty.
   LLVM_NODISCARD int NonEmptyQueueIndex();
 
+  // StealFromAnyThread() implements Steal() for the caller thread `pt`.
+  LLVM_NODISCARD llvm::Optional<TaskFunction> StealFromAnyThread(PerThread* pt);
+
+  // StealFromThreads() tries to steal a task from the queues of `threads` in a
+  // random order starting from `r`. `coprimes` are the coprimes of the number
+  // of `threads`.
+  LLVM_NODISCARD llvm::Optional<TaskFunction> StealFromThreads(
+      ArrayRef<int> threads, ArrayRef<unsigned> coprimes, unsigned r);
+
+  // Returns the index of a random queue for a new task added by a thread not
+  // managed by `this`. With worker placement it's a queue of a worker on the
+  // NUMA node of the caller CPU.
+  LLVM_NODISCARD unsigned RandomQueueIndex(PerThread* pt);
+
   LLVM_NODISCARD static PerThread* GetPerThread() {
     static thread_local PerThread per_thread_;
     PerThread* pt = &per_thread_;
@@ -344,11 +449,15 @@ class WorkQueueBase {
   unsigned NumActiveThreads() const { return num_threads_ - blocked_.load(); }
 
   const int num_threads_;
+  const WorkerSpinningOptions spinning_options_;
   ThreadingEnvironment threading_environment_;
 
   std::vector<ThreadData> thread_data_;
   std::vector<unsigned> coprimes_;
 
+  // Placement of worker threads on the NUMA topology, or null if disabled.
+  std::unique_ptr<WorkerPlacement> placement_;
+
   std::atomic<unsigned> blocked_;
   std::atomic<bool> done_;
   std::atomic<bool> cancelled_;
@@ -431,10 +540,16 @@ inline std::vector<unsigned> ComputeCoprimes(int n) {
 
 template <typename Derived>
 WorkQueueBase<Derived>::WorkQueueBase(QuiescingState* quiescing_state,
-                                      string_view name_prefix, int num_threads)
+                                      string_view name_prefix, int num_threads,
+                                      const CpuTopology* topology,
+                                      const WorkerSpinningOptions& spinning)
     : num_threads_(num_threads),
+      spinning_options_(spinning),
       thread_data_(num_threads),
       coprimes_(ComputeCoprimes(num_threads)),
+      placement_(topology ? std::make_unique<WorkerPlacement>(*topology,
+                                                              num_threads)
+                          : nullptr),
       blocked_(0),
       done_(false),
       cancelled_(false),
@@ -509,7 +624,34 @@ void WorkQueueBase<Derived>::Quiesce() {
 template <typename Derived>
 LLVM_NODISCARD llvm::Optional<TaskFunction> WorkQueueBase<Derived>::Steal() {
   PerThread* pt = GetPerThread();
+  llvm::Optional<TaskFunction> t = StealFromAnyThread(pt);
+
+  // Steals by threads not managed by `this` (e.g. in Quiesce) are not counted.
+  if (pt->parent == &derived_) {
+    ThreadCounters& counters = thread_data_[pt->thread_id].counters;
+    IncrementCounter(&counters.num_steal_attempts);
+    if (t.hasValue()) IncrementCounter(&counters.num_successful_steals);
+  }
+  return t;
+}
+
+template <typename Derived>
+LLVM_NODISCARD llvm::Optional<TaskFunction>
+WorkQueueBase<Derived>::StealFromAnyThread(PerThread* pt) {
   unsigned r = pt->rng();
+
+  // Stealing from workers on the same NUMA node keeps tasks close to the
+  // memory they were created with. Queues of the same node are visited once
+  // more below, but that's cheap compared to a remote steal.
+  if (placement_ && pt->parent == &derived_) {
+    int node = placement_->Node(pt->thread_id);
+    llvm::Optional<TaskFunction> t = StealFromThreads(
+        placement_->NodeThreads(node), placement_->NodeCoprimes(node), r);
+    if (t.hasValue()) return t;
+    // With a single node all queues have been visited already.
+    if (placement_->NumNodes() == 1) return llvm::None;
+  }
+
   unsigned victim = FastReduce(r, num_threads_);
   unsigned inc = coprimes_[FastReduce(r, coprimes_.size())];
 
@@ -526,6 +668,43 @@ LLVM_NODISCARD llvm::Optional<TaskFunction> WorkQueueBase<Derived>::Steal() {
   return llvm::None;
 }
 
+template <typename Derived>
+LLVM_NODISCARD llvm::Optional<TaskFunction>
+WorkQueueBase<Derived>::StealFromThreads(ArrayRef<int> threads,
+                                         ArrayRef<unsigned> coprimes,
+                                         unsigned r) {
+  const unsigned size = threads.size();
+  if (size == 0) return llvm::None;
+
+  unsigned victim = FastReduce(r, size);
+  unsigned inc = coprimes[FastReduce(r, coprimes.size())];
+
+  for (unsigned i = 0; i < size; i++) {
+    llvm::Optional<TaskFunction> t =
+        derived_.Steal(&(thread_data_[threads[victim]].queue));
+    if (t.hasValue()) return t;
+
+    victim += inc;
+    if (victim >= size) {
+      victim -= size;
+    }
+  }
+  return llvm::None;
+}
+
+template <typename Derived>
+unsigned WorkQueueBase<Derived>::RandomQueueIndex(PerThread* pt) {
+  unsigned r = pt->rng();
+  if (placement_) {
+    int node = placement_->NodeOfCpu(ThreadingEnvironment::ThisThreadCpu());
+    if (node >= 0) {
+      ArrayRef<int> threads = placement_->NodeThreads(node);
+      return threads[FastReduce(r, threads.size())];
+    }
+  }
+  return FastReduce(r, num_threads_);
+}
+
 template <typename Derived>
 void WorkQueueBase<Derived>::WorkerLoop(int thread_id) {
   PerThread* pt = GetPerThread();
@@ -533,6 +712,15 @@ void WorkQueueBase<Derived>::WorkerLoop(int thread_id) {
   pt->rng = FastRng(ThreadingEnvironment::ThisThreadIdHash());
   pt->thread_id = thread_id;
 
+  // Pinning is best effort: if it fails (e.g. the CPU is not available to the
+  // process), the worker still runs and is treated as part of its node.
+  if (placement_)
+    (void)ThreadingEnvironment::SetThisThreadAffinity(
+        placement_->Cpu(thread_id));
+
+  ThreadCounters& counters = thread_data_[thread_id].counters;
+  counters.start_time.store(NowNanos(), std::memory_order_relaxed);
+
   Queue* q = &(thread_data_[thread_id].queue);
   EventCount::Waiter* waiter = event_count_.waiter(thread_id);
 
@@ -540,7 +728,17 @@ void WorkQueueBase<Derived>::WorkerLoop(int thread_id) {
   // proportional to num_threads_ and we assume that new work is scheduled at
   // a constant rate, so we set spin_count to 5000 / num_threads_. The
   // constant was picked based on a fair dice roll, tune it.
-  const int spin_count = num_threads_ > 0 ? kSpinCount / num_threads_ : 0;
+  const int max_spin_count =
+      spinning_options_.spin_count > 0
+          ? spinning_options_.spin_count
+          : (num_threads_ > 0 ? kSpinCount / num_threads_ : 0);
+  const int min_spin_count = std::min(
+      max_spin_count, std::max(max_spin_count / kAdaptiveSpinRange, 1));
+
+  // Current spin count, adapted to the task arrival rate: if spinning finds
+  // a task, tasks arrive often enough to spin longer next time, otherwise the
+  // spinning was wasted and the next one is shorter.
+  int spin_count = max_spin_count;
 
   while (!cancelled_) {
     Optional<TaskFunction> t = derived_.NextTask(q);
@@ -554,6 +752,14 @@ void WorkQueueBase<Derived>::WorkerLoop(int thread_id) {
             t = Steal();
           }
 
+          IncrementCounter(&counters.num_spins);
+          if (t.hasValue()) IncrementCounter(&counters.num_successful_spins);
+          if (spinning_options_.adaptive) {
+            spin_count = t.hasValue()
+                             ? std::min(2 * spin_count, max_spin_count)
+                             : std::max(spin_count / 2, min_spin_count);
+          }
+
           const bool stopped_spinning = StopSpinning();
           // If a task was submitted to the queue without a call to
           // `event_count_.Notify()`, and we didn't steal anything above, we
@@ -566,7 +772,7 @@ void WorkQueueBase<Derived>::WorkerLoop(int thread_id) {
         }
 
         if (!t.hasValue()) {
-          if (!WaitForWork(waiter, &t)) {
+          if (!WaitForWork(thread_id, waiter, &t)) {
             return;
           }
         }
@@ -574,12 +780,14 @@ void WorkQueueBase<Derived>::WorkerLoop(int thread_id) {
     }
     if (t.hasValue()) {
       (*t)();  // Execute a task.
+      IncrementCounter(&counters.num_tasks_executed);
     }
   }
 }
 
 template <typename Derived>
-bool WorkQueueBase<Derived>::WaitForWork(EventCount::Waiter* waiter,
+bool WorkQueueBase<Derived>::WaitForWork(int thread_id,
+                                         EventCount::Waiter* waiter,
                                          llvm::Optional<TaskFunction>* task) {
   assert(!task->hasValue());
   // We already did best-effort emptiness check in Steal, so prepare for
@@ -593,6 +801,9 @@ bool WorkQueueBase<Derived>::WaitForWork(EventCount::Waiter* waiter,
       return false;
     } else {
       *task = derived_.Steal(&(thread_data_[victim].queue));
+      ThreadCounters& counters = thread_data_[thread_id].counters;
+      IncrementCounter(&counters.num_steal_attempts);
+      if (task->hasValue()) IncrementCounter(&counters.num_successful_steals);
       return true;
     }
   }
@@ -630,20 +841,33 @@ bool WorkQueueBase<Derived>::WaitForWork(EventCount::Waiter* waiter,
     return false;
   }
 
+  ThreadCounters& counters = thread_data_[thread_id].counters;
+  IncrementCounter(&counters.num_parks);
+  const int64_t park_start_time = NowNanos();
+  counters.park_start_time.store(park_start_time, std::memory_order_relaxed);
   event_count_.CommitWait(waiter);
+  counters.park_start_time.store(0, std::memory_order_relaxed);
+  counters.parked_time.store(
+      counters.parked_time.load(std::memory_order_relaxed) + NowNanos() -
+          park_start_time,
+      std::memory_order_relaxed);
+  IncrementCounter(&counters.num_unparks);
   blocked_.fetch_sub(1);
   return true;
 }
 
 template <typename Derived>
 bool WorkQueueBase<Derived>::StartSpinning() {
+  const uint64_t max_spinning_threads = spinning_options_.max_spinning_threads;
+  if (max_spinning_threads == 0) return false;
   if (NumActiveThreads() > kMinActiveThreadsToStartSpinning) return false;
 
   uint64_t spinning = spinning_state_.load(std::memory_order_relaxed);
   for (;;) {
     SpinningState state = SpinningState::Decode(spinning);
 
-    if ((state.num_spinning - state.num_no_notification) >= kMaxSpinningThreads)
+    if ((state.num_spinning - state.num_no_notification) >=
+        max_spinning_threads)
       return false;
 
     // Increment the number of spinning threads.
@@ -697,6 +921,18 @@ bool WorkQueueBase<Derived>::IsNotifyParkedThreadRequired() {
   }
 }
 
+template <typename Derived>
+void WorkQueueBase<Derived>::NotifyParkedThreads(unsigned num_tasks) {
+  for (unsigned i = 0; i < num_tasks; ++i) {
+    // Once a parked thread has to be notified, all the spinning threads are
+    // taken, and each of the remaining tasks needs a parked thread too.
+    if (IsNotifyParkedThreadRequired()) {
+      event_count_.NotifyMany(std::min<unsigned>(num_tasks - i, num_threads_));
+      return;
+    }
+  }
+}
+
 template <typename Derived>
 int WorkQueueBase<Derived>::NonEmptyQueueIndex() {
   PerThread* pt = GetPerThread();
@@ -734,6 +970,61 @@ void WorkQueueBase<Derived>::Cancel() {
   event_count_.Notify(true);
 }
 
+template <typename Derived>
+SpinningStats WorkQueueBase<Derived>::GetSpinningStats() const {
+  SpinningStats stats;
+  for (const ThreadData& thread_data : thread_data_) {
+    const ThreadCounters& counters = thread_data.counters;
+    stats.num_parks += counters.num_parks.load(std::memory_order_relaxed);
+    stats.num_unparks += counters.num_unparks.load(std::memory_order_relaxed);
+    stats.num_spins += counters.num_spins.load(std::memory_order_relaxed);
+    stats.num_successful_spins +=
+        counters.num_successful_spins.load(std::memory_order_relaxed);
+  }
+  return stats;
+}
+
+template <typename Derived>
+std::vector<WorkerThreadStats> WorkQueueBase<Derived>::GetWorkerThreadStats()
+    const {
+  const int64_t now = NowNanos();
+
+  std::vector<WorkerThreadStats> stats(num_threads_);
+  for (int i = 0; i < num_threads_; ++i) {
+    const ThreadData& thread_data = thread_data_[i];
+    const ThreadCounters& counters = thread_data.counters;
+    WorkerThreadStats& thread_stats = stats[i];
+
+    thread_stats.num_tasks_executed =
+        counters.num_tasks_executed.load(std::memory_order_relaxed);
+    thread_stats.num_steal_attempts =
+        counters.num_steal_attempts.load(std::memory_order_relaxed);
+    thread_stats.num_successful_steals =
+        counters.num_successful_steals.load(std::memory_order_relaxed);
+    thread_stats.num_spins = counters.num_spins.load(std::memory_order_relaxed);
+    thread_stats.num_successful_spins =
+        counters.num_successful_spins.load(std::memory_order_relaxed);
+    thread_stats.num_parks = counters.num_parks.load(std::memory_order_relaxed);
+    thread_stats.queue_depth = derived_.Size(&thread_data.queue);
+
+    // The thread might not have started yet.
+    const int64_t start_time =
+        counters.start_time.load(std::memory_order_relaxed);
+    if (start_time == 0) continue;
+
+    int64_t parked_time = counters.parked_time.load(std::memory_order_relaxed);
+    const int64_t park_start_time =
+        counters.park_start_time.load(std::memory_order_relaxed);
+    if (park_start_time != 0) parked_time += now - park_start_time;
+
+    const int64_t lifetime = std::max<int64_t>(now - start_time, 0);
+    parked_time = std::min(std::max<int64_t>(parked_time, 0), lifetime);
+    thread_stats.parked_time = std::chrono::nanoseconds(parked_time);
+    thread_stats.active_time = std::chrono::nanoseconds(lifetime - parked_time);
+  }
+  return stats;
+}
+
 }  // namespace internal
 }  // namespace tfrt
 
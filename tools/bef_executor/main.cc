@@ -66,14 +66,47 @@ static llvm::cl::opt<tfrt::HostAllocatorType> cl_host_allocator_type(  // NOLINT
         clEnumValN(tfrt::HostAllocatorType::kProfiledMalloc,
                    "profiled_allocator", "Malloc with metric profiling."),
         clEnumValN(tfrt::HostAllocatorType::kLeakCheckMalloc,
-                   "leak_check_allocator", "Malloc with memory leak check.")),
+                   "leak_check_allocator", "Malloc with memory leak check."),
+        clEnumValN(tfrt::HostAllocatorType::kSizeClassMalloc,
+                   "size_class_allocator",
+                   "Per-thread size class caches backed by malloc.")),
     llvm::cl::init(tfrt::HostAllocatorType::kLeakCheckMalloc));
 
+static llvm::cl::opt<size_t> cl_parallel_dispatch_threshold(  // NOLINT
+    "parallel_dispatch_threshold",
+    llvm::cl::desc("Dispatch ready kernels to the work queue when more than "
+                   "this number of kernels are ready (0 disables it)"),
+    llvm::cl::init(0));
+
+static llvm::cl::opt<bool> cl_request_arena(  // NOLINT
+    "request_arena",
+    llvm::cl::desc("Allocate the state and the values of each function "
+                   "execution from a request-scoped arena"),
+    llvm::cl::init(false));
+
 // Enable aggregate op handler types to be specified on the command line.
 static llvm::cl::opt<bool> cl_enable_tracing(  // NOLINT
     "enable_tracing", llvm::cl::desc("Enable Performance Tracing"),
     llvm::cl::Optional, llvm::cl::ValueDisallowed);
 
+static llvm::cl::opt<uint32_t> cl_tracing_sampling_period(  // NOLINT
+    "tracing_sampling_period",
+    llvm::cl::desc("Trace one in this number of function executions, even if "
+                   "tracing is not enabled (0 disables it)"),
+    llvm::cl::init(0));
+
+static llvm::cl::opt<bool> cl_profile_kernels(  // NOLINT
+    "profile_kernels",
+    llvm::cl::desc("Print the call count, errors and wall times of each "
+                   "kernel, sorted by total time, after running the functions"),
+    llvm::cl::init(false));
+
+static llvm::cl::opt<std::string> cl_metrics_file(  // NOLINT
+    "metrics_file",
+    llvm::cl::desc("Write the metrics to this file in the Prometheus text "
+                   "format after running the functions"),
+    llvm::cl::init(""));
+
 //===----------------------------------------------------------------------===//
 // Driver main
 //===----------------------------------------------------------------------===//
@@ -90,6 +123,11 @@ int main(int argc, char** argv) {
   run_config.devices = cl_devices;
   run_config.work_queue_type = cl_work_queue_type;
   run_config.host_allocator_type = cl_host_allocator_type;
+  run_config.parallel_dispatch_threshold = cl_parallel_dispatch_threshold;
+  run_config.use_request_arena = cl_request_arena;
+  run_config.tracing_sampling_period = cl_tracing_sampling_period;
+  run_config.profile_kernels = cl_profile_kernels;
+  run_config.metrics_file = cl_metrics_file;
 
   llvm::Optional<tfrt::tracing::TracingRequester> tracing;
   if (cl_enable_tracing) tracing.emplace();